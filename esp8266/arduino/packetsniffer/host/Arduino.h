@@ -0,0 +1,75 @@
+/**
+ * @file    Arduino.h
+ * @brief   Minimal stand-in for the ESP8266 Arduino core, just enough
+ *          to build the sniffer on a host for the replay harness.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "pgmspace.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef uint8_t  uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef int8_t   sint8;
+typedef int16_t  sint16;
+typedef int32_t  sint32;
+
+// Serial port writing to the harness' output, reading from its input
+class HostSerial
+{
+public:
+    void begin( unsigned long baud );
+    size_t print( const char* pText );
+    size_t println( const char* pText );
+    size_t printf( const char* pFormat, ... ) __attribute__(( format( printf, 2, 3 ) ));
+    size_t write( const uint8_t* pData, size_t length );
+    size_t write( uint8_t byte );
+    int available( void );
+    int read( void );
+    void flush( void );
+};
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+extern HostSerial Serial;
+
+unsigned long millis( void );
+unsigned long micros( void );
+void delay( unsigned long ms );
+void yield( void );
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,40 @@
+/**
+ * @file    ESP8266WiFi.h
+ * @brief   Minimal stand-in for the ESP8266WiFi library.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef HOST_ESP8266WIFI_H
+#define HOST_ESP8266WIFI_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <Arduino.h>
+#include <user_interface.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+class HostWiFi
+{
+public:
+    bool disconnect( bool wifiOff = false );
+};
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+extern HostWiFi WiFi;
+
+#endif // HOST_ESP8266WIFI_H
@@ -0,0 +1,485 @@
+/**
+ * @file    HostSdk.cpp
+ * @brief   Host implementation of the Arduino core and SDK functions
+ *          used by the sniffer. Time is virtual and only moves when
+ *          the replay harness says so.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdarg.h>
+#include <deque>
+#include <vector>
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+
+#include "HostSdk.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    FILE*                 pOutput;
+    std::deque<uint8_t>   input;
+    uint64_t              nowUs;
+    os_timer_t*           pTimers;
+    wifi_promiscuous_cb_t pRxCallback;
+    bool                  promiscuous;
+    uint8_t               channel;
+    std::vector<uint8_t>  flash;            // Allocated on first use
+    std::vector<uint32_t> sectorErases;
+    tHostFlashStats       flashStats;
+} tHostSdkVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static os_timer_t* nextDueTimer( uint64_t nowUs );
+static uint8_t* flashAt( uint32_t address, uint32_t size );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tHostSdkVars hostSdkVars = {
+    stdout,
+    std::deque<uint8_t>(),
+    0,
+    NULL,
+    NULL,
+    false,
+    1,
+    std::vector<uint8_t>(),
+    std::vector<uint32_t>(),
+    {}
+};
+
+HostSerial Serial;
+HostWiFi   WiFi;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void HostSdk_SetSerialOutput( FILE* pFile )
+{
+    hostSdkVars.pOutput = pFile;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void HostSdk_QueueSerialInput( const uint8_t* pData, size_t length )
+{
+    hostSdkVars.input.insert( hostSdkVars.input.end(), pData, pData + length );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void HostSdk_AdvanceTo( uint64_t nowUs )
+{
+    os_timer_t* pTimer;
+    while ( ( pTimer = nextDueTimer( nowUs ) ) != NULL )
+    {
+        // Run callback at its due time, it may re-arm itself
+        if ( pTimer->dueUs > hostSdkVars.nowUs )
+        {
+            hostSdkVars.nowUs = pTimer->dueUs;
+        }
+        if ( pTimer->repeat )
+        {
+            pTimer->dueUs += (uint64_t)pTimer->periodMs * 1000;
+        }
+        else
+        {
+            pTimer->armed = false;
+        }
+        pTimer->pFunc( pTimer->pArg );
+    }
+
+    if ( nowUs > hostSdkVars.nowUs )
+    {
+        hostSdkVars.nowUs = nowUs;
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint64_t HostSdk_Now( void )
+{
+    return hostSdkVars.nowUs;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+wifi_promiscuous_cb_t HostSdk_RxCallback( void )
+{
+    return hostSdkVars.promiscuous ? hostSdkVars.pRxCallback : NULL;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint8_t HostSdk_Channel( void )
+{
+    return hostSdkVars.channel;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool HostSdk_LoadFlash( const char* pPath )
+{
+    FILE* pFile = fopen( pPath, "rb" );
+    if ( pFile == NULL )
+    {
+        return true;
+    }
+    bool ok = fread( flashAt( 0, HOST_FLASH_SIZE ), 1, HOST_FLASH_SIZE, pFile ) == HOST_FLASH_SIZE;
+    fclose( pFile );
+    return ok;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool HostSdk_SaveFlash( const char* pPath )
+{
+    FILE* pFile = fopen( pPath, "wb" );
+    if ( pFile == NULL )
+    {
+        return false;
+    }
+    bool ok = fwrite( flashAt( 0, HOST_FLASH_SIZE ), 1, HOST_FLASH_SIZE, pFile ) == HOST_FLASH_SIZE;
+    return fclose( pFile ) == 0 && ok;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void HostSdk_GetFlashStats( tHostFlashStats* pStats )
+{
+    *pStats = hostSdkVars.flashStats;
+
+    uint32_t first = FS_PHYS_ADDR / SPI_FLASH_SEC_SIZE;
+    uint32_t last  = ( FS_PHYS_ADDR + FS_PHYS_SIZE ) / SPI_FLASH_SEC_SIZE;
+    pStats->maxSectorErases = 0;
+    pStats->minSectorErases = UINT32_MAX;
+    for ( uint32_t sector = first; sector < last && !hostSdkVars.sectorErases.empty(); ++sector )
+    {
+        uint32_t erases = hostSdkVars.sectorErases[ sector ];
+        pStats->maxSectorErases = erases > pStats->maxSectorErases ? erases : pStats->maxSectorErases;
+        pStats->minSectorErases = erases < pStats->minSectorErases ? erases : pStats->minSectorErases;
+    }
+    if ( pStats->minSectorErases == UINT32_MAX )
+    {
+        pStats->minSectorErases = 0;
+    }
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Arduino core
+ * ------------------------------------------------------------------
+ */
+
+void HostSerial::begin( unsigned long baud )
+{
+    (void)baud;
+}
+
+size_t HostSerial::print( const char* pText )
+{
+    return write( (const uint8_t*)pText, strlen( pText ) );
+}
+
+size_t HostSerial::println( const char* pText )
+{
+    return print( pText ) + print( "\n" );
+}
+
+size_t HostSerial::printf( const char* pFormat, ... )
+{
+    if ( hostSdkVars.pOutput == NULL )
+    {
+        return 0;
+    }
+
+    va_list args;
+    va_start( args, pFormat );
+    int written = vfprintf( hostSdkVars.pOutput, pFormat, args );
+    va_end( args );
+    return written < 0 ? 0 : (size_t)written;
+}
+
+size_t HostSerial::write( const uint8_t* pData, size_t length )
+{
+    if ( hostSdkVars.pOutput == NULL )
+    {
+        return length;
+    }
+    return fwrite( pData, 1, length, hostSdkVars.pOutput );
+}
+
+size_t HostSerial::write( uint8_t byte )
+{
+    return write( &byte, 1 );
+}
+
+int HostSerial::available( void )
+{
+    return (int)hostSdkVars.input.size();
+}
+
+int HostSerial::read( void )
+{
+    if ( hostSdkVars.input.empty() )
+    {
+        return -1;
+    }
+    uint8_t byte = hostSdkVars.input.front();
+    hostSdkVars.input.pop_front();
+    return byte;
+}
+
+void HostSerial::flush( void )
+{
+    if ( hostSdkVars.pOutput != NULL )
+    {
+        fflush( hostSdkVars.pOutput );
+    }
+}
+
+unsigned long millis( void )
+{
+    return (unsigned long)( hostSdkVars.nowUs / 1000 );
+}
+
+unsigned long micros( void )
+{
+    return (unsigned long)hostSdkVars.nowUs;
+}
+
+void delay( unsigned long ms )
+{
+    HostSdk_AdvanceTo( hostSdkVars.nowUs + (uint64_t)ms * 1000 );
+}
+
+void yield( void )
+{
+    // Nothing else runs on the host
+}
+
+/**
+ * ------------------------------------------------------------------
+ * ESP8266WiFi library
+ * ------------------------------------------------------------------
+ */
+
+bool HostWiFi::disconnect( bool wifiOff )
+{
+    (void)wifiOff;
+    return true;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * SDK
+ * ------------------------------------------------------------------
+ */
+
+bool wifi_set_opmode( uint8_t mode )
+{
+    (void)mode;
+    return true;
+}
+
+void wifi_promiscuous_enable( uint8_t enable )
+{
+    hostSdkVars.promiscuous = enable != 0;
+}
+
+void wifi_set_promiscuous_rx_cb( wifi_promiscuous_cb_t pCallback )
+{
+    hostSdkVars.pRxCallback = pCallback;
+}
+
+bool wifi_set_channel( uint8_t channel )
+{
+    hostSdkVars.channel = channel;
+    return true;
+}
+
+uint8_t wifi_get_channel( void )
+{
+    return hostSdkVars.channel;
+}
+
+void os_timer_setfn( os_timer_t* pTimer, os_timer_func_t* pFunc, void* pArg )
+{
+    os_timer_disarm( pTimer );
+    pTimer->pFunc = pFunc;
+    pTimer->pArg  = pArg;
+}
+
+void os_timer_arm( os_timer_t* pTimer, uint32_t ms, bool repeat )
+{
+    // Link in on first use
+    os_timer_t* pIter = hostSdkVars.pTimers;
+    while ( pIter != NULL && pIter != pTimer )
+    {
+        pIter = pIter->pNext;
+    }
+    if ( pIter == NULL )
+    {
+        pTimer->pNext       = hostSdkVars.pTimers;
+        hostSdkVars.pTimers = pTimer;
+    }
+
+    pTimer->dueUs    = hostSdkVars.nowUs + (uint64_t)ms * 1000;
+    pTimer->periodMs = ms;
+    pTimer->repeat   = repeat;
+    pTimer->armed    = true;
+}
+
+void os_timer_disarm( os_timer_t* pTimer )
+{
+    pTimer->armed = false;
+}
+
+SpiFlashOpResult spi_flash_erase_sector( uint16_t sector )
+{
+    uint8_t* pSector = flashAt( (uint32_t)sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE );
+    if ( pSector == NULL )
+    {
+        ++hostSdkVars.flashStats.errors;
+        return SPI_FLASH_RESULT_ERR;
+    }
+    memset( pSector, 0xFF, SPI_FLASH_SEC_SIZE );
+    ++hostSdkVars.sectorErases[ sector ];
+    ++hostSdkVars.flashStats.erases;
+    hostSdkVars.flashStats.busyUs += HOST_FLASH_ERASE_US;
+    return SPI_FLASH_RESULT_OK;
+}
+
+SpiFlashOpResult spi_flash_write( uint32_t address, uint32_t* pSource, uint32_t size )
+{
+    uint8_t* pFlash = flashAt( address, size );
+    if ( pFlash == NULL || ( address & 3 ) != 0 || ( size & 3 ) != 0 || ( (uintptr_t)pSource & 3 ) != 0 )
+    {
+        ++hostSdkVars.flashStats.errors;
+        return SPI_FLASH_RESULT_ERR;
+    }
+
+    // NOR flash: programming only ever clears bits
+    const uint8_t* pBytes = (const uint8_t*)pSource;
+    for ( uint32_t i = 0; i < size; ++i )
+    {
+        pFlash[ i ] &= pBytes[ i ];
+    }
+
+    uint64_t pages = size == 0 ? 0 : ( address + size - 1 ) / HOST_FLASH_PAGE_LEN - address / HOST_FLASH_PAGE_LEN + 1;
+    hostSdkVars.flashStats.bytesWritten += size;
+    hostSdkVars.flashStats.pagesWritten += pages;
+    hostSdkVars.flashStats.busyUs       += pages * HOST_FLASH_PAGE_US;
+    return SPI_FLASH_RESULT_OK;
+}
+
+SpiFlashOpResult spi_flash_read( uint32_t address, uint32_t* pDestination, uint32_t size )
+{
+    const uint8_t* pFlash = flashAt( address, size );
+    if ( pFlash == NULL || ( address & 3 ) != 0 || ( (uintptr_t)pDestination & 3 ) != 0 )
+    {
+        ++hostSdkVars.flashStats.errors;
+        return SPI_FLASH_RESULT_ERR;
+    }
+    memcpy( pDestination, pFlash, size );
+    hostSdkVars.flashStats.bytesRead += size;
+    return SPI_FLASH_RESULT_OK;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static os_timer_t* nextDueTimer( uint64_t nowUs )
+{
+    os_timer_t* pDue = NULL;
+    for ( os_timer_t* pTimer = hostSdkVars.pTimers; pTimer != NULL; pTimer = pTimer->pNext )
+    {
+        if ( pTimer->armed && pTimer->dueUs <= nowUs && ( pDue == NULL || pTimer->dueUs < pDue->dueUs ) )
+        {
+            pDue = pTimer;
+        }
+    }
+    return pDue;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint8_t* flashAt( uint32_t address, uint32_t size )
+{
+    // Erased chip until written
+    if ( hostSdkVars.flash.empty() )
+    {
+        hostSdkVars.flash.assign( HOST_FLASH_SIZE, 0xFF );
+        hostSdkVars.sectorErases.assign( HOST_FLASH_SIZE / SPI_FLASH_SEC_SIZE, 0 );
+    }
+    if ( address > HOST_FLASH_SIZE || size > HOST_FLASH_SIZE - address )
+    {
+        return NULL;
+    }
+    return &hostSdkVars.flash[ address ];
+}
@@ -0,0 +1,132 @@
+/**
+ * @file    HostSdk.h
+ * @brief   Control side of the host stand-ins, used by the replay
+ *          harness to drive the virtual clock, timers, promiscuous
+ *          RX callback and serial port.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef HOSTSDK_H
+#define HOSTSDK_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdio.h>
+
+#include <user_interface.h>
+#include <spi_flash.h>
+#include <flash_hal.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Typical busy times of a 4 MB SPI NOR flash (W25Q32 datasheet), used
+// to model how long the device would spend in spi_flash_*()
+#define HOST_FLASH_ERASE_US     45000   // 4 kB sector
+#define HOST_FLASH_PAGE_US      700     // Program 256 byte page
+#define HOST_FLASH_PAGE_LEN     256
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+// Emulated flash counters since start
+typedef struct
+{
+    uint64_t bytesWritten;      // Programmed
+    uint64_t bytesRead;
+    uint64_t pagesWritten;      // Pages touched by writes
+    uint32_t erases;
+    uint32_t maxSectorErases;   // Within the filesystem area
+    uint32_t minSectorErases;   // Within the filesystem area
+    uint32_t errors;            // Misaligned or out of range
+    uint64_t busyUs;            // Modelled device time in erase and program
+} tHostFlashStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Set where Serial output goes.
+ *
+ * @param  pFile Output file, NULL to discard
+ */
+void HostSdk_SetSerialOutput( FILE* pFile );
+
+/**
+ * Queue bytes to be returned by Serial.read().
+ *
+ * @param  pData  Bytes
+ * @param  length Number of bytes
+ */
+void HostSdk_QueueSerialInput( const uint8_t* pData, size_t length );
+
+/**
+ * Move the virtual clock forward, firing timers that fall due on the
+ * way in order. The clock never moves backwards.
+ *
+ * @param  nowUs Virtual time in microseconds
+ */
+void HostSdk_AdvanceTo( uint64_t nowUs );
+
+/**
+ * Get virtual time.
+ *
+ * @return Microseconds since start
+ */
+uint64_t HostSdk_Now( void );
+
+/**
+ * Get RX callback registered by the sniffer, only when promiscuous
+ * mode is enabled.
+ *
+ * @return Callback, NULL if none or promiscuous mode disabled.
+ */
+wifi_promiscuous_cb_t HostSdk_RxCallback( void );
+
+/**
+ * Get channel the sniffer has tuned to.
+ *
+ * @return Channel
+ */
+uint8_t HostSdk_Channel( void );
+
+/**
+ * Load the emulated flash from an image file, e.g. one saved by an
+ * earlier run. A missing file leaves the flash erased.
+ *
+ * @param  pPath Image file, HOST_FLASH_SIZE bytes
+ * @return FALSE if the file exists but can't be read.
+ */
+bool HostSdk_LoadFlash( const char* pPath );
+
+/**
+ * Save the emulated flash to an image file.
+ *
+ * @param  pPath Image file
+ * @return FALSE on write error.
+ */
+bool HostSdk_SaveFlash( const char* pPath );
+
+/**
+ * Get emulated flash counters.
+ *
+ * @param  pStats Output
+ */
+void HostSdk_GetFlashStats( tHostFlashStats* pStats );
+
+#endif // HOSTSDK_H
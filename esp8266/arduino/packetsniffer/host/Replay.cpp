@@ -0,0 +1,2758 @@
+/**
+ * @file    Replay.cpp
+ * @brief   Host replay harness. Feeds frames from pcap files through
+ *          the sniffer's RX callback and loop() as fast as possible
+ *          on a virtual clock, then reports throughput and per-frame
+ *          callback cost.
+ *
+ *          Build and run through PlatformIO:
+ *            pio run -e native
+ *            .pio/build/native/program [options] capture.pcap ...
+ *
+ *          Supported link types are raw 802.11 (105) and radiotap
+ *          (127). Radiotap RSSI, rate, MCS and channel are mapped
+ *          onto rx_ctrl, raw 802.11 frames get --channel and a fixed
+ *          RSSI. Frames radiotap marks as one A-MPDU are delivered in
+ *          a single callback, as the SDK does.
+ *
+ *          --bench-filter times the capture filter on its own, running
+ *          it FILTER_BENCH_REPEAT times per frame. Load the filter to
+ *          measure with --command "$(tools/snifferfilter.py EXPR)".
+ *
+ *          --bench-parse times IFrameView over the whole frames read
+ *          from the pcap files (not just what the SDK would capture):
+ *          every header field and every element of management frames.
+ *
+ *          --fuzz-parse SEED generates FUZZ_PARSE_FRAMES frames from
+ *          SEED, random bytes and frames of every type with random
+ *          flags and elements whose lengths may run past the end, and
+ *          runs every IFrameView accessor and the sniffer's element
+ *          parsers over each prefix of them, copied to a buffer of
+ *          exactly that size. Fails if an accessor returns bytes past
+ *          the prefix or a prefix disagrees with the whole frame, and
+ *          exits. The same SEED replays the same frames; build with
+ *          -fsanitize=address,undefined to catch stray reads as well.
+ *
+ *          Built with -DFLASH_LOG=1 the sniffer logs to an emulated
+ *          flash (see host/spi_flash.h) and the report adds what the
+ *          log wrote: compression, write amplification, erase spread
+ *          and the frame rate the device's flash could sustain.
+ *          --flash keeps the flash in an image file between runs, to
+ *          read a log back with --command dump.
+ *
+ *          --bench-oui times vendor lookups (src/Oui) of the transmitter
+ *          addresses in the pcap files, in the order they were heard,
+ *          and reports the vendor table's flash footprint.
+ *
+ *          --bench-probes times the device estimate (src/ProbeClusters)
+ *          over the probe requests in the pcap files, cut as the SDK
+ *          cuts management frames, and reports what it made of them.
+ *          Replay a trace from tools/probesim.py to see how close the
+ *          estimate gets to the devices that made it.
+ *
+ *          --compare-hop runs the channel hopping scheduler (src/
+ *          ChannelHop) over the frames of the pcap files twice, with
+ *          fixed and with adaptive dwell times, and reports the share of
+ *          frames and of transmitters each would have caught. Frames
+ *          count where the scheduler was tuned to their channel when
+ *          they were sent. tools/hopsim.py writes synthetic traffic
+ *          for it.
+ *
+ *          --bench-classify classifies a synthetic frame mix both the
+ *          way the sniffer first did, expanding the frame control field
+ *          into a struct with expandFrameControl() and building the
+ *          counter slot from type and subtype, and with the IFrameClass
+ *          table, checks that both count the same and exits.
+ *
+ *          --bench-stations inserts 64 to 10k transmitter addresses
+ *          into the station table (src/StationTable), random ones and
+ *          ones counting up under one OUI, and then updates them in
+ *          random order, reports ns per insert and per update, how many
+ *          stations the table could hold and how many it evicted, and
+ *          exits. Below the table size nothing should be evicted.
+ *          The table has STATION_TABLE_SLOTS slots, build with e.g.
+ *          -DSTATION_TABLE_SLOTS=16384 to try other sizes.
+ *
+ *          --bench-ring pushes RING_BENCH_RECORDS probe requests into
+ *          the capture ring (src/CaptureRing) from a producer thread,
+ *          standing in for the RX callback, while the main thread
+ *          drains them: once with nothing but the ring's own consumer
+ *          calls, once through loop() as the sniffer does. The
+ *          producer tries again when the ring is full, so every record
+ *          gets through; reports records per second and how often the
+ *          producer found the ring full (a drop on the device), and
+ *          exits.
+ *
+ *          --check-airtime compares the sniffer's table driven frame
+ *          durations (src/Airtime) for every rate, MCS, bandwidth, guard
+ *          interval and length with the PHY timing equations worked
+ *          out from the modulation parameters, and exits.
+ *
+ *          --check-hll adds 10 to 1M distinct addresses to the distinct
+ *          device sketch (src/DistinctDevices), random ones and ones
+ *          counting up under one OUI, HLL_CHECK_RUNS times each, then
+ *          the same addresses again. Fails if the root mean square
+ *          relative error of a size exceeds HLL_CHECK_RMS times the
+ *          standard error 1.04 / sqrt( HLL_REGISTERS ), a single run
+ *          exceeds HLL_CHECK_MAX times it, or repeats move the
+ *          estimate. Reports the errors and ns per update. Build with
+ *          e.g. -DHLL_PRECISION=10 to check other sketch sizes.
+ *
+ *          --check-beacons runs the beacon detector (src/BeaconDetector)
+ *          through scenarios of BEACON_CHECK_MS each, heard by a
+ *          sniffer hopping channels 1 to 13: a 6 access point ESS on
+ *          channels 1, 6 and 11 among 48 networks of one access point,
+ *          more SSIDs than the index holds, on its own and with a
+ *          beacon flood, open twins of the ESS, a clone of one of its
+ *          access points on another channel, and new access points for
+ *          it on channels it uses and doesn't, twins and new access
+ *          points again within and after BEACON_REARM_MS. Beacons go through
+ *          the access point inventory's parser as on the device.
+ *          Exits non-zero unless every scenario raises the alarms it
+ *          is expected to.
+ *
+ *          --check-aps beacons AP_CHECK_APS access points to the access
+ *          point inventory (src/ApInventory): the BSSIDs tools/hopsim.py
+ *          uses, then ones under one OUI counting up in the fourth and
+ *          in the sixth byte. Exits non-zero unless every one of them
+ *          is inserted once and none is evicted.
+ *
+ *          --check-deauth injects synthetic deauthentication traffic
+ *          into the flood detector (src/DeauthDetector) on a virtual
+ *          clock: a burst started at every millisecond of a window,
+ *          so it crosses bucket and second boundaries, must alarm on
+ *          its DEAUTH_ALARM_LEVEL'th frame; a steady trickle must not;
+ *          two interleaved attackers must raise an alarm each; a flood
+ *          from random sources must raise one flood alarm on its
+ *          DEAUTH_FLOOD_LEVEL'th frame and no tuple alarm; frames cut
+ *          before addr3 must be skipped. Reports the alarm latency,
+ *          ns per frame and bytes per tuple, and exits non-zero if any
+ *          case fails.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+
+#include <SnifferBuf/ISnifferBuf.h>
+#include <CaptureRing/ICaptureRing.h>
+#include <CaptureFilter/ICaptureFilter.h>
+#include <FrameView/IFrameView.h>
+#include <FlashLog/IFlashLog.h>
+#include <Airtime/IAirtime.h>
+#include <Oui/IOui.h>
+#include <ProbeClusters/IProbeClusters.h>
+#include <ChannelHop/IChannelHop.h>
+#include <StationTable/IStationTable.h>
+#include <DeauthDetector/IDeauthDetector.h>
+#include <DistinctDevices/IDistinctDevices.h>
+#include <ProbeSsids/IProbeSsids.h>
+#include <ApInventory/IApInventory.h>
+#include <BeaconDetector/IBeaconDetector.h>
+
+#include "HostSdk.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#define LINKTYPE_IEEE802_11             105
+#define LINKTYPE_IEEE802_11_RADIOTAP    127
+
+// Radiotap flags field
+#define RADIOTAP_FLAG_FCS               0x10
+
+// Radiotap A-MPDU status flags
+#define RADIOTAP_AMPDU_LAST_KNOWN       0x0004
+#define RADIOTAP_AMPDU_IS_LAST          0x0008
+
+// A-MPDU subframe delimiter, subframes are padded to 4 bytes
+#define AMPDU_DELIMITER_LEN             4
+
+// Virtual time to run after the last frame so the final report is out
+#define DRAIN_TIME_US                   2000000
+#define DRAIN_STEP_US                   10000
+
+// loop() runs back to back on the device, work done a piece per call
+// (a flash log dump) needs more than one call per step to finish
+#define DRAIN_LOOPS_PER_STEP            64
+
+// Filter runs per frame with --bench-filter, enough to swamp the
+// cost of reading the clock
+#define FILTER_BENCH_REPEAT             256
+
+// Frames --fuzz-parse generates, the longest, and failures it lists
+// before it only counts them
+#define FUZZ_PARSE_FRAMES               50000
+#define FUZZ_FRAME_MAX_LEN              600
+#define FUZZ_REPORT                     10
+
+// Parses per frame with --bench-parse
+#define PARSE_BENCH_REPEAT              64
+
+// Passes over the transmitter addresses with --bench-oui
+#define OUI_BENCH_REPEAT                16
+
+// Passes over the probe requests with --bench-probes
+#define PROBE_BENCH_REPEAT              16
+
+// Channels --compare-hop hops across, as HOP_CHANNELS in main.cpp
+#define HOP_COMPARE_CHANNELS            { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 }
+
+// Frames in the --bench-classify mix, and passes over them
+#define CLASSIFY_BENCH_FRAMES           65536
+#define CLASSIFY_BENCH_REPEAT           256
+
+// Distinct stations --bench-stations tries, and updates per run
+#define STATION_BENCH_COUNTS            { 64, 128, 1000, 2000, 5000, 10000 }
+#define STATION_BENCH_UPDATES           1000000
+
+// Records the producer thread offers with --bench-ring
+#define RING_BENCH_RECORDS              1000000
+
+// --check-beacons: scenario length, when the attacks start, the
+// sniffer's dwell per channel and networks around besides the ESS
+#define BEACON_CHECK_MS                 120000
+#define BEACON_CHECK_ATTACK_MS          70000
+#define BEACON_CHECK_DWELL_MS           200
+#define BEACON_CHECK_NETWORKS           48
+
+// --check-aps: access points, and beacons heard from each
+#define AP_CHECK_APS                    10
+#define AP_CHECK_BEACONS                1000
+
+// --check-deauth: gap between frames of a burst, of the trickle that
+// stays below the alarm level and of a flood from random sources
+#define DEAUTH_CHECK_BURST_MS           40
+#define DEAUTH_CHECK_TRICKLE_MS         300
+#define DEAUTH_CHECK_SPREAD_MS          50
+#define DEAUTH_CHECK_FRAMES             1000000
+
+// --check-hll: runs per size, and the bounds on the relative error in
+// standard errors
+#define HLL_CHECK_SIZES                 { 10, 100, 1000, 10000, 100000, 1000000 }
+#define HLL_CHECK_RUNS                  32
+#define HLL_CHECK_RMS                   1.5
+#define HLL_CHECK_MAX                   4.0
+
+// Mismatches listed by --check-airtime before it only counts them,
+// HT MCS it tries
+#define AIRTIME_CHECK_REPORT            10
+#define AIRTIME_CHECK_MCS               18
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    bool     swapped;
+    bool     nanoseconds;
+    uint32_t linkType;
+} tPcapFile;
+
+typedef struct
+{
+    int8_t   rssi;
+    uint8_t  channel;
+    uint8_t  rate;          // rx_ctrl encoding
+    bool     ht;
+    uint8_t  mcs;
+    bool     wide;
+    bool     shortGi;
+    bool     ampdu;         // Part of an A-MPDU
+    uint32_t ampduReference;
+    bool     ampduLast;
+} tRxInfo;
+
+// Frames going into one callback, more than one for an A-MPDU
+typedef struct
+{
+    tRxInfo              info;      // Of the first frame
+    std::vector<uint8_t> first;     // Bytes of the first frame the SDK would pass on
+    uint32_t             firstLength;
+    tAmpduInfo           entries[ SNIFFER_MAX_MPDUS ];
+    uint16_t             count;
+} tAggregate;
+
+// Probe request collected for --bench-probes
+typedef struct
+{
+    uint32_t timeMs;        // Virtual time heard
+    uint16_t captured;
+    uint16_t length;        // On-air, FCS included
+    uint8_t  frame[ SNIFFER_BUF2_LEN ];
+} tProbeSample;
+
+// Frame collected for --compare-hop
+typedef struct
+{
+    uint32_t timeMs;        // Virtual time sent
+    uint8_t  channel;
+    uint64_t transmitter;   // addr2, 0 if the frame has none
+} tHopSample;
+
+// Frame control field expanded a byte per bit, as the sniffer had it
+// before src/FrameClass
+typedef struct
+{
+    uint8_t protocol;
+    uint8_t type;
+    uint8_t subtype;
+    uint8_t toDS;
+    uint8_t fromDS;
+    uint8_t moreFragments;
+    uint8_t retry;
+    uint8_t powerManagement;
+    uint8_t moreData;
+    uint8_t protectedBit;
+    uint8_t order;
+} tFrameControl;
+
+// Access point beaconing in a --check-beacons scenario
+typedef struct
+{
+    uint8_t     bssid[ 6 ];
+    const char* pSsid;
+    uint8_t     channel;
+    bool        rsn;
+    uint32_t    startMs;
+    uint32_t    nextUs;     // Next beacon
+} tBeaconCheckAp;
+
+// What IFrameView made of a frame, offsets from its start, -1 absent
+typedef struct
+{
+    bool     valid;
+    uint8_t  headerLength;
+    int32_t  address[ 4 ];
+    int32_t  sequence;
+    int32_t  qos;
+    int32_t  body;
+    bool     hasIes;
+    bool     iesComplete;
+    uint16_t ieCount;
+    struct
+    {
+        uint16_t offset;
+        uint8_t  id;
+        uint8_t  length;
+        uint8_t  available;
+    } ies[ FUZZ_FRAME_MAX_LEN / 2 ];
+} tFuzzView;
+
+typedef struct
+{
+    uint8_t  defaultChannel;
+    bool     tunedOnly;
+    bool     quiet;
+    bool     benchFilter;
+    bool     benchParse;
+    bool     benchOui;
+    bool     benchProbes;
+    bool     compareHop;
+    const char* pFlashImage;
+} tReplayOptions;
+
+typedef struct
+{
+    uint64_t frames;        // Frames read from pcap files
+    uint64_t delivered;     // Callbacks, an A-MPDU is one
+    uint64_t aggregates;    // Callbacks carrying an A-MPDU
+    uint64_t missed;        // Frames on a channel the radio wasn't tuned to
+    uint64_t skipped;       // Unusable records
+    uint64_t callbackNs;
+    uint64_t callbackCycles;
+    uint64_t maxCallbackNs;
+    uint64_t filterNs;      // FILTER_BENCH_REPEAT runs per frame
+    uint64_t filterAccepted;
+    uint64_t parseNs;       // PARSE_BENCH_REPEAT parses per frame
+    uint64_t parseFrames;
+    uint64_t parseBytes;
+    uint64_t parseIes;
+} tReplayStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+// Sniffer entry points, from main.cpp
+void setup( void );
+void loop( void );
+
+static bool replayFile( const char* pPath, const tReplayOptions* pOptions, tReplayStats* pStats, uint64_t* pBaseUs );
+static void addFrame( tAggregate* pAggregate, const uint8_t* pFrame, uint32_t length, const tRxInfo* pInfo );
+static void deliverFrame( tAggregate* pAggregate, const tReplayOptions* pOptions, tReplayStats* pStats );
+static void benchFilter( const uint8_t* pBuffer, uint16_t length, tReplayStats* pStats );
+static void benchParse( const uint8_t* pFrame, uint32_t length, tReplayStats* pStats );
+static void benchOui( void );
+static void benchProbes( void );
+static void benchRing( void );
+static void benchStations( void );
+static void compareHop( void );
+static bool benchClassify( void );
+static void expandFrameControl( const uint8_t frameBytes[ 2 ], tFrameControl* pFrameControl );
+static uint32_t parseFrame( const uint8_t* pFrame, uint16_t length );
+static bool fuzzParse( uint32_t seed );
+static uint16_t fuzzFrame( uint32_t* pRandom, uint8_t* pFrame );
+static const char* viewFrame( const uint8_t* pFrame, uint16_t captured, tFuzzView* pView );
+static const char* compareViews( const tFuzzView* pPrefix, const tFuzzView* pWhole, uint16_t captured );
+static uint32_t nextRandom( uint32_t* pRandom );
+static bool parseRadiotap( const uint8_t* pData, uint32_t length, tRxInfo* pInfo, uint32_t* pHeaderLength, bool* pHasFcs );
+static uint8_t rateToRxControl( uint8_t rate500k );
+static uint8_t frequencyToChannel( uint16_t frequency );
+static uint32_t read32( const uint8_t* pData, bool swapped );
+static uint64_t readCycles( void );
+static bool checkAirtime( void );
+static bool checkDeauth( void );
+static bool checkBeacons( void );
+static bool checkAps( void );
+static uint16_t beaconFrame( uint8_t* pFrame, const uint8_t* pBssid, const char* pSsid, uint8_t channel, bool rsn );
+static bool checkHll( void );
+static uint64_t hllCheckAddress( uint64_t index, uint64_t seed, bool sequential );
+static void deauthFrame( uint8_t pFrame[ 26 ], uint8_t source, uint8_t target );
+static double referenceAirtime( const tRxControl* pRx, uint32_t length );
+#if FLASH_LOG
+static void reportFlashLog( void );
+#endif
+static void usage( const char* pName );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+// rx_ctrl rate encoding to 500 kbps units (0 = unused code)
+static const uint8_t rxControlRates[ 16 ] = { 2, 4, 11, 22, 0, 4, 11, 22, 96, 48, 24, 12, 108, 72, 36, 18 };
+
+// Transmitter addresses collected for --bench-oui, 6 bytes each
+static std::vector<uint8_t> ouiBenchMacs;
+
+// Probe requests collected for --bench-probes, in the order heard
+static std::vector<tProbeSample> probeBenchFrames;
+
+// Frames collected for --compare-hop, in the order sent
+static std::vector<tHopSample> hopCompareFrames;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+int main( int argc, char** argv )
+{
+    tReplayOptions options = { 1, false, false, false, false, false, false, false, NULL };
+    std::vector<const char*> files;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( strcmp( argv[ i ], "--channel" ) == 0 && i + 1 < argc )
+        {
+            options.defaultChannel = (uint8_t)atoi( argv[ ++i ] );
+        }
+        else if ( strcmp( argv[ i ], "--tuned-only" ) == 0 )
+        {
+            options.tunedOnly = true;
+        }
+        else if ( strcmp( argv[ i ], "--quiet" ) == 0 )
+        {
+            options.quiet = true;
+        }
+        else if ( strcmp( argv[ i ], "--bench-filter" ) == 0 )
+        {
+            options.benchFilter = true;
+        }
+        else if ( strcmp( argv[ i ], "--bench-parse" ) == 0 )
+        {
+            options.benchParse = true;
+        }
+        else if ( strcmp( argv[ i ], "--bench-oui" ) == 0 )
+        {
+            options.benchOui = true;
+        }
+        else if ( strcmp( argv[ i ], "--bench-probes" ) == 0 )
+        {
+            options.benchProbes = true;
+        }
+        else if ( strcmp( argv[ i ], "--compare-hop" ) == 0 )
+        {
+            options.compareHop = true;
+        }
+        else if ( strcmp( argv[ i ], "--bench-classify" ) == 0 )
+        {
+            return benchClassify() ? 0 : 1;
+        }
+        else if ( strcmp( argv[ i ], "--bench-stations" ) == 0 )
+        {
+            benchStations();
+            return 0;
+        }
+        else if ( strcmp( argv[ i ], "--bench-ring" ) == 0 )
+        {
+            benchRing();
+            return 0;
+        }
+        else if ( strcmp( argv[ i ], "--check-airtime" ) == 0 )
+        {
+            return checkAirtime() ? 0 : 1;
+        }
+        else if ( strcmp( argv[ i ], "--check-hll" ) == 0 )
+        {
+            return checkHll() ? 0 : 1;
+        }
+        else if ( strcmp( argv[ i ], "--check-beacons" ) == 0 )
+        {
+            return checkBeacons() ? 0 : 1;
+        }
+        else if ( strcmp( argv[ i ], "--check-aps" ) == 0 )
+        {
+            return checkAps() ? 0 : 1;
+        }
+        else if ( strcmp( argv[ i ], "--check-deauth" ) == 0 )
+        {
+            return checkDeauth() ? 0 : 1;
+        }
+        else if ( strcmp( argv[ i ], "--fuzz-parse" ) == 0 && i + 1 < argc )
+        {
+            return fuzzParse( (uint32_t)strtoul( argv[ ++i ], NULL, 0 ) ) ? 0 : 1;
+        }
+        else if ( strcmp( argv[ i ], "--flash" ) == 0 && i + 1 < argc )
+        {
+            options.pFlashImage = argv[ ++i ];
+        }
+        else if ( strcmp( argv[ i ], "--command" ) == 0 && i + 1 < argc )
+        {
+            const char* pCommand = argv[ ++i ];
+            HostSdk_QueueSerialInput( (const uint8_t*)pCommand, strlen( pCommand ) );
+            HostSdk_QueueSerialInput( (const uint8_t*)"\n", 1 );
+        }
+        else if ( argv[ i ][ 0 ] == '-' )
+        {
+            usage( argv[ 0 ] );
+            return 1;
+        }
+        else
+        {
+            files.push_back( argv[ i ] );
+        }
+    }
+    if ( files.empty() )
+    {
+        usage( argv[ 0 ] );
+        return 1;
+    }
+
+    if ( options.pFlashImage != NULL && !HostSdk_LoadFlash( options.pFlashImage ) )
+    {
+        fprintf( stderr, "%s: can't read flash image\n", options.pFlashImage );
+        return 1;
+    }
+
+    HostSdk_SetSerialOutput( options.quiet ? NULL : stdout );
+    setup();
+
+    // Handle --command before the first frame, like a device started
+    // ahead of the capture
+    loop();
+
+    tReplayStats stats;
+    memset( &stats, 0, sizeof( stats ) );
+    uint64_t baseUs = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for ( size_t i = 0; i < files.size(); ++i )
+    {
+        if ( !replayFile( files[ i ], &options, &stats, &baseUs ) )
+        {
+            return 1;
+        }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    // Let timers and the final report run, regardless of --quiet
+    HostSdk_SetSerialOutput( stdout );
+    uint64_t drainEnd = HostSdk_Now() + DRAIN_TIME_US;
+    while ( HostSdk_Now() < drainEnd )
+    {
+        HostSdk_AdvanceTo( HostSdk_Now() + DRAIN_STEP_US );
+        for ( uint16_t i = 0; i < DRAIN_LOOPS_PER_STEP; ++i )
+        {
+            loop();
+        }
+    }
+    fflush( stdout );
+
+    if ( options.pFlashImage != NULL && !HostSdk_SaveFlash( options.pFlashImage ) )
+    {
+        fprintf( stderr, "%s: can't write flash image\n", options.pFlashImage );
+        return 1;
+    }
+
+    double wallSeconds = std::chrono::duration<double>( end - start ).count();
+    double delivered   = stats.delivered > 0 ? (double)stats.delivered : 1.0;
+    fprintf( stderr, "\nREPLAY     %llu frames, %llu delivered (%llu A-MPDUs), %llu on other channels, %llu skipped\n",
+        (unsigned long long)stats.frames,
+        (unsigned long long)stats.delivered,
+        (unsigned long long)stats.aggregates,
+        (unsigned long long)stats.missed,
+        (unsigned long long)stats.skipped );
+    fprintf( stderr, "           %.3f s wall, %.0f frames/s (callback + loop)\n",
+        wallSeconds, wallSeconds > 0 ? stats.frames / wallSeconds : 0.0 );
+    fprintf( stderr, "CALLBACK   %.1f ns/frame avg, %llu ns max, %.0f cycles/frame avg\n",
+        stats.callbackNs / delivered,
+        (unsigned long long)stats.maxCallbackNs,
+        stats.callbackCycles / delivered );
+    if ( options.benchFilter )
+    {
+        fprintf( stderr, "FILTER     %.1f ns/frame avg, %.1f%% accepted\n",
+            stats.filterNs / ( delivered * FILTER_BENCH_REPEAT ),
+            100.0 * stats.filterAccepted / delivered );
+    }
+    if ( options.benchParse && stats.parseFrames > 0 )
+    {
+        double parseSeconds = stats.parseNs / 1e9;
+        fprintf( stderr, "PARSE      %.1f ns/frame avg, %.0f MB/s, %.1f elements/frame\n",
+            stats.parseNs / ( (double)stats.parseFrames * PARSE_BENCH_REPEAT ),
+            parseSeconds > 0 ? stats.parseBytes * (double)PARSE_BENCH_REPEAT / parseSeconds / 1e6 : 0.0,
+            stats.parseIes / (double)stats.parseFrames );
+    }
+    if ( options.benchOui )
+    {
+        benchOui();
+    }
+    if ( options.benchProbes )
+    {
+        benchProbes();
+    }
+    if ( options.compareHop )
+    {
+        compareHop();
+    }
+#if FLASH_LOG
+    reportFlashLog();
+#endif
+    if ( stats.frames > 0 )
+    {
+        fprintf( stderr, "COVERAGE   %.1f%% of frames on the tuned channel\n",
+            100.0 * ( stats.frames - stats.skipped - stats.missed ) / (double)stats.frames );
+    }
+
+    return 0;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool replayFile( const char* pPath, const tReplayOptions* pOptions, tReplayStats* pStats, uint64_t* pBaseUs )
+{
+    FILE* pFile = fopen( pPath, "rb" );
+    if ( pFile == NULL )
+    {
+        fprintf( stderr, "%s: can't open\n", pPath );
+        return false;
+    }
+
+    uint8_t header[ 24 ];
+    if ( fread( header, 1, sizeof( header ), pFile ) != sizeof( header ) )
+    {
+        fprintf( stderr, "%s: not a pcap file\n", pPath );
+        fclose( pFile );
+        return false;
+    }
+
+    tPcapFile pcap;
+    uint32_t  magic = read32( header, false );
+    switch ( magic )
+    {
+        case 0xA1B2C3D4: pcap.swapped = false; pcap.nanoseconds = false; break;
+        case 0xD4C3B2A1: pcap.swapped = true;  pcap.nanoseconds = false; break;
+        case 0xA1B23C4D: pcap.swapped = false; pcap.nanoseconds = true;  break;
+        case 0x4D3CB2A1: pcap.swapped = true;  pcap.nanoseconds = true;  break;
+        default:
+        {
+            fprintf( stderr, "%s: not a pcap file (pcapng is not supported)\n", pPath );
+            fclose( pFile );
+            return false;
+        }
+    }
+    pcap.linkType = read32( &header[ 20 ], pcap.swapped );
+    if ( pcap.linkType != LINKTYPE_IEEE802_11 && pcap.linkType != LINKTYPE_IEEE802_11_RADIOTAP )
+    {
+        fprintf( stderr, "%s: unsupported link type %u\n", pPath, pcap.linkType );
+        fclose( pFile );
+        return false;
+    }
+
+    // Each file starts where the previous one ended on the virtual clock
+    bool     first    = true;
+    uint64_t firstUs  = 0;
+    uint64_t offsetUs = *pBaseUs;
+
+    std::vector<uint8_t> data;
+    tAggregate           aggregate;
+    aggregate.count = 0;
+    uint8_t recordHeader[ 16 ];
+    while ( fread( recordHeader, 1, sizeof( recordHeader ), pFile ) == sizeof( recordHeader ) )
+    {
+        uint32_t seconds  = read32( &recordHeader[ 0 ], pcap.swapped );
+        uint32_t fraction = read32( &recordHeader[ 4 ], pcap.swapped );
+        uint32_t captured = read32( &recordHeader[ 8 ], pcap.swapped );
+        data.resize( captured );
+        if ( fread( data.data(), 1, captured, pFile ) != captured )
+        {
+            break;
+        }
+        ++pStats->frames;
+
+        uint64_t timestampUs = (uint64_t)seconds * 1000000 + ( pcap.nanoseconds ? fraction / 1000 : fraction );
+        if ( first )
+        {
+            firstUs = timestampUs;
+            first   = false;
+        }
+        if ( timestampUs >= firstUs )
+        {
+            *pBaseUs = offsetUs + ( timestampUs - firstUs );
+            HostSdk_AdvanceTo( *pBaseUs );
+        }
+
+        tRxInfo  info         = { -50, pOptions->defaultChannel, 0, false, 0, false, false, false, 0, false };
+        uint32_t headerLength = 0;
+        bool     hasFcs       = false;
+        if ( pcap.linkType == LINKTYPE_IEEE802_11_RADIOTAP
+          && !parseRadiotap( data.data(), captured, &info, &headerLength, &hasFcs ) )
+        {
+            ++pStats->skipped;
+            continue;
+        }
+
+        uint32_t frameLength = captured - headerLength;
+        if ( hasFcs && frameLength >= 4 )
+        {
+            frameLength -= 4;
+        }
+        if ( frameLength < 2 )
+        {
+            ++pStats->skipped;
+            continue;
+        }
+
+        if ( pOptions->benchParse )
+        {
+            benchParse( &data[ headerLength ], frameLength, pStats );
+        }
+        if ( pOptions->benchOui && frameLength >= FRAME_ADDR2_OFFSET + 6 )
+        {
+            const uint8_t* pMac = &data[ headerLength + FRAME_ADDR2_OFFSET ];
+            ouiBenchMacs.insert( ouiBenchMacs.end(), pMac, pMac + 6 );
+        }
+        if ( pOptions->benchProbes && IFrameClass_Get( data[ headerLength ] ) == MANAGEMENT_TYPE_PROBE_REQ )
+        {
+            // The SDK hands over the first SNIFFER_BUF2_LEN bytes
+            tProbeSample sample;
+            sample.timeMs   = (uint32_t)( HostSdk_Now() / 1000 );
+            sample.captured = (uint16_t)( frameLength < SNIFFER_BUF2_LEN ? frameLength : SNIFFER_BUF2_LEN );
+            sample.length   = (uint16_t)( frameLength + 4 );
+            memcpy( sample.frame, &data[ headerLength ], sample.captured );
+            probeBenchFrames.push_back( sample );
+        }
+
+        if ( pOptions->compareHop )
+        {
+            tHopSample sample;
+            sample.timeMs      = (uint32_t)( HostSdk_Now() / 1000 );
+            sample.channel     = info.channel;
+            sample.transmitter = 0;
+            if ( IFrameClass_HasTransmitter( IFrameClass_Get( data[ headerLength ] ) ) && frameLength >= FRAME_ADDR2_OFFSET + 6 )
+            {
+                memcpy( &sample.transmitter, &data[ headerLength + FRAME_ADDR2_OFFSET ], 6 );
+            }
+            hopCompareFrames.push_back( sample );
+        }
+
+        // Subframes are collected until the last one, or one of another
+        // A-MPDU shows up
+        if ( aggregate.count > 0 && ( !info.ampdu || info.ampduReference != aggregate.info.ampduReference ) )
+        {
+            deliverFrame( &aggregate, pOptions, pStats );
+        }
+        addFrame( &aggregate, &data[ headerLength ], frameLength, &info );
+        if ( !info.ampdu || info.ampduLast )
+        {
+            deliverFrame( &aggregate, pOptions, pStats );
+        }
+        loop();
+    }
+    if ( aggregate.count > 0 )
+    {
+        deliverFrame( &aggregate, pOptions, pStats );
+    }
+
+    fclose( pFile );
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void addFrame( tAggregate* pAggregate, const uint8_t* pFrame, uint32_t length, const tRxInfo* pInfo )
+{
+    if ( pAggregate->count == 0 )
+    {
+        pAggregate->info = *pInfo;
+        pAggregate->first.assign( pFrame, pFrame + ( length < SNIFFER_MAX_BUF_LEN ? length : SNIFFER_MAX_BUF_LEN ) );
+        pAggregate->firstLength = length;
+    }
+    if ( pAggregate->count == SNIFFER_MAX_MPDUS )
+    {
+        return;
+    }
+
+    // Length includes the FCS, like rx_ctrl's
+    tAmpduInfo* pEntry = &pAggregate->entries[ pAggregate->count++ ];
+    memset( pEntry, 0, sizeof( *pEntry ) );
+    pEntry->length = (uint16_t)( length + 4 );
+    if ( length >= 24 )
+    {
+        pEntry->seq = (uint16_t)( ( pFrame[ 22 ] | ( pFrame[ 23 ] << 8 ) ) >> 4 );
+        memcpy( pEntry->address3, &pFrame[ 16 ], 6 );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void deliverFrame( tAggregate* pAggregate, const tReplayOptions* pOptions, tReplayStats* pStats )
+{
+    const tRxInfo* pInfo  = &pAggregate->info;
+    const uint8_t* pFrame = pAggregate->first.data();
+    uint32_t       length = pAggregate->firstLength;
+    uint16_t       count  = pAggregate->count;
+    pAggregate->count = 0;
+
+    wifi_promiscuous_cb_t pCallback = HostSdk_RxCallback();
+    if ( pCallback == NULL )
+    {
+        pStats->missed += count;
+        return;
+    }
+    if ( pOptions->tunedOnly && pInfo->channel != HostSdk_Channel() )
+    {
+        pStats->missed += count;
+        return;
+    }
+
+    // PSDU of an A-MPDU is its subframes with delimiters and padding
+    uint32_t psduLength = length + 4;
+    if ( pInfo->ampdu )
+    {
+        psduLength = 0;
+        for ( uint16_t i = 0; i < count; ++i )
+        {
+            psduLength  = ( psduLength + 3 ) & ~3u;
+            psduLength += AMPDU_DELIMITER_LEN + pAggregate->entries[ i ].length;
+        }
+        psduLength = psduLength < UINT16_MAX ? psduLength : UINT16_MAX;
+    }
+
+    // Lay the frame out the way the SDK does: management frames in
+    // the larger buffer, everything else in the ordinary one with an
+    // entry per frame
+    union
+    {
+        tSnifferBuf  buf;
+        tSnifferBuf2 buf2;
+        uint8_t      raw[ sizeof( tSnifferBuf ) + ( SNIFFER_MAX_MPDUS - 1 ) * sizeof( tAmpduInfo ) ];
+    } buffer;
+    memset( &buffer, 0, sizeof( buffer ) );
+    tRxControl* pRx = &buffer.buf.rx_ctrl;
+    pRx->rssi          = pInfo->rssi;
+    pRx->rate          = pInfo->rate;
+    pRx->sig_mode      = pInfo->ht ? 1 : 0;
+    pRx->MCS           = pInfo->mcs;
+    pRx->CWB           = pInfo->wide ? 1 : 0;
+    pRx->SGI           = pInfo->shortGi ? 1 : 0;
+    pRx->channel       = pInfo->channel;
+    pRx->legacy_length = pInfo->ht ? 0 : ( psduLength & 0xFFF );
+    pRx->HT_length     = pInfo->ht ? ( psduLength & 0xFFFF ) : 0;
+    pRx->is_group      = length >= 10 ? ( pFrame[ 4 ] & 0x01 ) : 0;
+    pRx->Aggregation   = pInfo->ampdu ? 1 : 0;
+    pRx->ampdu_cnt     = pInfo->ampdu ? ( count & 0xFF ) : 0;
+
+    uint16_t bufferLength;
+    if ( ( pFrame[ 0 ] & 0x0C ) == 0 && !pInfo->ampdu )
+    {
+        memcpy( buffer.buf2.buf, pFrame, length < sizeof( buffer.buf2.buf ) ? length : sizeof( buffer.buf2.buf ) );
+        buffer.buf2.cnt = 1;
+        buffer.buf2.len = (uint16_t)( length + 4 );
+        bufferLength    = sizeof( tSnifferBuf2 );
+    }
+    else
+    {
+        memcpy( buffer.buf.buf, pFrame, length < sizeof( buffer.buf.buf ) ? length : sizeof( buffer.buf.buf ) );
+        buffer.buf.cnt = count;
+        memcpy( buffer.buf.ampdu_info, pAggregate->entries, count * sizeof( tAmpduInfo ) );
+        bufferLength = (uint16_t)( sizeof( tSnifferBuf ) + ( count - 1 ) * sizeof( tAmpduInfo ) );
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t cycles = readCycles();
+    pCallback( (uint8_t*)&buffer, bufferLength );
+    cycles = readCycles() - cycles;
+    uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+
+    ++pStats->delivered;
+    pStats->aggregates     += count > 1;
+    pStats->callbackNs     += ns;
+    pStats->callbackCycles += cycles;
+    if ( ns > pStats->maxCallbackNs )
+    {
+        pStats->maxCallbackNs = ns;
+    }
+
+    if ( pOptions->benchFilter )
+    {
+        benchFilter( (const uint8_t*)&buffer, bufferLength, pStats );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void benchFilter( const uint8_t* pBuffer, uint16_t length, tReplayStats* pStats )
+{
+    // Same arguments as the callback passes
+    tSnifferFrame  frame;
+    tSnifferLayout layout = ISnifferBuf_Parse( pBuffer, length, &frame );
+    if ( layout != SNIFFER_LAYOUT_BUF && layout != SNIFFER_LAYOUT_BUF2 )
+    {
+        return;
+    }
+
+    volatile uint16_t snapLength = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for ( uint16_t i = 0; i < FILTER_BENCH_REPEAT; ++i )
+    {
+        snapLength = ICaptureFilter_Run( frame.pRx, frame.pFrame, frame.captured );
+    }
+    pStats->filterNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+    pStats->filterAccepted += snapLength != 0;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void benchParse( const uint8_t* pFrame, uint32_t length, tReplayStats* pStats )
+{
+    uint16_t captured = length > UINT16_MAX ? UINT16_MAX : (uint16_t)length;
+
+    volatile uint32_t ies = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for ( uint16_t i = 0; i < PARSE_BENCH_REPEAT; ++i )
+    {
+        ies = parseFrame( pFrame, captured );
+    }
+    pStats->parseNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+    ++pStats->parseFrames;
+    pStats->parseBytes += captured;
+    pStats->parseIes   += ies;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void benchOui( void )
+{
+    // The sniffer's own reports looked up vendors too, count from here
+    tOuiStats before;
+    tOuiStats after;
+    size_t    macs = ouiBenchMacs.size() / 6;
+    char      name[ OUI_NAME_SIZE ];
+    IOui_GetStats( &before );
+
+    volatile uint32_t found = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for ( uint16_t pass = 0; pass < OUI_BENCH_REPEAT; ++pass )
+    {
+        for ( size_t i = 0; i < macs; ++i )
+        {
+            found += IOui_Lookup( &ouiBenchMacs[ i * 6 ], name, sizeof( name ) );
+        }
+    }
+    uint64_t ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+    IOui_GetStats( &after );
+
+    double lookups = macs > 0 ? (double)macs * OUI_BENCH_REPEAT : 1.0;
+    fprintf( stderr, "OUI        %lu prefixes, %lu vendors, %lu bytes of flash\n",
+        (unsigned long)after.entries,
+        (unsigned long)after.names,
+        (unsigned long)after.flashBytes );
+    fprintf( stderr, "           %.1f ns/lookup avg over %zu transmitters, %.1f%% found, %.1f%% from cache (%u slots)\n",
+        ns / lookups,
+        macs,
+        100.0 * ( after.found - before.found ) / lookups,
+        100.0 * ( after.cacheHits - before.cacheHits ) / lookups,
+        (unsigned int)OUI_CACHE_SLOTS );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void benchProbes( void )
+{
+    size_t             probes = probeBenchFrames.size();
+    std::set<uint32_t> fingerprints;
+    std::set<uint64_t> addresses;
+    for ( size_t i = 0; i < probes; ++i )
+    {
+        const tProbeSample* pSample = &probeBenchFrames[ i ];
+        uint32_t            fingerprint;
+        if ( IProbeClusters_Fingerprint( pSample->frame, pSample->captured, pSample->length, &fingerprint ) )
+        {
+            fingerprints.insert( fingerprint );
+        }
+        if ( pSample->captured >= FRAME_ADDR2_OFFSET + 6 )
+        {
+            uint64_t address = 0;
+            memcpy( &address, &pSample->frame[ FRAME_ADDR2_OFFSET ], 6 );
+            addresses.insert( address );
+        }
+    }
+
+    // Fingerprints alone, then the whole estimate from scratch each
+    // pass; the last pass leaves the estimate of the whole trace
+    volatile uint32_t sink = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for ( uint16_t pass = 0; pass < PROBE_BENCH_REPEAT; ++pass )
+    {
+        for ( size_t i = 0; i < probes; ++i )
+        {
+            uint32_t fingerprint = 0;
+            IProbeClusters_Fingerprint( probeBenchFrames[ i ].frame, probeBenchFrames[ i ].captured, probeBenchFrames[ i ].length, &fingerprint );
+            sink += fingerprint;
+        }
+    }
+    std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+    for ( uint16_t pass = 0; pass < PROBE_BENCH_REPEAT; ++pass )
+    {
+        IProbeClusters_Init();
+        for ( size_t i = 0; i < probes; ++i )
+        {
+            const tProbeSample* pSample = &probeBenchFrames[ i ];
+            IProbeClusters_Count( pSample->frame, pSample->captured, pSample->length, pSample->timeMs );
+        }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    uint64_t fingerprintNs = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( middle - start ).count();
+    uint64_t countNs       = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( end - middle ).count();
+
+    tProbeClustersStats stats;
+    IProbeClusters_GetStats( probes > 0 ? probeBenchFrames[ probes - 1 ].timeMs : 0, &stats );
+
+    double counted = probes > 0 ? (double)probes * PROBE_BENCH_REPEAT : 1.0;
+    fprintf( stderr, "PROBES     %zu probe requests from %zu addresses, %zu fingerprints, %.1f%% partial\n",
+        probes,
+        addresses.size(),
+        fingerprints.size(),
+        100.0 * stats.partial / ( probes > 0 ? (double)probes : 1.0 ) );
+    fprintf( stderr, "           ~%lu devices (%lu randomised) heard in the last %lu s, using %lu addresses since first heard\n",
+        (unsigned long)stats.devices,
+        (unsigned long)stats.randomised,
+        (unsigned long)( PROBE_CLUSTER_MAX_AGE_MS / 1000 ),
+        (unsigned long)stats.addresses );
+    fprintf( stderr, "           linked %lu (%lu by sequence, %lu undone), evicted %lu, replaced %lu\n",
+        (unsigned long)stats.linked,
+        (unsigned long)stats.bySequence,
+        (unsigned long)stats.undone,
+        (unsigned long)stats.evicted,
+        (unsigned long)stats.replaced );
+    fprintf( stderr, "           %.1f ns/probe avg, %.1f ns of it fingerprint\n",
+        countNs / counted,
+        fingerprintNs / counted );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void benchStations( void )
+{
+    static const uint32_t counts[] = STATION_BENCH_COUNTS;
+
+    fprintf( stderr, "STATIONS   %u slots of %zu bytes, probe limit %u\n",
+        (unsigned int)STATION_TABLE_SLOTS,
+        sizeof( tStation ),
+        (unsigned int)STATION_TABLE_PROBE_LIMIT );
+
+    uint32_t random = 1;
+    for ( size_t run = 0; run < 2 * sizeof( counts ) / sizeof( counts[ 0 ] ); ++run )
+    {
+        // Random addresses, then addresses under one OUI counting up
+        // from the fourth byte as tools/hopsim.py's do. The order of
+        // updates is drawn up front so the generator isn't timed.
+        bool                 counting = run >= sizeof( counts ) / sizeof( counts[ 0 ] );
+        uint32_t             stations = counts[ run % ( sizeof( counts ) / sizeof( counts[ 0 ] ) ) ];
+        std::vector<uint8_t> macs( 6 * stations );
+        for ( size_t i = 0; i < macs.size(); ++i )
+        {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            macs[ i ] = (uint8_t)random;
+        }
+        for ( uint32_t i = 0; counting && i < stations; ++i )
+        {
+            static const uint8_t oui[ 3 ] = { 0x00, 0x17, 0xF2 };
+            memcpy( &macs[ 6 * i ], oui, sizeof( oui ) );
+            macs[ 6 * i + 3 ] = (uint8_t)i;
+            macs[ 6 * i + 4 ] = (uint8_t)( i >> 8 );
+            macs[ 6 * i + 5 ] = 0;
+        }
+        std::vector<uint32_t> order( STATION_BENCH_UPDATES );
+        for ( uint32_t i = 0; i < STATION_BENCH_UPDATES; ++i )
+        {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            order[ i ] = random % stations;
+        }
+
+        // A thousand frames a second, all stations stay active
+        IStationTable_Init();
+        volatile uint32_t duplicates = 0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for ( uint32_t i = 0; i < stations; ++i )
+        {
+            duplicates += IStationTable_Update( &macs[ 6 * i ], -60, 100, 1, 200, STATION_SEQ_MANAGEMENT, (uint16_t)( i << 4 ), false, i / 1000 );
+        }
+        std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+        for ( uint32_t i = 0; i < STATION_BENCH_UPDATES; ++i )
+        {
+            duplicates += IStationTable_Update( &macs[ 6 * order[ i ] ], -60, 100, 1, 200, STATION_SEQ_MANAGEMENT, (uint16_t)( i << 4 ), false, ( stations + i ) / 1000 % STATION_TABLE_MAX_AGE_MS );
+        }
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        tStationTableStats stats;
+        IStationTable_GetStats( ( stations + STATION_BENCH_UPDATES ) / 1000 % STATION_TABLE_MAX_AGE_MS, &stats );
+        fprintf( stderr, "           %5lu %s stations: %5.1f ns/insert, %5.1f ns/update, %lu held, %lu evicted\n",
+            (unsigned long)stations,
+            counting ? "counting" : "random  ",
+            std::chrono::duration<double, std::nano>( middle - start ).count() / stations,
+            std::chrono::duration<double, std::nano>( end - middle ).count() / STATION_BENCH_UPDATES,
+            (unsigned long)stats.used,
+            (unsigned long)stats.evicted );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void benchRing( void )
+{
+    // Wildcard probe request, what the default filter records in the
+    // text build
+    static const uint8_t probe[] = {
+        0x40, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xDA, 0xA1, 0x19, 0x12, 0x34, 0x56, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0x40, 0x12, 0x00, 0x00, 0x01, 0x08, 0x02, 0x04,
+        0x0B, 0x16, 0x0C, 0x12, 0x18, 0x24, 0x32, 0x04, 0x30, 0x48,
+        0x60, 0x6C, 0x2D, 0x1A, 0x2D, 0x01, 0x17, 0xFF, 0xFF, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+    tRxControl rx;
+    memset( &rx, 0, sizeof( rx ) );
+    rx.rssi          = -50;
+    rx.channel       = 1;
+    rx.legacy_length = sizeof( probe ) + 4;
+
+    // The sniffer's report isn't wanted, only its loop()
+    HostSdk_SetSerialOutput( NULL );
+    setup();
+
+    for ( uint8_t viaLoop = 0; viaLoop < 2; ++viaLoop )
+    {
+        ICaptureRing_Init();
+        std::atomic<bool> done( false );
+        volatile uint32_t sink = 0;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::thread producer( [ & ]()
+        {
+            for ( uint32_t i = 0; i < RING_BENCH_RECORDS; ++i )
+            {
+                while ( !ICaptureRing_Push( &rx, probe, sizeof( probe ), sizeof( probe ) + 4, i ) )
+                {
+                    std::this_thread::yield();
+                }
+            }
+            done.store( true, std::memory_order_release );
+        } );
+
+        // Done is read first, so the ring is empty only when all
+        // records pushed have been drained. Either side gives way when
+        // it can't go on, or one core would spin its time slice away.
+        bool finished = false;
+        while ( !finished )
+        {
+            finished = done.load( std::memory_order_acquire );
+            if ( viaLoop )
+            {
+                loop();
+            }
+            else
+            {
+                const tCaptureRecord* pRecord;
+                while ( ( pRecord = ICaptureRing_Peek() ) != NULL )
+                {
+                    sink += pRecord->header[ FRAME_SEQ_CTRL_OFFSET ];
+                    ICaptureRing_Release();
+                }
+            }
+            std::this_thread::yield();
+        }
+        producer.join();
+        double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+        tCaptureRingStats stats;
+        ICaptureRing_GetStats( &stats );
+        fprintf( stderr, "%s %-9s  %.2f M records/s, %.0f ns/record, ring full on %.1f%% of pushes, high water %lu of %u\n",
+            viaLoop ? "          " : "RING      ",
+            viaLoop ? "loop()" : "ring only",
+            seconds > 0 ? stats.pushed / seconds / 1e6 : 0.0,
+            stats.pushed > 0 ? seconds * 1e9 / stats.pushed : 0.0,
+            100.0 * stats.dropped / ( (double)stats.pushed + stats.dropped ),
+            (unsigned long)stats.highWater,
+            (unsigned int)CAPTURE_RING_SLOTS );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void compareHop( void )
+{
+    static const uint8_t channels[] = HOP_COMPARE_CHANNELS;
+
+    std::set<uint64_t> transmitters;
+    for ( size_t i = 0; i < hopCompareFrames.size(); ++i )
+    {
+        if ( hopCompareFrames[ i ].transmitter != 0 )
+        {
+            transmitters.insert( hopCompareFrames[ i ].transmitter );
+        }
+    }
+    if ( hopCompareFrames.empty() )
+    {
+        return;
+    }
+    uint32_t startMs = hopCompareFrames.front().timeMs;
+    uint32_t endMs   = hopCompareFrames.back().timeMs;
+    fprintf( stderr, "HOP        %zu frames from %zu transmitters over %.1f s, %u channels hopped\n",
+        hopCompareFrames.size(),
+        transmitters.size(),
+        ( endMs - startMs ) / 1000.0,
+        (unsigned int)sizeof( channels ) );
+
+    // The scheduler as the sniffer runs it, hops falling due before
+    // each frame is sent. The sniffer's own hopping is over by now.
+    for ( uint8_t adaptive = 0; adaptive < 2; ++adaptive )
+    {
+        IChannelHop_SetAdaptive( adaptive != 0 );
+        uint32_t dwellMs;
+        uint8_t  channel = IChannelHop_Init( channels, sizeof( channels ), startMs, &dwellMs );
+        uint32_t hopMs   = startMs + dwellMs;
+        uint32_t hops    = 0;
+
+        uint64_t           caught = 0;
+        std::set<uint64_t> heard;
+        for ( size_t i = 0; i < hopCompareFrames.size(); ++i )
+        {
+            const tHopSample* pSample = &hopCompareFrames[ i ];
+            while ( (int32_t)( pSample->timeMs - hopMs ) >= 0 )
+            {
+                channel = IChannelHop_Next( hopMs, &dwellMs );
+                hopMs  += dwellMs;
+                ++hops;
+            }
+            if ( pSample->channel != channel )
+            {
+                continue;
+            }
+            ++caught;
+            IChannelHop_CountFrame( channel, 1 );
+            if ( pSample->transmitter != 0 )
+            {
+                heard.insert( pSample->transmitter );
+            }
+        }
+
+        fprintf( stderr, "           %-8s  %5.1f%% of frames, %5.1f%% of transmitters, %.0f ms average dwell\n",
+            adaptive ? "adaptive" : "fixed",
+            100.0 * caught / hopCompareFrames.size(),
+            transmitters.empty() ? 0.0 : 100.0 * heard.size() / transmitters.size(),
+            hops > 0 ? ( hopMs - dwellMs - startMs ) / (double)hops : 0.0 );
+    }
+    IChannelHop_SetAdaptive( CHANNEL_HOP_ADAPTIVE );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool benchClassify( void )
+{
+    // First frame control byte and share per 1000 of a busy channel:
+    // QoS data and its ACKs, beacons, block acks, RTS/CTS, probing,
+    // a little of everything else and a frame with a bad version
+    static const struct
+    {
+        uint8_t  frameControl0;
+        uint16_t share;
+    } mix[] = {
+        { 0x88, 350 }, { 0xD4, 150 }, { 0x80, 200 }, { 0x94, 60 }, { 0xB4, 40 },
+        { 0xC4, 40 },  { 0x40, 50 },  { 0x50, 40 },  { 0x48, 30 }, { 0xC8, 20 },
+        { 0x08, 15 },  { 0xD0, 3 },   { 0xC0, 1 },   { 0x01, 1 }
+    };
+
+    // Both frame control bytes per frame, retry flag on one in ten,
+    // data frames to or from the DS
+    std::vector<uint8_t> frames( 2 * CLASSIFY_BENCH_FRAMES );
+    uint32_t             random = 1;
+    for ( uint32_t i = 0; i < CLASSIFY_BENCH_FRAMES; ++i )
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        uint32_t pick  = random % 1000;
+        uint8_t  entry = 0;
+        while ( pick >= mix[ entry ].share )
+        {
+            pick -= mix[ entry++ ].share;
+        }
+        frames[ 2 * i ]     = mix[ entry ].frameControl0;
+        frames[ 2 * i + 1 ] = (uint8_t)( ( ( random >> 16 ) % 10 == 0 ? FRAME_FLAG_RETRY : 0 )
+                                       | ( ( mix[ entry ].frameControl0 & 0x0C ) == 0x08 ? ( random >> 24 ) & 0x03 : 0 ) );
+    }
+
+    uint32_t oldCounts[ FRAME_CLASS_COUNT ] = { 0 };
+    uint32_t newCounts[ FRAME_CLASS_COUNT ] = { 0 };
+    uint32_t oldRetries = 0;
+    uint32_t newRetries = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for ( uint16_t pass = 0; pass < CLASSIFY_BENCH_REPEAT; ++pass )
+    {
+        for ( uint32_t i = 0; i < CLASSIFY_BENCH_FRAMES; ++i )
+        {
+            tFrameControl frameControl;
+            expandFrameControl( &frames[ 2 * i ], &frameControl );
+            uint8_t slot = frameControl.protocol != 0 ? FRAME_CLASS_INVALID : FRAME_CLASS( frameControl.type, frameControl.subtype );
+            ++oldCounts[ slot ];
+            oldRetries += frameControl.retry;
+        }
+    }
+    std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+    for ( uint16_t pass = 0; pass < CLASSIFY_BENCH_REPEAT; ++pass )
+    {
+        for ( uint32_t i = 0; i < CLASSIFY_BENCH_FRAMES; ++i )
+        {
+            ++newCounts[ IFrameClass_Get( frames[ 2 * i ] ) ];
+            newRetries += ( frames[ 2 * i + 1 ] & FRAME_FLAG_RETRY ) != 0;
+        }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    double classified = (double)CLASSIFY_BENCH_FRAMES * CLASSIFY_BENCH_REPEAT;
+    double oldNs      = std::chrono::duration<double, std::nano>( middle - start ).count() / classified;
+    double newNs      = std::chrono::duration<double, std::nano>( end - middle ).count() / classified;
+    bool   agree      = memcmp( oldCounts, newCounts, sizeof( oldCounts ) ) == 0 && oldRetries == newRetries;
+    fprintf( stderr, "CLASSIFY   expandFrameControl() %.2f ns/frame, table %.2f ns/frame (%.1fx) over %u frames of a synthetic mix\n",
+        oldNs,
+        newNs,
+        newNs > 0 ? oldNs / newNs : 0.0,
+        (unsigned int)CLASSIFY_BENCH_FRAMES );
+    fprintf( stderr, "           counts %s\n", agree ? "agree" : "DIFFER" );
+    return agree;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void expandFrameControl( const uint8_t frameBytes[ 2 ], tFrameControl* pFrameControl )
+{
+    // First Byte
+    pFrameControl->protocol = ( frameBytes[0] & 0x03 );
+    pFrameControl->type     = ( frameBytes[0] & 0x0C ) >> 2;
+    pFrameControl->subtype  = ( frameBytes[0] & 0xF0 ) >> 4;
+
+    // Second Byte
+    pFrameControl->toDS                 = ( frameBytes[1] & 0x01 );
+    pFrameControl->fromDS               = ( frameBytes[1] & 0x02 ) >> 1;
+    pFrameControl->moreFragments        = ( frameBytes[1] & 0x04 ) >> 2;
+    pFrameControl->retry                = ( frameBytes[1] & 0x08 ) >> 3;
+    pFrameControl->powerManagement      = ( frameBytes[1] & 0x10 ) >> 4;
+    pFrameControl->moreData             = ( frameBytes[1] & 0x20 ) >> 5;
+    pFrameControl->protectedBit         = ( frameBytes[1] & 0x40 ) >> 6;
+    pFrameControl->order                = ( frameBytes[1] & 0x80 ) >> 7;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint32_t parseFrame( const uint8_t* pFrame, uint16_t length )
+{
+    // Touch every field so none of it can be optimised away
+    tFrameView view;
+    if ( !IFrameView_Init( &view, pFrame, length ) )
+    {
+        return 0;
+    }
+
+    uint32_t sum = view.headerLength;
+    for ( uint8_t index = 1; index <= 4; ++index )
+    {
+        const uint8_t* pAddress = IFrameView_Address( &view, index );
+        sum += pAddress != NULL ? pAddress[ 5 ] : 0;
+    }
+    uint16_t value;
+    if ( IFrameView_SequenceControl( &view, &value ) )
+    {
+        sum += FRAME_SEQ_NUMBER( value );
+    }
+    if ( IFrameView_QosControl( &view, &value ) )
+    {
+        sum += FRAME_QOS_TID( value );
+    }
+
+    uint32_t         ies = 0;
+    tFrameIeIterator iter;
+    tFrameIe         ie;
+    if ( IFrameView_Ies( &view, &iter ) )
+    {
+        while ( IFrameView_NextIe( &iter, &ie ) )
+        {
+            sum += ie.id + ie.available;
+            ++ies;
+        }
+    }
+    return ies + ( sum & 0x80000000u );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool fuzzParse( uint32_t seed )
+{
+    static tFuzzView whole;
+    static tFuzzView prefix;
+    uint8_t          frame[ FUZZ_FRAME_MAX_LEN ];
+    uint32_t         random   = seed != 0 ? seed : 1;
+    uint64_t         views    = 0;
+    uint64_t         failures = 0;
+    double           ns       = 0.0;
+
+    IProbeSsids_Init();
+    IProbeClusters_Init();
+    IApInventory_Init();
+    for ( uint32_t n = 0; n < FUZZ_PARSE_FRAMES; ++n )
+    {
+        uint16_t    length  = fuzzFrame( &random, frame );
+        const char* pWhole  = viewFrame( frame, length, &whole );
+        for ( uint32_t captured = 0; captured <= length; ++captured )
+        {
+            // Exactly the prefix, so a sanitizer sees any read past it
+            std::vector<uint8_t> buffer( frame, frame + captured );
+            const uint8_t*       pFrame = buffer.data();
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            const char* pProblem = viewFrame( pFrame, (uint16_t)captured, &prefix );
+            ns += std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count();
+            ++views;
+            if ( pProblem == NULL && captured == length )
+            {
+                pProblem = pWhole;
+            }
+            if ( pProblem == NULL )
+            {
+                pProblem = compareViews( &prefix, &whole, (uint16_t)captured );
+            }
+
+            // The parsers behind the report, for the frames the
+            // sniffer hands them
+            uint8_t frameClass = captured > 0 ? IFrameClass_Get( pFrame[ 0 ] ) : (uint8_t)FRAME_CLASS_INVALID;
+            if ( frameClass == MANAGEMENT_TYPE_PROBE_REQ && captured >= FRAME_ADDR2_OFFSET + 6 )
+            {
+                IProbeSsids_Count( pFrame, (uint16_t)captured );
+                IProbeClusters_Count( pFrame, (uint16_t)captured, length, n );
+            }
+            if ( frameClass == MANAGEMENT_TYPE_BEACON || frameClass == MANAGEMENT_TYPE_PROBE_RSP )
+            {
+                tAccessPoint heard;
+                IApInventory_Update( pFrame, (uint16_t)captured, -60, 6, n, &heard );
+            }
+
+            if ( pProblem != NULL && ++failures <= FUZZ_REPORT )
+            {
+                fprintf( stderr, "FUZZ       seed %lu frame %lu, %lu of %u bytes: %s\n",
+                    (unsigned long)seed,
+                    (unsigned long)n,
+                    (unsigned long)captured,
+                    length,
+                    pProblem );
+            }
+        }
+    }
+
+    fprintf( stderr, "FUZZ       seed %lu: %u frames, %llu prefixes, %llu failures, %.1f ns/view\n",
+        (unsigned long)seed,
+        FUZZ_PARSE_FRAMES,
+        (unsigned long long)views,
+        (unsigned long long)failures,
+        views > 0 ? ns / views : 0.0 );
+    return failures == 0;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint16_t fuzzFrame( uint32_t* pRandom, uint8_t* pFrame )
+{
+    // Frame control of every type, a reserved type and a bad protocol
+    // version among them
+    static const uint8_t frameControls[] =
+    {
+        0x00, 0x10, 0x20, 0x30, 0x40, 0x50, 0x80, 0xB0, 0xC0, 0xD0,
+        0x08, 0x48, 0x88, 0xC8,
+        0x74, 0x84, 0x94, 0xA4, 0xB4, 0xC4, 0xD4,
+        0x0C, 0x41
+    };
+    static const uint8_t ieIds[] =
+    {
+        FRAME_IE_SSID, FRAME_IE_SUPPORTED_RATES, FRAME_IE_DS_PARAMS, FRAME_IE_TIM,
+        FRAME_IE_COUNTRY, FRAME_IE_HT_CAPABILITIES, FRAME_IE_RSN, FRAME_IE_EXT_RATES,
+        FRAME_IE_HT_OPERATION, FRAME_IE_EXT_CAPABILITIES, FRAME_IE_VENDOR
+    };
+
+    // One in four all random
+    uint16_t length = (uint16_t)( nextRandom( pRandom ) % FUZZ_FRAME_MAX_LEN );
+    for ( uint16_t i = 0; i < length; ++i )
+    {
+        pFrame[ i ] = (uint8_t)nextRandom( pRandom );
+    }
+    if ( nextRandom( pRandom ) % 4 == 0 )
+    {
+        return (uint16_t)( length % 64 );
+    }
+
+    // Otherwise a header with random flags and addresses, fixed fields
+    // and then elements, every so often claiming more than is left
+    if ( length < 2 )
+    {
+        return length;
+    }
+    pFrame[ 0 ] = frameControls[ nextRandom( pRandom ) % sizeof( frameControls ) ];
+    pFrame[ 1 ] = nextRandom( pRandom ) % 2 == 0 ? 0 : pFrame[ 1 ];
+
+    tFrameView view;
+    if ( !IFrameView_Init( &view, pFrame, length ) || FRAME_CLASS_TYPE( view.frameClass ) != FRAME_TYPE_MANAGEMENT )
+    {
+        return length;
+    }
+    uint16_t offset = view.headerLength + (uint16_t)( nextRandom( pRandom ) % 13 );
+    while ( offset + 2 <= length )
+    {
+        uint32_t choice = nextRandom( pRandom );
+        pFrame[ offset ]     = choice % 8 == 0 ? (uint8_t)( choice >> 8 ) : ieIds[ ( choice >> 8 ) % sizeof( ieIds ) ];
+        pFrame[ offset + 1 ] = choice % 16 == 1 ? (uint8_t)( choice >> 16 ) : (uint8_t)( ( choice >> 16 ) % 34 );
+        offset += 2 + pFrame[ offset + 1 ];
+    }
+    return length;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static const char* viewFrame( const uint8_t* pFrame, uint16_t captured, tFuzzView* pView )
+{
+    // Every accessor, everything it returns checked against the
+    // captured bytes
+    memset( pView, 0, offsetof( tFuzzView, ies ) );
+    pView->sequence = pView->qos = pView->body = -1;
+    for ( uint8_t index = 0; index < 4; ++index )
+    {
+        pView->address[ index ] = -1;
+    }
+
+    tFrameView view;
+    pView->valid = IFrameView_Init( &view, pFrame, captured );
+    if ( captured < 2 )
+    {
+        return pView->valid ? "view of a frame without frame control" : NULL;
+    }
+    if ( view.headerLength != IFrameView_HeaderLength( view.frameClass, view.flags ) )
+    {
+        return "header length differs from IFrameView_HeaderLength()";
+    }
+    pView->headerLength = view.headerLength;
+    if ( !pView->valid )
+    {
+        return NULL;
+    }
+
+    const uint8_t* pEnd = pFrame + captured;
+    for ( uint8_t index = 1; index <= 4; ++index )
+    {
+        const uint8_t* pAddress = IFrameView_Address( &view, index );
+        if ( pAddress != NULL )
+        {
+            if ( pAddress < pFrame || pAddress + 6 > pEnd )
+            {
+                return "address past the captured bytes";
+            }
+            pView->address[ index - 1 ] = (int32_t)( pAddress - pFrame );
+        }
+    }
+    if ( IFrameView_Address( &view, 0 ) != NULL || IFrameView_Address( &view, 5 ) != NULL )
+    {
+        return "address number out of range accepted";
+    }
+
+    uint16_t value;
+    if ( IFrameView_SequenceControl( &view, &value ) )
+    {
+        if ( captured < FRAME_SEQ_CTRL_OFFSET + 2 || value != ( pFrame[ FRAME_SEQ_CTRL_OFFSET ] | ( pFrame[ FRAME_SEQ_CTRL_OFFSET + 1 ] << 8 ) ) )
+        {
+            return "sequence control past the captured bytes or misplaced";
+        }
+        pView->sequence = value;
+    }
+    if ( IFrameView_QosControl( &view, &value ) )
+    {
+        // After addr4 when both DS bits are set
+        uint16_t offset = FRAME_HEADER_LEN + ( ( view.flags & ( FRAME_FLAG_TO_DS | FRAME_FLAG_FROM_DS ) ) == ( FRAME_FLAG_TO_DS | FRAME_FLAG_FROM_DS ) ? FRAME_MAC_ADDR_LEN : 0 );
+        if ( captured < offset + FRAME_QOS_CTRL_LEN || value != ( pFrame[ offset ] | ( pFrame[ offset + 1 ] << 8 ) ) )
+        {
+            return "QoS control past the captured bytes or misplaced";
+        }
+        pView->qos = value;
+    }
+
+    const uint8_t* pBody;
+    uint16_t       bodyCaptured;
+    if ( IFrameView_Body( &view, &pBody, &bodyCaptured ) )
+    {
+        if ( pBody < pFrame || pBody + bodyCaptured != pEnd || pBody != pFrame + view.headerLength )
+        {
+            return "body outside the captured bytes";
+        }
+        pView->body = (int32_t)( pBody - pFrame );
+    }
+
+    tFrameIeIterator iter;
+    tFrameIe         ie;
+    pView->hasIes = IFrameView_Ies( &view, &iter );
+    if ( !pView->hasIes )
+    {
+        return IFrameView_FindIe( &view, FRAME_IE_SSID, &ie ) ? "element found in a frame without elements" : NULL;
+    }
+    while ( IFrameView_NextIe( &iter, &ie ) )
+    {
+        if ( ie.available > ie.length || ie.pData < pFrame + 2 || ie.pData + ie.available > pEnd )
+        {
+            return "element past the captured bytes";
+        }
+        if ( ie.available < ie.length && ie.pData + ie.available != pEnd )
+        {
+            return "element cut short before the end";
+        }
+        if ( pView->ieCount == sizeof( pView->ies ) / sizeof( pView->ies[ 0 ] ) )
+        {
+            return "more elements than bytes";
+        }
+        pView->ies[ pView->ieCount ].offset    = (uint16_t)( ie.pData - pFrame );
+        pView->ies[ pView->ieCount ].id        = ie.id;
+        pView->ies[ pView->ieCount ].length    = ie.length;
+        pView->ies[ pView->ieCount ].available = ie.available;
+        ++pView->ieCount;
+    }
+    pView->iesComplete = IFrameView_IesComplete( &iter );
+
+    // The first element of each id is what FindIe() returns
+    for ( uint16_t i = 0; i < pView->ieCount; ++i )
+    {
+        tFrameIe found;
+        if ( !IFrameView_FindIe( &view, pView->ies[ i ].id, &found ) || found.pData > pFrame + pView->ies[ i ].offset )
+        {
+            return "FindIe() missed an element the walk returned";
+        }
+    }
+    return NULL;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static const char* compareViews( const tFuzzView* pPrefix, const tFuzzView* pWhole, uint16_t captured )
+{
+    // A field is in the prefix exactly when the whole frame has it and
+    // it fits, and then it is the same
+    if ( captured < 2 )
+    {
+        return NULL;
+    }
+    if ( pPrefix->valid != pWhole->valid || pPrefix->headerLength != pWhole->headerLength )
+    {
+        return "frame class or header length depends on the captured length";
+    }
+    for ( uint8_t index = 0; index < 4; ++index )
+    {
+        bool fits = pWhole->address[ index ] >= 0 && pWhole->address[ index ] + 6 <= captured;
+        if ( pPrefix->address[ index ] != ( fits ? pWhole->address[ index ] : -1 ) )
+        {
+            return "address differs from the whole frame's";
+        }
+    }
+    bool fits = pWhole->sequence >= 0 && captured >= FRAME_SEQ_CTRL_OFFSET + 2;
+    if ( pPrefix->sequence != ( fits ? pWhole->sequence : -1 ) )
+    {
+        return "sequence control differs from the whole frame's";
+    }
+    if ( pPrefix->qos >= 0 && pPrefix->qos != pWhole->qos )
+    {
+        return "QoS control differs from the whole frame's";
+    }
+    if ( pWhole->qos >= 0 && captured >= pWhole->headerLength && pPrefix->qos < 0 )
+    {
+        return "QoS control missing from a captured header";
+    }
+    fits = pWhole->body >= 0 && captured >= pWhole->headerLength;
+    if ( pPrefix->body != ( fits ? pWhole->body : -1 ) )
+    {
+        return "body differs from the whole frame's";
+    }
+    if ( pPrefix->hasIes != pWhole->hasIes )
+    {
+        return "elements depend on the captured length";
+    }
+
+    // Elements are those of the whole frame up to the prefix, the last
+    // possibly cut
+    for ( uint16_t i = 0; i < pPrefix->ieCount; ++i )
+    {
+        if ( i >= pWhole->ieCount
+          || pPrefix->ies[ i ].offset != pWhole->ies[ i ].offset
+          || pPrefix->ies[ i ].id != pWhole->ies[ i ].id
+          || pPrefix->ies[ i ].length != pWhole->ies[ i ].length
+          || pPrefix->ies[ i ].available > pWhole->ies[ i ].available )
+        {
+            return "element differs from the whole frame's";
+        }
+    }
+    if ( pPrefix->ieCount < pWhole->ieCount && pWhole->ies[ pPrefix->ieCount ].offset <= captured )
+    {
+        return "element with its header captured not returned";
+    }
+    return NULL;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint32_t nextRandom( uint32_t* pRandom )
+{
+    // xorshift32
+    *pRandom ^= *pRandom << 13;
+    *pRandom ^= *pRandom >> 17;
+    *pRandom ^= *pRandom << 5;
+    return *pRandom;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool parseRadiotap( const uint8_t* pData, uint32_t length, tRxInfo* pInfo, uint32_t* pHeaderLength, bool* pHasFcs )
+{
+    // Size and alignment of radiotap fields 0..20, enough to reach
+    // A-MPDU status
+    static const uint8_t fieldSize[ 21 ]  = { 8, 1, 1, 4, 2, 1, 1, 2, 2, 2, 1, 1, 1, 1, 2, 2, 1, 1, 8, 3, 8 };
+    static const uint8_t fieldAlign[ 21 ] = { 8, 1, 1, 2, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 2, 2, 1, 1, 4, 1, 4 };
+
+    if ( length < 8 || pData[ 0 ] != 0 )
+    {
+        return false;
+    }
+    uint32_t headerLength = pData[ 2 ] | ( pData[ 3 ] << 8 );
+    if ( headerLength < 8 || headerLength > length )
+    {
+        return false;
+    }
+    *pHeaderLength = headerLength;
+
+    // Skip extended present words, only the first one is used
+    uint32_t present = read32( &pData[ 4 ], false );
+    uint32_t offset  = 8;
+    uint32_t word    = present;
+    while ( ( word & 0x80000000u ) && offset + 4 <= headerLength )
+    {
+        word    = read32( &pData[ offset ], false );
+        offset += 4;
+    }
+
+    for ( uint8_t field = 0; field < 21; ++field )
+    {
+        if ( ( present & ( 1u << field ) ) == 0 )
+        {
+            continue;
+        }
+        offset = ( offset + fieldAlign[ field ] - 1 ) & ~(uint32_t)( fieldAlign[ field ] - 1 );
+        if ( offset + fieldSize[ field ] > headerLength )
+        {
+            break;
+        }
+
+        const uint8_t* pField = &pData[ offset ];
+        switch ( field )
+        {
+            case 1:
+                *pHasFcs = ( pField[ 0 ] & RADIOTAP_FLAG_FCS ) != 0;
+                break;
+            case 2:
+                pInfo->rate = rateToRxControl( pField[ 0 ] );
+                break;
+            case 3:
+                pInfo->channel = frequencyToChannel( (uint16_t)( pField[ 0 ] | ( pField[ 1 ] << 8 ) ) );
+                break;
+            case 5:
+                pInfo->rssi = (int8_t)pField[ 0 ];
+                break;
+            case 19:
+                pInfo->ht      = true;
+                pInfo->wide    = ( pField[ 0 ] & 0x01 ) && ( pField[ 1 ] & 0x03 ) == 1;
+                pInfo->shortGi = ( pField[ 0 ] & 0x04 ) && ( pField[ 1 ] & 0x04 );
+                pInfo->mcs     = ( pField[ 0 ] & 0x02 ) ? ( pField[ 2 ] & 0x7F ) : 0;
+                break;
+            case 20:
+            {
+                uint16_t flags = (uint16_t)( pField[ 4 ] | ( pField[ 5 ] << 8 ) );
+                pInfo->ampdu          = true;
+                pInfo->ampduReference = read32( pField, false );
+                pInfo->ampduLast      = ( flags & RADIOTAP_AMPDU_LAST_KNOWN ) && ( flags & RADIOTAP_AMPDU_IS_LAST );
+                break;
+            }
+            default:
+                break;
+        }
+        offset += fieldSize[ field ];
+    }
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint8_t rateToRxControl( uint8_t rate500k )
+{
+    for ( uint8_t code = 0; code < 16; ++code )
+    {
+        if ( rxControlRates[ code ] == rate500k )
+        {
+            return code;
+        }
+    }
+    return 0;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint8_t frequencyToChannel( uint16_t frequency )
+{
+    if ( frequency == 2484 )
+    {
+        return 14;
+    }
+    if ( frequency >= 2412 && frequency <= 2472 )
+    {
+        return (uint8_t)( ( frequency - 2407 ) / 5 );
+    }
+    // 5 GHz and unknown, rx_ctrl only has 4 bits of channel
+    return 0;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint32_t read32( const uint8_t* pData, bool swapped )
+{
+    if ( swapped )
+    {
+        return ( (uint32_t)pData[ 0 ] << 24 ) | ( (uint32_t)pData[ 1 ] << 16 ) | ( (uint32_t)pData[ 2 ] << 8 ) | pData[ 3 ];
+    }
+    return ( (uint32_t)pData[ 3 ] << 24 ) | ( (uint32_t)pData[ 2 ] << 16 ) | ( (uint32_t)pData[ 1 ] << 8 ) | pData[ 0 ];
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint64_t readCycles( void )
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool checkAirtime( void )
+{
+    // Every legacy rate code, then HT MCS 0..AIRTIME_CHECK_MCS - 1 at
+    // both bandwidths and guard intervals, at every length rx_ctrl's
+    // length fields can hold. The two MCS past 15 have no duration.
+    uint64_t checked    = 0;
+    uint64_t mismatches = 0;
+    uint64_t ns         = 0;
+    for ( uint32_t mode = 0; mode < 16 + 4 * AIRTIME_CHECK_MCS; ++mode )
+    {
+        tRxControl rx;
+        memset( &rx, 0, sizeof( rx ) );
+        uint32_t lengths = 1 << 12;
+        if ( mode < 16 )
+        {
+            rx.rate = mode;
+        }
+        else
+        {
+            uint32_t ht = mode - 16;
+            rx.sig_mode = 1;
+            rx.MCS      = ht % AIRTIME_CHECK_MCS;
+            rx.CWB      = ( ht / AIRTIME_CHECK_MCS ) & 1;
+            rx.SGI      = ht / ( 2 * AIRTIME_CHECK_MCS );
+            lengths     = 1 << 16;
+        }
+
+        std::vector<uint32_t> durations( lengths );
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for ( uint32_t length = 0; length < lengths; ++length )
+        {
+            durations[ length ] = IAirtime_Duration( &rx, (uint16_t)length );
+        }
+        ns += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+
+        for ( uint32_t length = 0; length < lengths; ++length )
+        {
+            double reference = referenceAirtime( &rx, length );
+            if ( durations[ length ] == reference )
+            {
+                continue;
+            }
+            if ( ++mismatches <= AIRTIME_CHECK_REPORT )
+            {
+                fprintf( stderr, "AIRTIME    %s %u%s%s, %lu bytes: %lu us, reference %.1f us\n",
+                    rx.sig_mode != 0 ? "MCS" : "rate code",
+                    rx.sig_mode != 0 ? rx.MCS : rx.rate,
+                    rx.CWB ? " 40MHz" : "",
+                    rx.SGI ? " SGI" : "",
+                    (unsigned long)length,
+                    (unsigned long)durations[ length ],
+                    reference );
+            }
+        }
+        checked += lengths;
+    }
+
+    // ACK, 14 bytes, at 1 and 2 Mbps with long preamble, as quoted
+    // everywhere
+    tRxControl ack;
+    memset( &ack, 0, sizeof( ack ) );
+    mismatches += IAirtime_Duration( &ack, 14 ) != 304;
+    ack.rate = 1;
+    mismatches += IAirtime_Duration( &ack, 14 ) != 248;
+
+    fprintf( stderr, "AIRTIME    %llu durations checked against the PHY timing, %llu mismatches, %.1f ns/frame avg\n",
+        (unsigned long long)checked,
+        (unsigned long long)mismatches,
+        checked > 0 ? ns / (double)checked : 0.0 );
+    return mismatches == 0;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool checkHll( void )
+{
+    static const uint32_t sizes[] = HLL_CHECK_SIZES;
+
+    double standardError = 1.04 / sqrt( (double)HLL_REGISTERS );
+    fprintf( stderr, "HLL        %u registers, standard error %.1f%%, bound %.1f%% rms and %.1f%% per run, %u runs per size\n",
+        HLL_REGISTERS,
+        100.0 * standardError,
+        100.0 * HLL_CHECK_RMS * standardError,
+        100.0 * HLL_CHECK_MAX * standardError,
+        HLL_CHECK_RUNS );
+
+    bool     passed  = true;
+    uint64_t updates = 0;
+    double   ns      = 0.0;
+    for ( size_t size = 0; size < sizeof( sizes ) / sizeof( sizes[ 0 ] ); ++size )
+    {
+        uint32_t devices = sizes[ size ];
+        double   rms[ 2 ];
+        double   worst[ 2 ];
+        uint32_t moved = 0;
+        for ( uint32_t sequential = 0; sequential < 2; ++sequential )
+        {
+            double squares = 0.0;
+            worst[ sequential ] = 0.0;
+            for ( uint32_t run = 0; run < HLL_CHECK_RUNS; ++run )
+            {
+                std::vector<uint8_t> macs( 6 * devices );
+                for ( uint32_t i = 0; i < devices; ++i )
+                {
+                    uint64_t address = hllCheckAddress( i, run + 1, sequential != 0 );
+                    for ( uint32_t byte = 0; byte < 6; ++byte )
+                    {
+                        macs[ 6 * i + byte ] = (uint8_t)( address >> ( 40 - 8 * byte ) );
+                    }
+                }
+
+                IDistinctDevices_Init();
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                for ( uint32_t i = 0; i < devices; ++i )
+                {
+                    IDistinctDevices_Count( 1, &macs[ 6 * i ] );
+                }
+                ns      += std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count();
+                updates += devices;
+                tHllSketch sketch = IDistinctDevices_Swap()->all;
+
+                // Addresses heard again change nothing
+                for ( uint32_t i = 0; i < devices; ++i )
+                {
+                    IDistinctDevices_Count( 1, &macs[ 6 * i ] );
+                }
+                uint32_t estimate = IDistinctDevices_Estimate( &sketch );
+                moved += IDistinctDevices_Estimate( &IDistinctDevices_Swap()->all ) != estimate;
+
+                double error = ( (double)estimate - devices ) / devices;
+                squares += error * error;
+                if ( fabs( error ) > worst[ sequential ] )
+                {
+                    worst[ sequential ] = fabs( error );
+                }
+            }
+            rms[ sequential ] = sqrt( squares / HLL_CHECK_RUNS );
+            passed &= rms[ sequential ] <= HLL_CHECK_RMS * standardError && worst[ sequential ] <= HLL_CHECK_MAX * standardError;
+        }
+        passed &= moved == 0;
+        fprintf( stderr, "           %7lu addresses: random rms %4.1f%% max %4.1f%%, sequential rms %4.1f%% max %4.1f%%%s\n",
+            (unsigned long)devices,
+            100.0 * rms[ 0 ],
+            100.0 * worst[ 0 ],
+            100.0 * rms[ 1 ],
+            100.0 * worst[ 1 ],
+            moved != 0 ? ", repeats moved the estimate" : "" );
+    }
+    fprintf( stderr, "           %.1f ns/update, %s\n",
+        updates > 0 ? ns / updates : 0.0,
+        passed ? "within bounds" : "out of bounds" );
+    return passed;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint64_t hllCheckAddress( uint64_t index, uint64_t seed, bool sequential )
+{
+    const uint64_t mask = ( 1ULL << 48 ) - 1;
+
+    // Interfaces counting up under one OUI, as a vendor numbers them,
+    // sizes stay below the 2^24 a vendor has
+    if ( sequential )
+    {
+        return ( ( seed * 0x1A11ULL ) << 24 | ( ( seed * 0x9E3779ULL + index ) & 0xFFFFFF ) ) & mask;
+    }
+
+    // Multiplying by an odd number and xorshifts are both one to one
+    // on 48 bits, so distinct indices give distinct addresses
+    uint64_t address = ( index ^ ( seed * 0x5851F42D4C95ULL ) ) & mask;
+    address = ( address * 0x9E3779B97F4BULL ) & mask;
+    address ^= address >> 23;
+    address = ( address * 0xD6E8FEB86659ULL ) & mask;
+    address ^= address >> 21;
+    return address;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool checkBeacons( void )
+{
+    enum
+    {
+        SCENARIO_NONE,
+        SCENARIO_FLOOD,
+        SCENARIO_TWIN,
+        SCENARIO_CLONE,
+        SCENARIO_NEW_AP
+    };
+
+    // Alarms expected: flood, security, channel, BSSID
+    static const struct
+    {
+        const char* pName;
+        uint8_t     attack;
+        uint32_t    expected[ 4 ];
+    } scenarios[] =
+    {
+        { "ESS and 48 networks",          SCENARIO_NONE,   { 0, 0, 0, 0 } },
+        { "1000 networks in one dwell",   SCENARIO_FLOOD,  { 1, 0, 0, 0 } },
+        { "open twins of the ESS",        SCENARIO_TWIN,   { 0, 2, 0, 0 } },
+        { "ESS access point cloned",      SCENARIO_CLONE,  { 0, 0, 1, 0 } },
+        { "new ESS access points",        SCENARIO_NEW_AP, { 0, 0, 0, 2 } }
+    };
+
+    bool passed = true;
+    for ( size_t scenario = 0; scenario < sizeof( scenarios ) / sizeof( scenarios[ 0 ] ); ++scenario )
+    {
+        uint8_t                     attack = scenarios[ scenario ].attack;
+        std::vector<tBeaconCheckAp> aps;
+        uint32_t                    random = 7;
+        char                        names[ BEACON_CHECK_NETWORKS ][ 12 ];
+
+        // The ESS on 1, 6 and 11, all WPA2, then networks of one access
+        // point on every channel, a quarter of them open
+        static const uint8_t essChannels[ 6 ] = { 1, 1, 6, 6, 11, 11 };
+        for ( uint8_t i = 0; i < 6; ++i )
+        {
+            tBeaconCheckAp ap = { { 0x24, 0x0A, 0xC4, 0x00, 0x00, i }, "Campus", essChannels[ i ], true, 0, 0 };
+            aps.push_back( ap );
+        }
+        for ( uint8_t i = 0; i < BEACON_CHECK_NETWORKS; ++i )
+        {
+            snprintf( names[ i ], sizeof( names[ i ] ), "Home-%02u", i );
+            tBeaconCheckAp ap = { { 0x00, 0x17, 0xF2, 0x00, 0x01, i }, names[ i ], (uint8_t)( 1 + i % 13 ), i % 4 != 0, 0, 0 };
+            aps.push_back( ap );
+        }
+
+        // The attack, from BEACON_CHECK_ATTACK_MS
+        if ( attack == SCENARIO_TWIN )
+        {
+            // The second within BEACON_REARM_MS of the first alarm, not
+            // worth another, the third after it
+            static const uint8_t  channels[ 3 ] = { 6, 1, 11 };
+            static const uint32_t delays[ 3 ]   = { 0, 10000, 35000 };
+            for ( uint8_t i = 0; i < 3; ++i )
+            {
+                tBeaconCheckAp ap = { { 0x02, 0xBA, 0xD0, 0x00, 0x00, (uint8_t)( 1 + i ) }, "Campus", channels[ i ], false, BEACON_CHECK_ATTACK_MS + delays[ i ], 0 };
+                aps.push_back( ap );
+            }
+        }
+        else if ( attack == SCENARIO_CLONE )
+        {
+            tBeaconCheckAp ap = aps[ 2 ];
+            ap.channel = 3;
+            ap.startMs = BEACON_CHECK_ATTACK_MS;
+            aps.push_back( ap );
+        }
+        else if ( attack == SCENARIO_NEW_AP )
+        {
+            // One on a channel the ESS uses, three on channels it
+            // doesn't, the second of those within BEACON_REARM_MS of the
+            // first alarm and not worth another, the third after it
+            static const uint8_t  channels[ 4 ] = { 6, 3, 9, 13 };
+            static const uint32_t delays[ 4 ]   = { 0, 10000, 20000, 45000 };
+            for ( uint8_t i = 0; i < 4; ++i )
+            {
+                tBeaconCheckAp ap = { { 0x24, 0x0A, 0xC4, 0x00, 0x01, i }, "Campus", channels[ i ], true, BEACON_CHECK_ATTACK_MS + delays[ i ], 0 };
+                aps.push_back( ap );
+            }
+        }
+        for ( size_t i = 0; i < aps.size(); ++i )
+        {
+            random = nextRandom( &random ), random = random != 0 ? random : 1;
+            aps[ i ].nextUs = 1000ULL * aps[ i ].startMs + random % 102400;
+        }
+
+        // Flood during the first dwell on channel 6 after the attack
+        // starts
+        uint32_t floodMs = BEACON_CHECK_ATTACK_MS;
+        while ( 1 + floodMs / BEACON_CHECK_DWELL_MS % 13 != 6 || floodMs % BEACON_CHECK_DWELL_MS != 0 )
+        {
+            ++floodMs;
+        }
+
+        IApInventory_Init();
+        IBeaconDetector_Init();
+        uint32_t alarms[ 4 ] = { 0, 0, 0, 0 };
+        uint8_t  frame[ 128 ];
+        for ( uint32_t nowMs = 0; nowMs < BEACON_CHECK_MS; ++nowMs )
+        {
+            uint8_t        tuned = (uint8_t)( 1 + nowMs / BEACON_CHECK_DWELL_MS % 13 );
+            tAccessPoint   heard;
+            tBeaconAlarm   alarm;
+            for ( size_t i = 0; i < aps.size(); ++i )
+            {
+                if ( aps[ i ].nextUs >= 1000ULL * ( nowMs + 1 ) )
+                {
+                    continue;
+                }
+                aps[ i ].nextUs += 102400;
+                if ( aps[ i ].channel != tuned )
+                {
+                    continue;
+                }
+                uint16_t length = beaconFrame( frame, aps[ i ].bssid, aps[ i ].pSsid, aps[ i ].channel, aps[ i ].rsn );
+                if ( IApInventory_Update( frame, length, -60, tuned, nowMs, &heard ) )
+                {
+                    IBeaconDetector_Check( &heard, nowMs );
+                }
+            }
+            if ( attack == SCENARIO_FLOOD && nowMs >= floodMs && nowMs < floodMs + BEACON_CHECK_DWELL_MS )
+            {
+                for ( uint8_t i = 0; i < 5; ++i )
+                {
+                    char    ssid[ 12 ];
+                    uint8_t bssid[ 6 ] = { 0x02 };
+                    for ( uint8_t byte = 1; byte < 6; ++byte )
+                    {
+                        bssid[ byte ] = (uint8_t)nextRandom( &random );
+                    }
+                    snprintf( ssid, sizeof( ssid ), "FREE-%05u", (unsigned int)( nextRandom( &random ) % 100000 ) );
+                    uint16_t length = beaconFrame( frame, bssid, ssid, 6, false );
+                    if ( IApInventory_Update( frame, length, -60, tuned, nowMs, &heard ) )
+                    {
+                        IBeaconDetector_Check( &heard, nowMs );
+                    }
+                }
+            }
+            while ( IBeaconDetector_PollAlarm( &alarm ) )
+            {
+                ++alarms[ alarm.type - BEACON_ALARM_FLOOD ];
+            }
+        }
+
+        tBeaconDetectorStats stats;
+        IBeaconDetector_GetStats( &stats );
+        bool expected = memcmp( alarms, scenarios[ scenario ].expected, sizeof( alarms ) ) == 0;
+        passed &= expected;
+        fprintf( stderr, "%s%-29s floods %lu, security %lu, channel %lu, BSSID %lu%s; %lu new pairs, %lu SSIDs replaced\n",
+            scenario == 0 ? "BEACONS    " : "           ",
+            scenarios[ scenario ].pName,
+            (unsigned long)alarms[ 0 ],
+            (unsigned long)alarms[ 1 ],
+            (unsigned long)alarms[ 2 ],
+            (unsigned long)alarms[ 3 ],
+            expected ? "" : " (unexpected)",
+            (unsigned long)stats.newPairs,
+            (unsigned long)stats.replaced );
+    }
+    return passed;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool checkAps( void )
+{
+    enum
+    {
+        LAYOUT_HOPSIM,
+        LAYOUT_FOURTH,
+        LAYOUT_SIXTH
+    };
+    static const struct
+    {
+        const char* pName;
+        uint8_t     layout;
+    } layouts[] =
+    {
+        { "hopsim.py's BSSIDs",           LAYOUT_HOPSIM },
+        { "one OUI, 4th byte counting",   LAYOUT_FOURTH },
+        { "one OUI, 6th byte counting",   LAYOUT_SIXTH }
+    };
+
+    // What tools/hopsim.py puts on each channel by default
+    static const uint8_t hopsimChannels[ AP_CHECK_APS ] = { 1, 3, 6, 6, 6, 6, 9, 11, 11, 13 };
+    static const uint8_t hopsimNumbers[ AP_CHECK_APS ]  = { 0, 0, 0, 1, 2, 3, 0, 0, 1, 0 };
+
+    bool passed = true;
+    for ( size_t layout = 0; layout < sizeof( layouts ) / sizeof( layouts[ 0 ] ); ++layout )
+    {
+        uint8_t bssids[ AP_CHECK_APS ][ 6 ];
+        for ( uint8_t i = 0; i < AP_CHECK_APS; ++i )
+        {
+            static const uint8_t oui[ 3 ] = { 0x00, 0x1A, 0x11 };
+            memcpy( bssids[ i ], oui, sizeof( oui ) );
+            bssids[ i ][ 3 ] = layouts[ layout ].layout == LAYOUT_HOPSIM ? hopsimChannels[ i ] : layouts[ layout ].layout == LAYOUT_FOURTH ? i : 0;
+            bssids[ i ][ 4 ] = 0;
+            bssids[ i ][ 5 ] = layouts[ layout ].layout == LAYOUT_HOPSIM ? hopsimNumbers[ i ] : layouts[ layout ].layout == LAYOUT_SIXTH ? i : 0;
+        }
+
+        // Every access point beacons every 102.4 ms and is heard every
+        // time, nothing should ever be replaced
+        IApInventory_Init();
+        uint8_t frame[ 128 ];
+        for ( uint32_t beacon = 0; beacon < AP_CHECK_BEACONS; ++beacon )
+        {
+            uint32_t nowMs = beacon * 1024 / 10;
+            for ( uint8_t i = 0; i < AP_CHECK_APS; ++i )
+            {
+                tAccessPoint heard;
+                uint8_t      channel = layouts[ layout ].layout == LAYOUT_HOPSIM ? hopsimChannels[ i ] : 1;
+                uint16_t     length  = beaconFrame( frame, bssids[ i ], "check", channel, true );
+                IApInventory_Update( frame, length, -60, channel, nowMs, &heard );
+            }
+        }
+
+        tApInventoryStats stats;
+        IApInventory_GetStats( AP_CHECK_BEACONS * 1024 / 10, &stats );
+        bool expected = stats.inserted == AP_CHECK_APS && stats.active == AP_CHECK_APS && stats.evicted == 0 && stats.expired == 0;
+        passed &= expected;
+        fprintf( stderr, "%s%-29s %lu inserted, %lu active, %lu evicted, %lu expired%s\n",
+            layout == 0 ? "APS        " : "           ",
+            layouts[ layout ].pName,
+            (unsigned long)stats.inserted,
+            (unsigned long)stats.active,
+            (unsigned long)stats.evicted,
+            (unsigned long)stats.expired,
+            expected ? "" : " (unexpected)" );
+    }
+    return passed;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint16_t beaconFrame( uint8_t* pFrame, const uint8_t* pBssid, const char* pSsid, uint8_t channel, bool rsn )
+{
+    // WPA2 personal, CCMP
+    static const uint8_t rsnElement[ 22 ] =
+    {
+        FRAME_IE_RSN, 20, 0x01, 0x00, 0x00, 0x0F, 0xAC, 0x04, 0x01, 0x00, 0x00, 0x0F, 0xAC, 0x04,
+        0x01, 0x00, 0x00, 0x0F, 0xAC, 0x02, 0x00, 0x00
+    };
+
+    uint16_t length = 0;
+    memset( pFrame, 0, FRAME_HEADER_LEN + 12 );
+    pFrame[ 0 ] = 0x80;
+    memset( &pFrame[ FRAME_ADDR1_OFFSET ], 0xFF, 6 );
+    memcpy( &pFrame[ FRAME_ADDR2_OFFSET ], pBssid, 6 );
+    memcpy( &pFrame[ FRAME_ADDR3_OFFSET ], pBssid, 6 );
+    length = FRAME_HEADER_LEN;
+
+    // Timestamp, interval 100 TU, capabilities ESS and privacy
+    pFrame[ length + 8 ]  = 100;
+    pFrame[ length + 10 ] = rsn ? 0x11 : 0x01;
+    length += 12;
+
+    uint8_t ssidLength = (uint8_t)strlen( pSsid );
+    pFrame[ length++ ] = FRAME_IE_SSID;
+    pFrame[ length++ ] = ssidLength;
+    memcpy( &pFrame[ length ], pSsid, ssidLength );
+    length += ssidLength;
+    pFrame[ length++ ] = FRAME_IE_DS_PARAMS;
+    pFrame[ length++ ] = 1;
+    pFrame[ length++ ] = channel;
+    if ( rsn )
+    {
+        memcpy( &pFrame[ length ], rsnElement, sizeof( rsnElement ) );
+        length += sizeof( rsnElement );
+    }
+    return length;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool checkDeauth( void )
+{
+    uint8_t              frame[ 26 ];
+    tDeauthAlarm         alarm;
+    tDeauthDetectorStats stats;
+    bool                 passed = true;
+
+    // A burst started at every millisecond of a window, past the first
+    // second so the wheel has wrapped. Alarm on the frame reaching the
+    // level and on no other.
+    uint32_t lateStarts = 0;
+    for ( uint32_t startMs = 1000; startMs < 1000 + DEAUTH_WINDOW_MS; ++startMs )
+    {
+        IDeauthDetector_Init();
+        deauthFrame( frame, 1, 0xFF );
+        uint32_t alarmFrame = 0;
+        for ( uint32_t i = 1; i <= DEAUTH_ALARM_LEVEL + 1; ++i )
+        {
+            IDeauthDetector_Count( frame, sizeof( frame ), startMs + ( i - 1 ) * DEAUTH_CHECK_BURST_MS );
+            if ( IDeauthDetector_PollAlarm( &alarm ) && alarmFrame == 0 )
+            {
+                alarmFrame = i;
+            }
+        }
+        IDeauthDetector_GetStats( &stats );
+        if ( alarmFrame != DEAUTH_ALARM_LEVEL || stats.alarms != 1 )
+        {
+            if ( lateStarts++ == 0 )
+            {
+                fprintf( stderr, "DEAUTH     burst at %lu ms: alarm on frame %lu, %lu alarms\n",
+                    (unsigned long)startMs,
+                    (unsigned long)alarmFrame,
+                    (unsigned long)stats.alarms );
+            }
+        }
+    }
+    passed &= lateStarts == 0;
+    fprintf( stderr, "DEAUTH     burst every %u ms: alarm on frame %u, %u ms after the first, %lu of %u starts wrong\n",
+        DEAUTH_CHECK_BURST_MS,
+        DEAUTH_ALARM_LEVEL,
+        ( DEAUTH_ALARM_LEVEL - 1 ) * DEAUTH_CHECK_BURST_MS,
+        (unsigned long)lateStarts,
+        DEAUTH_WINDOW_MS );
+
+    // An access point sending the odd deauth for a minute
+    IDeauthDetector_Init();
+    deauthFrame( frame, 2, 3 );
+    for ( uint32_t nowMs = 0; nowMs < 60000; nowMs += DEAUTH_CHECK_TRICKLE_MS )
+    {
+        IDeauthDetector_Count( frame, sizeof( frame ), nowMs );
+    }
+    IDeauthDetector_GetStats( &stats );
+    passed &= stats.alarms == 0 && stats.floods == 0;
+    fprintf( stderr, "           one every %u ms for a minute: %lu alarms, %lu floods, expected 0, 0\n",
+        DEAUTH_CHECK_TRICKLE_MS,
+        (unsigned long)stats.alarms,
+        (unsigned long)stats.floods );
+
+    // Two attackers taking turns, each its own alarm
+    IDeauthDetector_Init();
+    uint32_t sources = 0;
+    for ( uint32_t i = 0; i < 2 * ( DEAUTH_ALARM_LEVEL + 1 ); ++i )
+    {
+        deauthFrame( frame, (uint8_t)( 4 + ( i & 1 ) ), 0xFF );
+        IDeauthDetector_Count( frame, sizeof( frame ), 5000 + i * ( DEAUTH_CHECK_BURST_MS / 2 ) );
+        while ( IDeauthDetector_PollAlarm( &alarm ) )
+        {
+            sources |= alarm.all ? 0 : 1u << ( alarm.source[ 5 ] - 4 );
+        }
+    }
+    IDeauthDetector_GetStats( &stats );
+    passed &= stats.alarms == 2 && sources == 3;
+    fprintf( stderr, "           two attackers interleaved: %lu alarms, %s, expected 2\n",
+        (unsigned long)stats.alarms,
+        sources == 3 ? "both sources" : "sources wrong" );
+
+    // A flood from random sources at random targets, a new tuple every
+    // frame, caught by the count of all frames only
+    IDeauthDetector_Init();
+    uint32_t random     = 11;
+    uint32_t floodFrame = 0;
+    for ( uint32_t i = 1; i <= 10000 / DEAUTH_CHECK_SPREAD_MS; ++i )
+    {
+        deauthFrame( frame, (uint8_t)nextRandom( &random ), (uint8_t)nextRandom( &random ) );
+        frame[ FRAME_ADDR2_OFFSET + 3 ] = (uint8_t)nextRandom( &random );
+        frame[ FRAME_ADDR2_OFFSET + 4 ] = (uint8_t)nextRandom( &random );
+        IDeauthDetector_Count( frame, sizeof( frame ), 20000 + i * DEAUTH_CHECK_SPREAD_MS );
+        while ( IDeauthDetector_PollAlarm( &alarm ) )
+        {
+            floodFrame = floodFrame == 0 && alarm.all ? i : floodFrame;
+        }
+    }
+    IDeauthDetector_GetStats( &stats );
+    passed &= stats.alarms == 0 && stats.floods == 1 && floodFrame == DEAUTH_FLOOD_LEVEL;
+    fprintf( stderr, "           one every %u ms from random sources: %lu alarms, %lu floods on frame %lu, expected 0, 1, %u\n",
+        DEAUTH_CHECK_SPREAD_MS,
+        (unsigned long)stats.alarms,
+        (unsigned long)stats.floods,
+        (unsigned long)floodFrame,
+        DEAUTH_FLOOD_LEVEL );
+
+    // Cut before the end of addr3, as a burst
+    IDeauthDetector_Init();
+    deauthFrame( frame, 6, 0xFF );
+    for ( uint32_t i = 0; i < 2 * DEAUTH_ALARM_LEVEL; ++i )
+    {
+        IDeauthDetector_Count( frame, FRAME_ADDR3_OFFSET + 5, 5000 + i );
+    }
+    IDeauthDetector_GetStats( &stats );
+    passed &= stats.frames == 0 && stats.truncated == 2 * DEAUTH_ALARM_LEVEL && stats.alarms == 0;
+    fprintf( stderr, "           truncated: %lu counted, %lu skipped, %lu alarms, expected 0, %u, 0\n",
+        (unsigned long)stats.frames,
+        (unsigned long)stats.truncated,
+        (unsigned long)stats.alarms,
+        2 * DEAUTH_ALARM_LEVEL );
+
+    // Cost per frame, from one source and from more sources than
+    // tuples, which replaces a tuple on every frame
+    double ns[ 2 ];
+    for ( uint32_t run = 0; run < 2; ++run )
+    {
+        IDeauthDetector_Init();
+        uint32_t spread = run == 0 ? 1 : 4 * DEAUTH_TRACKED_TUPLES;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for ( uint32_t i = 0; i < DEAUTH_CHECK_FRAMES; ++i )
+        {
+            frame[ FRAME_ADDR2_OFFSET + 5 ] = (uint8_t)( i % spread );
+            IDeauthDetector_Count( frame, sizeof( frame ), i / 16 );
+        }
+        ns[ run ] = std::chrono::duration<double, std::nano>( std::chrono::steady_clock::now() - start ).count() / DEAUTH_CHECK_FRAMES;
+        while ( IDeauthDetector_PollAlarm( &alarm ) );
+    }
+    IDeauthDetector_GetStats( &stats );
+    fprintf( stderr, "           %.1f ns/frame from one source, %.1f ns/frame from %u, %lu bytes per tuple, %u tuples and all\n",
+        ns[ 0 ],
+        ns[ 1 ],
+        4 * DEAUTH_TRACKED_TUPLES,
+        (unsigned long)( stats.memoryBytes / ( DEAUTH_TRACKED_TUPLES + 1 ) ),
+        DEAUTH_TRACKED_TUPLES );
+    return passed;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void deauthFrame( uint8_t pFrame[ 26 ], uint8_t source, uint8_t target )
+{
+    // Deauthentication, reason 7 (class 3 frame from nonassociated
+    // station), addresses differing in their last byte
+    static const uint8_t header[ 26 ] =
+    {
+        0xC0, 0x00, 0x3A, 0x01,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0x02, 0xDE, 0xAD, 0x00, 0x00, 0x00,
+        0x02, 0xDE, 0xAD, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x07, 0x00
+    };
+    memcpy( pFrame, header, sizeof( header ) );
+    pFrame[ FRAME_ADDR1_OFFSET + 5 ] = target;
+    pFrame[ FRAME_ADDR2_OFFSET + 5 ] = source;
+    pFrame[ FRAME_ADDR3_OFFSET + 5 ] = source;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static double referenceAirtime( const tRxControl* pRx, uint32_t length )
+{
+    // TXTIME as 802.11 spells it out, in floating point and from the
+    // modulation parameters rather than tables of rates
+    if ( pRx->sig_mode == 0 )
+    {
+        double mbps = rxControlRates[ pRx->rate ] / 2.0;
+        if ( mbps == 0 )
+        {
+            return 0;
+        }
+        if ( pRx->rate < 8 )
+        {
+            // DSSS/CCK: long PLCP preamble 144 + header 48 us, short
+            // 72 + 24 us, then the PSDU at the data rate
+            double plcp = pRx->rate >= 5 ? 72 + 24 : 144 + 48;
+            return plcp + ceil( 8.0 * length / mbps );
+        }
+
+        // ERP-OFDM: preamble 16 us, SIGNAL 4 us, 4 us symbols carrying
+        // SERVICE (16 bits), PSDU and tail (6 bits), 6 us extension
+        double symbols = ceil( ( 16 + 8.0 * length + 6 ) / ( 4 * mbps ) );
+        return 16 + 4 + 4 * symbols + 6;
+    }
+
+    if ( pRx->MCS > 15 )
+    {
+        return 0;
+    }
+
+    // HT: bits per subcarrier and coding rate of MCS 0..7, data
+    // subcarriers per bandwidth
+    static const struct
+    {
+        unsigned int bitsPerSubcarrier;
+        unsigned int rateNum;
+        unsigned int rateDen;
+    } modulations[ 8 ] = {
+        { 1, 1, 2 }, { 2, 1, 2 }, { 2, 3, 4 }, { 4, 1, 2 },
+        { 4, 3, 4 }, { 6, 2, 3 }, { 6, 3, 4 }, { 6, 5, 6 }
+    };
+    unsigned int streams     = pRx->MCS / 8 + 1;
+    unsigned int subcarriers = pRx->CWB ? 108 : 52;
+    unsigned int ndbps       = subcarriers * modulations[ pRx->MCS % 8 ].bitsPerSubcarrier * streams * modulations[ pRx->MCS % 8 ].rateNum / modulations[ pRx->MCS % 8 ].rateDen;
+    double       symbols     = ceil( ( 16 + 8.0 * length + 6 ) / ndbps );
+
+    // Mixed format: L-STF 8, L-LTF 8, L-SIG 4, HT-SIG 8, HT-STF 4 and
+    // an HT-LTF of 4 us per stream
+    double preamble = 8 + 8 + 4 + 8 + 4 + 4.0 * streams;
+
+    // Short GI symbols last 3.6 us, the PPDU is padded to 4 us
+    double data = pRx->SGI ? 4 * ceil( 36 * symbols / 40 ) : 4 * symbols;
+    return preamble + data + 6;
+}
+
+#if FLASH_LOG
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void reportFlashLog( void )
+{
+    // Written as far as the log knows, against what the flash did
+    tFlashLogStats  log;
+    tHostFlashStats flash;
+    IFlashLog_GetStats( &log );
+    HostSdk_GetFlashStats( &flash );
+
+    double rawBytes = log.rawBytes > 0 ? (double)log.rawBytes : 1.0;
+    double busy     = flash.busyUs / 1e6;
+    fprintf( stderr, "FLASHLOG   %lu records in %lu blocks (%lu compressed), %llu bytes stored of %llu (%.1f%%), %lu dropped\n",
+        (unsigned long)log.records,
+        (unsigned long)log.blocks,
+        (unsigned long)log.compressed,
+        (unsigned long long)log.storedBytes,
+        (unsigned long long)log.rawBytes,
+        100.0 * log.storedBytes / rawBytes,
+        (unsigned long)log.dropped );
+    fprintf( stderr, "           write amplification %.2f programmed, %.2f erased; %lu erases, %lu-%lu per sector, %lu errors\n",
+        flash.bytesWritten / rawBytes,
+        (double)flash.erases * SPI_FLASH_SEC_SIZE / rawBytes,
+        (unsigned long)flash.erases,
+        (unsigned long)flash.minSectorErases,
+        (unsigned long)flash.maxSectorErases,
+        (unsigned long)( log.errors + flash.errors ) );
+    fprintf( stderr, "           device flash busy %.3f s, sustains %.0f frames/s (%.0f kB/s of records)\n",
+        busy,
+        busy > 0 ? log.records / busy : 0.0,
+        busy > 0 ? log.rawBytes / busy / 1000 : 0.0 );
+}
+#endif
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void usage( const char* pName )
+{
+    fprintf( stderr,
+        "Usage: %s [options] capture.pcap ...\n"
+        "  --channel N     Channel for frames without radiotap channel (default 1)\n"
+        "  --tuned-only    Drop frames on channels the sniffer isn't tuned to\n"
+        "  --quiet         Discard sniffer output until the final report\n"
+        "  --command TEXT  Queue a line on the sniffer's serial input\n"
+        "  --flash FILE    Load emulated flash from FILE and save it back\n"
+        "  --bench-filter  Time the capture filter on its own\n"
+        "  --bench-parse   Time IFrameView over whole frames\n"
+        "  --fuzz-parse SEED Run random and truncated frames through IFrameView and exit\n"
+        "  --bench-oui     Time vendor lookups of transmitter addresses\n"
+        "  --bench-probes  Time the device estimate over probe requests\n"
+        "  --compare-hop   Run fixed and adaptive channel hopping over the frames\n"
+        "  --bench-classify Time frame classification, old and table driven, and exit\n"
+        "  --bench-stations Time station table inserts and updates and exit\n"
+        "  --bench-ring    Time the capture ring against a producer thread and exit\n"
+        "  --check-hll     Check distinct device estimates against exact counts and exit\n"
+        "  --check-beacons Check beacon flood and evil twin alarms in scenarios and exit\n"
+        "  --check-aps     Check that a few access points never replace each other and exit\n"
+        "  --check-deauth  Check the deauth flood detector on injected traffic and exit\n"
+        "  --check-airtime Check frame durations against the PHY timing and exit\n",
+        pName );
+}
@@ -0,0 +1,36 @@
+/**
+ * @file    flash_hal.h
+ * @brief   Minimal stand-in for the Arduino core's flash layout. The
+ *          filesystem area lies where eagle.flash.4m2m.ld puts it, in
+ *          the emulated flash of HostSdk.cpp.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef HOST_FLASH_HAL_H
+#define HOST_FLASH_HAL_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Emulated flash chip
+#define HOST_FLASH_SIZE     0x400000
+
+// Filesystem area, offsets into flash like FS_PHYS_ADDR on the device
+#define FS_PHYS_ADDR        0x200000
+#define FS_PHYS_SIZE        0x1FA000
+#define FS_PHYS_PAGE        0x100
+#define FS_PHYS_BLOCK       0x2000
+
+#endif // HOST_FLASH_HAL_H
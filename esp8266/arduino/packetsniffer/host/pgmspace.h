@@ -0,0 +1,36 @@
+/**
+ * @file    pgmspace.h
+ * @brief   Minimal stand-in for the ESP8266 core's flash access macros.
+ *          Host data is plain memory, reads are plain loads.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef HOST_PGMSPACE_H
+#define HOST_PGMSPACE_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#define PROGMEM
+
+#define pgm_read_byte( addr )       ( *(const uint8_t*)( addr ) )
+#define pgm_read_word( addr )       ( *(const uint16_t*)( addr ) )
+#define pgm_read_dword( addr )      ( *(const uint32_t*)( addr ) )
+
+#define memcpy_P                    memcpy
+#define strncpy_P                   strncpy
+
+#endif // HOST_PGMSPACE_H
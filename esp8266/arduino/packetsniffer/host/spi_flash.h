@@ -0,0 +1,65 @@
+/**
+ * @file    spi_flash.h
+ * @brief   Minimal stand-in for the ESP8266 non-OS SDK SPI flash API.
+ *
+ *          Backed by an emulated NOR flash in HostSdk.cpp: erase sets
+ *          a sector to 0xFF, writes can only clear bits, addresses and
+ *          sizes must be 4 byte aligned like on the device. See
+ *          HostSdk_GetFlashStats() for wear and modelled busy time.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef HOST_SPI_FLASH_H
+#define HOST_SPI_FLASH_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#define SPI_FLASH_SEC_SIZE      4096
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef enum
+{
+    SPI_FLASH_RESULT_OK,
+    SPI_FLASH_RESULT_ERR,
+    SPI_FLASH_RESULT_TIMEOUT
+} SpiFlashOpResult;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+// C linkage as in the SDK, whether or not the includer wraps this in
+// extern "C"
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+SpiFlashOpResult spi_flash_erase_sector( uint16_t sector );
+SpiFlashOpResult spi_flash_write( uint32_t address, uint32_t* pSource, uint32_t size );
+SpiFlashOpResult spi_flash_read( uint32_t address, uint32_t* pDestination, uint32_t size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SPI_FLASH_H
@@ -0,0 +1,70 @@
+/**
+ * @file    user_interface.h
+ * @brief   Minimal stand-in for the ESP8266 non-OS SDK API used by
+ *          the sniffer. Promiscuous RX and timers are driven by the
+ *          replay harness, see HostSdk.h.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef HOST_USER_INTERFACE_H
+#define HOST_USER_INTERFACE_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#define NULL_MODE       0x00
+#define STATION_MODE    0x01
+#define SOFTAP_MODE     0x02
+#define STATIONAP_MODE  0x03
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef void os_timer_func_t( void* pArg );
+
+typedef struct os_timer_s
+{
+    struct os_timer_s* pNext;
+    uint64_t           dueUs;
+    uint32_t           periodMs;
+    bool               armed;
+    bool               repeat;
+    os_timer_func_t*   pFunc;
+    void*              pArg;
+} os_timer_t;
+
+typedef void (*wifi_promiscuous_cb_t)( uint8_t* pBuf, uint16_t length );
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+bool wifi_set_opmode( uint8_t mode );
+void wifi_promiscuous_enable( uint8_t enable );
+void wifi_set_promiscuous_rx_cb( wifi_promiscuous_cb_t pCallback );
+bool wifi_set_channel( uint8_t channel );
+uint8_t wifi_get_channel( void );
+
+void os_timer_setfn( os_timer_t* pTimer, os_timer_func_t* pFunc, void* pArg );
+void os_timer_arm( os_timer_t* pTimer, uint32_t ms, bool repeat );
+void os_timer_disarm( os_timer_t* pTimer );
+
+#endif // HOST_USER_INTERFACE_H
@@ -0,0 +1,182 @@
+/**
+ * @file    Airtime.cpp
+ * @brief   Time frames spend on the air, per channel and frame class,
+ *          and from it how busy each channel is.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include "Airtime.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    tAirtimeBank banks[ AIRTIME_BANKS ];
+    uint32_t     activeBank;
+    uint32_t     writerBusy;
+} tAirtimeVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tAirtimeVars airtimeVars;
+
+static constexpr tAirtimeTable airtimeTable;
+
+// Spot checks that the generated table agrees with the standard
+static_assert( airtimeTable.rates[ 0 ].fixedUs == 192 && airtimeTable.rates[ 0 ].bitsPerSymbol == 2,   "1 Mbps DSSS" );
+static_assert( airtimeTable.rates[ 7 ].fixedUs == 96 && airtimeTable.rates[ 7 ].bitsPerSymbol == 22,   "11 Mbps CCK short preamble" );
+static_assert( airtimeTable.rates[ 4 ].bitsPerSymbol == 0,                                             "Unused rate code" );
+static_assert( airtimeTable.rates[ 12 ].fixedUs == 26 && airtimeTable.rates[ 12 ].bitsPerSymbol == 216, "54 Mbps OFDM" );
+static_assert( airtimeTable.rates[ AIRTIME_HT_INDEX( 7, 0, 0 ) ].fixedUs == 42 && airtimeTable.rates[ AIRTIME_HT_INDEX( 7, 0, 0 ) ].bitsPerSymbol == 260, "MCS 7" );
+static_assert( airtimeTable.rates[ AIRTIME_HT_INDEX( 15, 1, 1 ) ].fixedUs == 46 && airtimeTable.rates[ AIRTIME_HT_INDEX( 15, 1, 1 ) ].bitsPerSymbol == 1080, "MCS 15 40 MHz" );
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IAirtime_Init( void )
+{
+    memset( &airtimeVars, 0, sizeof( airtimeVars ) );
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint32_t IAirtime_Duration( const tRxControl* pRx, uint16_t length )
+{
+    uint8_t index;
+    if ( pRx->sig_mode == 0 )
+    {
+        index = pRx->rate;
+    }
+    else if ( pRx->MCS < AIRTIME_HT_MCS )
+    {
+        index = AIRTIME_HT_INDEX( pRx->MCS, pRx->CWB, pRx->SGI );
+    }
+    else
+    {
+        return 0;
+    }
+
+    const tAirtimeRate* pRate = &airtimeTable.rates[ index ];
+    if ( pRate->bitsPerSymbol == 0 )
+    {
+        return 0;
+    }
+
+    uint32_t symbols = ( pRate->extraBits + (uint32_t)length * pRate->bitsPerByte + pRate->bitsPerSymbol - 1 ) / pRate->bitsPerSymbol;
+    if ( pRate->shortGi )
+    {
+        // 4 us periods covering the 3.6 us symbols
+        symbols = ( symbols * 9 + 9 ) / 10;
+    }
+    return pRate->fixedUs + symbols * pRate->symbolUs;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint32_t IAirtime_Count( const tRxControl* pRx, uint16_t length, uint8_t frameClass )
+{
+    uint32_t airtimeUs = IAirtime_Duration( pRx, length );
+
+    __atomic_store_n( &airtimeVars.writerBusy, 1, __ATOMIC_SEQ_CST );
+    uint32_t      active = __atomic_load_n( &airtimeVars.activeBank, __ATOMIC_SEQ_CST );
+    tAirtimeBank* pBank  = &airtimeVars.banks[ active ];
+
+    ++pBank->frames;
+    pBank->unknown                   += airtimeUs == 0;
+    pBank->airtimeUs                 += airtimeUs;
+    pBank->channels[ pRx->channel ]  += airtimeUs;
+    pBank->classes[ frameClass ]     += airtimeUs;
+
+    __atomic_store_n( &airtimeVars.writerBusy, 0, __ATOMIC_RELEASE );
+
+    return airtimeUs;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+const tAirtimeBank* IAirtime_Swap( void )
+{
+    uint32_t retired = airtimeVars.activeBank;
+    uint32_t next    = retired ^ 1;
+
+    // Next bank still holds the interval returned by the previous call
+    memset( &airtimeVars.banks[ next ], 0, sizeof( tAirtimeBank ) );
+
+    __atomic_store_n( &airtimeVars.activeBank, next, __ATOMIC_SEQ_CST );
+    while ( __atomic_load_n( &airtimeVars.writerBusy, __ATOMIC_SEQ_CST ) != 0 )
+    {
+        // Callback still writing into retired bank
+    }
+
+    return &airtimeVars.banks[ retired ];
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint16_t IAirtime_Utilisation( uint32_t airtimeUs, uint32_t ms )
+{
+    if ( ms == 0 )
+    {
+        return 0;
+    }
+
+    // us per ms is 1/1000
+    uint32_t permille = airtimeUs / ms;
+    return permille < 1000 ? (uint16_t)permille : 1000;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
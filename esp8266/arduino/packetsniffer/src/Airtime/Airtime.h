@@ -0,0 +1,144 @@
+/**
+ * @file    Airtime.h
+ * @brief   Airtime private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef AIRTIME_H
+#define AIRTIME_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IAirtime.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#define AIRTIME_BANKS               2
+
+// Rate table: rx_ctrl.rate codes, then HT MCS 0..15 by bandwidth and
+// guard interval
+#define AIRTIME_LEGACY_RATES        16
+#define AIRTIME_HT_MCS              16
+#define AIRTIME_RATES               ( AIRTIME_LEGACY_RATES + 4 * AIRTIME_HT_MCS )
+#define AIRTIME_HT_INDEX( mcs, cwb, sgi ) ( AIRTIME_LEGACY_RATES + ( ( sgi ) << 5 ) + ( ( cwb ) << 4 ) + ( mcs ) )
+
+// rx_ctrl.rate codes below this are DSSS/CCK, 5..7 with short preamble
+#define AIRTIME_FIRST_OFDM_CODE     8
+#define AIRTIME_FIRST_SHORT_CODE    5
+
+// DSSS/CCK PLCP preamble and header
+#define AIRTIME_DSSS_LONG_US        192
+#define AIRTIME_DSSS_SHORT_US       96
+
+// L-STF, L-LTF and L-SIG, then HT-SIG, HT-STF and one HT-LTF per
+// spatial stream (up to two)
+#define AIRTIME_OFDM_PREAMBLE_US    20
+#define AIRTIME_HT_SIG_US           8
+#define AIRTIME_HT_STF_US           4
+#define AIRTIME_HT_LTF_US           4
+
+// ERP-OFDM and HT on 2.4 GHz end with idle time after the last symbol
+#define AIRTIME_SIGNAL_EXTENSION_US 6
+
+// SERVICE field and tail of a single BCC encoder, enough up to MCS 15
+#define AIRTIME_SERVICE_TAIL_BITS   22
+#define AIRTIME_SYMBOL_US           4
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+// Duration is fixedUs + symbolUs * ceil( ( extraBits + length *
+// bitsPerByte ) / bitsPerSymbol ). DSSS/CCK has 1 us "symbols" and
+// counts bits twice, so 5.5 Mbps fits in integers.
+typedef struct
+{
+    uint16_t fixedUs;
+    uint16_t bitsPerSymbol;     // 0 = unknown rate
+    uint8_t  bitsPerByte;
+    uint8_t  extraBits;
+    uint8_t  symbolUs;
+    uint8_t  shortGi;           // 3.6 us symbols, rounded up to 4 us
+} tAirtimeRate;
+
+// Rate table, generated at compile time by the constexpr constructor
+typedef struct AirtimeTable
+{
+    tAirtimeRate rates[ AIRTIME_RATES ];
+
+    constexpr AirtimeTable() : rates()
+    {
+        // rx_ctrl.rate to 500 kbps units, as IRxStats_LegacyRate()
+        const uint8_t legacyRates[ AIRTIME_LEGACY_RATES ] = {
+            2, 4, 11, 22, 0, 4, 11, 22, 96, 48, 24, 12, 108, 72, 36, 18
+        };
+
+        // Data bits per symbol of one spatial stream, MCS 0..7 at
+        // 20 and 40 MHz
+        const uint16_t htBits[ 2 ][ 8 ] = {
+            { 26, 52, 78, 104, 156, 208, 234, 260 },
+            { 54, 108, 162, 216, 324, 432, 486, 540 }
+        };
+
+        for ( unsigned int code = 0; code < AIRTIME_LEGACY_RATES; ++code )
+        {
+            tAirtimeRate& rate = rates[ code ];
+            rate.shortGi = 0;
+            if ( code < AIRTIME_FIRST_OFDM_CODE )
+            {
+                rate.fixedUs       = code < AIRTIME_FIRST_SHORT_CODE ? AIRTIME_DSSS_LONG_US : AIRTIME_DSSS_SHORT_US;
+                rate.bitsPerSymbol = legacyRates[ code ];
+                rate.bitsPerByte   = 16;
+                rate.extraBits     = 0;
+                rate.symbolUs      = 1;
+            }
+            else
+            {
+                // 4 us symbols, so 4 bits per symbol per Mbps
+                rate.fixedUs       = AIRTIME_OFDM_PREAMBLE_US + AIRTIME_SIGNAL_EXTENSION_US;
+                rate.bitsPerSymbol = 2 * legacyRates[ code ];
+                rate.bitsPerByte   = 8;
+                rate.extraBits     = AIRTIME_SERVICE_TAIL_BITS;
+                rate.symbolUs      = AIRTIME_SYMBOL_US;
+            }
+        }
+
+        for ( unsigned int sgi = 0; sgi < 2; ++sgi )
+        {
+            for ( unsigned int cwb = 0; cwb < 2; ++cwb )
+            {
+                for ( unsigned int mcs = 0; mcs < AIRTIME_HT_MCS; ++mcs )
+                {
+                    tAirtimeRate& rate    = rates[ AIRTIME_HT_INDEX( mcs, cwb, sgi ) ];
+                    unsigned int  streams = mcs / 8 + 1;
+                    rate.fixedUs       = AIRTIME_OFDM_PREAMBLE_US + AIRTIME_HT_SIG_US + AIRTIME_HT_STF_US + streams * AIRTIME_HT_LTF_US + AIRTIME_SIGNAL_EXTENSION_US;
+                    rate.bitsPerSymbol = streams * htBits[ cwb ][ mcs % 8 ];
+                    rate.bitsPerByte   = 8;
+                    rate.extraBits     = AIRTIME_SERVICE_TAIL_BITS;
+                    rate.symbolUs      = AIRTIME_SYMBOL_US;
+                    rate.shortGi       = sgi;
+                }
+            }
+        }
+    }
+} tAirtimeTable;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // AIRTIME_H
@@ -0,0 +1,112 @@
+/**
+ * @file    IAirtime.h
+ * @brief   Time frames spend on the air, per channel and frame class,
+ *          and from it how busy each channel is.
+ *
+ *          The duration of a frame follows from rx_ctrl: PSDU length,
+ *          legacy rate or HT MCS, bandwidth and guard interval give
+ *          the TXTIME 802.11 defines for DSSS/CCK, ERP-OFDM and HT
+ *          mixed format, 2.4 GHz signal extension included. Interframe
+ *          spaces, backoff and frames the radio missed are not
+ *          counted, so utilisation is a lower bound. HT frames are
+ *          timed as mixed format without STBC, the common case on
+ *          2.4 GHz, MCS above 15 count as unknown rate.
+ *
+ *          The RX callback writes into the active one of two banks,
+ *          loop() retires it once per interval, in the same way as
+ *          RxStats.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IAIRTIME_H
+#define IAIRTIME_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+
+#include <SnifferBuf/ISnifferBuf.h>
+#include <FrameClass/IFrameClass.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// rx_ctrl.channel is 4 bits
+#define AIRTIME_CHANNELS            16
+
+// Frame classes, plus frames that came without a header
+#define AIRTIME_CLASS_NO_HEADER     FRAME_CLASS_COUNT
+#define AIRTIME_CLASSES             ( FRAME_CLASS_COUNT + 1 )
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t unknown;                               // Frames of unknown rate, no airtime
+    uint32_t airtimeUs;
+    uint32_t channels[ AIRTIME_CHANNELS ];          // us by rx_ctrl.channel
+    uint32_t classes[ AIRTIME_CLASSES ];            // us by frame class
+} tAirtimeBank;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Clear all statistics. Must not be called while the RX callback is
+ * active.
+ */
+void IAirtime_Init( void );
+
+/**
+ * Get the time a frame took on the air, from the start of the
+ * preamble to the end of the last symbol.
+ *
+ * @param  pRx    RX control of the frame
+ * @param  length PSDU length in bytes, FCS and A-MPDU framing included
+ * @return Duration in us, 0 if the rate is unknown.
+ */
+uint32_t IAirtime_Duration( const tRxControl* pRx, uint16_t length );
+
+/**
+ * Account a received frame. Safe to call from the RX callback.
+ *
+ * @param  pRx        RX control of the frame
+ * @param  length     PSDU length, see IAirtime_Duration()
+ * @param  frameClass Frame class or AIRTIME_CLASS_NO_HEADER
+ * @return Duration in us, 0 if the rate is unknown.
+ */
+uint32_t IAirtime_Count( const tRxControl* pRx, uint16_t length, uint8_t frameClass );
+
+/**
+ * Retire the active interval and start a new one.
+ *
+ * @return Retired interval, valid until the next call.
+ */
+const tAirtimeBank* IAirtime_Swap( void );
+
+/**
+ * Get the share of time the medium was busy.
+ *
+ * @param  airtimeUs Airtime heard
+ * @param  ms        Time spent listening
+ * @return Utilisation in 1/10 percent, at most 1000.
+ */
+uint16_t IAirtime_Utilisation( uint32_t airtimeUs, uint32_t ms );
+
+#endif // IAIRTIME_H
@@ -0,0 +1,587 @@
+/**
+ * @file    ApInventory.cpp
+ * @brief   Access points heard from, built from beacons and probe
+ *          responses alone.
+ *
+ *          Only the RX callback writes to the entries. Changes to
+ *          anything but the counters, RSSI and time bump the slot's
+ *          version after the write; loop() copies an entry and retries
+ *          if the version moved meanwhile. The callback always runs to
+ *          completion before loop() continues, so that is enough to
+ *          never report a half written SSID.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include <FrameClass/IFrameClass.h>
+#include <FrameView/IFrameView.h>
+
+#include "ApInventory.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    tAccessPoint ap;
+    uint8_t      version;           // Written from RX callback only
+} tApSlot;
+
+typedef struct
+{
+    tApSlot      slots[ AP_INVENTORY_SLOTS ];
+    tAccessPoint reported[ AP_INVENTORY_SLOTS ];    // loop() only, frames = 0 if not listed
+    uint8_t      cursor;                            // loop() only, next slot to poll
+    uint32_t     frames;            // Written from RX callback only
+    uint32_t     malformed;         // Written from RX callback only
+    uint32_t     inserted;          // Written from RX callback only
+    uint32_t     updated;           // Written from RX callback only
+    uint32_t     expired;           // Written from RX callback only
+    uint32_t     evicted;           // Written from RX callback only
+} tApInventoryVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static tAccessPoint* findSlot( const uint8_t* pBssid, uint32_t nowMs, uint8_t** ppVersion );
+static void parseBeacon( const tFrameView* pView, const uint8_t* pBody, tAccessPoint* pHeard );
+static uint8_t parseSecurity( const uint8_t* pData, uint8_t length, const uint8_t* pOui );
+static uint8_t suiteSecurity( const uint8_t* pSuite, const uint8_t* pOui, bool akm );
+static uint8_t mergeHeard( tAccessPoint* pAp, const tAccessPoint* pHeard, bool beacon );
+static uint8_t compareReported( const tAccessPoint* pReported, const tAccessPoint* pAp );
+static void copySlot( uint8_t index, tAccessPoint* pAp );
+static inline bool isActive( const tAccessPoint* pAp, uint32_t nowMs );
+static inline uint32_t hashBssid( const uint8_t* pBssid );
+static inline uint32_t mix32( uint32_t value );
+static inline void countEvent( uint32_t* pCounter );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tApInventoryVars apInventoryVars;
+
+static const uint8_t rsnOui[ 3 ] = { 0x00, 0x0F, 0xAC };
+static const uint8_t wpaOui[ 3 ] = { 0x00, 0x50, 0xF2 };
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IApInventory_Init( void )
+{
+    memset( &apInventoryVars, 0, sizeof( apInventoryVars ) );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool IApInventory_Update( const uint8_t* pFrame, uint16_t captured, int8_t rssi, uint8_t rxChannel, uint32_t nowMs, tAccessPoint* pHeard )
+{
+    tFrameView     view;
+    const uint8_t* pBody;
+    uint16_t       bodyLength;
+
+    countEvent( &apInventoryVars.frames );
+    if ( !IFrameView_Init( &view, pFrame, captured )
+      || !IFrameView_Body( &view, &pBody, &bodyLength )
+      || bodyLength < AP_BODY_FIXED_LEN )
+    {
+        countEvent( &apInventoryVars.malformed );
+        return false;
+    }
+
+    const uint8_t* pBssid = &pFrame[ FRAME_ADDR3_OFFSET ];
+    memset( pHeard, 0, sizeof( *pHeard ) );
+    memcpy( pHeard->bssid, pBssid, sizeof( pHeard->bssid ) );
+    parseBeacon( &view, pBody, pHeard );
+
+    uint8_t*       pVersion;
+    tAccessPoint*  pAp     = findSlot( pBssid, nowMs, &pVersion );
+    bool           beacon  = view.frameClass == MANAGEMENT_TYPE_BEACON;
+
+    if ( pAp->frames == 0 || memcmp( pAp->bssid, pBssid, sizeof( pAp->bssid ) ) != 0 )
+    {
+        // New, or replacing one in place; the slot keeps its position
+        // in the probe sequence of any other access point
+        memset( pAp, 0, sizeof( *pAp ) );
+        memcpy( pAp->bssid, pBssid, sizeof( pAp->bssid ) );
+        pAp->channel     = rxChannel;
+        pAp->rssiAvg     = (int16_t)( rssi * AP_RSSI_SCALE );
+        pAp->firstSeenMs = nowMs;
+        mergeHeard( pAp, pHeard, beacon );
+        __atomic_store_n( pVersion, (uint8_t)( *pVersion + 1 ), __ATOMIC_RELEASE );
+        countEvent( &apInventoryVars.inserted );
+    }
+    else
+    {
+        if ( mergeHeard( pAp, pHeard, beacon ) != 0 )
+        {
+            __atomic_store_n( pVersion, (uint8_t)( *pVersion + 1 ), __ATOMIC_RELEASE );
+            countEvent( &apInventoryVars.updated );
+        }
+        pAp->rssiAvg = (int16_t)( pAp->rssiAvg + ( ( rssi * AP_RSSI_SCALE - pAp->rssiAvg ) >> AP_RSSI_SHIFT ) );
+    }
+    ++pAp->frames;
+    pAp->lastSeenMs = nowMs;
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool IApInventory_PollChange( uint32_t nowMs, tApChange* pChange )
+{
+    for ( uint32_t n = 0; n < AP_INVENTORY_SLOTS; ++n )
+    {
+        // Carry on where the last change was found, so a burst of
+        // changes in the first slots can't hold back the rest
+        uint8_t       index     = apInventoryVars.cursor;
+        tAccessPoint* pReported = &apInventoryVars.reported[ index ];
+        apInventoryVars.cursor  = ( index + 1 ) & AP_INVENTORY_MASK;
+
+        tAccessPoint ap;
+        copySlot( index, &ap );
+        bool same = ap.frames != 0 && memcmp( ap.bssid, pReported->bssid, sizeof( ap.bssid ) ) == 0;
+
+        if ( pReported->frames != 0 )
+        {
+            if ( !same )
+            {
+                // Replaced before it was seen to go quiet, look at the
+                // slot again for its new occupant
+                pChange->type   = AP_CHANGE_GONE;
+                pChange->fields = 0;
+                pChange->ap     = *pReported;
+                pReported->frames      = 0;
+                apInventoryVars.cursor = index;
+                return true;
+            }
+            if ( !isActive( &ap, nowMs ) )
+            {
+                pChange->type   = AP_CHANGE_GONE;
+                pChange->fields = 0;
+                pChange->ap     = ap;
+                pReported->frames = 0;
+                return true;
+            }
+
+            uint8_t fields = compareReported( pReported, &ap );
+            if ( fields != 0 )
+            {
+                pChange->type   = AP_CHANGE_UPDATED;
+                pChange->fields = fields;
+                pChange->ap     = ap;
+                *pReported      = ap;
+                return true;
+            }
+        }
+        else if ( ap.frames != 0 && isActive( &ap, nowMs ) )
+        {
+            pChange->type   = AP_CHANGE_NEW;
+            pChange->fields = 0;
+            pChange->ap     = ap;
+            *pReported      = ap;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IApInventory_GetStats( uint32_t nowMs, tApInventoryStats* pStats )
+{
+    pStats->active = 0;
+    for ( uint32_t i = 0; i < AP_INVENTORY_SLOTS; ++i )
+    {
+        const tAccessPoint* pAp = &apInventoryVars.slots[ i ].ap;
+        if ( pAp->frames != 0 && isActive( pAp, nowMs ) )
+        {
+            ++pStats->active;
+        }
+    }
+    pStats->frames    = __atomic_load_n( &apInventoryVars.frames,    __ATOMIC_RELAXED );
+    pStats->malformed = __atomic_load_n( &apInventoryVars.malformed, __ATOMIC_RELAXED );
+    pStats->inserted  = __atomic_load_n( &apInventoryVars.inserted,  __ATOMIC_RELAXED );
+    pStats->updated   = __atomic_load_n( &apInventoryVars.updated,   __ATOMIC_RELAXED );
+    pStats->expired   = __atomic_load_n( &apInventoryVars.expired,   __ATOMIC_RELAXED );
+    pStats->evicted   = __atomic_load_n( &apInventoryVars.evicted,   __ATOMIC_RELAXED );
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static tAccessPoint* findSlot( const uint8_t* pBssid, uint32_t nowMs, uint8_t** ppVersion )
+{
+    uint32_t index     = hashBssid( pBssid );
+    tApSlot* pVictim   = NULL;
+    uint32_t victimAge = 0;
+
+    for ( uint8_t probe = 0; probe < AP_INVENTORY_PROBE_LIMIT; ++probe, index = ( index + 1 ) & AP_INVENTORY_MASK )
+    {
+        tApSlot* pSlot = &apInventoryVars.slots[ index ];
+
+        // Slots are never freed, so the first free slot ends the
+        // sequence of access points that hashed here
+        if ( pSlot->ap.frames == 0 || memcmp( pSlot->ap.bssid, pBssid, sizeof( pSlot->ap.bssid ) ) == 0 )
+        {
+            *ppVersion = &pSlot->version;
+            return &pSlot->ap;
+        }
+
+        // Remember least recently heard in case the window is full
+        uint32_t age = nowMs - pSlot->ap.lastSeenMs;
+        if ( pVictim == NULL || age > victimAge )
+        {
+            pVictim   = pSlot;
+            victimAge = age;
+        }
+    }
+
+    countEvent( victimAge > AP_INVENTORY_MAX_AGE_MS ? &apInventoryVars.expired : &apInventoryVars.evicted );
+    *ppVersion = &pVictim->version;
+    return &pVictim->ap;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void parseBeacon( const tFrameView* pView, const uint8_t* pBody, tAccessPoint* pHeard )
+{
+    uint16_t interval   = (uint16_t)( pBody[ AP_BODY_INTERVAL_OFFSET ] | ( pBody[ AP_BODY_INTERVAL_OFFSET + 1 ] << 8 ) );
+    uint16_t capability = (uint16_t)( pBody[ AP_BODY_CAPABILITY_OFFSET ] | ( pBody[ AP_BODY_CAPABILITY_OFFSET + 1 ] << 8 ) );
+
+    // Channel 0 and AP_FLAG_HIDDEN mark what the frame didn't tell
+    pHeard->ssidLength     = 0;
+    pHeard->channel        = 0;
+    pHeard->security       = ( capability & AP_CAPABILITY_PRIVACY ) ? AP_SECURITY_PRIVACY : 0;
+    pHeard->flags          = AP_FLAG_HIDDEN | ( ( capability & AP_CAPABILITY_IBSS ) ? AP_FLAG_IBSS : 0 );
+    pHeard->beaconInterval = interval;
+
+    tFrameIeIterator iter;
+    tFrameIe         ie;
+    bool             ssid     = false;
+    bool             elements = false;
+    if ( IFrameView_Ies( pView, &iter ) )
+    {
+        while ( IFrameView_NextIe( &iter, &ie ) )
+        {
+            // Only the first SSID counts, trailing padding or FCS
+            // bytes read as empty ones
+            if ( ie.id == FRAME_IE_SSID && !ssid && ie.available == ie.length && ie.length <= AP_SSID_MAX_LEN )
+            {
+                ssid = true;
+                // Hidden networks send an empty SSID, or one of zeros
+                for ( uint8_t i = 0; i < ie.length; ++i )
+                {
+                    if ( ie.pData[ i ] != 0 )
+                    {
+                        pHeard->flags &= (uint8_t)~AP_FLAG_HIDDEN;
+                        break;
+                    }
+                }
+                memcpy( pHeard->ssid, ie.pData, ie.length );
+                pHeard->ssidLength = ie.length;
+            }
+            else if ( ie.id == FRAME_IE_DS_PARAMS && ie.available >= 1 )
+            {
+                pHeard->channel = ie.pData[ 0 ];
+            }
+            else if ( ie.id == FRAME_IE_RSN )
+            {
+                pHeard->security |= AP_SECURITY_RSN | parseSecurity( ie.pData, ie.available, rsnOui );
+                elements = true;
+            }
+            else if ( ie.id == FRAME_IE_VENDOR && ie.available >= 4
+                   && memcmp( ie.pData, wpaOui, sizeof( wpaOui ) ) == 0 && ie.pData[ 3 ] == AP_WPA_IE_TYPE )
+            {
+                // Same layout as RSN after the OUI and type
+                pHeard->security |= AP_SECURITY_WPA | parseSecurity( &ie.pData[ 4 ], ie.available - 4, wpaOui );
+                elements = true;
+            }
+        }
+        elements = elements || IFrameView_IesComplete( &iter );
+    }
+
+    // Most beacons are cut at 112 bytes. Encrypted, with neither RSN
+    // nor WPA element among the captured ones and the rest missing,
+    // could be anything.
+    if ( !( pHeard->security & AP_SECURITY_PRIVACY ) || elements )
+    {
+        pHeard->flags |= AP_FLAG_SECURITY_KNOWN;
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint8_t parseSecurity( const uint8_t* pData, uint8_t length, const uint8_t* pOui )
+{
+    // Version, group cipher, pairwise cipher list, AKM list. Whatever
+    // was captured of it counts.
+    uint8_t  security = 0;
+    uint16_t offset   = 2;
+    if ( offset + 4 <= length )
+    {
+        security |= suiteSecurity( &pData[ offset ], pOui, false );
+        offset   += 4;
+    }
+    for ( uint8_t list = 0; list < 2; ++list )
+    {
+        if ( offset + 2 > length )
+        {
+            break;
+        }
+        uint16_t count = (uint16_t)( pData[ offset ] | ( pData[ offset + 1 ] << 8 ) );
+        offset += 2;
+        for ( ; count > 0 && offset + 4 <= length; --count, offset += 4 )
+        {
+            security |= suiteSecurity( &pData[ offset ], pOui, list == 1 );
+        }
+    }
+    return security;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint8_t suiteSecurity( const uint8_t* pSuite, const uint8_t* pOui, bool akm )
+{
+    // Vendor specific suites aren't known
+    if ( memcmp( pSuite, pOui, 3 ) != 0 )
+    {
+        return 0;
+    }
+
+    if ( akm )
+    {
+        switch ( pSuite[ 3 ] )
+        {
+            case AP_AKM_8021X:
+            case AP_AKM_FT_8021X:
+            case AP_AKM_8021X_SHA256: return AP_SECURITY_EAP;
+            case AP_AKM_PSK:
+            case AP_AKM_FT_PSK:
+            case AP_AKM_PSK_SHA256:   return AP_SECURITY_PSK;
+            case AP_AKM_SAE:
+            case AP_AKM_FT_SAE:       return AP_SECURITY_SAE;
+            default:                  return 0;
+        }
+    }
+
+    switch ( pSuite[ 3 ] )
+    {
+        case AP_SUITE_TKIP:     return AP_SECURITY_TKIP;
+        case AP_SUITE_CCMP:
+        case AP_SUITE_GCMP:
+        case AP_SUITE_GCMP_256:
+        case AP_SUITE_CCMP_256: return AP_SECURITY_CCMP;
+        default:                return 0;
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint8_t mergeHeard( tAccessPoint* pAp, const tAccessPoint* pHeard, bool beacon )
+{
+    uint8_t fields = 0;
+
+    // A hidden network's SSID is only learnt from probe responses,
+    // beacons must not wipe it again
+    if ( !( pHeard->flags & AP_FLAG_HIDDEN )
+      && ( pHeard->ssidLength != pAp->ssidLength || memcmp( pHeard->ssid, pAp->ssid, pHeard->ssidLength ) != 0 ) )
+    {
+        memcpy( pAp->ssid, pHeard->ssid, pHeard->ssidLength );
+        pAp->ssidLength = pHeard->ssidLength;
+        fields |= AP_FIELD_SSID;
+    }
+
+    // Without DS parameters it stays where it was first heard, frames
+    // leak into adjacent channels
+    if ( pHeard->channel != 0 && pHeard->channel != pAp->channel )
+    {
+        pAp->channel = pHeard->channel;
+        fields |= AP_FIELD_CHANNEL;
+    }
+
+    // Don't let a truncated beacon undo what a complete one told
+    if ( ( ( pHeard->flags & AP_FLAG_SECURITY_KNOWN ) || !( pAp->flags & AP_FLAG_SECURITY_KNOWN ) )
+      && pHeard->security != pAp->security )
+    {
+        pAp->security = pHeard->security;
+        fields |= AP_FIELD_SECURITY;
+    }
+
+    if ( pHeard->beaconInterval != pAp->beaconInterval )
+    {
+        pAp->beaconInterval = pHeard->beaconInterval;
+        fields |= AP_FIELD_INTERVAL;
+    }
+
+    // Only beacons tell whether the SSID is hidden
+    uint8_t flags = pAp->flags | ( pHeard->flags & AP_FLAG_SECURITY_KNOWN );
+    if ( beacon )
+    {
+        flags = (uint8_t)( ( flags & ~( AP_FLAG_HIDDEN | AP_FLAG_IBSS ) ) | ( pHeard->flags & ( AP_FLAG_HIDDEN | AP_FLAG_IBSS ) ) );
+    }
+    if ( flags != pAp->flags )
+    {
+        pAp->flags = flags;
+        fields |= AP_FIELD_FLAGS;
+    }
+    return fields;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint8_t compareReported( const tAccessPoint* pReported, const tAccessPoint* pAp )
+{
+    uint8_t fields = 0;
+    if ( pReported->ssidLength != pAp->ssidLength || memcmp( pReported->ssid, pAp->ssid, pAp->ssidLength ) != 0 )
+    {
+        fields |= AP_FIELD_SSID;
+    }
+    if ( pReported->channel != pAp->channel )
+    {
+        fields |= AP_FIELD_CHANNEL;
+    }
+    if ( pReported->security != pAp->security )
+    {
+        fields |= AP_FIELD_SECURITY;
+    }
+    if ( pReported->beaconInterval != pAp->beaconInterval )
+    {
+        fields |= AP_FIELD_INTERVAL;
+    }
+    if ( ( pReported->flags ^ pAp->flags ) & ( AP_FLAG_HIDDEN | AP_FLAG_IBSS ) )
+    {
+        fields |= AP_FIELD_FLAGS;
+    }
+    return fields;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void copySlot( uint8_t index, tAccessPoint* pAp )
+{
+    const tApSlot* pSlot = &apInventoryVars.slots[ index ];
+    uint8_t        version;
+    do
+    {
+        version = __atomic_load_n( &pSlot->version, __ATOMIC_ACQUIRE );
+        memcpy( pAp, &pSlot->ap, sizeof( *pAp ) );
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    } while ( __atomic_load_n( &pSlot->version, __ATOMIC_RELAXED ) != version );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline bool isActive( const tAccessPoint* pAp, uint32_t nowMs )
+{
+    // The callback may have heard it after loop() read the clock
+    return (int32_t)( nowMs - pAp->lastSeenMs ) <= AP_INVENTORY_MAX_AGE_MS;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t hashBssid( const uint8_t* pBssid )
+{
+    // All 48 bits through the finalizer: a multiply only carries bits
+    // upward, so without the shifts the upper bytes never reach the
+    // slot bits
+    uint32_t low  = pBssid[ 0 ] | ( pBssid[ 1 ] << 8 ) | ( pBssid[ 2 ] << 16 ) | ( (uint32_t)pBssid[ 3 ] << 24 );
+    uint32_t high = pBssid[ 4 ] | ( pBssid[ 5 ] << 8 );
+    return mix32( low ^ mix32( high ) ) & AP_INVENTORY_MASK;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t mix32( uint32_t value )
+{
+    // MurmurHash3 finalizer
+    value ^= value >> 16;
+    value *= 0x85EBCA6Bu;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35u;
+    value ^= value >> 16;
+    return value;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline void countEvent( uint32_t* pCounter )
+{
+    __atomic_store_n( pCounter, *pCounter + 1, __ATOMIC_RELAXED );
+}
@@ -0,0 +1,83 @@
+/**
+ * @file    ApInventory.h
+ * @brief   Access point inventory private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef APINVENTORY_H
+#define APINVENTORY_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IApInventory.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#if ( AP_INVENTORY_SLOTS & ( AP_INVENTORY_SLOTS - 1 ) ) != 0
+#error "AP_INVENTORY_SLOTS must be a power of two"
+#endif
+
+#if AP_INVENTORY_PROBE_LIMIT > AP_INVENTORY_SLOTS
+#error "AP_INVENTORY_PROBE_LIMIT must not exceed AP_INVENTORY_SLOTS"
+#endif
+
+#if AP_INVENTORY_SLOTS > 256
+#error "AP_INVENTORY_SLOTS must not exceed 256"
+#endif
+
+#define AP_INVENTORY_MASK           ( AP_INVENTORY_SLOTS - 1 )
+
+// Smoothing of RSSI, new = old + ( sample - old ) / 2^N
+#define AP_RSSI_SHIFT               3
+
+// Fixed fields of beacons and probe responses
+#define AP_BODY_INTERVAL_OFFSET     8
+#define AP_BODY_CAPABILITY_OFFSET   10
+#define AP_BODY_FIXED_LEN           12
+
+// Capability information
+#define AP_CAPABILITY_IBSS          0x0002
+#define AP_CAPABILITY_PRIVACY       0x0010
+
+// Cipher and AKM suite types, same numbers for RSN (00-0F-AC) and
+// WPA (00-50-F2)
+#define AP_SUITE_TKIP               2
+#define AP_SUITE_CCMP               4
+#define AP_SUITE_GCMP               8
+#define AP_SUITE_GCMP_256           9
+#define AP_SUITE_CCMP_256           10
+#define AP_AKM_8021X                1
+#define AP_AKM_PSK                  2
+#define AP_AKM_FT_8021X             3
+#define AP_AKM_FT_PSK               4
+#define AP_AKM_8021X_SHA256         5
+#define AP_AKM_PSK_SHA256           6
+#define AP_AKM_SAE                  8
+#define AP_AKM_FT_SAE               9
+
+// WPA vendor element: Microsoft OUI, type 1
+#define AP_WPA_IE_TYPE              1
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // APINVENTORY_H
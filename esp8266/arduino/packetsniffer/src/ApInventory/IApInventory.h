@@ -0,0 +1,175 @@
+/**
+ * @file    IApInventory.h
+ * @brief   Access points heard from, built from beacons and probe
+ *          responses alone.
+ *
+ *          Access points are keyed on BSSID in a statically allocated
+ *          open addressing table, like the station table: linear
+ *          probing within AP_INVENTORY_PROBE_LIMIT slots, least
+ *          recently heard replaced when the window is full, slots
+ *          never emptied.
+ *
+ *          The RX callback keeps the entries up to date. loop() polls
+ *          for what changed since it last asked (new access points,
+ *          changed SSID/channel/security/beacon interval, access points
+ *          gone quiet), so only changes need to be printed or sent.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IAPINVENTORY_H
+#define IAPINVENTORY_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Number of slots, must be a power of two (about 60 bytes each, twice:
+// the callback's entry and loop()'s last reported copy)
+#ifndef AP_INVENTORY_SLOTS
+#define AP_INVENTORY_SLOTS          32
+#endif
+
+// Longest probe sequence, bounds the cost of an update
+#ifndef AP_INVENTORY_PROBE_LIMIT
+#define AP_INVENTORY_PROBE_LIMIT    4
+#endif
+
+// Access points not heard from in this long are reported gone and
+// first in line for replacement
+#ifndef AP_INVENTORY_MAX_AGE_MS
+#define AP_INVENTORY_MAX_AGE_MS     60000
+#endif
+
+// Longest SSID
+#define AP_SSID_MAX_LEN             32
+
+// RSSI average is kept in 1/16 dB
+#define AP_RSSI_SCALE               16
+
+// Security, from the capability privacy bit and the RSN and WPA
+// elements. GCMP and CCMP-256 count as CCMP.
+#define AP_SECURITY_PRIVACY         0x01    // Encrypted, WEP if nothing else is set
+#define AP_SECURITY_WPA             0x02    // WPA element
+#define AP_SECURITY_RSN             0x04    // RSN element (WPA2/WPA3)
+#define AP_SECURITY_PSK             0x08
+#define AP_SECURITY_EAP             0x10    // 802.1X
+#define AP_SECURITY_SAE             0x20    // WPA3 personal
+#define AP_SECURITY_TKIP            0x40
+#define AP_SECURITY_CCMP            0x80
+
+// Flags
+#define AP_FLAG_HIDDEN              0x01    // Beacons carry no SSID
+#define AP_FLAG_IBSS                0x02    // Ad-hoc network
+#define AP_FLAG_SECURITY_KNOWN      0x04    // Security elements seen or known absent
+
+// Fields of an AP_CHANGE_UPDATED
+#define AP_FIELD_SSID               0x01
+#define AP_FIELD_CHANNEL            0x02
+#define AP_FIELD_SECURITY           0x04
+#define AP_FIELD_INTERVAL           0x08
+#define AP_FIELD_FLAGS              0x10
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint8_t  bssid[ 6 ];
+    uint8_t  ssid[ AP_SSID_MAX_LEN ];   // Not terminated
+    uint8_t  ssidLength;
+    uint8_t  channel;                   // From DS parameters, else where heard
+    uint8_t  security;                  // AP_SECURITY_...
+    uint8_t  flags;                     // AP_FLAG_...
+    uint16_t beaconInterval;            // TU (1024 us)
+    int16_t  rssiAvg;                   // Smoothed RSSI, dBm * AP_RSSI_SCALE
+    uint32_t frames;                    // Beacons and probe responses, 0 = free slot
+    uint32_t firstSeenMs;
+    uint32_t lastSeenMs;
+} tAccessPoint;
+
+typedef enum
+{
+    AP_CHANGE_NEW               = 1,    // Heard for the first time, or again after gone
+    AP_CHANGE_UPDATED           = 2,    // See fields
+    AP_CHANGE_GONE              = 3     // Not heard in AP_INVENTORY_MAX_AGE_MS, or replaced
+} tApChangeType;
+
+typedef struct
+{
+    tApChangeType type;
+    uint8_t       fields;               // AP_FIELD_..., AP_CHANGE_UPDATED only
+    tAccessPoint  ap;                   // As it is now, or was last reported if gone
+} tApChange;
+
+// Running totals since IApInventory_Init()
+typedef struct
+{
+    uint32_t frames;        // Beacons and probe responses looked at
+    uint32_t malformed;     // Too short to hold the fixed fields
+    uint32_t active;        // Access points heard within AP_INVENTORY_MAX_AGE_MS
+    uint32_t inserted;      // New access points
+    uint32_t updated;       // Changes to SSID, channel, security, interval
+    uint32_t expired;       // Inactive access points replaced
+    uint32_t evicted;       // Active access points replaced, table too small
+} tApInventoryStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Empty the inventory and reset statistics.
+ */
+void IApInventory_Init( void );
+
+/**
+ * Update the inventory from a beacon or probe response. Bounded cost,
+ * safe to call from the RX callback.
+ *
+ * @param  pFrame    Frame, starting at frame control
+ * @param  captured  Number of bytes at pFrame
+ * @param  rssi      RSSI of the frame (dBm)
+ * @param  rxChannel Channel the frame was received on
+ * @param  nowMs     Current time
+ * @param  pHeard    Output, what the frame itself told; channel 0
+ *                   without DS parameters, no RSSI or timestamps
+ * @return FALSE if the frame was too short to look at.
+ */
+bool IApInventory_Update( const uint8_t* pFrame, uint16_t captured, int8_t rssi, uint8_t rxChannel, uint32_t nowMs, tAccessPoint* pHeard );
+
+/**
+ * Get the next change since the last call. Call from loop() only;
+ * it keeps a copy of what was last reported per slot to compare with.
+ *
+ * @param  nowMs   Current time
+ * @param  pChange Output
+ * @return FALSE when nothing changed.
+ */
+bool IApInventory_PollChange( uint32_t nowMs, tApChange* pChange );
+
+/**
+ * Get inventory statistics. Walks the whole table, call from loop().
+ *
+ * @param  nowMs  Current time
+ * @param  pStats Output
+ */
+void IApInventory_GetStats( uint32_t nowMs, tApInventoryStats* pStats );
+
+#endif // IAPINVENTORY_H
@@ -0,0 +1,571 @@
+/**
+ * @file    BeaconDetector.cpp
+ * @brief   Beacon flood and evil twin detector.
+ *
+ *          SSIDs are hashed once per beacon; the hash picks the start
+ *          of a probe sequence of at most BEACON_PROBE_LIMIT entries
+ *          and is compared before the SSID bytes are. Entries are never
+ *          emptied, the least recently heard in the window is replaced
+ *          when it is full, like the access point inventory. A flood of
+ *          random SSIDs simply cycles through the index.
+ *
+ *          Whether a pair was heard before is up to two Bloom filters,
+ *          bits picked by double hashing the SSID hash carried on over
+ *          the BSSID. A pair is added to the current filter and looked
+ *          up in both; when the current one is full the older one is
+ *          cleared and takes over, so pairs not heard for two fills
+ *          are forgotten and a flood can't saturate them.
+ *
+ *          Only the RX callback writes to the index. Alarms go through
+ *          a single producer, single consumer queue to loop().
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include "BeaconDetector.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint8_t  bssid[ 6 ];
+    uint8_t  channel;                   // From DS parameters, 0 = not known
+    uint8_t  security;                  // AP_SECURITY_... within BEACON_SECURITY_MASK
+    uint8_t  flags;                     // BEACON_BSSID_...
+    uint8_t  switches;                  // Channel switches since switchMs
+    uint32_t switchMs;
+    uint32_t lastSeenMs;
+} tKnownBssid;
+
+typedef struct
+{
+    uint32_t    beacons;                // 0 = free slot
+    uint32_t    hash;
+    uint32_t    firstSeenMs;
+    uint32_t    lastSeenMs;
+    uint8_t     ssid[ AP_SSID_MAX_LEN ];
+    uint8_t     ssidLength;
+    uint8_t     flags;                  // BEACON_SSID_...
+    uint16_t    channels;               // Bit per channel its BSSIDs used
+    uint32_t    securityRaisedMs;       // BEACON_SSID_SECURITY_RAISED at
+    uint32_t    bssidRaisedMs;          // BEACON_SSID_BSSID_RAISED at
+    tKnownBssid bssids[ BEACON_BSSIDS_PER_SSID ];
+} tSsidEntry;
+
+typedef struct
+{
+    tSsidEntry   entries[ BEACON_SSID_SLOTS ];
+    uint16_t     buckets[ BEACON_WHEEL_SLOTS ];  // New pairs per bucket, saturating
+    uint16_t     windowPairs;                    // Sum of buckets
+    uint32_t     lastTick;                       // Bucket of most recent new pair
+    bool         floodAlarmed;
+    uint32_t     pairs[ 2 ][ BEACON_PAIR_BITS / 32 ];    // Bloom filters of pairs heard
+    uint8_t      pairFilter;                     // The one pairs are added to
+    uint16_t     pairsAdded;                     // To it
+    tBeaconAlarm alarms[ BEACON_ALARM_SLOTS ];
+    uint32_t     alarmHead;                      // Written from RX callback only
+    uint32_t     alarmTail;                      // Written from loop() only
+    uint32_t     beacons;                        // Written from RX callback only
+    uint32_t     hidden;                         // Written from RX callback only
+    uint32_t     newPairs;                       // Written from RX callback only
+    uint32_t     replaced;                       // Written from RX callback only
+    uint32_t     floods;                         // Written from RX callback only
+    uint32_t     security;                       // Written from RX callback only
+    uint32_t     channel;                        // Written from RX callback only
+    uint32_t     bssid;                          // Written from RX callback only
+    uint32_t     dropped;                        // Written from RX callback only
+} tBeaconDetectorVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static tSsidEntry* findEntry( const tAccessPoint* pHeard, uint32_t hash, uint32_t nowMs );
+static void checkKnown( tKnownBssid* pKnown, const tAccessPoint* pHeard, uint32_t nowMs );
+static void checkNew( tSsidEntry* pEntry, const tAccessPoint* pHeard, uint32_t nowMs );
+static void countFlood( const tAccessPoint* pHeard, uint32_t nowMs );
+static bool rememberPair( uint32_t hash, const uint8_t* pBssid );
+static inline uint16_t channelBit( uint8_t channel );
+static inline bool isArmed( const tSsidEntry* pEntry, uint8_t flag, uint32_t raisedMs, uint32_t nowMs );
+static void raiseAlarm( tBeaconAlarmType type, const tAccessPoint* pHeard, const tKnownBssid* pOther, uint16_t count, uint32_t nowMs );
+static inline uint32_t hashSsid( const uint8_t* pSsid, uint8_t length );
+static inline void countEvent( uint32_t* pCounter );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tBeaconDetectorVars beaconDetectorVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IBeaconDetector_Init( void )
+{
+    memset( &beaconDetectorVars, 0, sizeof( beaconDetectorVars ) );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IBeaconDetector_Check( const tAccessPoint* pHeard, uint32_t nowMs )
+{
+    countEvent( &beaconDetectorVars.beacons );
+    if ( pHeard->ssidLength == 0 || ( pHeard->flags & AP_FLAG_HIDDEN ) )
+    {
+        countEvent( &beaconDetectorVars.hidden );
+        return;
+    }
+
+    tSsidEntry* pEntry = findEntry( pHeard, hashSsid( pHeard->ssid, pHeard->ssidLength ), nowMs );
+    ++pEntry->beacons;
+    pEntry->lastSeenMs = nowMs;
+
+    for ( uint8_t i = 0; i < BEACON_BSSIDS_PER_SSID; ++i )
+    {
+        tKnownBssid* pKnown = &pEntry->bssids[ i ];
+        if ( ( pKnown->flags & BEACON_BSSID_USED ) && memcmp( pKnown->bssid, pHeard->bssid, sizeof( pKnown->bssid ) ) == 0 )
+        {
+            checkKnown( pKnown, pHeard, nowMs );
+            pEntry->channels |= channelBit( pHeard->channel );
+            return;
+        }
+    }
+    checkNew( pEntry, pHeard, nowMs );
+    pEntry->channels |= channelBit( pHeard->channel );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool IBeaconDetector_PollAlarm( tBeaconAlarm* pAlarm )
+{
+    uint32_t tail = beaconDetectorVars.alarmTail;
+    if ( tail == __atomic_load_n( &beaconDetectorVars.alarmHead, __ATOMIC_ACQUIRE ) )
+    {
+        return false;
+    }
+
+    *pAlarm = beaconDetectorVars.alarms[ tail & BEACON_ALARM_MASK ];
+    __atomic_store_n( &beaconDetectorVars.alarmTail, tail + 1, __ATOMIC_RELEASE );
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IBeaconDetector_GetStats( tBeaconDetectorStats* pStats )
+{
+    pStats->ssids = 0;
+    for ( uint32_t i = 0; i < BEACON_SSID_SLOTS; ++i )
+    {
+        pStats->ssids += beaconDetectorVars.entries[ i ].beacons != 0;
+    }
+    pStats->beacons  = __atomic_load_n( &beaconDetectorVars.beacons,  __ATOMIC_RELAXED );
+    pStats->hidden   = __atomic_load_n( &beaconDetectorVars.hidden,   __ATOMIC_RELAXED );
+    pStats->newPairs = __atomic_load_n( &beaconDetectorVars.newPairs, __ATOMIC_RELAXED );
+    pStats->replaced = __atomic_load_n( &beaconDetectorVars.replaced, __ATOMIC_RELAXED );
+    pStats->floods   = __atomic_load_n( &beaconDetectorVars.floods,   __ATOMIC_RELAXED );
+    pStats->security = __atomic_load_n( &beaconDetectorVars.security, __ATOMIC_RELAXED );
+    pStats->channel  = __atomic_load_n( &beaconDetectorVars.channel,  __ATOMIC_RELAXED );
+    pStats->bssid    = __atomic_load_n( &beaconDetectorVars.bssid,    __ATOMIC_RELAXED );
+    pStats->dropped  = __atomic_load_n( &beaconDetectorVars.dropped,  __ATOMIC_RELAXED );
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static tSsidEntry* findEntry( const tAccessPoint* pHeard, uint32_t hash, uint32_t nowMs )
+{
+    uint32_t    index     = ( hash ^ ( hash >> 16 ) ) & BEACON_SSID_MASK;
+    tSsidEntry* pVictim   = NULL;
+    uint32_t    victimAge = 0;
+
+    for ( uint8_t probe = 0; probe < BEACON_PROBE_LIMIT; ++probe, index = ( index + 1 ) & BEACON_SSID_MASK )
+    {
+        tSsidEntry* pEntry = &beaconDetectorVars.entries[ index ];
+
+        // Entries are never freed, so the first free one ends the
+        // sequence of SSIDs that hashed here
+        if ( pEntry->beacons == 0 )
+        {
+            pVictim = pEntry;
+            break;
+        }
+        if ( pEntry->hash == hash && pEntry->ssidLength == pHeard->ssidLength
+          && memcmp( pEntry->ssid, pHeard->ssid, pHeard->ssidLength ) == 0 )
+        {
+            return pEntry;
+        }
+
+        // Remember least recently heard in case the window is full
+        uint32_t age = nowMs - pEntry->lastSeenMs;
+        if ( pVictim == NULL || age > victimAge )
+        {
+            pVictim   = pEntry;
+            victimAge = age;
+        }
+    }
+
+    if ( pVictim->beacons != 0 )
+    {
+        countEvent( &beaconDetectorVars.replaced );
+    }
+
+    // Learning starts over for a replaced SSID
+    memset( pVictim, 0, sizeof( *pVictim ) );
+    pVictim->hash        = hash;
+    pVictim->firstSeenMs = nowMs;
+    memcpy( pVictim->ssid, pHeard->ssid, pHeard->ssidLength );
+    pVictim->ssidLength  = pHeard->ssidLength;
+    return pVictim;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void checkKnown( tKnownBssid* pKnown, const tAccessPoint* pHeard, uint32_t nowMs )
+{
+    pKnown->lastSeenMs = nowMs;
+
+    // Same BSSID, other security: a clone beaconing next to it. Raised
+    // once, the two keep taking turns.
+    if ( pHeard->flags & AP_FLAG_SECURITY_KNOWN )
+    {
+        uint8_t security = pHeard->security & BEACON_SECURITY_MASK;
+        if ( ( pKnown->flags & BEACON_BSSID_SECURITY_KNOWN ) && security != pKnown->security
+          && !( pKnown->flags & BEACON_BSSID_SECURITY_RAISED ) )
+        {
+            raiseAlarm( BEACON_ALARM_SECURITY, pHeard, pKnown, 0, nowMs );
+            pKnown->flags |= BEACON_BSSID_SECURITY_RAISED;
+        }
+        pKnown->security = security;
+        pKnown->flags   |= BEACON_BSSID_SECURITY_KNOWN;
+    }
+
+    // An access point that moves switches once, a clone on another
+    // channel every time the sniffer hops between the two
+    if ( pHeard->channel == 0 || pHeard->channel == pKnown->channel )
+    {
+        return;
+    }
+    if ( pKnown->channel != 0 )
+    {
+        if ( pKnown->switches == 0 || nowMs - pKnown->switchMs > BEACON_TWIN_WINDOW_MS )
+        {
+            pKnown->switches = 1;
+            pKnown->switchMs = nowMs;
+        }
+        else if ( pKnown->switches < UINT8_MAX )
+        {
+            ++pKnown->switches;
+        }
+
+        if ( pKnown->switches >= 2 && !( pKnown->flags & BEACON_BSSID_CHANNEL_RAISED ) )
+        {
+            raiseAlarm( BEACON_ALARM_CHANNEL, pHeard, pKnown, 0, nowMs );
+            pKnown->flags |= BEACON_BSSID_CHANNEL_RAISED;
+        }
+    }
+    pKnown->channel = pHeard->channel;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void checkNew( tSsidEntry* pEntry, const tAccessPoint* pHeard, uint32_t nowMs )
+{
+    // Pairs the index dropped come back heard before, only the others
+    // are new
+    bool heardBefore = rememberPair( pEntry->hash, pHeard->bssid );
+    if ( !heardBefore )
+    {
+        countEvent( &beaconDetectorVars.newPairs );
+        countFlood( pHeard, nowMs );
+    }
+
+    // Compare with the access points heard with this SSID before, once
+    // per SSID and BEACON_REARM_MS for all BSSIDs it gets
+    bool         compare  = !heardBefore && isArmed( pEntry, BEACON_SSID_SECURITY_RAISED, pEntry->securityRaisedMs, nowMs );
+    uint8_t      security = pHeard->security & BEACON_SECURITY_MASK;
+    tKnownBssid* pVictim  = NULL;
+    tKnownBssid* pLatest  = NULL;
+    bool         mismatch = false;
+    for ( uint8_t i = 0; i < BEACON_BSSIDS_PER_SSID; ++i )
+    {
+        tKnownBssid* pKnown = &pEntry->bssids[ i ];
+        if ( !( pKnown->flags & BEACON_BSSID_USED ) )
+        {
+            pVictim = pKnown;
+            continue;
+        }
+
+        if ( compare && !mismatch && ( pHeard->flags & AP_FLAG_SECURITY_KNOWN )
+          && ( pKnown->flags & BEACON_BSSID_SECURITY_KNOWN ) && pKnown->security != security )
+        {
+            raiseAlarm( BEACON_ALARM_SECURITY, pHeard, pKnown, 0, nowMs );
+            pEntry->flags           |= BEACON_SSID_SECURITY_RAISED;
+            pEntry->securityRaisedMs = nowMs;
+            mismatch = true;
+        }
+
+        if ( pLatest == NULL || nowMs - pKnown->lastSeenMs < nowMs - pLatest->lastSeenMs )
+        {
+            pLatest = pKnown;
+        }
+        if ( pVictim == NULL || ( ( pVictim->flags & BEACON_BSSID_USED ) && nowMs - pKnown->lastSeenMs > nowMs - pVictim->lastSeenMs ) )
+        {
+            pVictim = pKnown;
+        }
+    }
+
+    // Past learning, a new access point for a known network stands out
+    // on a channel the network doesn't use. One on a channel it does
+    // use is as likely to be another access point of the ESS.
+    uint16_t channel = channelBit( pHeard->channel );
+    if ( !heardBefore && !mismatch && pLatest != NULL && nowMs - pEntry->firstSeenMs >= BEACON_LEARN_MS
+      && channel != 0 && !( pEntry->channels & channel )
+      && isArmed( pEntry, BEACON_SSID_BSSID_RAISED, pEntry->bssidRaisedMs, nowMs ) )
+    {
+        raiseAlarm( BEACON_ALARM_BSSID, pHeard, pLatest, 0, nowMs );
+        pEntry->flags        |= BEACON_SSID_BSSID_RAISED;
+        pEntry->bssidRaisedMs = nowMs;
+    }
+
+    memset( pVictim, 0, sizeof( *pVictim ) );
+    memcpy( pVictim->bssid, pHeard->bssid, sizeof( pVictim->bssid ) );
+    pVictim->channel    = pHeard->channel;
+    pVictim->security   = security;
+    pVictim->flags      = BEACON_BSSID_USED
+                        | ( ( pHeard->flags & AP_FLAG_SECURITY_KNOWN ) ? BEACON_BSSID_SECURITY_KNOWN : 0 )
+                        | ( mismatch ? BEACON_BSSID_SECURITY_RAISED : 0 );
+    pVictim->lastSeenMs = nowMs;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void countFlood( const tAccessPoint* pHeard, uint32_t nowMs )
+{
+    // Buckets between the last new pair and now fell out of the window
+    uint32_t tick    = nowMs >> BEACON_BUCKET_SHIFT;
+    uint32_t elapsed = tick - beaconDetectorVars.lastTick;
+    if ( elapsed >= BEACON_WHEEL_SLOTS )
+    {
+        memset( beaconDetectorVars.buckets, 0, sizeof( beaconDetectorVars.buckets ) );
+        beaconDetectorVars.windowPairs = 0;
+    }
+    else
+    {
+        for ( uint32_t i = 1; i <= elapsed; ++i )
+        {
+            uint16_t* pBucket = &beaconDetectorVars.buckets[ ( beaconDetectorVars.lastTick + i ) & BEACON_WHEEL_MASK ];
+            beaconDetectorVars.windowPairs -= *pBucket;
+            *pBucket = 0;
+        }
+    }
+    beaconDetectorVars.lastTick = tick;
+
+    uint16_t* pBucket = &beaconDetectorVars.buckets[ tick & BEACON_WHEEL_MASK ];
+    if ( *pBucket < UINT16_MAX / BEACON_WHEEL_SLOTS )
+    {
+        ++*pBucket;
+        ++beaconDetectorVars.windowPairs;
+    }
+
+    // Alarm on crossing the level, not on every beacon above it
+    if ( beaconDetectorVars.windowPairs >= BEACON_FLOOD_LEVEL )
+    {
+        if ( !beaconDetectorVars.floodAlarmed )
+        {
+            beaconDetectorVars.floodAlarmed = true;
+            raiseAlarm( BEACON_ALARM_FLOOD, pHeard, NULL, beaconDetectorVars.windowPairs, nowMs );
+        }
+    }
+    else
+    {
+        beaconDetectorVars.floodAlarmed = false;
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool rememberPair( uint32_t hash, const uint8_t* pBssid )
+{
+    // The SSID hash carried on over the BSSID, mixed so that every
+    // bit depends on all of it
+    for ( uint8_t i = 0; i < 6; ++i )
+    {
+        hash = ( hash ^ pBssid[ i ] ) * 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    uint32_t step = ( ( hash >> 16 ) | ( hash << 16 ) ) | 1;
+
+    uint32_t bits[ BEACON_PAIR_HASHES ];
+    uint8_t  found[ 2 ] = { 0, 0 };
+    for ( uint8_t i = 0; i < BEACON_PAIR_HASHES; ++i, hash += step )
+    {
+        bits[ i ] = hash & BEACON_PAIR_MASK;
+        for ( uint8_t filter = 0; filter < 2; ++filter )
+        {
+            found[ filter ] += ( beaconDetectorVars.pairs[ filter ][ bits[ i ] >> 5 ] >> ( bits[ i ] & 31 ) ) & 1;
+        }
+    }
+    if ( found[ 0 ] == BEACON_PAIR_HASHES || found[ 1 ] == BEACON_PAIR_HASHES )
+    {
+        return true;
+    }
+
+    if ( beaconDetectorVars.pairsAdded >= BEACON_PAIR_CAPACITY )
+    {
+        beaconDetectorVars.pairFilter ^= 1;
+        beaconDetectorVars.pairsAdded  = 0;
+        memset( beaconDetectorVars.pairs[ beaconDetectorVars.pairFilter ], 0, sizeof( beaconDetectorVars.pairs[ 0 ] ) );
+    }
+    for ( uint8_t i = 0; i < BEACON_PAIR_HASHES; ++i )
+    {
+        beaconDetectorVars.pairs[ beaconDetectorVars.pairFilter ][ bits[ i ] >> 5 ] |= 1u << ( bits[ i ] & 31 );
+    }
+    ++beaconDetectorVars.pairsAdded;
+    return false;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void raiseAlarm( tBeaconAlarmType type, const tAccessPoint* pHeard, const tKnownBssid* pOther, uint16_t count, uint32_t nowMs )
+{
+    switch ( type )
+    {
+        case BEACON_ALARM_FLOOD:    countEvent( &beaconDetectorVars.floods );   break;
+        case BEACON_ALARM_SECURITY: countEvent( &beaconDetectorVars.security ); break;
+        case BEACON_ALARM_CHANNEL:  countEvent( &beaconDetectorVars.channel );  break;
+        case BEACON_ALARM_BSSID:    countEvent( &beaconDetectorVars.bssid );    break;
+    }
+
+    uint32_t head = beaconDetectorVars.alarmHead;
+    if ( head - __atomic_load_n( &beaconDetectorVars.alarmTail, __ATOMIC_ACQUIRE ) >= BEACON_ALARM_SLOTS )
+    {
+        countEvent( &beaconDetectorVars.dropped );
+        return;
+    }
+
+    tBeaconAlarm* pAlarm = &beaconDetectorVars.alarms[ head & BEACON_ALARM_MASK ];
+    memset( pAlarm, 0, sizeof( *pAlarm ) );
+    pAlarm->type   = type;
+    pAlarm->heard  = *pHeard;
+    pAlarm->count  = count;
+    pAlarm->timeMs = nowMs;
+    if ( pOther != NULL )
+    {
+        memcpy( pAlarm->other, pOther->bssid, sizeof( pAlarm->other ) );
+        pAlarm->otherChannel  = pOther->channel;
+        pAlarm->otherSecurity = pOther->security;
+    }
+    __atomic_store_n( &beaconDetectorVars.alarmHead, head + 1, __ATOMIC_RELEASE );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t hashSsid( const uint8_t* pSsid, uint8_t length )
+{
+    // FNV-1a. The last bytes barely reach the high bits, SSIDs like
+    // "Net1" and "Net2" differ in little else, fold before masking.
+    uint32_t hash = 2166136261u;
+    for ( uint8_t i = 0; i < length; ++i )
+    {
+        hash = ( hash ^ pSsid[ i ] ) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint16_t channelBit( uint8_t channel )
+{
+    // 2.4 GHz channels, 0 is not known
+    return channel != 0 && channel < 16 ? (uint16_t)( 1u << channel ) : 0;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline bool isArmed( const tSsidEntry* pEntry, uint8_t flag, uint32_t raisedMs, uint32_t nowMs )
+{
+    return !( pEntry->flags & flag ) || nowMs - raisedMs >= BEACON_REARM_MS;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline void countEvent( uint32_t* pCounter )
+{
+    __atomic_store_n( pCounter, *pCounter + 1, __ATOMIC_RELAXED );
+}
@@ -0,0 +1,81 @@
+/**
+ * @file    BeaconDetector.h
+ * @brief   Beacon detector private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef BEACONDETECTOR_H
+#define BEACONDETECTOR_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IBeaconDetector.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#if ( BEACON_SSID_SLOTS & ( BEACON_SSID_SLOTS - 1 ) ) != 0
+#error "BEACON_SSID_SLOTS must be a power of two"
+#endif
+
+#if BEACON_PROBE_LIMIT > BEACON_SSID_SLOTS
+#error "BEACON_PROBE_LIMIT must not exceed BEACON_SSID_SLOTS"
+#endif
+
+#if ( BEACON_WHEEL_SLOTS & ( BEACON_WHEEL_SLOTS - 1 ) ) != 0
+#error "BEACON_WHEEL_SLOTS must be a power of two"
+#endif
+
+#if ( BEACON_ALARM_SLOTS & ( BEACON_ALARM_SLOTS - 1 ) ) != 0
+#error "BEACON_ALARM_SLOTS must be a power of two"
+#endif
+
+#if ( BEACON_PAIR_BITS & ( BEACON_PAIR_BITS - 1 ) ) != 0 || BEACON_PAIR_BITS < 32
+#error "BEACON_PAIR_BITS must be a power of two, at least 32"
+#endif
+
+#define BEACON_SSID_MASK            ( BEACON_SSID_SLOTS - 1 )
+#define BEACON_WHEEL_MASK           ( BEACON_WHEEL_SLOTS - 1 )
+#define BEACON_ALARM_MASK           ( BEACON_ALARM_SLOTS - 1 )
+#define BEACON_PAIR_MASK            ( BEACON_PAIR_BITS - 1 )
+
+// Bits set per pair, 3 is best for the filters' fill at capacity
+#define BEACON_PAIR_HASHES          3
+
+// Security compared between access points. Ciphers and key management
+// are left out, truncated beacons don't always carry all of them.
+#define BEACON_SECURITY_MASK        ( AP_SECURITY_PRIVACY | AP_SECURITY_WPA | AP_SECURITY_RSN )
+
+// Known BSSID flags, alarms already raised for it and what is known
+#define BEACON_BSSID_SECURITY_RAISED 0x01
+#define BEACON_BSSID_CHANNEL_RAISED  0x02
+#define BEACON_BSSID_SECURITY_KNOWN  0x40
+#define BEACON_BSSID_USED            0x80
+
+// SSID flags, alarms raised for BSSIDs not heard before, re-armed
+// BEACON_REARM_MS after
+#define BEACON_SSID_SECURITY_RAISED  0x01
+#define BEACON_SSID_BSSID_RAISED     0x02
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // BEACONDETECTOR_H
@@ -0,0 +1,202 @@
+/**
+ * @file    IBeaconDetector.h
+ * @brief   Beacon flood and evil twin detector.
+ *
+ *          Beacons are indexed by SSID in a statically allocated open
+ *          addressing table, each entry remembering the last few
+ *          BSSIDs that beaconed it. Per beacon that gives, at bounded
+ *          cost:
+ *
+ *            FLOOD     More than BEACON_FLOOD_LEVEL SSID/BSSID pairs
+ *                      never heard before within the window, the mark
+ *                      of tools beaconing random networks.
+ *            SECURITY  A BSSID advertises an SSID with other security
+ *                      (open, WEP, WPA, RSN) than a BSSID heard with it
+ *                      before, e.g. an open copy of a WPA2 network.
+ *                      Raised once per BSSID, and once per SSID within
+ *                      BEACON_REARM_MS for BSSIDs not heard before.
+ *            CHANNEL   One BSSID beacons on two channels by turns
+ *                      within BEACON_TWIN_WINDOW_MS, a clone of the
+ *                      access point on another channel. A channel
+ *                      change is only one switch.
+ *            BSSID     A BSSID not heard before shows up for an SSID
+ *                      known for at least BEACON_LEARN_MS, on a channel
+ *                      none of its BSSIDs have used. Raised once per
+ *                      SSID within BEACON_REARM_MS. Access points of an ESS added on channels
+ *                      it already uses are not reported.
+ *
+ *          Pairs heard are remembered in two Bloom filters taking
+ *          turns, apart from the index, so SSIDs and BSSIDs the index
+ *          had to drop are not new when they come back. A new pair
+ *          is taken for a known one about 5% of the time when the
+ *          filters are full.
+ *
+ *          Only the channel from DS parameters is trusted, frames leak
+ *          into adjacent channels. Hidden networks are skipped, all
+ *          of them share the empty SSID. Alarms are queued by the RX
+ *          callback and polled from loop().
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IBEACONDETECTOR_H
+#define IBEACONDETECTOR_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <ApInventory/IApInventory.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Number of SSIDs indexed, must be a power of two (about 220 bytes
+// each)
+#ifndef BEACON_SSID_SLOTS
+#define BEACON_SSID_SLOTS           32
+#endif
+
+// Longest probe sequence, bounds the cost of a beacon
+#ifndef BEACON_PROBE_LIMIT
+#define BEACON_PROBE_LIMIT          4
+#endif
+
+// BSSIDs remembered per SSID, the least recently heard is replaced.
+// Enough for the access points of an ESS in range, one that drops out
+// can't be followed across channels. Channels are remembered for all.
+#ifndef BEACON_BSSIDS_PER_SSID
+#define BEACON_BSSIDS_PER_SSID      8
+#endif
+
+// Bits of each of the two filters of pairs heard, must be a power of
+// two. A filter is cleared to take over once the other holds
+// BEACON_PAIR_CAPACITY pairs.
+#ifndef BEACON_PAIR_BITS
+#define BEACON_PAIR_BITS            4096
+#endif
+#ifndef BEACON_PAIR_CAPACITY
+#define BEACON_PAIR_CAPACITY        512
+#endif
+
+// New SSID/BSSID pairs per window that raise a flood alarm
+#ifndef BEACON_FLOOD_LEVEL
+#define BEACON_FLOOD_LEVEL          50
+#endif
+
+// Bucket width is 2^N ms, window is BEACON_WHEEL_SLOTS buckets
+// (default 8 x 256 ms, about one hop cycle)
+#ifndef BEACON_BUCKET_SHIFT
+#define BEACON_BUCKET_SHIFT         8
+#endif
+#define BEACON_WHEEL_SLOTS          8
+#define BEACON_WINDOW_MS            ( BEACON_WHEEL_SLOTS << BEACON_BUCKET_SHIFT )
+
+// An SSID must have been heard this long before a new BSSID for it is
+// an alarm, so the first hop cycles can learn all of its access points
+#ifndef BEACON_LEARN_MS
+#define BEACON_LEARN_MS             60000
+#endif
+
+// Channel switches of one BSSID this close together are a twin
+#ifndef BEACON_TWIN_WINDOW_MS
+#define BEACON_TWIN_WINDOW_MS       10000
+#endif
+
+// Alarms of an SSID for BSSIDs not heard before are raised once
+// within this long: an ESS being rolled out or a twin cycling through
+// BSSIDs is one alarm rather than a stream, a later attack is another
+#ifndef BEACON_REARM_MS
+#define BEACON_REARM_MS             30000
+#endif
+
+// Alarms queued for loop()
+#ifndef BEACON_ALARM_SLOTS
+#define BEACON_ALARM_SLOTS          8
+#endif
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef enum
+{
+    BEACON_ALARM_FLOOD          = 1,
+    BEACON_ALARM_SECURITY       = 2,
+    BEACON_ALARM_CHANNEL        = 3,
+    BEACON_ALARM_BSSID          = 4
+} tBeaconAlarmType;
+
+typedef struct
+{
+    tBeaconAlarmType type;
+    tAccessPoint     heard;         // Beacon that raised the alarm
+    uint8_t          other[ 6 ];    // BSSID it conflicts with, zero for FLOOD
+    uint8_t          otherChannel;  // CHANNEL: channel it was heard on before
+    uint8_t          otherSecurity; // SECURITY: AP_SECURITY_... of other
+    uint16_t         count;         // FLOOD: new pairs within the window
+    uint32_t         timeMs;
+} tBeaconAlarm;
+
+// Running totals since IBeaconDetector_Init()
+typedef struct
+{
+    uint32_t beacons;       // Beacons looked at
+    uint32_t hidden;        // Skipped, no SSID
+    uint32_t ssids;         // SSIDs in the index
+    uint32_t newPairs;      // SSID/BSSID pairs not heard before
+    uint32_t replaced;      // SSIDs dropped to make room
+    uint32_t floods;        // Alarms raised, by type
+    uint32_t security;
+    uint32_t channel;
+    uint32_t bssid;
+    uint32_t dropped;       // Alarms lost, queue full
+} tBeaconDetectorStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Empty the index and reset statistics.
+ */
+void IBeaconDetector_Init( void );
+
+/**
+ * Check a beacon. Bounded cost, safe to call from the RX callback.
+ *
+ * @param  pHeard What the beacon told, from IApInventory_Update()
+ * @param  nowMs  Current time
+ */
+void IBeaconDetector_Check( const tAccessPoint* pHeard, uint32_t nowMs );
+
+/**
+ * Get the next alarm raised since the last call. Cheap, call from
+ * every loop() to report alarms without waiting for the next
+ * statistics interval.
+ *
+ * @param  pAlarm Output
+ * @return FALSE if no alarm is queued.
+ */
+bool IBeaconDetector_PollAlarm( tBeaconAlarm* pAlarm );
+
+/**
+ * Get running statistics. Walks the whole index, call from loop().
+ *
+ * @param  pStats Output
+ */
+void IBeaconDetector_GetStats( tBeaconDetectorStats* pStats );
+
+#endif // IBEACONDETECTOR_H
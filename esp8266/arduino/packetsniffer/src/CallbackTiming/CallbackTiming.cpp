@@ -0,0 +1,229 @@
+/**
+ * @file    CallbackTiming.cpp
+ * @brief   How long the RX callback takes and how often it is called.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include "CallbackTiming.h"
+
+#if CALLBACK_TIMING && defined( __XTENSA__ )
+extern "C" {
+#include <user_interface.h>
+}
+#endif
+
+// Nothing below is built unless enabled
+#if CALLBACK_TIMING
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    tCallbackTimingBank banks[ CALLBACK_TIMING_BANKS ];
+    uint32_t            activeBank;
+    uint32_t            writerBusy;
+    uint32_t            lastStartTicks;     // Written from RX callback only
+    bool                started;            // Written from RX callback only
+} tCallbackTimingVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static inline uint8_t bucketOf( uint32_t ticks );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tCallbackTimingVars callbackTimingVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void ICallbackTiming_Init( void )
+{
+    memset( &callbackTimingVars, 0, sizeof( callbackTimingVars ) );
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void ICallbackTiming_Record( uint32_t startTicks, uint32_t stopTicks )
+{
+    uint32_t ticks = stopTicks - startTicks;
+    uint32_t gap   = startTicks - callbackTimingVars.lastStartTicks;
+    bool     first = !callbackTimingVars.started;
+    callbackTimingVars.lastStartTicks = startTicks;
+    callbackTimingVars.started        = true;
+
+    __atomic_store_n( &callbackTimingVars.writerBusy, 1, __ATOMIC_SEQ_CST );
+    uint32_t             active = __atomic_load_n( &callbackTimingVars.activeBank, __ATOMIC_SEQ_CST );
+    tCallbackTimingBank* pBank  = &callbackTimingVars.banks[ active ];
+
+    ++pBank->calls;
+    pBank->totalTicks += ticks;
+    if ( ticks > pBank->maxTicks )
+    {
+        pBank->maxTicks = ticks;
+    }
+    ++pBank->latency[ bucketOf( ticks ) ];
+
+    // Time between calls includes the time spent in the previous one
+    if ( !first )
+    {
+        ++pBank->gaps[ bucketOf( gap ) ];
+    }
+
+    __atomic_store_n( &callbackTimingVars.writerBusy, 0, __ATOMIC_RELEASE );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+const tCallbackTimingBank* ICallbackTiming_Swap( void )
+{
+    uint32_t retired = callbackTimingVars.activeBank;
+    uint32_t next    = retired ^ 1;
+
+    // Next bank still holds the interval returned by the previous call
+    memset( &callbackTimingVars.banks[ next ], 0, sizeof( tCallbackTimingBank ) );
+
+    __atomic_store_n( &callbackTimingVars.activeBank, next, __ATOMIC_SEQ_CST );
+    while ( __atomic_load_n( &callbackTimingVars.writerBusy, __ATOMIC_SEQ_CST ) != 0 )
+    {
+        // Callback still writing into retired bank
+    }
+
+    return &callbackTimingVars.banks[ retired ];
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint32_t ICallbackTiming_Percentile( const uint32_t* pBuckets, uint8_t percent )
+{
+    uint32_t total = 0;
+    for ( uint8_t bucket = 0; bucket < CALLBACK_TIMING_BUCKETS; ++bucket )
+    {
+        total += pBuckets[ bucket ];
+    }
+    if ( total == 0 )
+    {
+        return 0;
+    }
+
+    // Nearest rank
+    uint32_t rank = (uint32_t)( ( (uint64_t)total * percent + 99 ) / 100 );
+    if ( rank == 0 )
+    {
+        rank = 1;
+    }
+
+    uint32_t seen = 0;
+    for ( uint8_t bucket = 0; bucket < CALLBACK_TIMING_BUCKETS; ++bucket )
+    {
+        uint32_t count = pBuckets[ bucket ];
+        if ( seen + count >= rank )
+        {
+            if ( bucket == 0 )
+            {
+                return 0;
+            }
+
+            // Spread the calls evenly over the bucket, a log2 bucket is
+            // too coarse to report its bound as is
+            uint32_t low  = 1u << ( bucket - 1 );
+            uint32_t span = bucket < CALLBACK_TIMING_BUCKETS - 1 ? low : low * 2;
+            return low + (uint32_t)( (uint64_t)span * ( rank - seen ) / ( count + 1 ) );
+        }
+        seen += count;
+    }
+    return 0;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint32_t ICallbackTiming_TicksPerUs( void )
+{
+#if defined( __XTENSA__ )
+    return system_get_cpu_freq();
+#else
+    return CALLBACK_TIMING_HOST_TICKS_PER_US;
+#endif
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint32_t ICallbackTiming_ToNs( uint64_t ticks )
+{
+    uint64_t ns = ticks * 1000 / ICallbackTiming_TicksPerUs();
+    return ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint8_t bucketOf( uint32_t ticks )
+{
+    if ( ticks == 0 )
+    {
+        return 0;
+    }
+    uint8_t bucket = (uint8_t)( 32 - __builtin_clz( ticks ) );
+    return bucket < CALLBACK_TIMING_BUCKETS ? bucket : CALLBACK_TIMING_BUCKETS - 1;
+}
+
+#endif // CALLBACK_TIMING
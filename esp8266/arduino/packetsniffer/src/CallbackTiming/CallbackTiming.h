@@ -0,0 +1,44 @@
+/**
+ * @file    CallbackTiming.h
+ * @brief   Callback timing private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef CALLBACKTIMING_H
+#define CALLBACKTIMING_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "ICallbackTiming.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Double buffered, see ICallbackTiming_Swap()
+#define CALLBACK_TIMING_BANKS       2
+
+// Host ticks are nanoseconds
+#define CALLBACK_TIMING_HOST_TICKS_PER_US   1000
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // CALLBACKTIMING_H
@@ -0,0 +1,145 @@
+/**
+ * @file    ICallbackTiming.h
+ * @brief   How long the RX callback takes and how often it is called.
+ *
+ *          Build with -DCALLBACK_TIMING=1 to enable. The callback
+ *          reads the cycle counter (CCOUNT) on entry and exit and
+ *          counts its latency, and the time since the previous call,
+ *          into log2 histograms. loop() retires them once per interval
+ *          like the other per interval statistics.
+ *
+ *          Disabled, CALLBACK_TIMING_START() and CALLBACK_TIMING_STOP()
+ *          expand to nothing and no code or data is left of this
+ *          module.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef ICALLBACKTIMING_H
+#define ICALLBACKTIMING_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+
+#if CALLBACK_TIMING && !defined( __XTENSA__ )
+#include <time.h>
+#endif
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#ifndef CALLBACK_TIMING
+#define CALLBACK_TIMING             0
+#endif
+
+// Bucket n > 0 holds 2^(n-1) to 2^n - 1 ticks, the last one the rest
+#define CALLBACK_TIMING_BUCKETS     32
+
+#if CALLBACK_TIMING
+// Put at the very start and end of the callback, in the same scope
+#define CALLBACK_TIMING_START()     uint32_t callbackTimingStart = ICallbackTiming_Ticks()
+#define CALLBACK_TIMING_STOP()      ICallbackTiming_Record( callbackTimingStart, ICallbackTiming_Ticks() )
+#else
+#define CALLBACK_TIMING_START()
+#define CALLBACK_TIMING_STOP()
+#endif
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint32_t calls;
+    uint32_t maxTicks;                              // Longest call
+    uint64_t totalTicks;                            // In the callback
+    uint32_t latency[ CALLBACK_TIMING_BUCKETS ];    // Calls by ticks spent
+    uint32_t gaps[ CALLBACK_TIMING_BUCKETS ];       // Calls by ticks since previous call
+} tCallbackTimingBank;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+#if CALLBACK_TIMING
+
+/**
+ * Read the tick counter: CCOUNT (CPU cycles) on the ESP8266, a
+ * monotonic nanosecond clock on the host. Wraps.
+ *
+ * @return Ticks.
+ */
+static inline uint32_t ICallbackTiming_Ticks( void )
+{
+#if defined( __XTENSA__ )
+    uint32_t ticks;
+    __asm__ __volatile__( "rsr %0, ccount" : "=a"( ticks ) );
+    return ticks;
+#else
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    return (uint32_t)( now.tv_sec * 1000000000ull + now.tv_nsec );
+#endif
+}
+
+/**
+ * Clear all statistics. Must not be called while the RX callback is
+ * active.
+ */
+void ICallbackTiming_Init( void );
+
+/**
+ * Account a callback, see CALLBACK_TIMING_STOP().
+ *
+ * @param  startTicks Ticks on entry
+ * @param  stopTicks  Ticks on exit
+ */
+void ICallbackTiming_Record( uint32_t startTicks, uint32_t stopTicks );
+
+/**
+ * Retire the active interval and start a new one.
+ *
+ * @return Retired interval, valid until the next call.
+ */
+const tCallbackTimingBank* ICallbackTiming_Swap( void );
+
+/**
+ * Get a percentile of a histogram, interpolated within the bucket it
+ * falls in.
+ *
+ * @param  pBuckets latency or gaps of a bank
+ * @param  percent  Percentile, 0..100
+ * @return Ticks, 0 if the histogram is empty.
+ */
+uint32_t ICallbackTiming_Percentile( const uint32_t* pBuckets, uint8_t percent );
+
+/**
+ * Get the tick rate, the CPU clock on the ESP8266 (80 or 160 MHz).
+ *
+ * @return Ticks per microsecond.
+ */
+uint32_t ICallbackTiming_TicksPerUs( void );
+
+/**
+ * Convert ticks to nanoseconds at the current tick rate.
+ *
+ * @param  ticks Ticks
+ * @return Nanoseconds, saturated at UINT32_MAX.
+ */
+uint32_t ICallbackTiming_ToNs( uint64_t ticks );
+
+#endif // CALLBACK_TIMING
+
+#endif // ICALLBACKTIMING_H
@@ -0,0 +1,416 @@
+/**
+ * @file    CaptureFilter.cpp
+ * @brief   Bytecode capture filter.
+ *
+ *          Two program slots: a new program is checked into the one
+ *          not in use and then published, the loader waits for a
+ *          callback still running the old program before the slot can
+ *          be reused. Same handover as the counter banks.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include "CaptureFilter.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    tFilterInsn insns[ FILTER_MAX_INSNS ];
+    uint8_t     count;
+} tFilterProgram;
+
+typedef struct
+{
+    tFilterProgram programs[ FILTER_PROGRAMS ];
+    uint32_t       activeProgram;
+    uint32_t       runnerBusy;
+    uint32_t       evaluated;
+    uint32_t       accepted;
+    uint32_t       loaded;
+} tCaptureFilterVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static tFilterLoadResult check( const tFilterProgram* pProgram, uint8_t* pErrorAt );
+static void activate( uint32_t next );
+static inline bool loadFrame( const uint8_t* pFrame, uint16_t captured, uint32_t offset, uint8_t size, uint32_t* pValue );
+static inline uint32_t loadMeta( const tRxControl* pRx, uint32_t field );
+static inline void countEvent( uint32_t* pCounter );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tCaptureFilterVars captureFilterVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void ICaptureFilter_Init( void )
+{
+    memset( &captureFilterVars, 0, sizeof( captureFilterVars ) );
+
+    // Accept everything, whole frame
+    captureFilterVars.programs[ 0 ].insns[ 0 ].op = FILTER_OP_RET;
+    captureFilterVars.programs[ 0 ].insns[ 0 ].k  = UINT16_MAX;
+    captureFilterVars.programs[ 0 ].count         = 1;
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+tFilterLoadResult ICaptureFilter_Load( const uint8_t* pCode, uint16_t length, uint8_t* pErrorAt )
+{
+    if ( pErrorAt != NULL )
+    {
+        *pErrorAt = 0;
+    }
+    if ( length % FILTER_INSN_LEN != 0 )
+    {
+        return FILTER_LOAD_BAD_LENGTH;
+    }
+    if ( length == 0 )
+    {
+        return FILTER_LOAD_EMPTY;
+    }
+    if ( length / FILTER_INSN_LEN > FILTER_MAX_INSNS )
+    {
+        return FILTER_LOAD_TOO_LONG;
+    }
+
+    uint32_t        next     = captureFilterVars.activeProgram ^ 1;
+    tFilterProgram* pProgram = &captureFilterVars.programs[ next ];
+    pProgram->count = (uint8_t)( length / FILTER_INSN_LEN );
+    for ( uint8_t i = 0; i < pProgram->count; ++i )
+    {
+        const uint8_t* pSrc  = &pCode[ i * FILTER_INSN_LEN ];
+        tFilterInsn*   pInsn = &pProgram->insns[ i ];
+        pInsn->op = pSrc[ 0 ];
+        pInsn->jt = pSrc[ 1 ];
+        pInsn->jf = pSrc[ 2 ];
+        pInsn->k  = (uint32_t)pSrc[ 4 ] | ( (uint32_t)pSrc[ 5 ] << 8 ) | ( (uint32_t)pSrc[ 6 ] << 16 ) | ( (uint32_t)pSrc[ 7 ] << 24 );
+    }
+
+    tFilterLoadResult result = check( pProgram, pErrorAt );
+    if ( result == FILTER_LOAD_OK )
+    {
+        activate( next );
+    }
+    return result;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+tFilterLoadResult ICaptureFilter_LoadInsns( const tFilterInsn* pInsns, uint8_t count, uint8_t* pErrorAt )
+{
+    if ( pErrorAt != NULL )
+    {
+        *pErrorAt = 0;
+    }
+    if ( count == 0 )
+    {
+        return FILTER_LOAD_EMPTY;
+    }
+    if ( count > FILTER_MAX_INSNS )
+    {
+        return FILTER_LOAD_TOO_LONG;
+    }
+
+    uint32_t        next     = captureFilterVars.activeProgram ^ 1;
+    tFilterProgram* pProgram = &captureFilterVars.programs[ next ];
+    memcpy( pProgram->insns, pInsns, count * sizeof( tFilterInsn ) );
+    pProgram->count = count;
+
+    tFilterLoadResult result = check( pProgram, pErrorAt );
+    if ( result == FILTER_LOAD_OK )
+    {
+        activate( next );
+    }
+    return result;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint16_t ICaptureFilter_Run( const tRxControl* pRx, const uint8_t* pFrame, uint16_t captured )
+{
+    __atomic_store_n( &captureFilterVars.runnerBusy, 1, __ATOMIC_SEQ_CST );
+    uint32_t           active = __atomic_load_n( &captureFilterVars.activeProgram, __ATOMIC_SEQ_CST );
+    const tFilterInsn* pInsn  = captureFilterVars.programs[ active ].insns;
+
+    // Checked when loaded: opcodes and metadata fields are known, jumps
+    // go forward and stay in the program, the last instruction returns
+    uint32_t a      = 0;
+    uint32_t result = 0;
+    for ( ;; )
+    {
+        const tFilterInsn* pCurrent = pInsn++;
+        switch ( pCurrent->op )
+        {
+            case FILTER_OP_RET:
+                result = pCurrent->k;
+                goto done;
+            case FILTER_OP_LD_IMM:
+                a = pCurrent->k;
+                break;
+            case FILTER_OP_LD_B:
+                if ( !loadFrame( pFrame, captured, pCurrent->k, 1, &a ) )
+                {
+                    goto done;
+                }
+                break;
+            case FILTER_OP_LD_H:
+                if ( !loadFrame( pFrame, captured, pCurrent->k, 2, &a ) )
+                {
+                    goto done;
+                }
+                break;
+            case FILTER_OP_LD_W:
+                if ( !loadFrame( pFrame, captured, pCurrent->k, 4, &a ) )
+                {
+                    goto done;
+                }
+                break;
+            case FILTER_OP_LD_META:
+                a = loadMeta( pRx, pCurrent->k );
+                break;
+            case FILTER_OP_AND:
+                a &= pCurrent->k;
+                break;
+            case FILTER_OP_RSH:
+                a >>= pCurrent->k;
+                break;
+            case FILTER_OP_JA:
+                pInsn += pCurrent->k;
+                break;
+            case FILTER_OP_JEQ:
+                pInsn += a == pCurrent->k ? pCurrent->jt : pCurrent->jf;
+                break;
+            case FILTER_OP_JGT:
+                pInsn += a > pCurrent->k ? pCurrent->jt : pCurrent->jf;
+                break;
+            case FILTER_OP_JGE:
+                pInsn += a >= pCurrent->k ? pCurrent->jt : pCurrent->jf;
+                break;
+            case FILTER_OP_JSET:
+                pInsn += ( a & pCurrent->k ) != 0 ? pCurrent->jt : pCurrent->jf;
+                break;
+            case FILTER_OP_JSGT:
+                pInsn += (int32_t)a > (int32_t)pCurrent->k ? pCurrent->jt : pCurrent->jf;
+                break;
+            case FILTER_OP_JSGE:
+                pInsn += (int32_t)a >= (int32_t)pCurrent->k ? pCurrent->jt : pCurrent->jf;
+                break;
+            default:
+                goto done;
+        }
+    }
+
+done:
+    __atomic_store_n( &captureFilterVars.runnerBusy, 0, __ATOMIC_RELEASE );
+
+    countEvent( &captureFilterVars.evaluated );
+    if ( result != 0 )
+    {
+        countEvent( &captureFilterVars.accepted );
+    }
+    return result > UINT16_MAX ? UINT16_MAX : (uint16_t)result;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void ICaptureFilter_GetStats( tCaptureFilterStats* pStats )
+{
+    pStats->evaluated = __atomic_load_n( &captureFilterVars.evaluated, __ATOMIC_RELAXED );
+    pStats->accepted  = __atomic_load_n( &captureFilterVars.accepted,  __ATOMIC_RELAXED );
+    pStats->loaded    = captureFilterVars.loaded;
+    pStats->insns     = captureFilterVars.programs[ captureFilterVars.activeProgram ].count;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static tFilterLoadResult check( const tFilterProgram* pProgram, uint8_t* pErrorAt )
+{
+    uint8_t count = pProgram->count;
+    for ( uint8_t pc = 0; pc < count; ++pc )
+    {
+        const tFilterInsn* pInsn  = &pProgram->insns[ pc ];
+        uint32_t           remain = count - pc - 1;
+        if ( pErrorAt != NULL )
+        {
+            *pErrorAt = pc;
+        }
+
+        switch ( pInsn->op )
+        {
+            case FILTER_OP_RET:
+            case FILTER_OP_LD_IMM:
+            case FILTER_OP_LD_B:
+            case FILTER_OP_LD_H:
+            case FILTER_OP_LD_W:
+            case FILTER_OP_AND:
+                break;
+            case FILTER_OP_LD_META:
+                if ( pInsn->k >= FILTER_META_COUNT )
+                {
+                    return FILTER_LOAD_BAD_OPCODE;
+                }
+                break;
+            case FILTER_OP_RSH:
+                if ( pInsn->k >= 32 )
+                {
+                    return FILTER_LOAD_BAD_OPCODE;
+                }
+                break;
+            case FILTER_OP_JA:
+                if ( pInsn->k >= remain )
+                {
+                    return FILTER_LOAD_BAD_JUMP;
+                }
+                break;
+            case FILTER_OP_JEQ:
+            case FILTER_OP_JGT:
+            case FILTER_OP_JGE:
+            case FILTER_OP_JSET:
+            case FILTER_OP_JSGT:
+            case FILTER_OP_JSGE:
+                if ( pInsn->jt >= remain || pInsn->jf >= remain )
+                {
+                    return FILTER_LOAD_BAD_JUMP;
+                }
+                break;
+            default:
+                return FILTER_LOAD_BAD_OPCODE;
+        }
+    }
+
+    // Jumps can't pass the last instruction, so returning there is
+    // enough to never run off the end
+    if ( pProgram->insns[ count - 1 ].op != FILTER_OP_RET )
+    {
+        if ( pErrorAt != NULL )
+        {
+            *pErrorAt = count - 1;
+        }
+        return FILTER_LOAD_NO_RETURN;
+    }
+    return FILTER_LOAD_OK;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void activate( uint32_t next )
+{
+    __atomic_store_n( &captureFilterVars.activeProgram, next, __ATOMIC_SEQ_CST );
+    while ( __atomic_load_n( &captureFilterVars.runnerBusy, __ATOMIC_SEQ_CST ) != 0 )
+    {
+        // Callback still running the old program
+    }
+    ++captureFilterVars.loaded;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline bool loadFrame( const uint8_t* pFrame, uint16_t captured, uint32_t offset, uint8_t size, uint32_t* pValue )
+{
+    if ( offset >= captured || captured - offset < size )
+    {
+        return false;
+    }
+
+    uint32_t value = 0;
+    for ( uint8_t i = 0; i < size; ++i )
+    {
+        value = ( value << 8 ) | pFrame[ offset + i ];
+    }
+    *pValue = value;
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t loadMeta( const tRxControl* pRx, uint32_t field )
+{
+    switch ( field )
+    {
+        case FILTER_META_RSSI:    return (uint32_t)(int32_t)pRx->rssi;
+        case FILTER_META_CHANNEL: return pRx->channel;
+        case FILTER_META_LENGTH:  return ISnifferBuf_FrameLength( pRx );
+        case FILTER_META_RATE:    return pRx->rate;
+        case FILTER_META_MCS:     return pRx->MCS;
+        case FILTER_META_HT:      return pRx->sig_mode != 0;
+        default:                  return 0;
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline void countEvent( uint32_t* pCounter )
+{
+    __atomic_store_n( pCounter, *pCounter + 1, __ATOMIC_RELAXED );
+}
@@ -0,0 +1,45 @@
+/**
+ * @file    CaptureFilter.h
+ * @brief   Capture filter private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef CAPTUREFILTER_H
+#define CAPTUREFILTER_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "ICaptureFilter.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#if FILTER_MAX_INSNS < 1 || FILTER_MAX_INSNS > 255
+#error "FILTER_MAX_INSNS must be 1..255"
+#endif
+
+// Active program plus one being loaded
+#define FILTER_PROGRAMS     2
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // CAPTUREFILTER_H
@@ -0,0 +1,178 @@
+/**
+ * @file    ICaptureFilter.h
+ * @brief   Bytecode capture filter, run in the RX callback to decide
+ *          which frames are recorded and how many bytes of each.
+ *
+ *          A small BPF-like machine: one 32 bit accumulator, loads
+ *          from the frame bytes and RX metadata, a few ALU operations
+ *          and forward-only conditional jumps. Programs are checked
+ *          when loaded, so running one needs no checks beyond frame
+ *          bounds and always terminates. A program returns the number
+ *          of frame bytes to record, 0 drops the frame. A load past
+ *          the captured bytes drops the frame as well.
+ *
+ *          Programs are compiled from filter expressions on the host
+ *          with tools/snifferfilter.py.
+ *
+ *          Frame statistics are counted before the filter runs and see
+ *          every frame. The probed SSID and device summaries (PROBES,
+ *          PROBERS) are fed from the capture ring instead, so they
+ *          only see the probe requests a filter passes, cut to its snap
+ *          length: a filter without probe requests leaves them at
+ *          zero, and a snap length short of the elements counts the
+ *          probes as malformed or partial.
+ *
+ *          Wire format, FILTER_INSN_LEN bytes per instruction:
+ *            u8 opcode, u8 jump if true, u8 jump if false, u8 zero,
+ *            u32 k (little endian)
+ *          Jumps are relative to the next instruction.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef ICAPTUREFILTER_H
+#define ICAPTUREFILTER_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <SnifferBuf/ISnifferBuf.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Longest program (8 bytes per instruction, two copies are kept)
+#ifndef FILTER_MAX_INSNS
+#define FILTER_MAX_INSNS    64
+#endif
+
+// Bytes per instruction on the wire
+#define FILTER_INSN_LEN     8
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef enum
+{
+    FILTER_OP_RET       = 0,    // Return k
+    FILTER_OP_LD_IMM    = 1,    // A = k
+    FILTER_OP_LD_B      = 2,    // A = frame[k]
+    FILTER_OP_LD_H      = 3,    // A = frame[k..k+1], big endian
+    FILTER_OP_LD_W      = 4,    // A = frame[k..k+3], big endian
+    FILTER_OP_LD_META   = 5,    // A = metadata field k (tFilterMeta)
+    FILTER_OP_AND       = 6,    // A &= k
+    FILTER_OP_RSH       = 7,    // A >>= k
+    FILTER_OP_JA        = 8,    // Jump k
+    FILTER_OP_JEQ       = 9,    // Jump jt if A == k, else jf
+    FILTER_OP_JGT       = 10,   // Unsigned A > k
+    FILTER_OP_JGE       = 11,   // Unsigned A >= k
+    FILTER_OP_JSET      = 12,   // A & k != 0
+    FILTER_OP_JSGT      = 13,   // Signed A > k
+    FILTER_OP_JSGE      = 14,   // Signed A >= k
+    FILTER_OP_COUNT
+} tFilterOp;
+
+typedef enum
+{
+    FILTER_META_RSSI    = 0,    // dBm, signed
+    FILTER_META_CHANNEL = 1,    // Channel the frame arrived on
+    FILTER_META_LENGTH  = 2,    // On-air length
+    FILTER_META_RATE    = 3,    // rx_ctrl legacy rate code
+    FILTER_META_MCS     = 4,    // HT MCS
+    FILTER_META_HT      = 5,    // 1 if HT, else 0
+    FILTER_META_COUNT
+} tFilterMeta;
+
+typedef struct
+{
+    uint8_t  op;
+    uint8_t  jt;
+    uint8_t  jf;
+    uint32_t k;
+} tFilterInsn;
+
+typedef enum
+{
+    FILTER_LOAD_OK = 0,
+    FILTER_LOAD_EMPTY,          // No instructions
+    FILTER_LOAD_TOO_LONG,       // More than FILTER_MAX_INSNS
+    FILTER_LOAD_BAD_LENGTH,     // Not a whole number of instructions
+    FILTER_LOAD_BAD_OPCODE,     // Unknown opcode or metadata field
+    FILTER_LOAD_BAD_JUMP,       // Jump past the end
+    FILTER_LOAD_NO_RETURN       // Can run past the last instruction
+} tFilterLoadResult;
+
+typedef struct
+{
+    uint32_t evaluated;     // Frames run through the filter
+    uint32_t accepted;      // Frames the filter returned non-zero for
+    uint32_t loaded;        // Programs loaded
+    uint8_t  insns;         // Length of the active program
+} tCaptureFilterStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Reset to a program accepting every frame and clear counters.
+ * Must be called before the RX callback is registered.
+ */
+void ICaptureFilter_Init( void );
+
+/**
+ * Check and activate a program in wire format. The previous program
+ * stays active if the new one is rejected. Not safe to call from the
+ * RX callback.
+ *
+ * @param  pCode    Program
+ * @param  length   Number of bytes in pCode
+ * @param  pErrorAt Output, index of offending instruction (may be NULL)
+ * @return FILTER_LOAD_OK if loaded.
+ */
+tFilterLoadResult ICaptureFilter_Load( const uint8_t* pCode, uint16_t length, uint8_t* pErrorAt );
+
+/**
+ * Check and activate a program built on the device. Same as
+ * ICaptureFilter_Load().
+ *
+ * @param  pInsns   Instructions
+ * @param  count    Number of instructions
+ * @param  pErrorAt Output, index of offending instruction (may be NULL)
+ * @return FILTER_LOAD_OK if loaded.
+ */
+tFilterLoadResult ICaptureFilter_LoadInsns( const tFilterInsn* pInsns, uint8_t count, uint8_t* pErrorAt );
+
+/**
+ * Run the active program over a frame. Safe to call from the RX
+ * callback.
+ *
+ * @param  pRx      RX control of the frame
+ * @param  pFrame   Frame bytes
+ * @param  captured Number of bytes in pFrame
+ * @return Number of bytes to record, 0 to drop the frame.
+ */
+uint16_t ICaptureFilter_Run( const tRxControl* pRx, const uint8_t* pFrame, uint16_t captured );
+
+/**
+ * Get counters, running totals since ICaptureFilter_Init().
+ *
+ * @param  pStats Output
+ */
+void ICaptureFilter_GetStats( tCaptureFilterStats* pStats );
+
+#endif // ICAPTUREFILTER_H
@@ -0,0 +1,175 @@
+/**
+ * @file    CaptureRing.cpp
+ * @brief   Lock-free single-producer/single-consumer capture ring.
+ *
+ *          head is only written by the producer (RX callback) and
+ *          tail only by the consumer (loop()). Both are free running
+ *          and wrap at 2^32; the slot is selected by masking. The
+ *          release-store of head publishes the record contents and
+ *          the release-store of tail hands the slot back.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include "CaptureRing.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    // Producer owned
+    uint32_t head __attribute__(( aligned( CAPTURE_RING_ALIGN ) ));
+    uint32_t pushed;
+    uint32_t dropped;
+    uint32_t highWater;
+
+    // Consumer owned
+    uint32_t tail __attribute__(( aligned( CAPTURE_RING_ALIGN ) ));
+
+    tCaptureRecord records[ CAPTURE_RING_SLOTS ] __attribute__(( aligned( CAPTURE_RING_ALIGN ) ));
+} tCaptureRingVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tCaptureRingVars captureRingVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void ICaptureRing_Init( void )
+{
+    captureRingVars.head      = 0;
+    captureRingVars.tail      = 0;
+    captureRingVars.pushed    = 0;
+    captureRingVars.dropped   = 0;
+    captureRingVars.highWater = 0;
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool ICaptureRing_Push( const tRxControl* pRxCtrl, const uint8_t* pHeader, uint16_t captured, uint16_t length, uint32_t timestamp )
+{
+    uint32_t head = captureRingVars.head;
+    uint32_t tail = __atomic_load_n( &captureRingVars.tail, __ATOMIC_ACQUIRE );
+
+    if ( ( head - tail ) >= CAPTURE_RING_SLOTS )
+    {
+        // Only the producer writes this, so a plain increment is fine
+        __atomic_store_n( &captureRingVars.dropped, captureRingVars.dropped + 1, __ATOMIC_RELAXED );
+        return false;
+    }
+
+    if ( captured > CAPTURE_HEADER_LEN )
+    {
+        captured = CAPTURE_HEADER_LEN;
+    }
+
+    tCaptureRecord* pRecord = &captureRingVars.records[ head & CAPTURE_RING_MASK ];
+    pRecord->rxCtrl    = *pRxCtrl;
+    pRecord->timestamp = timestamp;
+    pRecord->length    = length;
+    pRecord->captured  = captured;
+    memcpy( pRecord->header, pHeader, captured );
+
+    __atomic_store_n( &captureRingVars.head, head + 1, __ATOMIC_RELEASE );
+
+    uint32_t fill = head + 1 - tail;
+    if ( fill > captureRingVars.highWater )
+    {
+        __atomic_store_n( &captureRingVars.highWater, fill, __ATOMIC_RELAXED );
+    }
+    __atomic_store_n( &captureRingVars.pushed, captureRingVars.pushed + 1, __ATOMIC_RELAXED );
+
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+const tCaptureRecord* ICaptureRing_Peek( void )
+{
+    uint32_t tail = captureRingVars.tail;
+    uint32_t head = __atomic_load_n( &captureRingVars.head, __ATOMIC_ACQUIRE );
+
+    if ( head == tail )
+    {
+        return NULL;
+    }
+    return &captureRingVars.records[ tail & CAPTURE_RING_MASK ];
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void ICaptureRing_Release( void )
+{
+    uint32_t tail = captureRingVars.tail;
+    uint32_t head = __atomic_load_n( &captureRingVars.head, __ATOMIC_ACQUIRE );
+
+    if ( head != tail )
+    {
+        __atomic_store_n( &captureRingVars.tail, tail + 1, __ATOMIC_RELEASE );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void ICaptureRing_GetStats( tCaptureRingStats* pStats )
+{
+    pStats->pushed    = __atomic_load_n( &captureRingVars.pushed, __ATOMIC_RELAXED );
+    pStats->dropped   = __atomic_load_n( &captureRingVars.dropped, __ATOMIC_RELAXED );
+    pStats->highWater = __atomic_load_n( &captureRingVars.highWater, __ATOMIC_RELAXED );
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
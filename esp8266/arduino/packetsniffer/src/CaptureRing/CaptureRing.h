@@ -0,0 +1,52 @@
+/**
+ * @file    CaptureRing.h
+ * @brief   Capture ring private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef CAPTURERING_H
+#define CAPTURERING_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "ICaptureRing.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#if ( CAPTURE_RING_SLOTS & ( CAPTURE_RING_SLOTS - 1 ) ) != 0
+#error "CAPTURE_RING_SLOTS must be a power of two"
+#endif
+
+#define CAPTURE_RING_MASK     ( CAPTURE_RING_SLOTS - 1 )
+
+// Keep producer and consumer indices on separate cache lines on host
+// builds. The ESP8266 has no data cache, so don't waste RAM there.
+#if defined( __xtensa__ )
+#define CAPTURE_RING_ALIGN    4
+#else
+#define CAPTURE_RING_ALIGN    64
+#endif
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // CAPTURERING_H
@@ -0,0 +1,108 @@
+/**
+ * @file    ICaptureRing.h
+ * @brief   Single-producer/single-consumer ring of captured frames,
+ *          filled from the promiscuous RX callback and drained from
+ *          loop().
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef ICAPTURERING_H
+#define ICAPTURERING_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <SnifferBuf/ISnifferBuf.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Number of frame bytes kept per record, whole management frame
+// buffers fit
+#define CAPTURE_HEADER_LEN    SNIFFER_MAX_BUF_LEN
+
+// Number of records in ring (must be a power of two)
+#ifndef CAPTURE_RING_SLOTS
+#define CAPTURE_RING_SLOTS    32
+#endif
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    tRxControl rxCtrl;
+    uint32_t   timestamp;   // micros() at time of capture
+    uint16_t   length;      // On-air length of the frame
+    uint16_t   captured;    // Number of valid bytes in header
+    uint8_t    header[ CAPTURE_HEADER_LEN ];
+} tCaptureRecord;
+
+typedef struct
+{
+    uint32_t pushed;        // Records successfully enqueued
+    uint32_t dropped;       // Records lost because ring was full
+    uint32_t highWater;     // Max number of records in ring at once
+} tCaptureRingStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Reset ring to empty and clear all counters.
+ * Must not be called while producer or consumer is active.
+ */
+void ICaptureRing_Init( void );
+
+/**
+ * Enqueue a frame. Producer side, safe to call from the RX callback.
+ *
+ * @param  pRxCtrl   RX metadata from the SDK
+ * @param  pHeader   Frame bytes
+ * @param  captured  Number of bytes in pHeader (truncated to
+ *                   CAPTURE_HEADER_LEN)
+ * @param  length    On-air length of the frame
+ * @param  timestamp Capture timestamp
+ * @return TRUE if enqueued, FALSE if ring was full (counted as drop).
+ */
+bool ICaptureRing_Push( const tRxControl* pRxCtrl, const uint8_t* pHeader, uint16_t captured, uint16_t length, uint32_t timestamp );
+
+/**
+ * Get oldest record without removing it. Consumer side.
+ * The record stays valid until ICaptureRing_Release() is called.
+ *
+ * @return Pointer to oldest record, NULL if ring is empty.
+ */
+const tCaptureRecord* ICaptureRing_Peek( void );
+
+/**
+ * Remove oldest record (the one returned by ICaptureRing_Peek()).
+ * Consumer side.
+ */
+void ICaptureRing_Release( void );
+
+/**
+ * Get snapshot of ring counters. Counters are running totals since
+ * ICaptureRing_Init().
+ *
+ * @param  pStats Output
+ */
+void ICaptureRing_GetStats( tCaptureRingStats* pStats );
+
+#endif // ICAPTURERING_H
@@ -0,0 +1,314 @@
+/**
+ * @file    ChannelHop.cpp
+ * @brief   Channel hopping scheduler with adaptive dwell times.
+ *
+ *          Frames are attributed to the channel in their rx_ctrl, not
+ *          to the channel the scheduler thinks it is on, so frames
+ *          that were in flight during a hop end up on the right
+ *          channel. The frame rate of a channel is sampled at the end
+ *          of every dwell and smoothed across visits.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include "ChannelHop.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint32_t frames;        // Written from RX callback only
+    uint32_t retries;       // Written from RX callback only
+    uint32_t duplicates;    // Written from RX callback only
+    uint32_t dwellMs;
+    uint32_t visits;
+    uint16_t rate;
+    uint16_t nextDwellMs;
+} tChannelState;
+
+typedef struct
+{
+    uint8_t       channels[ CHANNEL_HOP_MAX_CHANNEL ];
+    uint8_t       count;
+    uint8_t       index;
+    uint8_t       current;
+    uint32_t      dwellStartMs;
+    uint32_t      framesAtStart;    // Not counting duplicates
+    tChannelState state[ CHANNEL_HOP_MAX_CHANNEL + 1 ];    // Indexed by channel number
+} tChannelHopVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static uint32_t startDwell( uint32_t nowMs );
+static inline uint32_t uniqueFrames( const tChannelState* pState );
+static uint32_t computeDwell( uint8_t channel );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tChannelHopVars channelHopVars;
+
+// Kept apart from the rest, which IChannelHop_Init() clears
+static bool channelHopAdaptive = CHANNEL_HOP_ADAPTIVE;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint8_t IChannelHop_Init( const uint8_t* pChannels, uint8_t count, uint32_t nowMs, uint32_t* pDwellMs )
+{
+    memset( &channelHopVars, 0, sizeof( channelHopVars ) );
+
+    for ( uint8_t i = 0; i < count && channelHopVars.count < CHANNEL_HOP_MAX_CHANNEL; ++i )
+    {
+        if ( pChannels[ i ] >= 1 && pChannels[ i ] <= CHANNEL_HOP_MAX_CHANNEL )
+        {
+            channelHopVars.channels[ channelHopVars.count++ ] = pChannels[ i ];
+        }
+    }
+    if ( channelHopVars.count == 0 )
+    {
+        // Fall back to channel 1 rather than not sniffing at all
+        channelHopVars.channels[ 0 ] = 1;
+        channelHopVars.count         = 1;
+    }
+
+    *pDwellMs = startDwell( nowMs );
+    return channelHopVars.current;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IChannelHop_SetAdaptive( bool adaptive )
+{
+    channelHopAdaptive = adaptive;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IChannelHop_CountFrame( uint8_t channel, uint16_t mpdus )
+{
+    if ( channel <= CHANNEL_HOP_MAX_CHANNEL )
+    {
+        uint32_t* pFrames = &channelHopVars.state[ channel ].frames;
+        __atomic_store_n( pFrames, *pFrames + mpdus, __ATOMIC_RELAXED );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IChannelHop_CountRetry( uint8_t channel, bool duplicate )
+{
+    if ( channel <= CHANNEL_HOP_MAX_CHANNEL )
+    {
+        tChannelState* pState = &channelHopVars.state[ channel ];
+        __atomic_store_n( &pState->retries, pState->retries + 1, __ATOMIC_RELAXED );
+        if ( duplicate )
+        {
+            __atomic_store_n( &pState->duplicates, pState->duplicates + 1, __ATOMIC_RELAXED );
+        }
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint8_t IChannelHop_Next( uint32_t nowMs, uint32_t* pDwellMs )
+{
+    tChannelState* pState = &channelHopVars.state[ channelHopVars.current ];
+
+    // Close current dwell and update its rate estimate
+    uint32_t elapsedMs = nowMs - channelHopVars.dwellStartMs;
+    uint32_t frames    = uniqueFrames( pState ) - channelHopVars.framesAtStart;
+    uint32_t sample    = 0;
+    if ( elapsedMs > 0 )
+    {
+        sample = (uint32_t)( ( (uint64_t)frames * 1000 ) / elapsedMs );
+    }
+    if ( sample > UINT16_MAX )
+    {
+        sample = UINT16_MAX;
+    }
+    pState->dwellMs += elapsedMs;
+    pState->rate     = (uint16_t)( pState->rate + ( ( (int32_t)sample - (int32_t)pState->rate ) >> CHANNEL_HOP_RATE_SHIFT ) );
+
+    // Round robin keeps every channel sampled once per cycle
+    channelHopVars.index = ( channelHopVars.index + 1 ) % channelHopVars.count;
+
+    *pDwellMs = startDwell( nowMs );
+    return channelHopVars.current;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool IChannelHop_GetStats( uint8_t channel, tChannelHopStats* pStats )
+{
+    if ( channel < 1 || channel > CHANNEL_HOP_MAX_CHANNEL )
+    {
+        return false;
+    }
+
+    const tChannelState* pState = &channelHopVars.state[ channel ];
+    pStats->frames      = __atomic_load_n( &pState->frames, __ATOMIC_RELAXED );
+    pStats->retries     = __atomic_load_n( &pState->retries, __ATOMIC_RELAXED );
+    pStats->duplicates  = __atomic_load_n( &pState->duplicates, __ATOMIC_RELAXED );
+    pStats->dwellMs     = pState->dwellMs;
+    pStats->visits      = pState->visits;
+    pStats->rate        = pState->rate;
+    pStats->nextDwellMs = pState->nextDwellMs;
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint32_t IChannelHop_ListenMs( uint8_t channel, uint32_t nowMs )
+{
+    if ( channel < 1 || channel > CHANNEL_HOP_MAX_CHANNEL )
+    {
+        return 0;
+    }
+
+    uint32_t listenMs = channelHopVars.state[ channel ].dwellMs;
+    if ( channel == channelHopVars.current )
+    {
+        listenMs += nowMs - channelHopVars.dwellStartMs;
+    }
+    return listenMs;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint8_t IChannelHop_Current( void )
+{
+    return channelHopVars.current;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint32_t startDwell( uint32_t nowMs )
+{
+    uint8_t        channel = channelHopVars.channels[ channelHopVars.index ];
+    tChannelState* pState  = &channelHopVars.state[ channel ];
+    uint32_t       dwellMs = computeDwell( channel );
+
+    channelHopVars.current       = channel;
+    channelHopVars.dwellStartMs  = nowMs;
+    channelHopVars.framesAtStart = uniqueFrames( pState );
+    pState->nextDwellMs          = (uint16_t)dwellMs;
+    ++pState->visits;
+
+    return dwellMs;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint32_t computeDwell( uint8_t channel )
+{
+    uint32_t dwellMs = CHANNEL_HOP_CYCLE_MS / channelHopVars.count;
+
+    if ( channelHopAdaptive )
+    {
+        // Every channel gets the minimum, the rest of the cycle is
+        // shared in proportion to the smoothed frame rates
+        uint32_t minimumMs = (uint32_t)channelHopVars.count * CHANNEL_HOP_MIN_DWELL_MS;
+        uint32_t spareMs   = CHANNEL_HOP_CYCLE_MS > minimumMs ? CHANNEL_HOP_CYCLE_MS - minimumMs : 0;
+        uint32_t rateSum   = 0;
+        for ( uint8_t i = 0; i < channelHopVars.count; ++i )
+        {
+            rateSum += channelHopVars.state[ channelHopVars.channels[ i ] ].rate;
+        }
+
+        dwellMs = CHANNEL_HOP_MIN_DWELL_MS;
+        if ( rateSum > 0 )
+        {
+            dwellMs += (uint32_t)( ( (uint64_t)spareMs * channelHopVars.state[ channel ].rate ) / rateSum );
+        }
+    }
+
+    if ( dwellMs < CHANNEL_HOP_MIN_DWELL_MS )
+    {
+        dwellMs = CHANNEL_HOP_MIN_DWELL_MS;
+    }
+    if ( dwellMs > CHANNEL_HOP_MAX_DWELL_MS )
+    {
+        dwellMs = CHANNEL_HOP_MAX_DWELL_MS;
+    }
+    return dwellMs;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t uniqueFrames( const tChannelState* pState )
+{
+    // Read duplicates first, so a retransmission counted in between
+    // can't make the difference negative
+    uint32_t duplicates = __atomic_load_n( &pState->duplicates, __ATOMIC_RELAXED );
+    return __atomic_load_n( &pState->frames, __ATOMIC_RELAXED ) - duplicates;
+}
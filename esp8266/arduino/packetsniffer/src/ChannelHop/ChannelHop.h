@@ -0,0 +1,41 @@
+/**
+ * @file    ChannelHop.h
+ * @brief   Channel hopping scheduler private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef CHANNELHOP_H
+#define CHANNELHOP_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IChannelHop.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Smoothing of per-channel rate, new = old + ( sample - old ) / 2^N
+#define CHANNEL_HOP_RATE_SHIFT      2
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // CHANNELHOP_H
@@ -0,0 +1,159 @@
+/**
+ * @file    IChannelHop.h
+ * @brief   Channel hopping scheduler with per-channel dwell times
+ *          adapted to the observed frame rate.
+ *
+ *          Channels are visited round robin so every channel is
+ *          sampled each cycle. Busy channels get a larger share of
+ *          the cycle, quiet channels only get CHANNEL_HOP_MIN_DWELL_MS.
+ *          Retransmissions of frames already heard don't make a
+ *          channel busier.
+ *          The scheduler only does bookkeeping; the caller drives it
+ *          from a timer and performs the actual channel switch.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef ICHANNELHOP_H
+#define ICHANNELHOP_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Highest channel number in any regulatory domain (Japan)
+#define CHANNEL_HOP_MAX_CHANNEL     14
+
+// Shortest time spent on a channel
+#ifndef CHANNEL_HOP_MIN_DWELL_MS
+#define CHANNEL_HOP_MIN_DWELL_MS    50
+#endif
+
+// Longest time spent on a channel
+#ifndef CHANNEL_HOP_MAX_DWELL_MS
+#define CHANNEL_HOP_MAX_DWELL_MS    1000
+#endif
+
+// Target time for visiting every channel once
+#ifndef CHANNEL_HOP_CYCLE_MS
+#define CHANNEL_HOP_CYCLE_MS        2000
+#endif
+
+// Set to 0 to use the same dwell time (cycle / channels) everywhere,
+// see also IChannelHop_SetAdaptive()
+#ifndef CHANNEL_HOP_ADAPTIVE
+#define CHANNEL_HOP_ADAPTIVE        1
+#endif
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+// Running per-channel totals since IChannelHop_Init()
+typedef struct
+{
+    uint32_t frames;        // Frames received with this channel in rx_ctrl, A-MPDUs expanded
+    uint32_t retries;       // Of those, frames with the retry flag
+    uint32_t duplicates;    // Of those, retransmissions of a frame already heard
+    uint32_t dwellMs;       // Time the radio has spent on this channel
+    uint32_t visits;        // Number of times channel was selected
+    uint16_t rate;          // Smoothed frame rate without duplicates (frames/s)
+    uint16_t nextDwellMs;   // Dwell time for next visit
+} tChannelHopStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Set channel set and reset all statistics.
+ *
+ * @param  pChannels Channels to hop across, copied
+ * @param  count     Number of channels, at most CHANNEL_HOP_MAX_CHANNEL
+ * @param  nowMs     Current time
+ * @param  pDwellMs  Time to stay on the returned channel
+ * @return First channel to tune to.
+ */
+uint8_t IChannelHop_Init( const uint8_t* pChannels, uint8_t count, uint32_t nowMs, uint32_t* pDwellMs );
+
+/**
+ * Choose between adaptive and fixed dwell times, CHANNEL_HOP_ADAPTIVE
+ * until called. Takes effect from the next dwell, call before
+ * IChannelHop_Init() to hop that way from the start.
+ *
+ * @param  adaptive TRUE to adapt dwell times to the frame rates
+ */
+void IChannelHop_SetAdaptive( bool adaptive );
+
+/**
+ * Attribute a received frame to a channel. Safe to call from the
+ * RX callback.
+ *
+ * @param  channel Channel from rx_ctrl (frames just after a hop may
+ *                 still carry the previous channel)
+ * @param  mpdus   Frames the reception carried, more than one for an
+ *                 A-MPDU
+ */
+void IChannelHop_CountFrame( uint8_t channel, uint16_t mpdus );
+
+/**
+ * Attribute a frame with the retry flag to a channel, in addition to
+ * IChannelHop_CountFrame(). Safe to call from the RX callback.
+ *
+ * @param  channel   Channel from rx_ctrl
+ * @param  duplicate TRUE if the original frame was heard as well
+ */
+void IChannelHop_CountRetry( uint8_t channel, bool duplicate );
+
+/**
+ * Close the current dwell and pick the next channel. To be called
+ * when the dwell time returned by the previous call has elapsed.
+ *
+ * @param  nowMs    Current time
+ * @param  pDwellMs Time to stay on the returned channel
+ * @return Channel to tune to.
+ */
+uint8_t IChannelHop_Next( uint32_t nowMs, uint32_t* pDwellMs );
+
+/**
+ * Get running statistics of a channel.
+ *
+ * @param  channel Channel number 1..CHANNEL_HOP_MAX_CHANNEL
+ * @param  pStats  Output
+ * @return FALSE if channel is out of range.
+ */
+bool IChannelHop_GetStats( uint8_t channel, tChannelHopStats* pStats );
+
+/**
+ * Get the time the radio has spent on a channel, unlike dwellMs of
+ * IChannelHop_GetStats() including the visit in progress.
+ *
+ * @param  channel Channel number 1..CHANNEL_HOP_MAX_CHANNEL
+ * @param  nowMs   Current time
+ * @return Running total in ms, 0 if channel is out of range.
+ */
+uint32_t IChannelHop_ListenMs( uint8_t channel, uint32_t nowMs );
+
+/**
+ * Get the channel the scheduler currently dwells on.
+ *
+ * @return Channel number
+ */
+uint8_t IChannelHop_Current( void );
+
+#endif // ICHANNELHOP_H
@@ -0,0 +1,394 @@
+/**
+ * @file    DeauthDetector.cpp
+ * @brief   Sliding window deauthentication/disassociation flood
+ *          detector.
+ *
+ *          Tuple keys are the three addresses as they appear in the
+ *          MAC header (addr1 = target, addr2 = source, addr3 = BSSID),
+ *          so a lookup compares against the frame without copying.
+ *          Tuples are kept in a small open addressing table, a tuple
+ *          within DEAUTH_PROBE_LIMIT slots of the hash of its key;
+ *          floods from random sources cycle through it, replacing the
+ *          probed tuple that has been quiet the longest, and are caught
+ *          by the wheel of all frames instead.
+ *
+ *          Only the RX callback modifies tuples. loop() owns the
+ *          reported counter of each tuple and reads the rest without
+ *          locking.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include <FrameClass/IFrameClass.h>
+
+#include "DeauthDetector.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint8_t  key[ DEAUTH_KEY_LEN ];         // Target, source, BSSID
+    uint8_t  buckets[ DEAUTH_WHEEL_SLOTS ]; // Frames per bucket, saturating
+    uint16_t windowFrames;                  // Sum of buckets
+    uint32_t lastTick;                      // Bucket of most recent frame
+    uint32_t totalFrames;                   // 0 = free
+    uint8_t  raised;                        // Written from RX callback only
+    uint8_t  reported;                      // Written from loop() only
+    bool     alarmed;
+} tDeauthTuple;
+
+typedef struct
+{
+    tDeauthTuple tuples[ DEAUTH_TRACKED_TUPLES ];
+    tDeauthTuple all;                       // All frames, key zero
+    uint32_t     frames;                    // Written from RX callback only
+    uint32_t     alarms;                    // Written from RX callback only
+    uint32_t     floods;                    // Written from RX callback only
+    uint32_t     replaced;                  // Written from RX callback only
+    uint32_t     truncated;                 // Written from RX callback only
+} tDeauthDetectorVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static tDeauthTuple* findTuple( const uint8_t* pKey, uint32_t tick );
+static bool countFrame( tDeauthTuple* pTuple, uint32_t tick, uint16_t level );
+static void advanceWheel( tDeauthTuple* pTuple, uint32_t tick );
+static uint16_t windowCount( const tDeauthTuple* pTuple, uint32_t tick );
+static void toAlarm( const tDeauthTuple* pTuple, uint16_t windowFrames, tDeauthAlarm* pAlarm );
+static inline uint32_t hashKey( const uint8_t* pKey );
+static inline uint32_t mix32( uint32_t value );
+static inline void countEvent( uint32_t* pCounter );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tDeauthDetectorVars deauthDetectorVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IDeauthDetector_Init( void )
+{
+    memset( &deauthDetectorVars, 0, sizeof( deauthDetectorVars ) );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IDeauthDetector_Count( const uint8_t* pHeader, uint16_t captured, uint32_t nowMs )
+{
+    // The key runs from addr1 to the end of addr3
+    if ( captured < FRAME_ADDR3_OFFSET + 6 )
+    {
+        countEvent( &deauthDetectorVars.truncated );
+        return;
+    }
+
+    uint32_t      tick   = nowMs >> DEAUTH_BUCKET_SHIFT;
+    tDeauthTuple* pTuple = findTuple( &pHeader[ FRAME_ADDR1_OFFSET ], tick );
+
+    countEvent( &deauthDetectorVars.frames );
+    if ( countFrame( pTuple, tick, DEAUTH_ALARM_LEVEL ) )
+    {
+        countEvent( &deauthDetectorVars.alarms );
+    }
+    if ( countFrame( &deauthDetectorVars.all, tick, DEAUTH_FLOOD_LEVEL ) )
+    {
+        countEvent( &deauthDetectorVars.floods );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool IDeauthDetector_PollAlarm( tDeauthAlarm* pAlarm )
+{
+    // The tuples, then all of them together
+    for ( uint8_t i = 0; i <= DEAUTH_TRACKED_TUPLES; ++i )
+    {
+        tDeauthTuple* pTuple = i < DEAUTH_TRACKED_TUPLES ? &deauthDetectorVars.tuples[ i ] : &deauthDetectorVars.all;
+        uint8_t       raised = __atomic_load_n( &pTuple->raised, __ATOMIC_ACQUIRE );
+        if ( raised != pTuple->reported )
+        {
+            // Several alarms from one tuple between polls are reported
+            // once
+            pTuple->reported = raised;
+            toAlarm( pTuple, pTuple->windowFrames, pAlarm );
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint8_t IDeauthDetector_Active( uint32_t nowMs, tDeauthAlarm* pActive, uint8_t count )
+{
+    uint32_t tick  = nowMs >> DEAUTH_BUCKET_SHIFT;
+    uint8_t  found = 0;
+    for ( uint8_t i = 0; i < DEAUTH_TRACKED_TUPLES && found < count; ++i )
+    {
+        const tDeauthTuple* pTuple = &deauthDetectorVars.tuples[ i ];
+        if ( pTuple->totalFrames == 0 )
+        {
+            continue;
+        }
+
+        uint16_t frames = windowCount( pTuple, tick );
+        if ( frames >= DEAUTH_ALARM_LEVEL )
+        {
+            toAlarm( pTuple, frames, &pActive[ found++ ] );
+        }
+    }
+    return found;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IDeauthDetector_GetStats( tDeauthDetectorStats* pStats )
+{
+    pStats->frames      = __atomic_load_n( &deauthDetectorVars.frames,    __ATOMIC_RELAXED );
+    pStats->alarms      = __atomic_load_n( &deauthDetectorVars.alarms,    __ATOMIC_RELAXED );
+    pStats->floods      = __atomic_load_n( &deauthDetectorVars.floods,    __ATOMIC_RELAXED );
+    pStats->replaced    = __atomic_load_n( &deauthDetectorVars.replaced,  __ATOMIC_RELAXED );
+    pStats->truncated   = __atomic_load_n( &deauthDetectorVars.truncated, __ATOMIC_RELAXED );
+    pStats->memoryBytes = sizeof( deauthDetectorVars.tuples ) + sizeof( deauthDetectorVars.all );
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static tDeauthTuple* findTuple( const uint8_t* pKey, uint32_t tick )
+{
+    uint32_t      index     = hashKey( pKey );
+    tDeauthTuple* pVictim   = NULL;
+    uint32_t      victimAge = 0;
+
+    for ( uint8_t probe = 0; probe < DEAUTH_PROBE_LIMIT; ++probe )
+    {
+        tDeauthTuple* pTuple = &deauthDetectorVars.tuples[ ( index + probe ) & DEAUTH_TUPLE_MASK ];
+        if ( pTuple->totalFrames == 0 )
+        {
+            // Tuples are replaced, never freed, so the key isn't
+            // further along
+            pVictim = pTuple;
+            break;
+        }
+        if ( memcmp( pTuple->key, pKey, DEAUTH_KEY_LEN ) == 0 )
+        {
+            return pTuple;
+        }
+
+        uint32_t age = tick - pTuple->lastTick;
+        if ( pVictim == NULL || age > victimAge )
+        {
+            pVictim   = pTuple;
+            victimAge = age;
+        }
+    }
+
+    if ( pVictim->totalFrames != 0 )
+    {
+        countEvent( &deauthDetectorVars.replaced );
+    }
+
+    // Pending alarm of the replaced tuple is dropped
+    memcpy( pVictim->key, pKey, DEAUTH_KEY_LEN );
+    memset( pVictim->buckets, 0, sizeof( pVictim->buckets ) );
+    pVictim->windowFrames = 0;
+    pVictim->lastTick     = tick;
+    pVictim->totalFrames  = 0;
+    pVictim->alarmed      = false;
+    __atomic_store_n( &pVictim->raised, __atomic_load_n( &pVictim->reported, __ATOMIC_RELAXED ), __ATOMIC_RELEASE );
+    return pVictim;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool countFrame( tDeauthTuple* pTuple, uint32_t tick, uint16_t level )
+{
+    advanceWheel( pTuple, tick );
+    uint8_t* pBucket = &pTuple->buckets[ tick & DEAUTH_WHEEL_MASK ];
+    if ( *pBucket < UINT8_MAX )
+    {
+        ++*pBucket;
+        ++pTuple->windowFrames;
+    }
+    ++pTuple->totalFrames;
+
+    // Alarm on crossing the level, not on every frame above it
+    if ( pTuple->windowFrames < level )
+    {
+        pTuple->alarmed = false;
+        return false;
+    }
+    if ( pTuple->alarmed )
+    {
+        return false;
+    }
+    pTuple->alarmed = true;
+    __atomic_store_n( &pTuple->raised, (uint8_t)( pTuple->raised + 1 ), __ATOMIC_RELEASE );
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void advanceWheel( tDeauthTuple* pTuple, uint32_t tick )
+{
+    uint32_t elapsed = tick - pTuple->lastTick;
+    if ( elapsed >= DEAUTH_WHEEL_SLOTS )
+    {
+        memset( pTuple->buckets, 0, sizeof( pTuple->buckets ) );
+        pTuple->windowFrames = 0;
+    }
+    else
+    {
+        // Buckets between last frame and now fell out of the window
+        for ( uint32_t i = 1; i <= elapsed; ++i )
+        {
+            uint8_t* pBucket = &pTuple->buckets[ ( pTuple->lastTick + i ) & DEAUTH_WHEEL_MASK ];
+            pTuple->windowFrames -= *pBucket;
+            *pBucket = 0;
+        }
+    }
+    pTuple->lastTick = tick;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint16_t windowCount( const tDeauthTuple* pTuple, uint32_t tick )
+{
+    // Same as advanceWheel() without modifying the tuple
+    uint32_t elapsed = tick - pTuple->lastTick;
+    if ( elapsed >= DEAUTH_WHEEL_SLOTS )
+    {
+        return 0;
+    }
+
+    uint16_t frames = pTuple->windowFrames;
+    for ( uint32_t i = 1; i <= elapsed; ++i )
+    {
+        frames -= pTuple->buckets[ ( pTuple->lastTick + i ) & DEAUTH_WHEEL_MASK ];
+    }
+    return frames;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void toAlarm( const tDeauthTuple* pTuple, uint16_t windowFrames, tDeauthAlarm* pAlarm )
+{
+    memcpy( pAlarm->target, &pTuple->key[ 0 ],  6 );
+    memcpy( pAlarm->source, &pTuple->key[ 6 ],  6 );
+    memcpy( pAlarm->bssid,  &pTuple->key[ 12 ], 6 );
+    pAlarm->windowFrames = windowFrames;
+    pAlarm->totalFrames  = pTuple->totalFrames;
+    pAlarm->lastSeenMs   = pTuple->lastTick << DEAUTH_BUCKET_SHIFT;
+    pAlarm->all          = pTuple == &deauthDetectorVars.all;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t hashKey( const uint8_t* pKey )
+{
+    // FNV-1a over the three addresses, then the finalizer so every
+    // byte reaches the slot bits
+    uint32_t hash = 2166136261u;
+    for ( uint8_t i = 0; i < DEAUTH_KEY_LEN; ++i )
+    {
+        hash ^= pKey[ i ];
+        hash *= 16777619u;
+    }
+    return mix32( hash );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t mix32( uint32_t value )
+{
+    // MurmurHash3 finalizer
+    value ^= value >> 16;
+    value *= 0x85EBCA6Bu;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35u;
+    value ^= value >> 16;
+    return value;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline void countEvent( uint32_t* pCounter )
+{
+    __atomic_store_n( pCounter, *pCounter + 1, __ATOMIC_RELAXED );
+}
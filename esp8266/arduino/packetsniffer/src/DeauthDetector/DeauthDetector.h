@@ -0,0 +1,57 @@
+/**
+ * @file    DeauthDetector.h
+ * @brief   Deauth detector private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef DEAUTHDETECTOR_H
+#define DEAUTHDETECTOR_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IDeauthDetector.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#if ( DEAUTH_WHEEL_SLOTS & ( DEAUTH_WHEEL_SLOTS - 1 ) ) != 0
+#error "DEAUTH_WHEEL_SLOTS must be a power of two"
+#endif
+
+#define DEAUTH_WHEEL_MASK           ( DEAUTH_WHEEL_SLOTS - 1 )
+
+#if ( DEAUTH_TRACKED_TUPLES & ( DEAUTH_TRACKED_TUPLES - 1 ) ) != 0
+#error "DEAUTH_TRACKED_TUPLES must be a power of two"
+#endif
+
+#if DEAUTH_PROBE_LIMIT > DEAUTH_TRACKED_TUPLES
+#error "DEAUTH_PROBE_LIMIT must not exceed DEAUTH_TRACKED_TUPLES"
+#endif
+
+#define DEAUTH_TUPLE_MASK           ( DEAUTH_TRACKED_TUPLES - 1 )
+
+// Bytes of the tuple key, source + BSSID + target
+#define DEAUTH_KEY_LEN              18
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // DEAUTHDETECTOR_H
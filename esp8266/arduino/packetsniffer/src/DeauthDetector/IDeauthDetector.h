@@ -0,0 +1,147 @@
+/**
+ * @file    IDeauthDetector.h
+ * @brief   Sliding window deauthentication/disassociation flood
+ *          detector.
+ *
+ *          Frames are counted per (source, BSSID, target) tuple in a
+ *          time wheel of DEAUTH_WHEEL_SLOTS buckets, so the rate over
+ *          the last window is known at every frame rather than once
+ *          per report interval. A tuple raises an alarm on the frame
+ *          that brings its window count up to DEAUTH_ALARM_LEVEL and
+ *          is re-armed once the count has dropped below it again.
+ *
+ *          A flood from random sources or at random targets makes a
+ *          new tuple of every frame and none of them reaches the
+ *          level, so all frames are also counted together in one more
+ *          wheel. It raises a flood alarm on DEAUTH_FLOOD_LEVEL frames
+ *          within the window, re-armed the same way.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IDEAUTHDETECTOR_H
+#define IDEAUTHDETECTOR_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Frames per window from one tuple that raise an alarm
+#ifndef DEAUTH_ALARM_LEVEL
+#define DEAUTH_ALARM_LEVEL          5
+#endif
+
+// Frames per window from all tuples together that raise a flood
+// alarm, one more than a lone attacker's so that raises its own first
+#ifndef DEAUTH_FLOOD_LEVEL
+#define DEAUTH_FLOOD_LEVEL          ( DEAUTH_ALARM_LEVEL + 1 )
+#endif
+
+// Bucket width is 2^N ms, window is DEAUTH_WHEEL_SLOTS buckets
+// (default 8 x 128 ms, about one second)
+#ifndef DEAUTH_BUCKET_SHIFT
+#define DEAUTH_BUCKET_SHIFT         7
+#endif
+#define DEAUTH_WHEEL_SLOTS          8
+#define DEAUTH_WINDOW_MS            ( DEAUTH_WHEEL_SLOTS << DEAUTH_BUCKET_SHIFT )
+
+// Number of tuples tracked at once, must be a power of two (40 bytes
+// each)
+#ifndef DEAUTH_TRACKED_TUPLES
+#define DEAUTH_TRACKED_TUPLES       16
+#endif
+
+// Longest probe sequence, bounds the cost of a frame
+#ifndef DEAUTH_PROBE_LIMIT
+#define DEAUTH_PROBE_LIMIT          4
+#endif
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint8_t  source[ 6 ];   // Transmitter (addr2)
+    uint8_t  bssid[ 6 ];    // addr3
+    uint8_t  target[ 6 ];   // Receiver (addr1), broadcast kicks everyone
+    uint16_t windowFrames;  // Frames within the last DEAUTH_WINDOW_MS
+    uint32_t totalFrames;   // Frames since tuple was first seen
+    uint32_t lastSeenMs;    // Start of the bucket of the last frame
+    bool     all;           // Flood alarm, all tuples together, addresses zero
+} tDeauthAlarm;
+
+typedef struct
+{
+    uint32_t frames;        // Deauth/disassoc frames counted
+    uint32_t alarms;        // Alarms raised by tuples
+    uint32_t floods;        // Alarms raised by all tuples together
+    uint32_t replaced;      // Tuples dropped to make room for new ones
+    uint32_t truncated;     // Frames skipped, addresses not captured
+    uint32_t memoryBytes;   // Of the tuples
+} tDeauthDetectorStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Forget all tuples and reset statistics.
+ */
+void IDeauthDetector_Init( void );
+
+/**
+ * Count a deauthentication or disassociation frame. Bounded cost,
+ * safe to call from the RX callback.
+ *
+ * @param  pHeader  MAC header
+ * @param  captured Number of valid bytes in pHeader, frames cut
+ *                  before the end of addr3 are skipped
+ * @param  nowMs    Current time
+ */
+void IDeauthDetector_Count( const uint8_t* pHeader, uint16_t captured, uint32_t nowMs );
+
+/**
+ * Get the next alarm raised since the last call. Cheap, call from
+ * every loop() to report alarms without waiting for the next
+ * statistics interval.
+ *
+ * @param  pAlarm Output, the tuple that raised the alarm, or all of
+ *                them
+ * @return FALSE if no new alarm has been raised.
+ */
+bool IDeauthDetector_PollAlarm( tDeauthAlarm* pAlarm );
+
+/**
+ * Get tuples currently at or above the alarm level.
+ *
+ * @param  nowMs   Current time
+ * @param  pActive Output array
+ * @param  count   Size of pActive
+ * @return Number of tuples written to pActive.
+ */
+uint8_t IDeauthDetector_Active( uint32_t nowMs, tDeauthAlarm* pActive, uint8_t count );
+
+/**
+ * Get running statistics.
+ *
+ * @param  pStats Output
+ */
+void IDeauthDetector_GetStats( tDeauthDetectorStats* pStats );
+
+#endif // IDEAUTHDETECTOR_H
@@ -0,0 +1,234 @@
+/**
+ * @file    DistinctDevices.cpp
+ * @brief   Distinct transmitter counts per channel and interval,
+ *          estimated with HyperLogLog.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <math.h>
+#include <string.h>
+
+#include "DistinctDevices.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    tDistinctDevicesBank banks[ DISTINCT_DEVICES_BANKS ];
+    tHllSketch           total;
+    uint32_t             activeBank;
+    uint32_t             writerBusy;
+} tDistinctDevicesVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static inline uint32_t hashMac( const uint8_t* pMac );
+static inline uint32_t mix32( uint32_t value );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tDistinctDevicesVars distinctDevicesVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IDistinctDevices_Init( void )
+{
+    memset( &distinctDevicesVars, 0, sizeof( distinctDevicesVars ) );
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IDistinctDevices_Count( uint8_t channel, const uint8_t* pMac )
+{
+    if ( channel > CHANNEL_HOP_MAX_CHANNEL )
+    {
+        return;
+    }
+
+    // Top bits pick the register, the rank is the position of the
+    // first set bit in the rest
+    uint32_t hash  = hashMac( pMac );
+    uint32_t index = hash >> HLL_RANK_BITS;
+    uint32_t rest  = hash << HLL_PRECISION;
+    uint8_t  rank  = rest == 0 ? HLL_RANK_BITS + 1 : (uint8_t)( __builtin_clz( rest ) + 1 );
+
+    __atomic_store_n( &distinctDevicesVars.writerBusy, 1, __ATOMIC_SEQ_CST );
+    uint32_t active    = __atomic_load_n( &distinctDevicesVars.activeBank, __ATOMIC_SEQ_CST );
+    uint8_t* pRegister = &distinctDevicesVars.banks[ active ].channels[ channel ].registers[ index ];
+    if ( rank > *pRegister )
+    {
+        *pRegister = rank;
+    }
+    __atomic_store_n( &distinctDevicesVars.writerBusy, 0, __ATOMIC_RELEASE );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+const tDistinctDevicesBank* IDistinctDevices_Swap( void )
+{
+    uint32_t retired = distinctDevicesVars.activeBank;
+    uint32_t next    = retired ^ 1;
+
+    // Next bank still holds the interval returned by the previous call
+    memset( &distinctDevicesVars.banks[ next ], 0, sizeof( tDistinctDevicesBank ) );
+
+    __atomic_store_n( &distinctDevicesVars.activeBank, next, __ATOMIC_SEQ_CST );
+    while ( __atomic_load_n( &distinctDevicesVars.writerBusy, __ATOMIC_SEQ_CST ) != 0 )
+    {
+        // Callback still writing into retired bank
+    }
+
+    tDistinctDevicesBank* pBank = &distinctDevicesVars.banks[ retired ];
+    for ( uint8_t channel = 0; channel <= CHANNEL_HOP_MAX_CHANNEL; ++channel )
+    {
+        IDistinctDevices_Merge( &pBank->all, &pBank->channels[ channel ] );
+    }
+    IDistinctDevices_Merge( &distinctDevicesVars.total, &pBank->all );
+
+    return pBank;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+const tHllSketch* IDistinctDevices_GetTotal( void )
+{
+    return &distinctDevicesVars.total;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IDistinctDevices_Merge( tHllSketch* pDst, const tHllSketch* pSrc )
+{
+    for ( uint32_t i = 0; i < HLL_REGISTERS; ++i )
+    {
+        if ( pSrc->registers[ i ] > pDst->registers[ i ] )
+        {
+            pDst->registers[ i ] = pSrc->registers[ i ];
+        }
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint32_t IDistinctDevices_Estimate( const tHllSketch* pSketch )
+{
+    const float m = HLL_REGISTERS;
+
+    float    sum   = 0.0f;
+    uint32_t zeros = 0;
+    for ( uint32_t i = 0; i < HLL_REGISTERS; ++i )
+    {
+        sum   += 1.0f / (float)( 1UL << pSketch->registers[ i ] );
+        zeros += pSketch->registers[ i ] == 0;
+    }
+
+    float alpha;
+    switch ( HLL_REGISTERS )
+    {
+        case 16: alpha = 0.673f; break;
+        case 32: alpha = 0.697f; break;
+        case 64: alpha = 0.709f; break;
+        default: alpha = 0.7213f / ( 1.0f + 1.079f / m ); break;
+    }
+    float estimate = alpha * m * m / sum;
+
+    // Linear counting is more accurate while many registers are unused
+    if ( estimate <= 2.5f * m && zeros != 0 )
+    {
+        estimate = m * logf( m / (float)zeros );
+    }
+
+    // Hash collisions in the 32 bit hash space
+    const float hashSpace = 4294967296.0f;
+    if ( estimate > hashSpace / 30.0f )
+    {
+        estimate = -hashSpace * logf( 1.0f - estimate / hashSpace );
+    }
+
+    return (uint32_t)( estimate + 0.5f );
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t hashMac( const uint8_t* pMac )
+{
+    // Every hash bit matters here, so mix properly
+    uint32_t low  = pMac[ 0 ] | ( pMac[ 1 ] << 8 ) | ( pMac[ 2 ] << 16 ) | ( (uint32_t)pMac[ 3 ] << 24 );
+    uint32_t high = pMac[ 4 ] | ( pMac[ 5 ] << 8 );
+    return mix32( low ^ mix32( high ) );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t mix32( uint32_t value )
+{
+    // MurmurHash3 finalizer
+    value ^= value >> 16;
+    value *= 0x85EBCA6Bu;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35u;
+    value ^= value >> 16;
+    return value;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file    DistinctDevices.h
+ * @brief   Distinct device counter private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef DISTINCTDEVICES_H
+#define DISTINCTDEVICES_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IDistinctDevices.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#if HLL_PRECISION < 4 || HLL_PRECISION > 16
+#error "HLL_PRECISION must be within 4..16"
+#endif
+
+#define DISTINCT_DEVICES_BANKS      2
+
+// Hash bits left after the register index
+#define HLL_RANK_BITS               ( 32 - HLL_PRECISION )
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // DISTINCTDEVICES_H
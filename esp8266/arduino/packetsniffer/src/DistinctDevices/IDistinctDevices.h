@@ -0,0 +1,118 @@
+/**
+ * @file    IDistinctDevices.h
+ * @brief   Distinct transmitter counts per channel and interval,
+ *          estimated with HyperLogLog.
+ *
+ *          Each sketch is 2^HLL_PRECISION one byte registers, standard
+ *          error is about 1.04 / sqrt( 2^HLL_PRECISION ) regardless of
+ *          the number of devices. Sketches merge by taking the max of
+ *          each register, which is how per-channel interval sketches
+ *          are combined into the all-channel and running totals.
+ *
+ *          The RX callback writes into the active bank of per-channel
+ *          sketches, loop() retires it once per interval, in the same
+ *          way as FrameCounters.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IDISTINCTDEVICES_H
+#define IDISTINCTDEVICES_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+
+#include <ChannelHop/IChannelHop.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Registers per sketch = 2^HLL_PRECISION (4..16). 256 give about
+// 6.5% standard error; two banks of 16 sketches and the total are
+// 33 sketches, about 8.4 kB.
+#ifndef HLL_PRECISION
+#define HLL_PRECISION               8
+#endif
+
+#define HLL_REGISTERS               ( 1 << HLL_PRECISION )
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint8_t registers[ HLL_REGISTERS ];
+} tHllSketch;
+
+// One interval of sketches, indexed by rx_ctrl channel
+typedef struct
+{
+    tHllSketch channels[ CHANNEL_HOP_MAX_CHANNEL + 1 ];
+    tHllSketch all;                 // All channels merged, set by Swap()
+} tDistinctDevicesBank;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Clear all sketches. Must not be called while the RX callback is
+ * active.
+ */
+void IDistinctDevices_Init( void );
+
+/**
+ * Add a transmitter address to the active interval. Safe to call
+ * from the RX callback.
+ *
+ * @param  channel Channel from rx_ctrl
+ * @param  pMac    Transmitter address, need not be aligned
+ */
+void IDistinctDevices_Count( uint8_t channel, const uint8_t* pMac );
+
+/**
+ * Retire the active interval and start a new one. The retired
+ * interval is merged into the running total.
+ *
+ * @return Retired interval, valid until the next call.
+ */
+const tDistinctDevicesBank* IDistinctDevices_Swap( void );
+
+/**
+ * Get sketch of all devices seen since IDistinctDevices_Init(), up
+ * to the last IDistinctDevices_Swap().
+ *
+ * @return Running total sketch
+ */
+const tHllSketch* IDistinctDevices_GetTotal( void );
+
+/**
+ * Merge a sketch into another, afterwards pDst estimates the union.
+ *
+ * @param  pDst Sketch to merge into
+ * @param  pSrc Sketch to merge from
+ */
+void IDistinctDevices_Merge( tHllSketch* pDst, const tHllSketch* pSrc );
+
+/**
+ * Estimate the number of distinct addresses added to a sketch.
+ *
+ * @param  pSketch Sketch
+ * @return Estimated count
+ */
+uint32_t IDistinctDevices_Estimate( const tHllSketch* pSketch );
+
+#endif // IDISTINCTDEVICES_H
@@ -0,0 +1,708 @@
+/**
+ * @file    FlashLog.cpp
+ * @brief   Compressed capture log in flash.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include "FlashLog.h"
+
+// Nothing below is built unless enabled
+#if FLASH_LOG
+
+#include <flash_hal.h>
+
+extern "C" {
+#include <spi_flash.h>
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    // Block as written to or read from flash, word aligned for
+    // spi_flash_*()
+    uint32_t       block[ ( FLASH_LOG_BLOCK_HEADER_LEN + FLASH_LOG_BLOCK_LEN ) / 4 ];
+
+    // Records being collected, or those of a block being dumped
+    uint8_t        raw[ FLASH_LOG_BLOCK_LEN ];
+    uint16_t       rawLength;
+    uint8_t        rawRecords;
+
+    // Last position of each hashed 4 byte sequence
+    uint16_t       hash[ 1 << FLASH_LOG_HASH_BITS ];
+
+    uint32_t       base;            // Log area offset in flash
+    uint32_t       sectors;
+    bool           open;            // sequence is valid
+    uint32_t       sequence;        // Sector being written
+    uint32_t       offset;          // Next block in it, SPI_FLASH_SEC_SIZE if full
+
+    bool           dumping;
+    uint32_t       dumpSequence;    // Sector being read
+    uint32_t       dumpOffset;      // Next block in it, 0 before the sector header
+
+    tFlashLogStats stats;
+} tFlashLogVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static void writeBlock( void );
+static void nextSector( void );
+static bool readSectorHeader( uint32_t sector, uint32_t* pSequence, uint32_t* pErases );
+static bool readBlockHeader( uint32_t sequence, uint32_t offset, uint16_t* pStored, uint16_t* pRaw );
+static uint16_t compressBlock( const uint8_t* pIn, uint16_t length, uint8_t* pOut, uint16_t outMax );
+static bool putSequence( uint8_t* pOut, uint16_t* pLength, uint16_t outMax, const uint8_t* pLiterals, uint16_t literals, uint16_t offset, uint16_t matchLength );
+static uint8_t* putLength( uint8_t* pDst, uint16_t length );
+static bool decompressBlock( const uint8_t* pIn, uint16_t length, uint8_t* pOut, uint16_t rawLength );
+static bool getLength( const uint8_t* pIn, uint16_t length, uint16_t* pPosition, uint32_t* pValue );
+static uint16_t fletcher16( const uint8_t* pData, uint16_t length );
+static inline uint32_t read32( const uint8_t* pData );
+static inline uint16_t get16( const uint8_t* pData );
+static inline uint32_t alignedLength( uint16_t length );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tFlashLogVars flashLogVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IFlashLog_Init( void )
+{
+    memset( &flashLogVars, 0, sizeof( flashLogVars ) );
+    flashLogVars.base          = FS_PHYS_ADDR;
+    flashLogVars.sectors       = FS_PHYS_SIZE / SPI_FLASH_SEC_SIZE;
+    flashLogVars.stats.sectors = flashLogVars.sectors;
+
+    // Newest sector left by an earlier run
+    uint32_t erases = 0;
+    for ( uint32_t sector = 0; sector < flashLogVars.sectors; ++sector )
+    {
+        uint32_t sequence;
+        uint32_t sectorErases;
+        if ( !readSectorHeader( sector, &sequence, &sectorErases ) )
+        {
+            continue;
+        }
+        if ( !flashLogVars.open || sequence > flashLogVars.sequence )
+        {
+            flashLogVars.open     = true;
+            flashLogVars.sequence = sequence;
+            erases                = sectorErases;
+        }
+    }
+    if ( !flashLogVars.open )
+    {
+        return;
+    }
+    flashLogVars.stats.sequence  = flashLogVars.sequence;
+    flashLogVars.stats.maxErases = erases;
+
+    // Continue after its last block. One that doesn't make sense was
+    // cut short by a reset, start over in the next sector.
+    flashLogVars.offset = FLASH_LOG_SECTOR_HEADER_LEN;
+    while ( flashLogVars.offset + FLASH_LOG_BLOCK_HEADER_LEN <= SPI_FLASH_SEC_SIZE )
+    {
+        uint16_t stored;
+        uint16_t raw;
+        if ( !readBlockHeader( flashLogVars.sequence, flashLogVars.offset, &stored, &raw ) )
+        {
+            if ( stored != FLASH_LOG_ERASED_LEN )
+            {
+                flashLogVars.offset = SPI_FLASH_SEC_SIZE;
+            }
+            break;
+        }
+        flashLogVars.offset += FLASH_LOG_BLOCK_HEADER_LEN + alignedLength( stored );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool IFlashLog_Append( const uint8_t* pRecord, uint16_t length )
+{
+    if ( flashLogVars.sectors == 0 || flashLogVars.dumping || length == 0 || length > FLASH_LOG_RECORD_MAX_LEN )
+    {
+        ++flashLogVars.stats.dropped;
+        return false;
+    }
+
+    if ( flashLogVars.rawLength + 1 + length > FLASH_LOG_BLOCK_LEN || flashLogVars.rawRecords == UINT8_MAX )
+    {
+        writeBlock();
+    }
+
+    flashLogVars.raw[ flashLogVars.rawLength ] = (uint8_t)length;
+    memcpy( &flashLogVars.raw[ flashLogVars.rawLength + 1 ], pRecord, length );
+    flashLogVars.rawLength += 1 + length;
+    ++flashLogVars.rawRecords;
+    ++flashLogVars.stats.records;
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IFlashLog_Flush( void )
+{
+    writeBlock();
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IFlashLog_DumpStart( void )
+{
+    writeBlock();
+
+    flashLogVars.stats.dumped  = 0;
+    flashLogVars.stats.corrupt = 0;
+    if ( !flashLogVars.open )
+    {
+        return;
+    }
+
+    // Oldest sector is the one to be erased next
+    flashLogVars.dumping      = true;
+    flashLogVars.dumpSequence = flashLogVars.sequence + 1 >= flashLogVars.sectors ? flashLogVars.sequence + 1 - flashLogVars.sectors : 0;
+    flashLogVars.dumpOffset   = 0;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool IFlashLog_DumpNext( tFlashLogEmit pEmit )
+{
+    while ( flashLogVars.dumping )
+    {
+        if ( flashLogVars.dumpSequence > flashLogVars.sequence )
+        {
+            flashLogVars.dumping = false;
+            break;
+        }
+
+        // Sectors never written, or left over from a log area of a
+        // different size, are skipped
+        if ( flashLogVars.dumpOffset == 0 )
+        {
+            uint32_t sequence;
+            uint32_t erases;
+            if ( !readSectorHeader( flashLogVars.dumpSequence % flashLogVars.sectors, &sequence, &erases ) || sequence != flashLogVars.dumpSequence )
+            {
+                ++flashLogVars.dumpSequence;
+                continue;
+            }
+            flashLogVars.dumpOffset = FLASH_LOG_SECTOR_HEADER_LEN;
+        }
+
+        uint16_t stored;
+        uint16_t raw;
+        if ( flashLogVars.dumpOffset + FLASH_LOG_BLOCK_HEADER_LEN > SPI_FLASH_SEC_SIZE ||
+             !readBlockHeader( flashLogVars.dumpSequence, flashLogVars.dumpOffset, &stored, &raw ) )
+        {
+            ++flashLogVars.dumpSequence;
+            flashLogVars.dumpOffset = 0;
+            continue;
+        }
+
+        uint8_t* pBlock  = (uint8_t*)flashLogVars.block;
+        uint8_t* pStored = &pBlock[ FLASH_LOG_BLOCK_HEADER_LEN ];
+        uint32_t address = flashLogVars.base + ( flashLogVars.dumpSequence % flashLogVars.sectors ) * SPI_FLASH_SEC_SIZE + flashLogVars.dumpOffset;
+        flashLogVars.dumpOffset += FLASH_LOG_BLOCK_HEADER_LEN + alignedLength( stored );
+        if ( spi_flash_read( address + FLASH_LOG_BLOCK_HEADER_LEN, &flashLogVars.block[ FLASH_LOG_BLOCK_HEADER_LEN / 4 ], alignedLength( stored ) ) != SPI_FLASH_RESULT_OK )
+        {
+            ++flashLogVars.stats.errors;
+            ++flashLogVars.stats.corrupt;
+            return true;
+        }
+
+        bool ok = fletcher16( pStored, stored ) == get16( &pBlock[ 6 ] );
+        if ( ok && ( pBlock[ 4 ] & FLASH_LOG_BLOCK_LZ4 ) != 0 )
+        {
+            ok = decompressBlock( pStored, stored, flashLogVars.raw, raw );
+        }
+        else if ( ok )
+        {
+            ok = stored == raw;
+            memcpy( flashLogVars.raw, pStored, stored );
+        }
+
+        // Records up to the first one that doesn't fit
+        uint16_t position = 0;
+        uint8_t  records  = 0;
+        while ( ok && position < raw && records < pBlock[ 5 ] )
+        {
+            uint8_t length = flashLogVars.raw[ position ];
+            if ( length == 0 || position + 1 + length > raw )
+            {
+                break;
+            }
+            pEmit( &flashLogVars.raw[ position + 1 ], length );
+            position += 1 + length;
+            ++records;
+        }
+        flashLogVars.stats.dumped += records;
+        if ( !ok || position != raw || records != pBlock[ 5 ] )
+        {
+            ++flashLogVars.stats.corrupt;
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IFlashLog_GetStats( tFlashLogStats* pStats )
+{
+    *pStats = flashLogVars.stats;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void writeBlock( void )
+{
+    if ( flashLogVars.rawLength == 0 )
+    {
+        return;
+    }
+
+    // Stored as is unless compression saves something
+    uint8_t* pBlock  = (uint8_t*)flashLogVars.block;
+    uint8_t* pStored = &pBlock[ FLASH_LOG_BLOCK_HEADER_LEN ];
+    uint8_t  flags   = FLASH_LOG_BLOCK_LZ4;
+    uint16_t stored  = compressBlock( flashLogVars.raw, flashLogVars.rawLength, pStored, flashLogVars.rawLength - 1 );
+    if ( stored == 0 )
+    {
+        memcpy( pStored, flashLogVars.raw, flashLogVars.rawLength );
+        stored = flashLogVars.rawLength;
+        flags  = 0;
+    }
+
+    // Padding is left erased
+    uint32_t length = FLASH_LOG_BLOCK_HEADER_LEN + alignedLength( stored );
+    memset( &pStored[ stored ], 0xFF, length - FLASH_LOG_BLOCK_HEADER_LEN - stored );
+
+    uint16_t check = fletcher16( pStored, stored );
+    pBlock[ 0 ] = (uint8_t)stored;
+    pBlock[ 1 ] = (uint8_t)( stored >> 8 );
+    pBlock[ 2 ] = (uint8_t)flashLogVars.rawLength;
+    pBlock[ 3 ] = (uint8_t)( flashLogVars.rawLength >> 8 );
+    pBlock[ 4 ] = flags;
+    pBlock[ 5 ] = flashLogVars.rawRecords;
+    pBlock[ 6 ] = (uint8_t)check;
+    pBlock[ 7 ] = (uint8_t)( check >> 8 );
+
+    // Blocks never straddle sectors
+    if ( !flashLogVars.open || flashLogVars.offset + length > SPI_FLASH_SEC_SIZE )
+    {
+        nextSector();
+    }
+
+    uint32_t address = flashLogVars.base + ( flashLogVars.sequence % flashLogVars.sectors ) * SPI_FLASH_SEC_SIZE + flashLogVars.offset;
+    if ( flashLogVars.offset + length > SPI_FLASH_SEC_SIZE ||
+         spi_flash_write( address, flashLogVars.block, length ) != SPI_FLASH_RESULT_OK )
+    {
+        // Try the next sector with the next block
+        ++flashLogVars.stats.errors;
+        flashLogVars.offset = SPI_FLASH_SEC_SIZE;
+    }
+    else
+    {
+        flashLogVars.offset += length;
+        ++flashLogVars.stats.blocks;
+        flashLogVars.stats.compressed  += flags != 0;
+        flashLogVars.stats.rawBytes    += flashLogVars.rawLength;
+        flashLogVars.stats.storedBytes += length;
+    }
+
+    flashLogVars.rawLength  = 0;
+    flashLogVars.rawRecords = 0;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void nextSector( void )
+{
+    flashLogVars.sequence = flashLogVars.open ? flashLogVars.sequence + 1 : 0;
+    flashLogVars.open     = true;
+    flashLogVars.offset   = SPI_FLASH_SEC_SIZE;
+    flashLogVars.stats.sequence = flashLogVars.sequence;
+
+    // Keep counting erases where the sector's last header left off
+    uint32_t sector = flashLogVars.sequence % flashLogVars.sectors;
+    uint32_t sequence;
+    uint32_t erases;
+    if ( !readSectorHeader( sector, &sequence, &erases ) )
+    {
+        erases = 0;
+    }
+    ++erases;
+    flashLogVars.stats.maxErases = erases > flashLogVars.stats.maxErases ? erases : flashLogVars.stats.maxErases;
+
+    uint32_t address = flashLogVars.base + sector * SPI_FLASH_SEC_SIZE;
+    if ( spi_flash_erase_sector( (uint16_t)( address / SPI_FLASH_SEC_SIZE ) ) != SPI_FLASH_RESULT_OK )
+    {
+        ++flashLogVars.stats.errors;
+        return;
+    }
+    ++flashLogVars.stats.erases;
+
+    uint32_t header[ FLASH_LOG_SECTOR_HEADER_LEN / 4 ] = {
+        FLASH_LOG_MAGIC, flashLogVars.sequence, erases, ~( FLASH_LOG_MAGIC ^ flashLogVars.sequence ^ erases )
+    };
+    if ( spi_flash_write( address, header, sizeof( header ) ) != SPI_FLASH_RESULT_OK )
+    {
+        ++flashLogVars.stats.errors;
+        return;
+    }
+    flashLogVars.offset = FLASH_LOG_SECTOR_HEADER_LEN;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool readSectorHeader( uint32_t sector, uint32_t* pSequence, uint32_t* pErases )
+{
+    uint32_t header[ FLASH_LOG_SECTOR_HEADER_LEN / 4 ];
+    if ( spi_flash_read( flashLogVars.base + sector * SPI_FLASH_SEC_SIZE, header, sizeof( header ) ) != SPI_FLASH_RESULT_OK )
+    {
+        ++flashLogVars.stats.errors;
+        return false;
+    }
+    if ( header[ 0 ] != FLASH_LOG_MAGIC || header[ 3 ] != ~( header[ 0 ] ^ header[ 1 ] ^ header[ 2 ] ) || header[ 1 ] % flashLogVars.sectors != sector )
+    {
+        return false;
+    }
+    *pSequence = header[ 1 ];
+    *pErases   = header[ 2 ];
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool readBlockHeader( uint32_t sequence, uint32_t offset, uint16_t* pStored, uint16_t* pRaw )
+{
+    uint32_t address = flashLogVars.base + ( sequence % flashLogVars.sectors ) * SPI_FLASH_SEC_SIZE + offset;
+    if ( spi_flash_read( address, flashLogVars.block, FLASH_LOG_BLOCK_HEADER_LEN ) != SPI_FLASH_RESULT_OK )
+    {
+        ++flashLogVars.stats.errors;
+        *pStored = 0;
+        return false;
+    }
+
+    const uint8_t* pBlock = (const uint8_t*)flashLogVars.block;
+    *pStored = get16( &pBlock[ 0 ] );
+    *pRaw    = get16( &pBlock[ 2 ] );
+    return *pStored != 0 && *pStored <= FLASH_LOG_BLOCK_LEN &&
+           *pRaw    != 0 && *pRaw    <= FLASH_LOG_BLOCK_LEN &&
+           offset + FLASH_LOG_BLOCK_HEADER_LEN + alignedLength( *pStored ) <= SPI_FLASH_SEC_SIZE;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint16_t compressBlock( const uint8_t* pIn, uint16_t length, uint8_t* pOut, uint16_t outMax )
+{
+    // LZ4 block format, greedy with a single hash probe: a few hundred
+    // cycles per record and most of the gain on similar frames
+    uint16_t in     = 0;
+    uint16_t anchor = 0;
+    uint16_t out    = 0;
+    memset( flashLogVars.hash, 0, sizeof( flashLogVars.hash ) );
+
+    if ( length > FLASH_LOG_MATCH_LIMIT )
+    {
+        uint16_t matchLimit = length - FLASH_LOG_MATCH_LIMIT;
+        uint16_t copyLimit  = length - FLASH_LOG_LAST_LITERALS;
+        while ( in <= matchLimit )
+        {
+            uint32_t sequence  = read32( &pIn[ in ] );
+            uint16_t hash      = (uint16_t)( ( sequence * 2654435761u ) >> ( 32 - FLASH_LOG_HASH_BITS ) );
+            uint16_t candidate = flashLogVars.hash[ hash ];
+            flashLogVars.hash[ hash ] = in;
+            if ( candidate >= in || read32( &pIn[ candidate ] ) != sequence )
+            {
+                ++in;
+                continue;
+            }
+
+            uint16_t matchLength = FLASH_LOG_MIN_MATCH;
+            while ( in + matchLength < copyLimit && pIn[ candidate + matchLength ] == pIn[ in + matchLength ] )
+            {
+                ++matchLength;
+            }
+            if ( !putSequence( pOut, &out, outMax, &pIn[ anchor ], in - anchor, in - candidate, matchLength ) )
+            {
+                return 0;
+            }
+            in    += matchLength;
+            anchor = in;
+        }
+    }
+
+    // Rest as literals
+    if ( !putSequence( pOut, &out, outMax, &pIn[ anchor ], length - anchor, 0, 0 ) )
+    {
+        return 0;
+    }
+    return out;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool putSequence( uint8_t* pOut, uint16_t* pLength, uint16_t outMax, const uint8_t* pLiterals, uint16_t literals, uint16_t offset, uint16_t matchLength )
+{
+    // Token, literals and their extra length bytes, offset and extra
+    // match length bytes
+    uint32_t need = 1 + literals + ( literals >= 15 ? ( literals - 15 ) / 255 + 1 : 0 );
+    if ( matchLength != 0 )
+    {
+        uint16_t extra = matchLength - FLASH_LOG_MIN_MATCH;
+        need += 2 + ( extra >= 15 ? ( extra - 15 ) / 255 + 1 : 0 );
+    }
+    if ( *pLength + need > outMax )
+    {
+        return false;
+    }
+
+    uint8_t* pToken = &pOut[ *pLength ];
+    uint8_t* pDst   = pToken + 1;
+    *pToken = (uint8_t)( ( literals >= 15 ? 15 : literals ) << 4 );
+    if ( literals >= 15 )
+    {
+        pDst = putLength( pDst, literals - 15 );
+    }
+    memcpy( pDst, pLiterals, literals );
+    pDst += literals;
+
+    if ( matchLength != 0 )
+    {
+        uint16_t extra = matchLength - FLASH_LOG_MIN_MATCH;
+        *pToken |= extra >= 15 ? 15 : extra;
+        *pDst++ = (uint8_t)offset;
+        *pDst++ = (uint8_t)( offset >> 8 );
+        if ( extra >= 15 )
+        {
+            pDst = putLength( pDst, extra - 15 );
+        }
+    }
+
+    *pLength = (uint16_t)( pDst - pOut );
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint8_t* putLength( uint8_t* pDst, uint16_t length )
+{
+    while ( length >= 255 )
+    {
+        *pDst++ = 255;
+        length -= 255;
+    }
+    *pDst++ = (uint8_t)length;
+    return pDst;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool decompressBlock( const uint8_t* pIn, uint16_t length, uint8_t* pOut, uint16_t rawLength )
+{
+    // Flash contents are not trusted, every length is checked against
+    // both buffers
+    uint16_t in  = 0;
+    uint16_t out = 0;
+    while ( in < length )
+    {
+        uint8_t  token    = pIn[ in++ ];
+        uint32_t literals = token >> 4;
+        if ( literals == 15 && !getLength( pIn, length, &in, &literals ) )
+        {
+            return false;
+        }
+        if ( literals > (uint32_t)( length - in ) || literals > (uint32_t)( rawLength - out ) )
+        {
+            return false;
+        }
+        memcpy( &pOut[ out ], &pIn[ in ], literals );
+        in  += literals;
+        out += literals;
+
+        // Last sequence has no match
+        if ( in == length )
+        {
+            break;
+        }
+        if ( length - in < 2 )
+        {
+            return false;
+        }
+        uint16_t offset = get16( &pIn[ in ] );
+        in += 2;
+
+        uint32_t matchLength = token & 0x0F;
+        if ( matchLength == 15 && !getLength( pIn, length, &in, &matchLength ) )
+        {
+            return false;
+        }
+        matchLength += FLASH_LOG_MIN_MATCH;
+        if ( offset == 0 || offset > out || matchLength > (uint32_t)( rawLength - out ) )
+        {
+            return false;
+        }
+
+        // May overlap itself, byte by byte
+        for ( ; matchLength > 0; --matchLength, ++out )
+        {
+            pOut[ out ] = pOut[ out - offset ];
+        }
+    }
+    return out == rawLength;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool getLength( const uint8_t* pIn, uint16_t length, uint16_t* pPosition, uint32_t* pValue )
+{
+    uint8_t value;
+    do
+    {
+        if ( *pPosition >= length )
+        {
+            return false;
+        }
+        value    = pIn[ ( *pPosition )++ ];
+        *pValue += value;
+    } while ( value == 255 );
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint16_t fletcher16( const uint8_t* pData, uint16_t length )
+{
+    uint16_t sum1 = 0;
+    uint16_t sum2 = 0;
+    for ( uint16_t i = 0; i < length; ++i )
+    {
+        sum1 = ( sum1 + pData[ i ] ) % 255;
+        sum2 = ( sum2 + sum1 ) % 255;
+    }
+    return ( sum2 << 8 ) | sum1;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t read32( const uint8_t* pData )
+{
+    uint32_t value;
+    memcpy( &value, pData, sizeof( value ) );
+    return value;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint16_t get16( const uint8_t* pData )
+{
+    return (uint16_t)( pData[ 0 ] | ( pData[ 1 ] << 8 ) );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t alignedLength( uint16_t length )
+{
+    return ( (uint32_t)length + 3 ) & ~3u;
+}
+
+#endif // FLASH_LOG
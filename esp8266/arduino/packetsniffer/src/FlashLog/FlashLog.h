@@ -0,0 +1,61 @@
+/**
+ * @file    FlashLog.h
+ * @brief   Flash log private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IFlashLog.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#define FLASH_LOG_SECTOR_HEADER_LEN 16
+#define FLASH_LOG_BLOCK_HEADER_LEN  8
+
+// Stored length of a block not yet written
+#define FLASH_LOG_ERASED_LEN        0xFFFF
+
+// Compressor hash table, 2 bytes per entry
+#define FLASH_LOG_HASH_BITS         10
+
+// LZ4 block format limits: shortest match, last match must start this
+// far from the end, the last bytes are always literals
+#define FLASH_LOG_MIN_MATCH         4
+#define FLASH_LOG_MATCH_LIMIT       12
+#define FLASH_LOG_LAST_LITERALS     5
+
+#if FLASH_LOG_BLOCK_LEN > 4096 - FLASH_LOG_SECTOR_HEADER_LEN - FLASH_LOG_BLOCK_HEADER_LEN
+#error "FLASH_LOG_BLOCK_LEN: a block must fit in a sector"
+#endif
+
+#if FLASH_LOG_BLOCK_LEN % 4 != 0
+#error "FLASH_LOG_BLOCK_LEN must be a multiple of 4"
+#endif
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // FLASHLOG_H
@@ -0,0 +1,150 @@
+/**
+ * @file    IFlashLog.h
+ * @brief   Compressed capture log in flash, for unattended sniffing
+ *          without a host on the serial port.
+ *
+ *          Build with -DFLASH_LOG=1 to enable. Records (the payload of
+ *          STREAM_RECORD_FRAME) are collected in a RAM block, which is
+ *          LZ4 compressed and written with a single flash write once
+ *          full. Blocks go into the sectors of the filesystem area in
+ *          turn, erasing the oldest sector when the log wraps, so every
+ *          sector is erased equally often.
+ *
+ *          Sector layout (little endian):
+ *
+ *            u32  magic (FLASH_LOG_MAGIC)
+ *            u32  sequence, +1 per sector written since the log was
+ *                 first used, sector = sequence % sectors
+ *            u32  times this sector has been erased
+ *            u32  check, ~(magic ^ sequence ^ erases)
+ *            ...  blocks, 4 byte aligned, until 0xFFFF (erased)
+ *
+ *          Block layout:
+ *
+ *            u16  stored length
+ *            u16  raw length
+ *            u8   flags (FLASH_LOG_BLOCK_...)
+ *            u8   records
+ *            u16  Fletcher-16 over the stored bytes
+ *            ...  stored bytes, raw ones are u8 length + record
+ *
+ *          Erasing a sector stalls the CPU for tens of milliseconds,
+ *          which the capture ring has to absorb. Only call from loop().
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IFLASHLOG_H
+#define IFLASHLOG_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#ifndef FLASH_LOG
+#define FLASH_LOG                   0
+#endif
+
+// Records collected in RAM before they are compressed and written. A
+// reset loses at most this much.
+#ifndef FLASH_LOG_BLOCK_LEN
+#define FLASH_LOG_BLOCK_LEN         2048
+#endif
+
+// Longest record, the length prefix is a byte
+#define FLASH_LOG_RECORD_MAX_LEN    255
+
+#define FLASH_LOG_MAGIC             0x31474C46  // "FLG1"
+
+// Block flags
+#define FLASH_LOG_BLOCK_LZ4         0x01        // Stored bytes are an LZ4 block
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+// Called for every record read back by IFlashLog_DumpNext()
+typedef void (*tFlashLogEmit)( const uint8_t* pRecord, uint16_t length );
+
+typedef struct
+{
+    uint32_t records;       // Appended since start
+    uint32_t dropped;       // Not appended: too long, dumping or no log area
+    uint32_t blocks;        // Written since start
+    uint32_t compressed;    // Blocks stored compressed
+    uint64_t rawBytes;      // Of the blocks written
+    uint64_t storedBytes;   // Of the blocks written, headers included
+    uint32_t erases;        // Sectors erased since start
+    uint32_t errors;        // Failed flash operations
+    uint32_t sequence;      // Sector being written
+    uint32_t sectors;       // In the log area, 0 if there is none
+    uint32_t maxErases;     // Of the newest sector, written in turn it's the most worn
+    uint32_t dumped;        // Records read back by the last dump
+    uint32_t corrupt;       // Blocks skipped by the last dump
+} tFlashLogStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+#if FLASH_LOG
+
+/**
+ * Find the end of the log left by an earlier run and continue after
+ * it, in a fresh sector if the last one was cut short.
+ */
+void IFlashLog_Init( void );
+
+/**
+ * Append a record, written to flash once the block is full.
+ *
+ * @param  pRecord Record
+ * @param  length  Record length, at most FLASH_LOG_RECORD_MAX_LEN
+ * @return FALSE if the record was dropped.
+ */
+bool IFlashLog_Append( const uint8_t* pRecord, uint16_t length );
+
+/**
+ * Write the records collected so far, e.g. before the device may be
+ * switched off.
+ */
+void IFlashLog_Flush( void );
+
+/**
+ * Start reading the log back, oldest record first. Records appended
+ * until the dump has finished are dropped.
+ */
+void IFlashLog_DumpStart( void );
+
+/**
+ * Read back the next block of a dump started by IFlashLog_DumpStart().
+ *
+ * @param  pEmit Called for every record in the block
+ * @return FALSE when the dump has finished (or none was started).
+ */
+bool IFlashLog_DumpNext( tFlashLogEmit pEmit );
+
+/**
+ * Get log counters.
+ *
+ * @param  pStats Output
+ */
+void IFlashLog_GetStats( tFlashLogStats* pStats );
+
+#endif // FLASH_LOG
+
+#endif // IFLASHLOG_H
@@ -0,0 +1,104 @@
+/**
+ * @file    FrameClass.cpp
+ * @brief   Table driven 802.11 frame classification.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "FrameClass.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+constexpr tFrameClassTable frameClassTable;
+
+// Spot checks that the generated table agrees with the enums
+static_assert( frameClassTable.classes[ 0x40 ] == MANAGEMENT_TYPE_PROBE_REQ,        "Probe request misclassified" );
+static_assert( frameClassTable.classes[ 0x80 ] == MANAGEMENT_TYPE_BEACON,           "Beacon misclassified" );
+static_assert( frameClassTable.classes[ 0xC0 ] == MANAGEMENT_TYPE_DEAUTHENTICATION, "Deauth misclassified" );
+static_assert( frameClassTable.classes[ 0xD4 ] == CONTROL_TYPE_ACK,                 "ACK misclassified" );
+static_assert( frameClassTable.classes[ 0x88 ] == DATA_TYPE_QOS_DATA,               "QoS data misclassified" );
+static_assert( frameClassTable.classes[ 0x01 ] == FRAME_CLASS_INVALID,              "Bad protocol version accepted" );
+
+static const char* const frameClassNames[ FRAME_CLASS_COUNT ] = {
+    // Management
+    "ASSOC_REQ", "ASSOC_RSP", "REASSOC_REQ", "REASSOC_RSP",
+    "PROBE_REQ", "PROBE_RSP", "MGMT_RSV6",   "MGMT_RSV7",
+    "BEACON",    "ATIM",      "DISASSOC",    "AUTH",
+    "DEAUTH",    "ACTION",    "MGMT_RSV14",  "MGMT_RSV15",
+
+    // Control
+    "CTRL_RSV0", "CTRL_RSV1", "CTRL_RSV2",   "CTRL_RSV3",
+    "CTRL_RSV4", "CTRL_RSV5", "CTRL_RSV6",   "CTRL_WRAP",
+    "BAR",       "BA",        "PS_POLL",     "RTS",
+    "CTS",       "ACK",       "CF_END",      "CF_END_ACK",
+
+    // Data
+    "DATA",      "DATA_ACK",  "DATA_POLL",   "DATA_ACK_POLL",
+    "NULL",      "CF_ACK",    "CF_POLL",     "CF_ACK_POLL",
+    "QOS_DATA",  "QOS_ACK",   "QOS_POLL",    "QOS_ACK_POLL",
+    "QOS_NULL",  "DATA_RSV13","QOS_POLL_ND", "QOS_ACK_ND",
+
+    // Reserved type
+    "RSV_0",     "RSV_1",     "RSV_2",       "RSV_3",
+    "RSV_4",     "RSV_5",     "RSV_6",       "RSV_7",
+    "RSV_8",     "RSV_9",     "RSV_10",      "RSV_11",
+    "RSV_12",    "RSV_13",    "RSV_14",      "RSV_15",
+
+    // Invalid protocol version
+    "INVALID"
+};
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+const char* IFrameClass_Name( uint8_t frameClass )
+{
+    if ( frameClass >= FRAME_CLASS_COUNT )
+    {
+        return "?";
+    }
+    return frameClassNames[ frameClass ];
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
@@ -0,0 +1,38 @@
+/**
+ * @file    FrameClass.h
+ * @brief   Frame classification private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef FRAMECLASS_H
+#define FRAMECLASS_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IFrameClass.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // FRAMECLASS_H
@@ -0,0 +1,199 @@
+/**
+ * @file    IFrameClass.h
+ * @brief   Table driven 802.11 frame classification.
+ *
+ *          The first frame control byte (protocol, type, subtype) is
+ *          mapped to a frame class id through a 256 entry lookup
+ *          table. The class id is type * 16 + subtype and doubles as
+ *          counter slot, frames with an unknown protocol version all
+ *          map to FRAME_CLASS_INVALID.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IFRAMECLASS_H
+#define IFRAMECLASS_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Frame class id from frame type and subtype
+#define FRAME_CLASS( type, subtype )    ( ( ( type ) << 4 ) | ( subtype ) )
+
+// Frame class ids are valid as index into arrays of this size
+#define FRAME_CLASS_COUNT               ( 4 * 16 + 1 )
+
+// Type/subtype of a frame class
+#define FRAME_CLASS_TYPE( frameClass )     ( ( frameClass ) >> 4 )
+#define FRAME_CLASS_SUBTYPE( frameClass )  ( ( frameClass ) & 0x0F )
+
+// Protocol version bits of first frame control byte
+#define FRAME_CONTROL_PROTOCOL_MASK     0x03
+
+// Second frame control byte flags
+#define FRAME_FLAG_TO_DS            0x01
+#define FRAME_FLAG_FROM_DS          0x02
+#define FRAME_FLAG_MORE_FRAGMENTS   0x04
+#define FRAME_FLAG_RETRY            0x08
+#define FRAME_FLAG_POWER_MANAGEMENT 0x10
+#define FRAME_FLAG_MORE_DATA        0x20
+#define FRAME_FLAG_PROTECTED        0x40
+#define FRAME_FLAG_ORDER            0x80
+
+// Offsets into the MAC header
+#define FRAME_ADDR1_OFFSET          4
+#define FRAME_ADDR2_OFFSET          10
+#define FRAME_ADDR3_OFFSET          16
+#define FRAME_SEQ_CTRL_OFFSET       22
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef enum{
+    FRAME_TYPE_MANAGEMENT = 0x0,
+    FRAME_TYPE_CONTROL    = 0x1,
+    FRAME_TYPE_DATA       = 0x2,
+    FRAME_TYPE_RESERVED   = 0x3
+} tFrameType;
+
+typedef enum{
+    MANAGEMENT_TYPE_ASSOC_REQ         = FRAME_CLASS( FRAME_TYPE_MANAGEMENT, 0x0 ),
+    MANAGEMENT_TYPE_ASSOC_RSP         = FRAME_CLASS( FRAME_TYPE_MANAGEMENT, 0x1 ),
+    MANAGEMENT_TYPE_REASSOC_REQ       = FRAME_CLASS( FRAME_TYPE_MANAGEMENT, 0x2 ),
+    MANAGEMENT_TYPE_REASSOC_RSP       = FRAME_CLASS( FRAME_TYPE_MANAGEMENT, 0x3 ),
+    MANAGEMENT_TYPE_PROBE_REQ         = FRAME_CLASS( FRAME_TYPE_MANAGEMENT, 0x4 ),
+    MANAGEMENT_TYPE_PROBE_RSP         = FRAME_CLASS( FRAME_TYPE_MANAGEMENT, 0x5 ),
+    // 0110 - 0111 RESERVED
+    MANAGEMENT_TYPE_BEACON            = FRAME_CLASS( FRAME_TYPE_MANAGEMENT, 0x8 ),
+    MANAGEMENT_TYPE_ATIM              = FRAME_CLASS( FRAME_TYPE_MANAGEMENT, 0x9 ),
+    MANAGEMENT_TYPE_DISASSOC          = FRAME_CLASS( FRAME_TYPE_MANAGEMENT, 0xA ),
+    MANAGEMENT_TYPE_AUTHENTICATION    = FRAME_CLASS( FRAME_TYPE_MANAGEMENT, 0xB ),
+    MANAGEMENT_TYPE_DEAUTHENTICATION  = FRAME_CLASS( FRAME_TYPE_MANAGEMENT, 0xC ),
+    MANAGEMENT_TYPE_ACTION            = FRAME_CLASS( FRAME_TYPE_MANAGEMENT, 0xD )
+    // 1110 - 1111 RESERVED
+} tManagementSubType;
+
+typedef enum{
+    // 0000 - 0111 RESERVED
+    CONTROL_TYPE_BLOCK_ACK_REQ        = FRAME_CLASS( FRAME_TYPE_CONTROL, 0x8 ),
+    CONTROL_TYPE_BLOCK_ACK            = FRAME_CLASS( FRAME_TYPE_CONTROL, 0x9 ),
+    CONTROL_TYPE_PS_POLL              = FRAME_CLASS( FRAME_TYPE_CONTROL, 0xA ),
+    CONTROL_TYPE_RTS                  = FRAME_CLASS( FRAME_TYPE_CONTROL, 0xB ),
+    CONTROL_TYPE_CTS                  = FRAME_CLASS( FRAME_TYPE_CONTROL, 0xC ),
+    CONTROL_TYPE_ACK                  = FRAME_CLASS( FRAME_TYPE_CONTROL, 0xD ),
+    CONTROL_TYPE_CF_END               = FRAME_CLASS( FRAME_TYPE_CONTROL, 0xE ),
+    CONTROL_TYPE_CF_END_ACK           = FRAME_CLASS( FRAME_TYPE_CONTROL, 0xF )
+} tControlSubType;
+
+typedef enum{
+    DATA_TYPE_DATA                    = FRAME_CLASS( FRAME_TYPE_DATA, 0x0 ),
+    DATA_TYPE_DATA_CF_ACK             = FRAME_CLASS( FRAME_TYPE_DATA, 0x1 ),
+    DATA_TYPE_DATA_CF_POLL            = FRAME_CLASS( FRAME_TYPE_DATA, 0x2 ),
+    DATA_TYPE_DATA_CF_ACK_POLL        = FRAME_CLASS( FRAME_TYPE_DATA, 0x3 ),
+    DATA_TYPE_NULL                    = FRAME_CLASS( FRAME_TYPE_DATA, 0x4 ),
+    DATA_TYPE_CF_ACK                  = FRAME_CLASS( FRAME_TYPE_DATA, 0x5 ),
+    DATA_TYPE_CF_POLL                 = FRAME_CLASS( FRAME_TYPE_DATA, 0x6 ),
+    DATA_TYPE_CF_ACK_POLL             = FRAME_CLASS( FRAME_TYPE_DATA, 0x7 ),
+    DATA_TYPE_QOS_DATA                = FRAME_CLASS( FRAME_TYPE_DATA, 0x8 ),
+    DATA_TYPE_QOS_DATA_CF_ACK         = FRAME_CLASS( FRAME_TYPE_DATA, 0x9 ),
+    DATA_TYPE_QOS_DATA_CF_POLL        = FRAME_CLASS( FRAME_TYPE_DATA, 0xA ),
+    DATA_TYPE_QOS_DATA_CF_ACK_POLL    = FRAME_CLASS( FRAME_TYPE_DATA, 0xB ),
+    DATA_TYPE_QOS_NULL                = FRAME_CLASS( FRAME_TYPE_DATA, 0xC ),
+    DATA_TYPE_RESERVED                = FRAME_CLASS( FRAME_TYPE_DATA, 0xD ),
+    DATA_TYPE_QOS_CF_POLL_NODATA      = FRAME_CLASS( FRAME_TYPE_DATA, 0xE ),
+    DATA_TYPE_QOS_CF_ACK_NODATA       = FRAME_CLASS( FRAME_TYPE_DATA, 0xF )
+} tDataSubType;
+
+typedef enum{
+    // Protocol version other than 0
+    FRAME_CLASS_INVALID               = FRAME_CLASS_COUNT - 1
+} tFrameClassSpecial;
+
+// Lookup table keyed on first frame control byte, generated at
+// compile time by the constexpr constructor
+typedef struct FrameClassTable
+{
+    uint8_t classes[ 256 ];
+
+    constexpr FrameClassTable() : classes()
+    {
+        for ( unsigned int frameControl0 = 0; frameControl0 < 256; ++frameControl0 )
+        {
+            if ( ( frameControl0 & FRAME_CONTROL_PROTOCOL_MASK ) != 0 )
+            {
+                classes[ frameControl0 ] = FRAME_CLASS_INVALID;
+            }
+            else
+            {
+                classes[ frameControl0 ] = FRAME_CLASS( ( frameControl0 & 0x0C ) >> 2, ( frameControl0 & 0xF0 ) >> 4 );
+            }
+        }
+    }
+} tFrameClassTable;
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+// Lookup table, use IFrameClass_Get() instead of indexing directly
+extern const tFrameClassTable frameClassTable;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Get frame class of a frame. Single table load, safe to call from
+ * the RX callback.
+ *
+ * @param  frameControl0 First frame control byte
+ * @return Frame class id, always < FRAME_CLASS_COUNT.
+ */
+static inline uint8_t IFrameClass_Get( uint8_t frameControl0 )
+{
+    return frameClassTable.classes[ frameControl0 ];
+}
+
+/**
+ * Check if frames of a class carry a transmitter address (addr2).
+ * CTS and ACK only have a receiver address.
+ *
+ * @param  frameClass Frame class id
+ * @return TRUE if addr2 is present.
+ */
+static inline bool IFrameClass_HasTransmitter( uint8_t frameClass )
+{
+    return frameClass < FRAME_CLASS( FRAME_TYPE_RESERVED, 0 )
+        && frameClass != CONTROL_TYPE_CTS
+        && frameClass != CONTROL_TYPE_ACK
+        && frameClass != FRAME_CLASS( FRAME_TYPE_CONTROL, 0x7 );    // Control wrapper
+}
+
+/**
+ * Get printable name of a frame class.
+ *
+ * @param  frameClass Frame class id
+ * @return Short name, "?" if frameClass is out of range.
+ */
+const char* IFrameClass_Name( uint8_t frameClass );
+
+#endif // IFRAMECLASS_H
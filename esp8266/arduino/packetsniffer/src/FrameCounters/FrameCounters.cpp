@@ -0,0 +1,205 @@
+/**
+ * @file    FrameCounters.cpp
+ * @brief   Double buffered per type/subtype frame counters.
+ *
+ *          The RX callback announces itself through writerBusy
+ *          before it looks up the active bank. loop() flips the
+ *          active bank and then waits for writerBusy to clear, so
+ *          once IFrameCounters_Swap() reads the retired bank no
+ *          increment can still be in flight against it. On the
+ *          ESP8266 the callback never preempts loop() and the wait
+ *          falls straight through.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include "FrameCounters.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    tFrameCounterBank   banks[ FRAME_COUNTER_BANKS ];
+    tFrameCounterTotals totals;
+    uint32_t            activeBank;
+    uint32_t            writerBusy;
+} tFrameCountersVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static tFrameCounterBank* beginWrite( void );
+static void endWrite( void );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tFrameCountersVars frameCountersVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IFrameCounters_Init( void )
+{
+    memset( &frameCountersVars, 0, sizeof( frameCountersVars ) );
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IFrameCounters_Count( uint8_t frameClass, uint8_t frameControl1, uint16_t mpdus )
+{
+    tFrameCounterBank* pBank = beginWrite();
+
+    ++pBank->packets;
+    pBank->mpdus                 += mpdus;
+    pBank->aggregates            += mpdus > 1;
+    pBank->classes[ frameClass ] += mpdus;
+    pBank->retry           += ( frameControl1 & FRAME_FLAG_RETRY ) != 0;
+    pBank->protectedFrames += ( frameControl1 & FRAME_FLAG_PROTECTED ) != 0;
+    pBank->moreFragments   += ( frameControl1 & FRAME_FLAG_MORE_FRAGMENTS ) != 0;
+
+    endWrite();
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IFrameCounters_CountNoHeader( uint16_t mpdus )
+{
+    tFrameCounterBank* pBank = beginWrite();
+
+    ++pBank->packets;
+    ++pBank->noHeader;
+    pBank->mpdus      += mpdus;
+    pBank->aggregates += mpdus > 1;
+
+    endWrite();
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IFrameCounters_CountDuplicate( void )
+{
+    tFrameCounterBank* pBank = beginWrite();
+
+    ++pBank->duplicates;
+
+    endWrite();
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+const tFrameCounterBank* IFrameCounters_Swap( void )
+{
+    uint32_t retired = frameCountersVars.activeBank;
+    uint32_t next    = retired ^ 1;
+
+    // Next bank still holds the interval returned by the previous call
+    memset( &frameCountersVars.banks[ next ], 0, sizeof( tFrameCounterBank ) );
+
+    __atomic_store_n( &frameCountersVars.activeBank, next, __ATOMIC_SEQ_CST );
+    while ( __atomic_load_n( &frameCountersVars.writerBusy, __ATOMIC_SEQ_CST ) != 0 )
+    {
+        // Callback still counting into retired bank
+    }
+
+    const tFrameCounterBank* pBank   = &frameCountersVars.banks[ retired ];
+    tFrameCounterTotals*     pTotals = &frameCountersVars.totals;
+
+    pTotals->packets         += pBank->packets;
+    pTotals->noHeader        += pBank->noHeader;
+    pTotals->mpdus           += pBank->mpdus;
+    pTotals->aggregates      += pBank->aggregates;
+    pTotals->retry           += pBank->retry;
+    pTotals->duplicates      += pBank->duplicates;
+    pTotals->protectedFrames += pBank->protectedFrames;
+    pTotals->moreFragments   += pBank->moreFragments;
+    for ( uint8_t i = 0; i < FRAME_CLASS_COUNT; ++i )
+    {
+        pTotals->classes[ i ] += pBank->classes[ i ];
+    }
+
+    return pBank;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+const tFrameCounterTotals* IFrameCounters_GetTotals( void )
+{
+    return &frameCountersVars.totals;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static tFrameCounterBank* beginWrite( void )
+{
+    __atomic_store_n( &frameCountersVars.writerBusy, 1, __ATOMIC_SEQ_CST );
+    uint32_t active = __atomic_load_n( &frameCountersVars.activeBank, __ATOMIC_SEQ_CST );
+    return &frameCountersVars.banks[ active ];
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void endWrite( void )
+{
+    __atomic_store_n( &frameCountersVars.writerBusy, 0, __ATOMIC_RELEASE );
+}
@@ -0,0 +1,40 @@
+/**
+ * @file    FrameCounters.h
+ * @brief   Frame counters private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef FRAMECOUNTERS_H
+#define FRAMECOUNTERS_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IFrameCounters.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#define FRAME_COUNTER_BANKS   2
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // FRAMECOUNTERS_H
@@ -0,0 +1,118 @@
+/**
+ * @file    IFrameCounters.h
+ * @brief   Per type/subtype frame counters, double buffered so loop()
+ *          can take consistent interval snapshots while the RX
+ *          callback keeps counting.
+ *
+ *          One callback can carry an A-MPDU. Frame classes count every
+ *          MPDU in it under the class of the first one, the only
+ *          header delivered; flags are only known for that one.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IFRAMECOUNTERS_H
+#define IFRAMECOUNTERS_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+
+#include <FrameClass/IFrameClass.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+// Counters for one interval, written by the RX callback
+typedef struct
+{
+    uint32_t packets;                       // All callbacks
+    uint32_t noHeader;                      // Callbacks without frame bytes
+    uint32_t mpdus;                         // Frames in all callbacks, A-MPDUs expanded
+    uint32_t aggregates;                    // Callbacks carrying an A-MPDU
+    uint32_t classes[ FRAME_CLASS_COUNT ];  // MPDUs by frame class
+    uint32_t retry;
+    uint32_t duplicates;                    // Retries of a frame already heard
+    uint32_t protectedFrames;
+    uint32_t moreFragments;
+} tFrameCounterBank;
+
+// Running totals since IFrameCounters_Init()
+typedef struct
+{
+    uint64_t packets;
+    uint64_t noHeader;
+    uint64_t mpdus;
+    uint64_t aggregates;
+    uint64_t classes[ FRAME_CLASS_COUNT ];
+    uint64_t retry;
+    uint64_t duplicates;
+    uint64_t protectedFrames;
+    uint64_t moreFragments;
+} tFrameCounterTotals;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Clear both banks and all totals.
+ * Must be called before the RX callback is registered.
+ */
+void IFrameCounters_Init( void );
+
+/**
+ * Count a received frame. Only to be called from the RX callback.
+ *
+ * @param  frameClass    Frame class from IFrameClass_Get()
+ * @param  frameControl1 Second frame control byte (flags)
+ * @param  mpdus         Frames the callback carried, see tSnifferFrame
+ */
+void IFrameCounters_Count( uint8_t frameClass, uint8_t frameControl1, uint16_t mpdus );
+
+/**
+ * Count a callback that carried no frame bytes. Only to be called
+ * from the RX callback.
+ *
+ * @param  mpdus Frames the callback carried, see tSnifferFrame
+ */
+void IFrameCounters_CountNoHeader( uint16_t mpdus );
+
+/**
+ * Count a retransmission of a frame already heard, in addition to
+ * IFrameCounters_Count(). Only to be called from the RX callback.
+ */
+void IFrameCounters_CountDuplicate( void );
+
+/**
+ * Retire the bank the RX callback has been counting into since the
+ * previous call, add it to the totals and make the other bank active.
+ * Only to be called from loop().
+ *
+ * @return Counters for the interval just ended, valid until next call.
+ */
+const tFrameCounterBank* IFrameCounters_Swap( void );
+
+/**
+ * Get running totals, updated by IFrameCounters_Swap().
+ *
+ * @return Totals
+ */
+const tFrameCounterTotals* IFrameCounters_GetTotals( void );
+
+#endif // IFRAMECOUNTERS_H
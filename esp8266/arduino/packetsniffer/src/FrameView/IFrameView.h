@@ -0,0 +1,390 @@
+/**
+ * @file    IFrameView.h
+ * @brief   Zero-copy view of an 802.11 frame: MAC header fields and
+ *          the information elements of management frame bodies.
+ *
+ *          Nothing is copied, the view points into the captured bytes
+ *          and every accessor checks against the captured length, so
+ *          truncated frames (the SDK only hands over the start of most
+ *          frames) are safe to look at. Fields that aren't there, or
+ *          weren't captured, are reported as missing.
+ *
+ *          Header only, cheap enough for the RX callback and builds on
+ *          the host as is.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IFRAMEVIEW_H
+#define IFRAMEVIEW_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <FrameClass/IFrameClass.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// MAC header layout beyond the first three addresses
+#define FRAME_SEQ_CTRL_OFFSET       22
+#define FRAME_ADDR4_OFFSET          24
+#define FRAME_MAC_ADDR_LEN          6
+#define FRAME_SHORT_HEADER_LEN      10      // CTS, ACK
+#define FRAME_CONTROL_HEADER_LEN    16      // RTS, PS-Poll, BAR, BA, CF-End
+#define FRAME_HEADER_LEN            24      // Management, data
+#define FRAME_QOS_CTRL_LEN          2
+#define FRAME_HT_CTRL_LEN           4
+
+// Sequence control fields
+#define FRAME_SEQ_NUMBER( seqCtrl )     ( ( seqCtrl ) >> 4 )
+#define FRAME_FRAGMENT( seqCtrl )       ( ( seqCtrl ) & 0x0F )
+
+// QoS control fields
+#define FRAME_QOS_TID( qosCtrl )        ( ( qosCtrl ) & 0x0F )
+#define FRAME_QOS_AMSDU                 0x0080
+
+// Data subtypes with this bit carry QoS control
+#define FRAME_DATA_SUBTYPE_QOS          0x08
+
+// Information element ids
+#define FRAME_IE_SSID               0
+#define FRAME_IE_SUPPORTED_RATES    1
+#define FRAME_IE_DS_PARAMS          3
+#define FRAME_IE_TIM                5
+#define FRAME_IE_COUNTRY            7
+#define FRAME_IE_HT_CAPABILITIES    45
+#define FRAME_IE_RSN                48
+#define FRAME_IE_EXT_RATES          50
+#define FRAME_IE_HT_OPERATION       61
+#define FRAME_IE_EXT_CAPABILITIES   127
+#define FRAME_IE_VENDOR             221
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    const uint8_t* pFrame;
+    uint16_t       captured;        // Valid bytes at pFrame
+    uint8_t        frameClass;
+    uint8_t        flags;           // Second frame control byte
+    uint8_t        headerLength;    // MAC header length, may exceed captured
+} tFrameView;
+
+typedef struct
+{
+    uint8_t        id;
+    uint8_t        length;          // Length the element claims
+    uint8_t        available;       // Bytes of it captured, <= length
+    const uint8_t* pData;
+} tFrameIe;
+
+typedef struct
+{
+    const uint8_t* pFrame;
+    uint32_t       offset;          // Next element, > captured once truncated
+    uint32_t       captured;
+} tFrameIeIterator;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Get MAC header length of a frame. Management and data frames with
+ * the order flag set carry HT control.
+ *
+ * @param  frameClass Frame class id
+ * @param  flags      Second frame control byte
+ * @return Header length in bytes, 0 for FRAME_CLASS_INVALID.
+ */
+static inline uint8_t IFrameView_HeaderLength( uint8_t frameClass, uint8_t flags )
+{
+    uint8_t length;
+    switch ( FRAME_CLASS_TYPE( frameClass ) )
+    {
+        case FRAME_TYPE_MANAGEMENT:
+            return FRAME_HEADER_LEN + ( ( flags & FRAME_FLAG_ORDER ) ? FRAME_HT_CTRL_LEN : 0 );
+
+        case FRAME_TYPE_CONTROL:
+            if ( frameClass == CONTROL_TYPE_CTS || frameClass == CONTROL_TYPE_ACK )
+            {
+                return FRAME_SHORT_HEADER_LEN;
+            }
+            if ( frameClass >= CONTROL_TYPE_BLOCK_ACK_REQ || frameClass == FRAME_CLASS( FRAME_TYPE_CONTROL, 0x7 ) )
+            {
+                // Control wrapper: addr1, carried frame control and HT
+                // control, same length
+                return FRAME_CONTROL_HEADER_LEN;
+            }
+            return FRAME_SHORT_HEADER_LEN;
+
+        case FRAME_TYPE_DATA:
+            length = FRAME_HEADER_LEN;
+            if ( ( flags & ( FRAME_FLAG_TO_DS | FRAME_FLAG_FROM_DS ) ) == ( FRAME_FLAG_TO_DS | FRAME_FLAG_FROM_DS ) )
+            {
+                length += FRAME_MAC_ADDR_LEN;
+            }
+            if ( FRAME_CLASS_SUBTYPE( frameClass ) & FRAME_DATA_SUBTYPE_QOS )
+            {
+                length += FRAME_QOS_CTRL_LEN;
+                if ( flags & FRAME_FLAG_ORDER )
+                {
+                    length += FRAME_HT_CTRL_LEN;
+                }
+            }
+            return length;
+
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Set up a view of a frame.
+ *
+ * @param  pView    Output
+ * @param  pFrame   Frame bytes, must outlive the view
+ * @param  captured Number of bytes at pFrame
+ * @return FALSE if not even frame control was captured or the
+ *         protocol version is unknown.
+ */
+static inline bool IFrameView_Init( tFrameView* pView, const uint8_t* pFrame, uint16_t captured )
+{
+    if ( captured < 2 )
+    {
+        return false;
+    }
+    pView->pFrame       = pFrame;
+    pView->captured     = captured;
+    pView->frameClass   = IFrameClass_Get( pFrame[ 0 ] );
+    pView->flags        = pFrame[ 1 ];
+    pView->headerLength = IFrameView_HeaderLength( pView->frameClass, pView->flags );
+    return pView->frameClass != FRAME_CLASS_INVALID;
+}
+
+/**
+ * Get an address field.
+ *
+ * @param  pView View
+ * @param  index Address number, 1-4
+ * @return Pointer to the 6 address bytes, NULL if the frame has no
+ *         such address or it wasn't captured.
+ */
+static inline const uint8_t* IFrameView_Address( const tFrameView* pView, uint8_t index )
+{
+    uint8_t  type = FRAME_CLASS_TYPE( pView->frameClass );
+    uint16_t offset;
+    switch ( index )
+    {
+        case 1:
+            offset = FRAME_ADDR1_OFFSET;
+            break;
+        case 2:
+            if ( !IFrameClass_HasTransmitter( pView->frameClass ) )
+            {
+                return NULL;
+            }
+            offset = FRAME_ADDR2_OFFSET;
+            break;
+        case 3:
+            if ( type != FRAME_TYPE_MANAGEMENT && type != FRAME_TYPE_DATA )
+            {
+                return NULL;
+            }
+            offset = FRAME_ADDR3_OFFSET;
+            break;
+        case 4:
+            if ( type != FRAME_TYPE_DATA || ( pView->flags & ( FRAME_FLAG_TO_DS | FRAME_FLAG_FROM_DS ) ) != ( FRAME_FLAG_TO_DS | FRAME_FLAG_FROM_DS ) )
+            {
+                return NULL;
+            }
+            offset = FRAME_ADDR4_OFFSET;
+            break;
+        default:
+            return NULL;
+    }
+    if ( offset + FRAME_MAC_ADDR_LEN > pView->captured )
+    {
+        return NULL;
+    }
+    return &pView->pFrame[ offset ];
+}
+
+/**
+ * Get sequence control, management and data frames only.
+ *
+ * @param  pView   View
+ * @param  pValue  Output, see FRAME_SEQ_NUMBER() and FRAME_FRAGMENT()
+ * @return FALSE if the frame has none or it wasn't captured.
+ */
+static inline bool IFrameView_SequenceControl( const tFrameView* pView, uint16_t* pValue )
+{
+    uint8_t type = FRAME_CLASS_TYPE( pView->frameClass );
+    if ( ( type != FRAME_TYPE_MANAGEMENT && type != FRAME_TYPE_DATA ) || pView->captured < FRAME_SEQ_CTRL_OFFSET + 2 )
+    {
+        return false;
+    }
+    *pValue = (uint16_t)( pView->pFrame[ FRAME_SEQ_CTRL_OFFSET ] | ( pView->pFrame[ FRAME_SEQ_CTRL_OFFSET + 1 ] << 8 ) );
+    return true;
+}
+
+/**
+ * Get QoS control, QoS data frames only.
+ *
+ * @param  pView   View
+ * @param  pValue  Output, see FRAME_QOS_TID()
+ * @return FALSE if the frame has none or it wasn't captured.
+ */
+static inline bool IFrameView_QosControl( const tFrameView* pView, uint16_t* pValue )
+{
+    if ( FRAME_CLASS_TYPE( pView->frameClass ) != FRAME_TYPE_DATA || ( FRAME_CLASS_SUBTYPE( pView->frameClass ) & FRAME_DATA_SUBTYPE_QOS ) == 0 )
+    {
+        return false;
+    }
+    uint16_t offset = FRAME_HEADER_LEN;
+    if ( ( pView->flags & ( FRAME_FLAG_TO_DS | FRAME_FLAG_FROM_DS ) ) == ( FRAME_FLAG_TO_DS | FRAME_FLAG_FROM_DS ) )
+    {
+        offset += FRAME_MAC_ADDR_LEN;
+    }
+    if ( offset + FRAME_QOS_CTRL_LEN > pView->captured )
+    {
+        return false;
+    }
+    *pValue = (uint16_t)( pView->pFrame[ offset ] | ( pView->pFrame[ offset + 1 ] << 8 ) );
+    return true;
+}
+
+/**
+ * Get the captured part of the frame body.
+ *
+ * @param  pView     View
+ * @param  ppBody    Output, start of body
+ * @param  pCaptured Output, body bytes captured (0 if only the header was)
+ * @return FALSE if the MAC header wasn't captured in full.
+ */
+static inline bool IFrameView_Body( const tFrameView* pView, const uint8_t** ppBody, uint16_t* pCaptured )
+{
+    if ( pView->headerLength == 0 || pView->headerLength > pView->captured )
+    {
+        return false;
+    }
+    *ppBody    = &pView->pFrame[ pView->headerLength ];
+    *pCaptured = pView->captured - pView->headerLength;
+    return true;
+}
+
+/**
+ * Start walking the information elements of a management frame body,
+ * past the fixed fields of its subtype.
+ *
+ * @param  pView View
+ * @param  pIter Output
+ * @return FALSE if the frame doesn't carry elements (or they are
+ *         encrypted).
+ */
+static inline bool IFrameView_Ies( const tFrameView* pView, tFrameIeIterator* pIter )
+{
+    uint8_t fixed;
+    switch ( pView->frameClass )
+    {
+        case MANAGEMENT_TYPE_PROBE_REQ:      fixed = 0;  break;
+        case MANAGEMENT_TYPE_ASSOC_REQ:      fixed = 4;  break;     // Capabilities, listen interval
+        case MANAGEMENT_TYPE_ASSOC_RSP:
+        case MANAGEMENT_TYPE_REASSOC_RSP:    fixed = 6;  break;     // Capabilities, status, AID
+        case MANAGEMENT_TYPE_REASSOC_REQ:    fixed = 10; break;     // As assoc, current AP
+        case MANAGEMENT_TYPE_PROBE_RSP:
+        case MANAGEMENT_TYPE_BEACON:         fixed = 12; break;     // Timestamp, interval, capabilities
+        case MANAGEMENT_TYPE_AUTHENTICATION: fixed = 6;  break;     // Algorithm, sequence, status
+        default:                             return false;
+    }
+    if ( pView->flags & FRAME_FLAG_PROTECTED )
+    {
+        return false;
+    }
+
+    pIter->pFrame   = pView->pFrame;
+    pIter->offset   = pView->headerLength + fixed;
+    pIter->captured = pView->captured;
+    return true;
+}
+
+/**
+ * Get next information element. An element running past the captured
+ * bytes is returned with available < length and ends the walk.
+ *
+ * @param  pIter Iterator from IFrameView_Ies()
+ * @param  pIe   Output
+ * @return FALSE when no more elements were captured.
+ */
+static inline bool IFrameView_NextIe( tFrameIeIterator* pIter, tFrameIe* pIe )
+{
+    if ( pIter->offset >= pIter->captured || pIter->captured - pIter->offset < 2 )
+    {
+        return false;
+    }
+
+    const uint8_t* pElement  = &pIter->pFrame[ pIter->offset ];
+    uint32_t       remaining = pIter->captured - pIter->offset - 2;
+    pIe->id        = pElement[ 0 ];
+    pIe->length    = pElement[ 1 ];
+    pIe->available = pIe->length <= remaining ? pIe->length : (uint8_t)remaining;
+    pIe->pData     = &pElement[ 2 ];
+    pIter->offset += 2 + pIe->length;
+    return true;
+}
+
+/**
+ * Check if an element walk ended exactly at the end of the captured
+ * bytes, i.e. no element was cut short.
+ *
+ * @param  pIter Iterator that IFrameView_NextIe() returned FALSE for
+ * @return TRUE if all elements were complete.
+ */
+static inline bool IFrameView_IesComplete( const tFrameIeIterator* pIter )
+{
+    return pIter->offset == pIter->captured;
+}
+
+/**
+ * Find the first information element with a given id.
+ *
+ * @param  pView View
+ * @param  id    Element id, FRAME_IE_...
+ * @param  pIe   Output
+ * @return FALSE if not found among the captured elements.
+ */
+static inline bool IFrameView_FindIe( const tFrameView* pView, uint8_t id, tFrameIe* pIe )
+{
+    tFrameIeIterator iter;
+    if ( !IFrameView_Ies( pView, &iter ) )
+    {
+        return false;
+    }
+    while ( IFrameView_NextIe( &iter, pIe ) )
+    {
+        if ( pIe->id == id )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // IFRAMEVIEW_H
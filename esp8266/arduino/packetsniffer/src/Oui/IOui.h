@@ -0,0 +1,93 @@
+/**
+ * @file    IOui.h
+ * @brief   Vendor names of MAC addresses, from a table in flash.
+ *
+ *          The table is generated at build time from the IEEE OUI
+ *          list (tools/ouitable.py, run by tools/pio_ouitable.py): a
+ *          minimal perfect hash over the 24-bit prefixes, an entry per
+ *          prefix holding the prefix and where its vendor's name is,
+ *          and the names, each stored once. A lookup reads one
+ *          displacement, one entry and the name from flash. Without
+ *          the list the table is empty and every lookup fails.
+ *
+ *          Prefixes looked up recently are cached in RAM, found or
+ *          not, so the busiest transmitters of a report skip the hash.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IOUI_H
+#define IOUI_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Prefixes cached, must be a power of two, 0 to always hash (8 bytes
+// each)
+#ifndef OUI_CACHE_SLOTS
+#define OUI_CACHE_SLOTS             16
+#endif
+
+// Buffer for a name, longer ones are cut when the table is generated
+#define OUI_NAME_SIZE               32
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint32_t entries;       // Prefixes in the table
+    uint32_t names;         // Distinct vendor names
+    uint32_t flashBytes;    // Displacements, entries and names
+    uint32_t lookups;       // Running totals since IOui_Init()
+    uint32_t cacheHits;
+    uint32_t found;
+} tOuiStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Empty the cache and reset statistics.
+ */
+void IOui_Init( void );
+
+/**
+ * Look up the vendor of a MAC address. Locally administered and group
+ * addresses have none. Call from loop() only, the cache isn't shared
+ * with the RX callback.
+ *
+ * @param  pMac  MAC address
+ * @param  pName Output, terminated vendor name
+ * @param  size  Size of pName, OUI_NAME_SIZE fits any name
+ * @return FALSE if the prefix isn't in the table (pName is empty).
+ */
+bool IOui_Lookup( const uint8_t* pMac, char* pName, size_t size );
+
+/**
+ * Get table footprint and lookup statistics.
+ *
+ * @param  pStats Output
+ */
+void IOui_GetStats( tOuiStats* pStats );
+
+#endif // IOUI_H
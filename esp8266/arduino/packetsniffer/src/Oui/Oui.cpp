@@ -0,0 +1,209 @@
+/**
+ * @file    Oui.cpp
+ * @brief   Vendor names of MAC addresses, from a table in flash.
+ *
+ *          Flash is read through pgm_read_...(): the ESP8266 only maps
+ *          it for aligned 32-bit loads.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include "Oui.h"
+
+// Generated into the build directory by tools/pio_ouitable.py; built
+// any other way the table is empty
+#if __has_include( <OuiData.h> )
+#include <OuiData.h>
+#else
+#define OUI_ENTRIES                 0
+#define OUI_BUCKETS                 1
+#define OUI_NAMES                   0
+#define OUI_NAME_MAX                0
+#define OUI_POOL_SIZE               1
+#define OUI_SALT                    0u
+static const uint16_t  ouiDisplacements[ OUI_BUCKETS ] PROGMEM = { 0 };
+static const tOuiEntry ouiEntries[ 1 ] PROGMEM                 = { { 0, 0 } };
+static const char      ouiNames[ OUI_POOL_SIZE ] PROGMEM       = "";
+#endif
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#if OUI_NAME_MAX >= OUI_NAME_SIZE
+#error "OUI_NAME_SIZE can't hold the names in the table, generate it with a lower --name-max"
+#endif
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+#if OUI_CACHE_SLOTS > 0
+    tOuiCacheSlot cache[ OUI_CACHE_SLOTS ];
+#endif
+    uint32_t      lookups;
+    uint32_t      cacheHits;
+    uint32_t      found;
+} tOuiVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static uint32_t findEntry( uint32_t oui );
+static inline uint32_t mix( uint32_t x );
+static inline uint32_t reduce( uint32_t hash, uint32_t range );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tOuiVars ouiVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IOui_Init( void )
+{
+    memset( &ouiVars, 0, sizeof( ouiVars ) );
+#if OUI_CACHE_SLOTS > 0
+    for ( uint32_t i = 0; i < OUI_CACHE_SLOTS; ++i )
+    {
+        ouiVars.cache[ i ].oui = OUI_CACHE_EMPTY;
+    }
+#endif
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool IOui_Lookup( const uint8_t* pMac, char* pName, size_t size )
+{
+    pName[ 0 ] = '\0';
+    ++ouiVars.lookups;
+    if ( OUI_ENTRIES == 0 || ( pMac[ 0 ] & OUI_LOCAL_GROUP_BITS ) )
+    {
+        return false;
+    }
+
+    uint32_t oui = ( (uint32_t)pMac[ 0 ] << 16 ) | ( (uint32_t)pMac[ 1 ] << 8 ) | pMac[ 2 ];
+    uint32_t entry;
+#if OUI_CACHE_SLOTS > 0
+    tOuiCacheSlot* pSlot = &ouiVars.cache[ mix( oui ) & OUI_CACHE_MASK ];
+    if ( pSlot->oui == oui )
+    {
+        entry = pSlot->entry;
+        ++ouiVars.cacheHits;
+    }
+    else
+    {
+        entry        = findEntry( oui );
+        pSlot->oui   = oui;
+        pSlot->entry = entry;
+    }
+#else
+    entry = findEntry( oui );
+#endif
+    if ( entry == OUI_NOT_FOUND )
+    {
+        return false;
+    }
+
+    strncpy_P( pName, &ouiNames[ pgm_read_dword( &ouiEntries[ entry ].name ) ], size - 1 );
+    pName[ size - 1 ] = '\0';
+    ++ouiVars.found;
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IOui_GetStats( tOuiStats* pStats )
+{
+    pStats->entries    = OUI_ENTRIES;
+    pStats->names      = OUI_NAMES;
+    pStats->flashBytes = OUI_ENTRIES == 0 ? 0 : sizeof( ouiDisplacements ) + sizeof( ouiEntries ) + sizeof( ouiNames );
+    pStats->lookups    = ouiVars.lookups;
+    pStats->cacheHits  = ouiVars.cacheHits;
+    pStats->found      = ouiVars.found;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint32_t findEntry( uint32_t oui )
+{
+    // Bucket from the hash, slot from the hash and the bucket's
+    // displacement; every prefix in the table has a slot of its own
+    uint32_t hash         = mix( oui ^ OUI_SALT );
+    uint32_t displacement = pgm_read_word( &ouiDisplacements[ reduce( hash, OUI_BUCKETS ) ] );
+    uint32_t entry        = reduce( mix( hash + displacement * OUI_DISPLACEMENT_STEP ), OUI_ENTRIES );
+
+    // Prefixes not in the table land in some slot too
+    return pgm_read_dword( &ouiEntries[ entry ].oui ) == oui ? entry : OUI_NOT_FOUND;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t mix( uint32_t x )
+{
+    // 32-bit finaliser, as mix() in tools/ouitable.py
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t reduce( uint32_t hash, uint32_t range )
+{
+    // Maps onto 0..range-1 with a multiply instead of a division
+    return (uint32_t)( ( (uint64_t)hash * range ) >> 32 );
+}
@@ -0,0 +1,71 @@
+/**
+ * @file    Oui.h
+ * @brief   OUI private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef OUI_H
+#define OUI_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include <pgmspace.h>
+
+#include "IOui.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#if ( OUI_CACHE_SLOTS & ( OUI_CACHE_SLOTS - 1 ) ) != 0
+#error "OUI_CACHE_SLOTS must be a power of two"
+#endif
+
+#define OUI_CACHE_MASK              ( OUI_CACHE_SLOTS - 1 )
+
+// Cache slot holding no prefix, and entry of a prefix not in the table
+#define OUI_CACHE_EMPTY             0xFFFFFFFFu
+#define OUI_NOT_FOUND               0xFFFFFFFFu
+
+// Locally administered and group bits of the first octet
+#define OUI_LOCAL_GROUP_BITS        0x03
+
+// Slot of a key is hashed again with its bucket's displacement times
+// this, as in tools/ouitable.py
+#define OUI_DISPLACEMENT_STEP       0x9E3779B9u
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+// Table entry, in flash. The prefix tells a key from one that merely
+// hashes to its slot.
+typedef struct
+{
+    uint32_t oui;
+    uint32_t name;          // Offset into ouiNames
+} tOuiEntry;
+
+typedef struct
+{
+    uint32_t oui;           // OUI_CACHE_EMPTY = free slot
+    uint32_t entry;         // Index into ouiEntries, or OUI_NOT_FOUND
+} tOuiCacheSlot;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // OUI_H
@@ -0,0 +1,161 @@
+/**
+ * @file    IProbeClusters.h
+ * @brief   Estimated number of devices behind the addresses sending
+ *          probe requests.
+ *
+ *          Phones probe from random, locally administered addresses
+ *          and change them every few scans, so counting addresses
+ *          counts the same phone many times over. What a device puts
+ *          in its probe requests changes far less: the elements it
+ *          sends and their order, its rates and HT capabilities. Each
+ *          probe request is reduced to a hash of those (the
+ *          fingerprint), the SSID and channel left out, and addresses
+ *          are grouped by fingerprint.
+ *
+ *          Within a group every device is tracked by the address it
+ *          currently uses. Devices change addresses between scans, so
+ *          a new random address takes over the track of a device quiet
+ *          for PROBE_CLUSTER_SCAN_MS or more, and for at least half of
+ *          the interval it has been scanning at: the one whose sequence
+ *          numbers it continues (at most PROBE_CLUSTER_SEQ_GAP ahead,
+ *          many devices keep counting across address changes), or else
+ *          the one quiet the longest. With no device between scans it
+ *          is another device of the same kind. Globally administered
+ *          addresses are devices of their own. A device not heard for
+ *          PROBE_CLUSTER_MAX_AGE_MS is gone.
+ *
+ *          Two devices of the same model taking turns to scan look like
+ *          one, so the estimate is a lower bound for identical devices
+ *          and much closer than the address count for the rest. Memory
+ *          is fixed: PROBE_CLUSTER_SLOTS fingerprints sharing
+ *          PROBE_CLUSTER_DEVICES devices.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IPROBECLUSTERS_H
+#define IPROBECLUSTERS_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Number of fingerprints tracked, must be a power of two (16 bytes
+// each)
+#ifndef PROBE_CLUSTER_SLOTS
+#define PROBE_CLUSTER_SLOTS         32
+#endif
+
+// Longest probe sequence, bounds the cost of a probe request
+#ifndef PROBE_CLUSTER_PROBE_LIMIT
+#define PROBE_CLUSTER_PROBE_LIMIT   4
+#endif
+
+// Devices tracked, shared by all fingerprints (24 bytes each). When
+// all are in use the least recently heard is replaced.
+#ifndef PROBE_CLUSTER_DEVICES
+#define PROBE_CLUSTER_DEVICES       128
+#endif
+
+// Elements after the SSID that make up the fingerprint. Probe requests
+// are cut at 112 bytes and a long SSID pushes the rest out, only the
+// first few are always there.
+#ifndef PROBE_CLUSTER_ELEMENTS
+#define PROBE_CLUSTER_ELEMENTS      4
+#endif
+
+// A device heard this recently is still scanning, a new address with
+// its fingerprint meanwhile is another device
+#ifndef PROBE_CLUSTER_SCAN_MS
+#define PROBE_CLUSTER_SCAN_MS       3000
+#endif
+
+// Sequence numbers this far ahead of a device's last continue it
+#ifndef PROBE_CLUSTER_SEQ_GAP
+#define PROBE_CLUSTER_SEQ_GAP       64
+#endif
+
+// A device not heard this long is gone
+#ifndef PROBE_CLUSTER_MAX_AGE_MS
+#define PROBE_CLUSTER_MAX_AGE_MS    300000
+#endif
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    // Devices heard within PROBE_CLUSTER_MAX_AGE_MS
+    uint32_t devices;       // Estimated devices
+    uint32_t randomised;    // Of those, with locally administered addresses
+    uint32_t addresses;     // Addresses they used since first heard, however
+                            // long ago, saturates per device
+    uint32_t localAddresses;
+    uint32_t fingerprints;  // Fingerprints they have
+
+    // Running totals since IProbeClusters_Init()
+    uint32_t probes;        // Probe requests counted
+    uint32_t partial;       // Skipped, fingerprint cut short by capture length
+    uint32_t malformed;     // Skipped, no transmitter or a group address
+    uint32_t linked;        // New addresses taken as a known device's
+    uint32_t bySequence;    // Of those, by sequence number
+    uint32_t undone;        // Taken back, the old address was heard again
+    uint32_t evicted;       // Active devices dropped, fingerprint full
+    uint32_t replaced;      // Active fingerprints dropped, index full
+} tProbeClustersStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Forget all devices and reset statistics.
+ */
+void IProbeClusters_Init( void );
+
+/**
+ * Count a probe request. Bounded cost.
+ *
+ * @param  pFrame   Frame, starting with the MAC header
+ * @param  captured Number of valid bytes in pFrame
+ * @param  length   On-air length of the frame, FCS included
+ * @param  nowMs    Current time
+ */
+void IProbeClusters_Count( const uint8_t* pFrame, uint16_t captured, uint16_t length, uint32_t nowMs );
+
+/**
+ * Compute the fingerprint of a probe request.
+ *
+ * @param  pFrame       Frame, starting with the MAC header
+ * @param  captured     Number of valid bytes in pFrame
+ * @param  length       On-air length of the frame, FCS included
+ * @param  pFingerprint Output
+ * @return FALSE if elements of the fingerprint weren't captured.
+ */
+bool IProbeClusters_Fingerprint( const uint8_t* pFrame, uint16_t captured, uint16_t length, uint32_t* pFingerprint );
+
+/**
+ * Get the estimate and running statistics. Walks all devices.
+ *
+ * @param  nowMs  Current time
+ * @param  pStats Output
+ */
+void IProbeClusters_GetStats( uint32_t nowMs, tProbeClustersStats* pStats );
+
+#endif // IPROBECLUSTERS_H
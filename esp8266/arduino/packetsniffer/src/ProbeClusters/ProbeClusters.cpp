@@ -0,0 +1,552 @@
+/**
+ * @file    ProbeClusters.cpp
+ * @brief   Estimated number of devices behind the addresses sending
+ *          probe requests.
+ *
+ *          Fingerprints index an open addressing table, probe sequences
+ *          of at most PROBE_CLUSTER_PROBE_LIMIT entries. Entries are
+ *          never emptied, the least recently heard is replaced when the
+ *          sequence is full, like the beacon detector's SSIDs. Each
+ *          fingerprint heads a list of its devices, taken from a common
+ *          pool, so a popular model can have many without every
+ *          fingerprint reserving room for them. A probe request costs
+ *          one fingerprint, one short probe sequence and a pass over
+ *          the devices of its fingerprint, which drops those gone on
+ *          the way. Only when the pool runs out is all of it walked.
+ *
+ *          Fed from loop() with probe requests taken off the capture
+ *          ring, nothing here runs in the RX callback.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include <FrameClass/IFrameClass.h>
+#include <FrameView/IFrameView.h>
+
+#include "ProbeClusters.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint8_t  mac[ 6 ];                  // Address in use
+    uint8_t  previous[ PROBE_CLUSTER_PREVIOUS_LEN ];    // End of the address before
+    uint16_t seq;                       // Last sequence number
+    uint16_t next;                      // Next device of the fingerprint, or free
+    uint32_t lastSeenMs;
+    uint16_t addresses;                 // Addresses used, saturates
+    uint16_t interval;                  // Between scans, PROBE_CLUSTER_INTERVAL_UNIT_MS, 0 = not known
+    uint8_t  flags;                     // PROBE_DEVICE_...
+} tProbeDevice;
+
+typedef struct
+{
+    uint32_t probes;                    // 0 = free slot
+    uint32_t fingerprint;
+    uint32_t lastSeenMs;
+    uint16_t first;                     // Device list
+    uint8_t  sequenceLinks;             // Addresses linked by sequence number, saturates
+    uint8_t  quietLinks;                // Linked for want of one, saturates
+} tProbeCluster;
+
+typedef struct
+{
+    tProbeCluster       clusters[ PROBE_CLUSTER_SLOTS ];
+    tProbeDevice        devices[ PROBE_CLUSTER_DEVICES ];
+    uint16_t            free;           // Free device list
+    tProbeClustersStats stats;          // Running totals only
+} tProbeClustersVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static tProbeCluster* findCluster( uint32_t fingerprint, uint32_t nowMs );
+static void countAddress( tProbeCluster* pCluster, const uint8_t* pMac, uint16_t seq, uint32_t nowMs );
+static uint16_t newDevice( uint32_t nowMs );
+static void freeDevices( uint16_t* pLink, uint32_t nowMs, bool all );
+static void hearDevice( tProbeDevice* pDevice, uint16_t seq, uint32_t nowMs );
+static inline bool isActive( const tProbeDevice* pDevice, uint32_t nowMs );
+static inline uint32_t hashBytes( uint32_t hash, const uint8_t* pData, uint8_t length );
+static inline uint32_t hashByte( uint32_t hash, uint8_t value );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tProbeClustersVars probeClustersVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IProbeClusters_Init( void )
+{
+    memset( &probeClustersVars, 0, sizeof( probeClustersVars ) );
+    for ( uint32_t i = 0; i < PROBE_CLUSTER_SLOTS; ++i )
+    {
+        probeClustersVars.clusters[ i ].first = PROBE_DEVICE_NONE;
+    }
+    for ( uint32_t i = 0; i < PROBE_CLUSTER_DEVICES; ++i )
+    {
+        probeClustersVars.devices[ i ].next = i + 1 < PROBE_CLUSTER_DEVICES ? (uint16_t)( i + 1 ) : PROBE_DEVICE_NONE;
+    }
+    probeClustersVars.free = 0;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IProbeClusters_Count( const uint8_t* pFrame, uint16_t captured, uint16_t length, uint32_t nowMs )
+{
+    tFrameView     view;
+    const uint8_t* pMac = NULL;
+    uint16_t       seqCtrl;
+
+    ++probeClustersVars.stats.probes;
+    if ( !IFrameView_Init( &view, pFrame, captured )
+      || ( pMac = IFrameView_Address( &view, 2 ) ) == NULL
+      || ( pMac[ 0 ] & PROBE_CLUSTER_GROUP_BIT )
+      || !IFrameView_SequenceControl( &view, &seqCtrl ) )
+    {
+        ++probeClustersVars.stats.malformed;
+        return;
+    }
+
+    uint32_t fingerprint;
+    if ( !IProbeClusters_Fingerprint( pFrame, captured, length, &fingerprint ) )
+    {
+        ++probeClustersVars.stats.partial;
+        return;
+    }
+
+    tProbeCluster* pCluster = findCluster( fingerprint, nowMs );
+    ++pCluster->probes;
+    pCluster->lastSeenMs = nowMs;
+    countAddress( pCluster, pMac, FRAME_SEQ_NUMBER( seqCtrl ), nowMs );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool IProbeClusters_Fingerprint( const uint8_t* pFrame, uint16_t captured, uint16_t length, uint32_t* pFingerprint )
+{
+    tFrameView       view;
+    tFrameIeIterator iter;
+    tFrameIe         ie;
+
+    if ( !IFrameView_Init( &view, pFrame, captured ) || view.frameClass != MANAGEMENT_TYPE_PROBE_REQ
+      || !IFrameView_Ies( &view, &iter ) )
+    {
+        return false;
+    }
+
+    // FNV-1a over the element ids in order and what the device says
+    // about itself. The SSID differs between probes of one device and
+    // DS parameters carry the channel scanned.
+    uint32_t hash     = 2166136261u;
+    uint8_t  elements = 0;
+    while ( elements < PROBE_CLUSTER_ELEMENTS && IFrameView_NextIe( &iter, &ie ) )
+    {
+        if ( ie.available < ie.length )
+        {
+            return false;
+        }
+        if ( ie.id == FRAME_IE_SSID || ie.id == FRAME_IE_DS_PARAMS )
+        {
+            continue;
+        }
+
+        ++elements;
+        hash = hashByte( hash, ie.id );
+        switch ( ie.id )
+        {
+            case FRAME_IE_SUPPORTED_RATES:
+            case FRAME_IE_EXT_RATES:
+            case FRAME_IE_EXT_CAPABILITIES:
+                hash = hashByte( hash, ie.length );
+                hash = hashBytes( hash, ie.pData, ie.length );
+                break;
+            case FRAME_IE_HT_CAPABILITIES:
+                hash = hashByte( hash, ie.length );
+                hash = hashBytes( hash, ie.pData, ie.length < PROBE_CLUSTER_HT_BYTES ? ie.length : PROBE_CLUSTER_HT_BYTES );
+                break;
+            case FRAME_IE_VENDOR:
+                // Contents (WPS device names, P2P) vary, who and what
+                // doesn't
+                hash = hashBytes( hash, ie.pData, ie.length < PROBE_CLUSTER_VENDOR_BYTES ? ie.length : PROBE_CLUSTER_VENDOR_BYTES );
+                break;
+            default:
+                hash = hashByte( hash, ie.length );
+                break;
+        }
+    }
+
+    // Fewer elements than wanted, and the frame goes on beyond what was
+    // captured: the rest of them weren't
+    if ( elements < PROBE_CLUSTER_ELEMENTS && (uint32_t)captured + PROBE_CLUSTER_FCS_LEN < length )
+    {
+        return false;
+    }
+
+    // Finaliser, FNV-1a leaves the last bytes in the low bits only
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+    hash *= 0x846CA68Bu;
+    hash ^= hash >> 16;
+    *pFingerprint = hash;
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IProbeClusters_GetStats( uint32_t nowMs, tProbeClustersStats* pStats )
+{
+    *pStats                = probeClustersVars.stats;
+    pStats->devices        = 0;
+    pStats->randomised     = 0;
+    pStats->addresses      = 0;
+    pStats->localAddresses = 0;
+    pStats->fingerprints   = 0;
+
+    for ( uint32_t i = 0; i < PROBE_CLUSTER_SLOTS; ++i )
+    {
+        bool active = false;
+        for ( uint16_t d = probeClustersVars.clusters[ i ].first; d != PROBE_DEVICE_NONE; d = probeClustersVars.devices[ d ].next )
+        {
+            const tProbeDevice* pDevice = &probeClustersVars.devices[ d ];
+            if ( !isActive( pDevice, nowMs ) )
+            {
+                continue;
+            }
+            active = true;
+            ++pStats->devices;
+            pStats->addresses += pDevice->addresses;
+            if ( pDevice->flags & PROBE_DEVICE_LOCAL )
+            {
+                ++pStats->randomised;
+                pStats->localAddresses += pDevice->addresses;
+            }
+        }
+        pStats->fingerprints += active;
+    }
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static tProbeCluster* findCluster( uint32_t fingerprint, uint32_t nowMs )
+{
+    uint32_t       index     = fingerprint & PROBE_CLUSTER_MASK;
+    tProbeCluster* pVictim   = NULL;
+    uint32_t       victimAge = 0;
+
+    for ( uint8_t probe = 0; probe < PROBE_CLUSTER_PROBE_LIMIT; ++probe, index = ( index + 1 ) & PROBE_CLUSTER_MASK )
+    {
+        tProbeCluster* pCluster = &probeClustersVars.clusters[ index ];
+
+        // Entries are never freed, so the first free one ends the
+        // sequence of fingerprints that hashed here
+        if ( pCluster->probes == 0 )
+        {
+            pVictim = pCluster;
+            break;
+        }
+        if ( pCluster->fingerprint == fingerprint )
+        {
+            return pCluster;
+        }
+
+        // Remember least recently heard in case the sequence is full
+        uint32_t age = nowMs - pCluster->lastSeenMs;
+        if ( pVictim == NULL || age > victimAge )
+        {
+            pVictim   = pCluster;
+            victimAge = age;
+        }
+    }
+
+    if ( pVictim->probes != 0 && victimAge <= PROBE_CLUSTER_MAX_AGE_MS )
+    {
+        ++probeClustersVars.stats.replaced;
+    }
+
+    // Devices of a replaced fingerprint are lost with it
+    freeDevices( &pVictim->first, nowMs, true );
+    memset( pVictim, 0, sizeof( *pVictim ) );
+    pVictim->fingerprint = fingerprint;
+    pVictim->first       = PROBE_DEVICE_NONE;
+    return pVictim;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void countAddress( tProbeCluster* pCluster, const uint8_t* pMac, uint16_t seq, uint32_t nowMs )
+{
+    bool          local    = ( pMac[ 0 ] & PROBE_CLUSTER_LOCAL_BIT ) != 0;
+    tProbeDevice* pNext    = NULL;      // Continues the sequence numbers
+    tProbeDevice* pQuiet   = NULL;      // Quiet the longest
+    tProbeDevice* pTaken   = NULL;      // Took this address over
+    uint32_t      quietAge = 0;
+    uint16_t      nextGap  = PROBE_CLUSTER_SEQ_GAP + 1;
+
+    // Devices gone are dropped on the way
+    freeDevices( &pCluster->first, nowMs, false );
+    for ( uint16_t d = pCluster->first; d != PROBE_DEVICE_NONE; d = probeClustersVars.devices[ d ].next )
+    {
+        tProbeDevice* pDevice = &probeClustersVars.devices[ d ];
+        if ( memcmp( pDevice->mac, pMac, sizeof( pDevice->mac ) ) == 0 )
+        {
+            hearDevice( pDevice, seq, nowMs );
+            return;
+        }
+        if ( ( pDevice->flags & PROBE_DEVICE_LINKED )
+          && memcmp( pDevice->previous, &pMac[ 6 - PROBE_CLUSTER_PREVIOUS_LEN ], PROBE_CLUSTER_PREVIOUS_LEN ) == 0 )
+        {
+            pTaken = pDevice;
+        }
+
+        // Only random addresses move on to new ones, and not in the
+        // middle of a scan or long before the next one is due
+        uint32_t age = nowMs - pDevice->lastSeenMs;
+        if ( !local || !( pDevice->flags & PROBE_DEVICE_LOCAL ) || age < PROBE_CLUSTER_SCAN_MS
+          || age < (uint32_t)pDevice->interval * PROBE_CLUSTER_INTERVAL_UNIT_MS / 2 )
+        {
+            continue;
+        }
+        uint16_t gap = ( seq - pDevice->seq ) & PROBE_CLUSTER_SEQ_MASK;
+        if ( gap != 0 && gap < nextGap )
+        {
+            pNext   = pDevice;
+            nextGap = gap;
+        }
+        if ( age > quietAge )
+        {
+            pQuiet   = pDevice;
+            quietAge = age;
+        }
+    }
+
+    // An address taken over by another is heard again: the device
+    // still has it, the other address is another device's
+    if ( pTaken != NULL )
+    {
+        ++probeClustersVars.stats.undone;
+        pTaken->addresses -= pTaken->addresses > 1;
+        pTaken->flags     &= (uint8_t)~PROBE_DEVICE_LINKED;
+    }
+    else
+    {
+        // A device that changed its address. Where devices continue
+        // their sequence numbers, a quiet one that didn't hasn't.
+        tProbeDevice* pDevice = pNext;
+        if ( pDevice == NULL && pCluster->sequenceLinks <= pCluster->quietLinks )
+        {
+            pDevice = pQuiet;
+        }
+        if ( pDevice != NULL )
+        {
+            ++probeClustersVars.stats.linked;
+            if ( pDevice == pNext )
+            {
+                ++probeClustersVars.stats.bySequence;
+                pCluster->sequenceLinks += pCluster->sequenceLinks < UINT8_MAX;
+            }
+            else
+            {
+                pCluster->quietLinks += pCluster->quietLinks < UINT8_MAX;
+            }
+            memcpy( pDevice->previous, &pDevice->mac[ 6 - PROBE_CLUSTER_PREVIOUS_LEN ], PROBE_CLUSTER_PREVIOUS_LEN );
+            memcpy( pDevice->mac, pMac, sizeof( pDevice->mac ) );
+            pDevice->addresses += pDevice->addresses < UINT16_MAX;
+            pDevice->flags     |= PROBE_DEVICE_LINKED;
+            hearDevice( pDevice, seq, nowMs );
+            return;
+        }
+    }
+
+    // Another device
+    uint16_t      index   = newDevice( nowMs );
+    tProbeDevice* pDevice = &probeClustersVars.devices[ index ];
+    memcpy( pDevice->mac, pMac, sizeof( pDevice->mac ) );
+    pDevice->seq        = seq;
+    pDevice->lastSeenMs = nowMs;
+    pDevice->addresses  = 1;
+    pDevice->interval   = 0;
+    pDevice->flags      = PROBE_DEVICE_USED | ( local ? PROBE_DEVICE_LOCAL : 0 );
+    pDevice->next       = pCluster->first;
+    pCluster->first     = index;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint16_t newDevice( uint32_t nowMs )
+{
+    // Out of devices: collect those gone from every fingerprint, or
+    // else take the least recently heard one
+    if ( probeClustersVars.free == PROBE_DEVICE_NONE )
+    {
+        uint16_t* pVictim   = NULL;
+        uint32_t  victimAge = 0;
+        for ( uint32_t i = 0; i < PROBE_CLUSTER_SLOTS; ++i )
+        {
+            freeDevices( &probeClustersVars.clusters[ i ].first, nowMs, false );
+            for ( uint16_t* pLink = &probeClustersVars.clusters[ i ].first; *pLink != PROBE_DEVICE_NONE; pLink = &probeClustersVars.devices[ *pLink ].next )
+            {
+                uint32_t age = nowMs - probeClustersVars.devices[ *pLink ].lastSeenMs;
+                if ( pVictim == NULL || age > victimAge )
+                {
+                    pVictim   = pLink;
+                    victimAge = age;
+                }
+            }
+        }
+        if ( probeClustersVars.free == PROBE_DEVICE_NONE )
+        {
+            ++probeClustersVars.stats.evicted;
+            uint16_t index                          = *pVictim;
+            *pVictim                                = probeClustersVars.devices[ index ].next;
+            probeClustersVars.devices[ index ].next = PROBE_DEVICE_NONE;
+            return index;
+        }
+    }
+
+    uint16_t index         = probeClustersVars.free;
+    probeClustersVars.free = probeClustersVars.devices[ index ].next;
+    return index;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void freeDevices( uint16_t* pLink, uint32_t nowMs, bool all )
+{
+    while ( *pLink != PROBE_DEVICE_NONE )
+    {
+        uint16_t      index   = *pLink;
+        tProbeDevice* pDevice = &probeClustersVars.devices[ index ];
+        if ( !all && isActive( pDevice, nowMs ) )
+        {
+            pLink = &pDevice->next;
+            continue;
+        }
+        *pLink                 = pDevice->next;
+        pDevice->flags         = 0;
+        pDevice->next          = probeClustersVars.free;
+        probeClustersVars.free = index;
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void hearDevice( tProbeDevice* pDevice, uint16_t seq, uint32_t nowMs )
+{
+    // A new scan: learn how often the device scans, a moving average
+    // of 1/PROBE_CLUSTER_INTERVAL_WEIGHT
+    uint32_t age = nowMs - pDevice->lastSeenMs;
+    if ( age >= PROBE_CLUSTER_SCAN_MS )
+    {
+        uint32_t sample = age / PROBE_CLUSTER_INTERVAL_UNIT_MS;
+        sample          = sample > UINT16_MAX ? UINT16_MAX : sample;
+        if ( pDevice->interval == 0 )
+        {
+            pDevice->interval = (uint16_t)sample;
+        }
+        else
+        {
+            pDevice->interval = (uint16_t)( ( (uint32_t)pDevice->interval * ( PROBE_CLUSTER_INTERVAL_WEIGHT - 1 ) + sample ) / PROBE_CLUSTER_INTERVAL_WEIGHT );
+        }
+    }
+    pDevice->seq        = seq;
+    pDevice->lastSeenMs = nowMs;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline bool isActive( const tProbeDevice* pDevice, uint32_t nowMs )
+{
+    return ( pDevice->flags & PROBE_DEVICE_USED ) && nowMs - pDevice->lastSeenMs <= PROBE_CLUSTER_MAX_AGE_MS;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t hashBytes( uint32_t hash, const uint8_t* pData, uint8_t length )
+{
+    for ( uint8_t i = 0; i < length; ++i )
+    {
+        hash = hashByte( hash, pData[ i ] );
+    }
+    return hash;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t hashByte( uint32_t hash, uint8_t value )
+{
+    return ( hash ^ value ) * 16777619u;
+}
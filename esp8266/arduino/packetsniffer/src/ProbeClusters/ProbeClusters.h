@@ -0,0 +1,86 @@
+/**
+ * @file    ProbeClusters.h
+ * @brief   Probe request device estimate private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef PROBECLUSTERS_H
+#define PROBECLUSTERS_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IProbeClusters.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#if ( PROBE_CLUSTER_SLOTS & ( PROBE_CLUSTER_SLOTS - 1 ) ) != 0
+#error "PROBE_CLUSTER_SLOTS must be a power of two"
+#endif
+
+#if PROBE_CLUSTER_PROBE_LIMIT > PROBE_CLUSTER_SLOTS
+#error "PROBE_CLUSTER_PROBE_LIMIT must not exceed PROBE_CLUSTER_SLOTS"
+#endif
+
+#if PROBE_CLUSTER_DEVICES >= 0xFFFF
+#error "PROBE_CLUSTER_DEVICES must be below 0xFFFF"
+#endif
+
+#define PROBE_CLUSTER_MASK          ( PROBE_CLUSTER_SLOTS - 1 )
+
+// End of a device list
+#define PROBE_DEVICE_NONE           0xFFFF
+
+// Sequence numbers are 12 bits
+#define PROBE_CLUSTER_SEQ_MASK      0x0FFF
+
+// On-air lengths count the FCS, captured bytes don't
+#define PROBE_CLUSTER_FCS_LEN       4
+
+// Bytes of HT capabilities in the fingerprint: capability info and
+// A-MPDU parameters. The MCS set follows, the same for most devices.
+#define PROBE_CLUSTER_HT_BYTES      3
+
+// Bytes of vendor elements in the fingerprint: OUI and type
+#define PROBE_CLUSTER_VENDOR_BYTES  4
+
+// First address byte: locally administered and group bits
+#define PROBE_CLUSTER_LOCAL_BIT     0x02
+#define PROBE_CLUSTER_GROUP_BIT     0x01
+
+// Bytes of the address a device had before kept, to notice when it is
+// heard again. Random addresses are random in the last bytes too.
+#define PROBE_CLUSTER_PREVIOUS_LEN  4
+
+// Scan intervals are kept in these units, averaged over about this
+// many scans
+#define PROBE_CLUSTER_INTERVAL_UNIT_MS  100
+#define PROBE_CLUSTER_INTERVAL_WEIGHT   4
+
+// Device flags
+#define PROBE_DEVICE_LOCAL          0x01
+#define PROBE_DEVICE_LINKED         0x02    // Took over previous
+#define PROBE_DEVICE_USED           0x80
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // PROBECLUSTERS_H
@@ -0,0 +1,123 @@
+/**
+ * @file    IProbeSsids.h
+ * @brief   Most probed SSIDs, tracked with a count-min sketch and a
+ *          small top-K heap.
+ *
+ *          Every directed probe request bumps its SSID in a
+ *          PROBE_SKETCH_DEPTH x PROBE_SKETCH_WIDTH count-min sketch.
+ *          The sketch estimate (an upper bound of the true count)
+ *          decides whether the SSID belongs among the PROBE_TOP_K
+ *          most probed ones, which are kept in a min-heap together
+ *          with the last few stations probing for them. Memory use
+ *          is fixed regardless of the number of distinct SSIDs.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IPROBESSIDS_H
+#define IPROBESSIDS_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Sketch rows and counters per row (power of two), 2 bytes each
+#ifndef PROBE_SKETCH_DEPTH
+#define PROBE_SKETCH_DEPTH          4
+#endif
+#ifndef PROBE_SKETCH_WIDTH
+#define PROBE_SKETCH_WIDTH          256
+#endif
+
+// Number of SSIDs tracked by name
+#ifndef PROBE_TOP_K
+#define PROBE_TOP_K                 8
+#endif
+
+// Stations remembered per tracked SSID
+#define PROBE_TOP_STATIONS          4
+
+// Longest SSID allowed by 802.11
+#define PROBE_SSID_MAX_LEN          32
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint8_t  ssid[ PROBE_SSID_MAX_LEN ];
+    uint8_t  length;
+    bool     truncated;                 // SSID continued beyond captured bytes
+    uint8_t  stationCount;              // Valid entries in stations
+    uint8_t  nextStation;               // Next entry to replace
+    uint16_t distinctStations;          // Stations seen, saturates
+    uint32_t probes;                    // Sketch estimate
+    uint8_t  stations[ PROBE_TOP_STATIONS ][ 6 ];
+} tProbeSsid;
+
+// Running totals since IProbeSsids_Init()
+typedef struct
+{
+    uint32_t probes;        // Probe requests counted
+    uint32_t wildcard;      // Probe requests for any SSID
+    uint32_t truncated;     // SSID cut short by capture length
+    uint32_t malformed;     // No SSID element found
+} tProbeSsidsStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Clear sketch, top list and statistics.
+ */
+void IProbeSsids_Init( void );
+
+/**
+ * Count a probe request.
+ *
+ * @param  pFrame   Frame, starting with the MAC header
+ * @param  captured Number of valid bytes in pFrame
+ */
+void IProbeSsids_Count( const uint8_t* pFrame, uint16_t captured );
+
+/**
+ * Get the most probed SSIDs, most probed first.
+ *
+ * @param  pTop  Output array
+ * @param  count Size of pTop
+ * @return Number of SSIDs written to pTop.
+ */
+uint8_t IProbeSsids_Top( tProbeSsid* pTop, uint8_t count );
+
+/**
+ * Halve all counts so old probes gradually give way to new ones.
+ * SSIDs whose count reaches zero are forgotten. Call once per report
+ * interval.
+ */
+void IProbeSsids_Decay( void );
+
+/**
+ * Get running statistics.
+ *
+ * @param  pStats Output
+ */
+void IProbeSsids_GetStats( tProbeSsidsStats* pStats );
+
+#endif // IPROBESSIDS_H
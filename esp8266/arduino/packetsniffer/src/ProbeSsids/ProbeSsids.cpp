@@ -0,0 +1,386 @@
+/**
+ * @file    ProbeSsids.cpp
+ * @brief   Most probed SSIDs, tracked with a count-min sketch and a
+ *          small top-K heap.
+ *
+ *          Fed from loop() with probe requests taken off the capture
+ *          ring, nothing here runs in the RX callback.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include <FrameClass/IFrameClass.h>
+#include <FrameView/IFrameView.h>
+
+#include "ProbeSsids.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint16_t         sketch[ PROBE_SKETCH_DEPTH ][ PROBE_SKETCH_WIDTH ];
+    tProbeSsid       heap[ PROBE_TOP_K ];       // Min-heap on probes
+    uint8_t          heapSize;
+    tProbeSsidsStats stats;
+} tProbeSsidsVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static bool findSsid( const uint8_t* pFrame, uint16_t captured, const uint8_t** ppSsid, uint8_t* pLength, bool* pTruncated );
+static uint32_t sketchAdd( const uint8_t* pSsid, uint8_t length );
+static void addStation( tProbeSsid* pEntry, const uint8_t* pMac );
+static void siftDown( uint8_t index );
+static void siftUp( uint8_t index );
+static void swapEntries( uint8_t a, uint8_t b );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tProbeSsidsVars probeSsidsVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IProbeSsids_Init( void )
+{
+    memset( &probeSsidsVars, 0, sizeof( probeSsidsVars ) );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IProbeSsids_Count( const uint8_t* pFrame, uint16_t captured )
+{
+    const uint8_t* pSsid;
+    uint8_t        length;
+    bool           truncated;
+
+    ++probeSsidsVars.stats.probes;
+    if ( !findSsid( pFrame, captured, &pSsid, &length, &truncated ) )
+    {
+        ++probeSsidsVars.stats.malformed;
+        return;
+    }
+    if ( length == 0 )
+    {
+        // Wildcard probes say nothing about the station's networks
+        ++probeSsidsVars.stats.wildcard;
+        return;
+    }
+    if ( truncated )
+    {
+        ++probeSsidsVars.stats.truncated;
+    }
+
+    uint32_t       estimate = sketchAdd( pSsid, length );
+    const uint8_t* pMac     = &pFrame[ FRAME_ADDR2_OFFSET ];
+
+    // Already tracked, estimates only grow so it can only sink
+    for ( uint8_t i = 0; i < probeSsidsVars.heapSize; ++i )
+    {
+        tProbeSsid* pEntry = &probeSsidsVars.heap[ i ];
+        if ( pEntry->length == length && memcmp( pEntry->ssid, pSsid, length ) == 0 )
+        {
+            pEntry->probes     = estimate;
+            pEntry->truncated |= truncated;
+            addStation( pEntry, pMac );
+            siftDown( i );
+            return;
+        }
+    }
+
+    // New SSID, takes the place of the least probed one if it beats it
+    uint8_t index;
+    if ( probeSsidsVars.heapSize < PROBE_TOP_K )
+    {
+        index = probeSsidsVars.heapSize++;
+    }
+    else if ( estimate > probeSsidsVars.heap[ 0 ].probes )
+    {
+        index = 0;
+    }
+    else
+    {
+        return;
+    }
+
+    tProbeSsid* pEntry = &probeSsidsVars.heap[ index ];
+    memset( pEntry, 0, sizeof( *pEntry ) );
+    memcpy( pEntry->ssid, pSsid, length );
+    pEntry->length    = length;
+    pEntry->truncated = truncated;
+    pEntry->probes    = estimate;
+    addStation( pEntry, pMac );
+
+    if ( index == 0 )
+    {
+        siftDown( 0 );
+    }
+    else
+    {
+        siftUp( index );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint8_t IProbeSsids_Top( tProbeSsid* pTop, uint8_t count )
+{
+    uint8_t found = 0;
+    for ( uint8_t i = 0; i < probeSsidsVars.heapSize; ++i )
+    {
+        const tProbeSsid* pEntry = &probeSsidsVars.heap[ i ];
+
+        // Insertion sort, count is small
+        uint8_t position = found;
+        while ( position > 0 && pTop[ position - 1 ].probes < pEntry->probes )
+        {
+            if ( position < count )
+            {
+                pTop[ position ] = pTop[ position - 1 ];
+            }
+            --position;
+        }
+        if ( position < count )
+        {
+            pTop[ position ] = *pEntry;
+            if ( found < count )
+            {
+                ++found;
+            }
+        }
+    }
+    return found;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IProbeSsids_Decay( void )
+{
+    for ( uint8_t row = 0; row < PROBE_SKETCH_DEPTH; ++row )
+    {
+        for ( uint16_t column = 0; column < PROBE_SKETCH_WIDTH; ++column )
+        {
+            probeSsidsVars.sketch[ row ][ column ] >>= 1;
+        }
+    }
+
+    // SSIDs not probed since the last halvings drop out, the rest
+    // are built back into a heap
+    uint8_t kept = 0;
+    for ( uint8_t i = 0; i < probeSsidsVars.heapSize; ++i )
+    {
+        probeSsidsVars.heap[ i ].probes >>= 1;
+        if ( probeSsidsVars.heap[ i ].probes != 0 )
+        {
+            probeSsidsVars.heap[ kept++ ] = probeSsidsVars.heap[ i ];
+        }
+    }
+    probeSsidsVars.heapSize = kept;
+    for ( uint8_t i = kept / 2; i > 0; --i )
+    {
+        siftDown( i - 1 );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IProbeSsids_GetStats( tProbeSsidsStats* pStats )
+{
+    *pStats = probeSsidsVars.stats;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static bool findSsid( const uint8_t* pFrame, uint16_t captured, const uint8_t** ppSsid, uint8_t* pLength, bool* pTruncated )
+{
+    // SSID is the first element of a probe request, but walk the
+    // elements rather than trusting the sender
+    tFrameView view;
+    tFrameIe   ssid;
+    if ( !IFrameView_Init( &view, pFrame, captured ) || !IFrameView_FindIe( &view, FRAME_IE_SSID, &ssid ) )
+    {
+        return false;
+    }
+    if ( ssid.length > PROBE_SSID_MAX_LEN || ( ssid.length > 0 && ssid.available == 0 ) )
+    {
+        return false;
+    }
+    *ppSsid     = ssid.pData;
+    *pTruncated = ssid.available < ssid.length;
+    *pLength    = ssid.available;
+    return true;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint32_t sketchAdd( const uint8_t* pSsid, uint8_t length )
+{
+    // FNV-1a, rows indexed by double hashing h1 + row * h2
+    uint32_t hash = 2166136261u;
+    for ( uint8_t i = 0; i < length; ++i )
+    {
+        hash = ( hash ^ pSsid[ i ] ) * 16777619u;
+    }
+    uint32_t step = ( ( hash >> 16 ) | ( hash << 16 ) ) | 1;
+
+    uint32_t estimate = UINT32_MAX;
+    for ( uint8_t row = 0; row < PROBE_SKETCH_DEPTH; ++row, hash += step )
+    {
+        uint16_t* pCounter = &probeSsidsVars.sketch[ row ][ hash & PROBE_SKETCH_MASK ];
+        if ( *pCounter < UINT16_MAX )
+        {
+            ++*pCounter;
+        }
+        if ( *pCounter < estimate )
+        {
+            estimate = *pCounter;
+        }
+    }
+    return estimate;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void addStation( tProbeSsid* pEntry, const uint8_t* pMac )
+{
+    for ( uint8_t i = 0; i < pEntry->stationCount; ++i )
+    {
+        if ( memcmp( pEntry->stations[ i ], pMac, 6 ) == 0 )
+        {
+            return;
+        }
+    }
+
+    // Stations forgotten here are counted again if they come back,
+    // so distinctStations is an upper bound
+    memcpy( pEntry->stations[ pEntry->nextStation ], pMac, 6 );
+    pEntry->nextStation = ( pEntry->nextStation + 1 ) % PROBE_TOP_STATIONS;
+    if ( pEntry->stationCount < PROBE_TOP_STATIONS )
+    {
+        ++pEntry->stationCount;
+    }
+    if ( pEntry->distinctStations < UINT16_MAX )
+    {
+        ++pEntry->distinctStations;
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void siftDown( uint8_t index )
+{
+    for ( ;; )
+    {
+        uint8_t smallest = index;
+        uint8_t left     = 2 * index + 1;
+        uint8_t right    = 2 * index + 2;
+        if ( left < probeSsidsVars.heapSize && probeSsidsVars.heap[ left ].probes < probeSsidsVars.heap[ smallest ].probes )
+        {
+            smallest = left;
+        }
+        if ( right < probeSsidsVars.heapSize && probeSsidsVars.heap[ right ].probes < probeSsidsVars.heap[ smallest ].probes )
+        {
+            smallest = right;
+        }
+        if ( smallest == index )
+        {
+            return;
+        }
+        swapEntries( index, smallest );
+        index = smallest;
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void siftUp( uint8_t index )
+{
+    while ( index > 0 )
+    {
+        uint8_t parent = ( index - 1 ) / 2;
+        if ( probeSsidsVars.heap[ parent ].probes <= probeSsidsVars.heap[ index ].probes )
+        {
+            return;
+        }
+        swapEntries( index, parent );
+        index = parent;
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void swapEntries( uint8_t a, uint8_t b )
+{
+    tProbeSsid temp          = probeSsidsVars.heap[ a ];
+    probeSsidsVars.heap[ a ] = probeSsidsVars.heap[ b ];
+    probeSsidsVars.heap[ b ] = temp;
+}
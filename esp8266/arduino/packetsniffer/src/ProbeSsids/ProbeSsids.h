@@ -0,0 +1,44 @@
+/**
+ * @file    ProbeSsids.h
+ * @brief   Probe SSID tracking private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef PROBESSIDS_H
+#define PROBESSIDS_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IProbeSsids.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#if ( PROBE_SKETCH_WIDTH & ( PROBE_SKETCH_WIDTH - 1 ) ) != 0
+#error "PROBE_SKETCH_WIDTH must be a power of two"
+#endif
+
+#define PROBE_SKETCH_MASK           ( PROBE_SKETCH_WIDTH - 1 )
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // PROBESSIDS_H
@@ -0,0 +1,103 @@
+/**
+ * @file    IRxStats.h
+ * @brief   Per interval distributions of RSSI, legacy rate and HT MCS
+ *          from rx_ctrl.
+ *
+ *          RSSI is kept in 1 dB buckets, so percentiles come straight
+ *          out of the histogram without approximation. The RX callback
+ *          writes into the active one of two banks, loop() retires it
+ *          once per interval, in the same way as FrameCounters.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef IRXSTATS_H
+#define IRXSTATS_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+
+#include <SnifferBuf/ISnifferBuf.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// RSSI buckets, bucket n holds -n dBm (0 and -127 collect the rest)
+#define RX_STATS_RSSI_BUCKETS       128
+
+// rx_ctrl.rate codes
+#define RX_STATS_RATE_CODES         16
+
+// HT MCS 0..15, anything above is counted in the last bucket
+#define RX_STATS_MCS_BUCKETS        17
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t ht;                                    // sig_mode != 0
+    uint32_t wide;                                  // 40 MHz (CWB)
+    uint32_t shortGi;                               // HT with short guard interval
+    int32_t  rssiSum;
+    uint32_t rates[ RX_STATS_RATE_CODES ];          // Legacy frames by rate code
+    uint32_t mcs[ RX_STATS_MCS_BUCKETS ];           // HT frames by MCS
+    uint16_t rssi[ RX_STATS_RSSI_BUCKETS ];         // Saturating
+} tRxStatsBank;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Clear all statistics. Must not be called while the RX callback is
+ * active.
+ */
+void IRxStats_Init( void );
+
+/**
+ * Account a received frame. Safe to call from the RX callback.
+ *
+ * @param  pRx RX control of the frame
+ */
+void IRxStats_Count( const tRxControl* pRx );
+
+/**
+ * Retire the active interval and start a new one.
+ *
+ * @return Retired interval, valid until the next call.
+ */
+const tRxStatsBank* IRxStats_Swap( void );
+
+/**
+ * Get an RSSI percentile of an interval.
+ *
+ * @param  pBank   Interval
+ * @param  percent Percentile, 0..100
+ * @return RSSI in dBm, 0 if the interval holds no frames.
+ */
+int8_t IRxStats_RssiPercentile( const tRxStatsBank* pBank, uint8_t percent );
+
+/**
+ * Get the bit rate of an rx_ctrl rate code.
+ *
+ * @param  rateCode rx_ctrl.rate
+ * @return Rate in 500 kbps units, 0 if the code is not used.
+ */
+uint8_t IRxStats_LegacyRate( uint8_t rateCode );
+
+#endif // IRXSTATS_H
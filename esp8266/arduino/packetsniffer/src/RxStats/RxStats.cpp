@@ -0,0 +1,178 @@
+/**
+ * @file    RxStats.cpp
+ * @brief   Per interval distributions of RSSI, legacy rate and HT MCS
+ *          from rx_ctrl.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include "RxStats.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    tRxStatsBank banks[ RX_STATS_BANKS ];
+    uint32_t     activeBank;
+    uint32_t     writerBusy;
+} tRxStatsVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tRxStatsVars rxStatsVars;
+
+// rx_ctrl.rate to 500 kbps units, codes 5-7 are short preamble DSSS
+static const uint8_t legacyRates[ RX_STATS_RATE_CODES ] = {
+    2, 4, 11, 22, 0, 4, 11, 22, 96, 48, 24, 12, 108, 72, 36, 18
+};
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IRxStats_Init( void )
+{
+    memset( &rxStatsVars, 0, sizeof( rxStatsVars ) );
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IRxStats_Count( const tRxControl* pRx )
+{
+    int8_t  rssi   = pRx->rssi;
+    uint8_t bucket = rssi >= 0 ? 0 : ( rssi <= -( RX_STATS_RSSI_BUCKETS - 1 ) ? RX_STATS_RSSI_BUCKETS - 1 : (uint8_t)-rssi );
+
+    __atomic_store_n( &rxStatsVars.writerBusy, 1, __ATOMIC_SEQ_CST );
+    uint32_t      active = __atomic_load_n( &rxStatsVars.activeBank, __ATOMIC_SEQ_CST );
+    tRxStatsBank* pBank  = &rxStatsVars.banks[ active ];
+
+    ++pBank->frames;
+    pBank->rssiSum        += rssi;
+    pBank->rssi[ bucket ] += pBank->rssi[ bucket ] != UINT16_MAX;
+    if ( pRx->sig_mode != 0 )
+    {
+        ++pBank->ht;
+        ++pBank->mcs[ pRx->MCS < RX_STATS_MCS_BUCKETS - 1 ? pRx->MCS : RX_STATS_MCS_BUCKETS - 1 ];
+        pBank->shortGi += pRx->SGI;
+    }
+    else
+    {
+        ++pBank->rates[ pRx->rate ];
+    }
+    pBank->wide += pRx->CWB;
+
+    __atomic_store_n( &rxStatsVars.writerBusy, 0, __ATOMIC_RELEASE );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+const tRxStatsBank* IRxStats_Swap( void )
+{
+    uint32_t retired = rxStatsVars.activeBank;
+    uint32_t next    = retired ^ 1;
+
+    // Next bank still holds the interval returned by the previous call
+    memset( &rxStatsVars.banks[ next ], 0, sizeof( tRxStatsBank ) );
+
+    __atomic_store_n( &rxStatsVars.activeBank, next, __ATOMIC_SEQ_CST );
+    while ( __atomic_load_n( &rxStatsVars.writerBusy, __ATOMIC_SEQ_CST ) != 0 )
+    {
+        // Callback still writing into retired bank
+    }
+
+    return &rxStatsVars.banks[ retired ];
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+int8_t IRxStats_RssiPercentile( const tRxStatsBank* pBank, uint8_t percent )
+{
+    uint32_t total = 0;
+    for ( uint8_t bucket = 0; bucket < RX_STATS_RSSI_BUCKETS; ++bucket )
+    {
+        total += pBank->rssi[ bucket ];
+    }
+    if ( total == 0 )
+    {
+        return 0;
+    }
+
+    // Nearest rank, counting from the weakest signal
+    uint32_t rank = ( total * percent + 99 ) / 100;
+    if ( rank == 0 )
+    {
+        rank = 1;
+    }
+
+    uint32_t seen = 0;
+    for ( int16_t bucket = RX_STATS_RSSI_BUCKETS - 1; bucket >= 0; --bucket )
+    {
+        seen += pBank->rssi[ bucket ];
+        if ( seen >= rank )
+        {
+            return (int8_t)-bucket;
+        }
+    }
+    return 0;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint8_t IRxStats_LegacyRate( uint8_t rateCode )
+{
+    return rateCode < RX_STATS_RATE_CODES ? legacyRates[ rateCode ] : 0;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
@@ -0,0 +1,40 @@
+/**
+ * @file    RxStats.h
+ * @brief   RX statistics private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef RXSTATS_H
+#define RXSTATS_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IRxStats.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#define RX_STATS_BANKS              2
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // RXSTATS_H
@@ -0,0 +1,218 @@
+/**
+ * @file    ISnifferBuf.h
+ * @brief   Buffer layouts handed to the promiscuous RX callback by
+ *          the ESP8266 SDK.
+ *
+ *          The layout is told apart by the length the callback gets:
+ *            sizeof( tRxControl )    RX control only, no frame bytes
+ *            sizeof( tSnifferBuf2 )  Management frame, first 112 bytes
+ *            sizeof( tSnifferBuf ) + ( N - 1 ) * sizeof( tAmpduInfo )
+ *                                    Other frames, first 36 bytes and
+ *                                    length/sequence of N frames (more
+ *                                    than one for an A-MPDU)
+ *          ISnifferBuf_Parse() does the dispatch.
+ *
+ *          Only the first frame of an A-MPDU comes with header bytes,
+ *          the others are described by their length/sequence entry.
+ *          Without frame bytes, rx_ctrl's ampdu_cnt is all there is.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef ISNIFFERBUF_H
+#define ISNIFFERBUF_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Number of frame bytes delivered in tSnifferBuf
+#define SNIFFER_BUF_LEN       36
+
+// Number of frame bytes delivered in tSnifferBuf2
+#define SNIFFER_BUF2_LEN      112
+
+// Most frame bytes any layout delivers
+#define SNIFFER_MAX_BUF_LEN   SNIFFER_BUF2_LEN
+
+// An A-MPDU holds at most 64 MPDUs (block ack window)
+#define SNIFFER_MAX_MPDUS     64
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct RxControl {
+    signed rssi:8;
+    unsigned rate:4;
+    unsigned is_group:1;
+    unsigned:1;
+    unsigned sig_mode:2;
+    unsigned legacy_length:12;
+    unsigned damatch0:1;
+    unsigned damatch1:1;
+    unsigned bssidmatch0:1;
+    unsigned bssidmatch1:1;
+    unsigned MCS:7;
+    unsigned CWB:1;
+    unsigned HT_length:16;
+    unsigned Smoothing:1;
+    unsigned Not_Sounding:1;
+    unsigned:1;
+    unsigned Aggregation:1;
+    unsigned STBC:2;
+    unsigned FEC_CODING:1;
+    unsigned SGI:1;
+    unsigned rxend_state:8;
+    unsigned ampdu_cnt:8;
+    unsigned channel:4;
+    unsigned:12;
+} tRxControl;
+
+typedef struct Ampdu_Info
+{
+  uint16_t length;
+  uint16_t seq;
+  uint8_t  address3[6];
+} tAmpduInfo;
+
+typedef struct sniffer_buf {
+    tRxControl rx_ctrl;
+    uint8_t  buf[SNIFFER_BUF_LEN];
+    uint16_t cnt;
+    tAmpduInfo ampdu_info[1];   // cnt entries, as far as the buffer goes
+} tSnifferBuf;
+
+typedef struct sniffer_buf2 {
+    tRxControl rx_ctrl;
+    uint8_t  buf[SNIFFER_BUF2_LEN];
+    uint16_t cnt;
+    uint16_t len;
+} tSnifferBuf2;
+
+typedef enum
+{
+    SNIFFER_LAYOUT_INVALID,     // Too short for RX control
+    SNIFFER_LAYOUT_RX_CTRL,     // RX control only
+    SNIFFER_LAYOUT_BUF,         // tSnifferBuf
+    SNIFFER_LAYOUT_BUF2         // tSnifferBuf2
+} tSnifferLayout;
+
+// Callback buffer, whatever its layout
+typedef struct
+{
+    const tRxControl* pRx;
+    const uint8_t*    pFrame;       // Start of the (first) frame, NULL if none
+    uint16_t          captured;     // Valid bytes at pFrame
+    uint16_t          length;       // On-air length of the (first) frame
+    uint32_t          totalLength;  // On-air length of all frames described
+    uint16_t          count;        // Entries at pAmpdu
+    uint16_t          mpdus;        // Frames received, at least 1
+    const tAmpduInfo* pAmpdu;       // Per frame length/sequence, NULL if none
+} tSnifferFrame;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Get on-air length of a frame, the length field depends on whether
+ * it was received as HT or legacy.
+ *
+ * @param  pRx RX control of the frame
+ * @return Frame length in bytes
+ */
+static inline uint16_t ISnifferBuf_FrameLength( const tRxControl* pRx )
+{
+    return pRx->sig_mode != 0 ? pRx->HT_length : pRx->legacy_length;
+}
+
+/**
+ * Work out the layout of a callback buffer and describe the frame in
+ * it. Only trusts as many length/sequence entries as the buffer has
+ * room for, whatever cnt says, and no more than an A-MPDU can hold.
+ * Safe to call from the RX callback.
+ *
+ * @param  pBuffer Buffer passed to the callback
+ * @param  length  Length passed to the callback
+ * @param  pFrame  Output, pRx and mpdus are valid unless
+ *                 SNIFFER_LAYOUT_INVALID, the rest only for
+ *                 SNIFFER_LAYOUT_BUF and _BUF2
+ * @return Layout of the buffer.
+ */
+static inline tSnifferLayout ISnifferBuf_Parse( const uint8_t* pBuffer, uint16_t length, tSnifferFrame* pFrame )
+{
+    if ( length < sizeof( tRxControl ) )
+    {
+        return SNIFFER_LAYOUT_INVALID;
+    }
+    pFrame->pRx = (const tRxControl*)pBuffer;
+
+    // Entries, where there are any, override this
+    pFrame->mpdus = 1;
+    if ( pFrame->pRx->Aggregation && pFrame->pRx->ampdu_cnt > 1 )
+    {
+        pFrame->mpdus = pFrame->pRx->ampdu_cnt < SNIFFER_MAX_MPDUS ? pFrame->pRx->ampdu_cnt : SNIFFER_MAX_MPDUS;
+    }
+
+    uint16_t       bufLength;
+    tSnifferLayout layout;
+    if ( length == sizeof( tSnifferBuf2 ) )
+    {
+        const tSnifferBuf2* pBuf2 = (const tSnifferBuf2*)pBuffer;
+        pFrame->pFrame      = pBuf2->buf;
+        pFrame->length      = pBuf2->len != 0 ? pBuf2->len : ISnifferBuf_FrameLength( pFrame->pRx );
+        pFrame->totalLength = pFrame->length;
+        pFrame->count       = 0;
+        pFrame->pAmpdu      = NULL;
+        bufLength           = SNIFFER_BUF2_LEN;
+        layout              = SNIFFER_LAYOUT_BUF2;
+    }
+    else if ( length >= sizeof( tSnifferBuf ) )
+    {
+        const tSnifferBuf* pBuf  = (const tSnifferBuf*)pBuffer;
+        uint16_t           room  = ( length - offsetof( tSnifferBuf, ampdu_info ) ) / sizeof( tAmpduInfo );
+        if ( room > SNIFFER_MAX_MPDUS )
+        {
+            room = SNIFFER_MAX_MPDUS;
+        }
+        pFrame->pFrame      = pBuf->buf;
+        pFrame->count       = pBuf->cnt < room ? pBuf->cnt : room;
+        pFrame->mpdus       = pFrame->count > 0 ? pFrame->count : pFrame->mpdus;
+        pFrame->pAmpdu      = pFrame->count > 0 ? pBuf->ampdu_info : NULL;
+        pFrame->length      = pFrame->count > 0 ? pBuf->ampdu_info[ 0 ].length : ISnifferBuf_FrameLength( pFrame->pRx );
+        pFrame->totalLength = pFrame->count > 0 ? 0 : pFrame->length;
+        for ( uint16_t i = 0; i < pFrame->count; ++i )
+        {
+            pFrame->totalLength += pBuf->ampdu_info[ i ].length;
+        }
+        bufLength = SNIFFER_BUF_LEN;
+        layout    = SNIFFER_LAYOUT_BUF;
+    }
+    else
+    {
+        // Not a layout the SDK uses, the frame bytes can't be trusted
+        return SNIFFER_LAYOUT_RX_CTRL;
+    }
+
+    // Frames shorter than the buffer leave garbage behind them
+    pFrame->captured = pFrame->length != 0 && pFrame->length < bufLength ? pFrame->length : bufLength;
+    return layout;
+}
+
+#endif // ISNIFFERBUF_H
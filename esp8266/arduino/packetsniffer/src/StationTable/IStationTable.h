@@ -0,0 +1,147 @@
+/**
+ * @file    IStationTable.h
+ * @brief   Per-transmitter statistics in a fixed size hash table.
+ *
+ *          Stations are keyed on MAC address and live in a statically
+ *          allocated open addressing table with linear probing. A
+ *          lookup never looks further than STATION_TABLE_PROBE_LIMIT
+ *          slots; when no free slot is found within that window the
+ *          least recently seen station in it is replaced. Slots are
+ *          never emptied, so no tombstones are needed.
+ *
+ *          Every station also remembers the last sequence control it
+ *          sent, per sequence space, which tells a retransmission of
+ *          a frame already heard (retry flag, same sequence control)
+ *          from one whose original was missed. Management and non-QoS
+ *          data share a space, QoS data has one per TID of which only
+ *          the last one used is kept, so retries interleaved across
+ *          TIDs go undetected.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef ISTATIONTABLE_H
+#define ISTATIONTABLE_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Number of slots, must be a power of two (40 bytes each)
+#ifndef STATION_TABLE_SLOTS
+#define STATION_TABLE_SLOTS         256
+#endif
+
+// Longest probe sequence, bounds the cost of an update
+#ifndef STATION_TABLE_PROBE_LIMIT
+#define STATION_TABLE_PROBE_LIMIT   8
+#endif
+
+// Stations not heard from in this long are inactive and first in
+// line for replacement
+#ifndef STATION_TABLE_MAX_AGE_MS
+#define STATION_TABLE_MAX_AGE_MS    60000
+#endif
+
+// RSSI average is kept in 1/16 dB
+#define STATION_RSSI_SCALE          16
+
+// Sequence spaces for IStationTable_Update()
+#define STATION_SEQ_MANAGEMENT      0       // Also non-QoS data
+#define STATION_SEQ_QOS_DATA        1
+#define STATION_SEQ_SPACES          2
+#define STATION_SEQ_NONE            0xFF    // Frame without sequence control
+
+// Last sequence control of a space nothing was heard in yet
+#define STATION_SEQ_CTRL_UNKNOWN    0xFFFF
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint8_t  mac[ 6 ];
+    int16_t  rssiAvg;       // Smoothed RSSI, dBm * STATION_RSSI_SCALE
+    uint32_t frames;        // 0 = free slot
+    uint32_t bytes;         // On-air bytes
+    uint32_t airtimeUs;     // Time on the air, see IAirtime_Duration()
+    uint32_t retries;       // Frames with the retry flag
+    uint32_t duplicates;    // Retransmissions of a frame already heard
+    uint16_t lastSeqCtrl[ STATION_SEQ_SPACES ];
+    uint32_t firstSeenMs;
+    uint32_t lastSeenMs;
+} tStation;
+
+// Running totals since IStationTable_Init()
+typedef struct
+{
+    uint32_t active;        // Stations seen within STATION_TABLE_MAX_AGE_MS
+    uint32_t used;          // Occupied slots
+    uint32_t inserted;      // New stations
+    uint32_t expired;       // Inactive stations replaced
+    uint32_t evicted;       // Active stations replaced, table too small
+} tStationTableStats;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Empty the table and reset statistics.
+ */
+void IStationTable_Init( void );
+
+/**
+ * Account a frame to its transmitter, adding it if unknown. Bounded
+ * cost, safe to call from the RX callback.
+ *
+ * @param  pMac      Transmitter address, need not be aligned
+ * @param  rssi      RSSI of the frame (dBm)
+ * @param  length    On-air length of the frame, all MPDUs of an A-MPDU
+ * @param  mpdus     Frames the reception carried, see tSnifferFrame
+ * @param  airtimeUs Time the frame took on the air
+ * @param  seqSpace  STATION_SEQ_... of the frame
+ * @param  seqCtrl   Sequence control, ignored with STATION_SEQ_NONE
+ * @param  retry     Retry flag of the frame
+ * @param  nowMs     Current time
+ * @return TRUE if the frame is a retransmission of one already heard.
+ */
+bool IStationTable_Update( const uint8_t* pMac, int8_t rssi, uint32_t length, uint16_t mpdus, uint32_t airtimeUs, uint8_t seqSpace, uint16_t seqCtrl, bool retry, uint32_t nowMs );
+
+/**
+ * Get table statistics. Walks the whole table, call from loop().
+ *
+ * @param  nowMs  Current time
+ * @param  pStats Output
+ */
+void IStationTable_GetStats( uint32_t nowMs, tStationTableStats* pStats );
+
+/**
+ * Get the active stations with most frames, busiest first. Entries
+ * are copied while the RX callback may be updating them, so a copy
+ * can be slightly inconsistent.
+ *
+ * @param  nowMs  Current time
+ * @param  pTop   Output array
+ * @param  count  Size of pTop
+ * @return Number of stations written to pTop.
+ */
+uint8_t IStationTable_Top( uint32_t nowMs, tStation* pTop, uint8_t count );
+
+#endif // ISTATIONTABLE_H
@@ -0,0 +1,275 @@
+/**
+ * @file    StationTable.cpp
+ * @brief   Per-transmitter statistics in a fixed size hash table.
+ *
+ *          Only the RX callback writes to the table. loop() reads
+ *          entries without locking, which at worst reports a station
+ *          that is being updated with a stale counter or two.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include "StationTable.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    tStation slots[ STATION_TABLE_SLOTS ];
+    uint32_t used;          // Written from RX callback only
+    uint32_t inserted;      // Written from RX callback only
+    uint32_t expired;       // Written from RX callback only
+    uint32_t evicted;       // Written from RX callback only
+} tStationTableVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static inline uint32_t hashMac( const uint8_t* pMac );
+static inline uint32_t mix32( uint32_t value );
+static inline void countEvent( uint32_t* pCounter );
+static inline bool checkSequence( tStation* pStation, uint8_t seqSpace, uint16_t seqCtrl, bool retry );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tStationTableVars stationTableVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStationTable_Init( void )
+{
+    memset( &stationTableVars, 0, sizeof( stationTableVars ) );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+bool IStationTable_Update( const uint8_t* pMac, int8_t rssi, uint32_t length, uint16_t mpdus, uint32_t airtimeUs, uint8_t seqSpace, uint16_t seqCtrl, bool retry, uint32_t nowMs )
+{
+    uint32_t  index      = hashMac( pMac );
+    tStation* pVictim    = NULL;
+    uint32_t  victimAge  = 0;
+
+    for ( uint8_t probe = 0; probe < STATION_TABLE_PROBE_LIMIT; ++probe, index = ( index + 1 ) & STATION_TABLE_MASK )
+    {
+        tStation* pStation = &stationTableVars.slots[ index ];
+
+        // Slots are never freed, so the first free slot ends the
+        // sequence of stations that hashed here
+        if ( pStation->frames == 0 )
+        {
+            pVictim = pStation;
+            countEvent( &stationTableVars.used );
+            break;
+        }
+
+        if ( memcmp( pStation->mac, pMac, sizeof( pStation->mac ) ) == 0 )
+        {
+            pStation->frames    += mpdus;
+            pStation->bytes     += length;
+            pStation->airtimeUs += airtimeUs;
+            pStation->lastSeenMs = nowMs;
+            pStation->rssiAvg    = (int16_t)( pStation->rssiAvg + ( ( rssi * STATION_RSSI_SCALE - pStation->rssiAvg ) >> STATION_RSSI_SHIFT ) );
+            return checkSequence( pStation, seqSpace, seqCtrl, retry );
+        }
+
+        // Remember least recently seen in case the window is full
+        uint32_t age = nowMs - pStation->lastSeenMs;
+        if ( pVictim == NULL || age > victimAge )
+        {
+            pVictim   = pStation;
+            victimAge = age;
+        }
+    }
+
+    if ( pVictim->frames != 0 )
+    {
+        countEvent( victimAge > STATION_TABLE_MAX_AGE_MS ? &stationTableVars.expired : &stationTableVars.evicted );
+    }
+    countEvent( &stationTableVars.inserted );
+
+    // Replace in place, the station keeps its position in the probe
+    // sequence of any other station
+    memcpy( pVictim->mac, pMac, sizeof( pVictim->mac ) );
+    pVictim->rssiAvg     = (int16_t)( rssi * STATION_RSSI_SCALE );
+    pVictim->frames      = mpdus;
+    pVictim->bytes       = length;
+    pVictim->airtimeUs   = airtimeUs;
+    pVictim->firstSeenMs = nowMs;
+    pVictim->lastSeenMs  = nowMs;
+    pVictim->retries     = 0;
+    pVictim->duplicates  = 0;
+    for ( uint8_t space = 0; space < STATION_SEQ_SPACES; ++space )
+    {
+        pVictim->lastSeqCtrl[ space ] = STATION_SEQ_CTRL_UNKNOWN;
+    }
+    return checkSequence( pVictim, seqSpace, seqCtrl, retry );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStationTable_GetStats( uint32_t nowMs, tStationTableStats* pStats )
+{
+    pStats->active = 0;
+    for ( uint32_t i = 0; i < STATION_TABLE_SLOTS; ++i )
+    {
+        const tStation* pStation = &stationTableVars.slots[ i ];
+        if ( pStation->frames != 0 && nowMs - pStation->lastSeenMs <= STATION_TABLE_MAX_AGE_MS )
+        {
+            ++pStats->active;
+        }
+    }
+    pStats->used     = __atomic_load_n( &stationTableVars.used,     __ATOMIC_RELAXED );
+    pStats->inserted = __atomic_load_n( &stationTableVars.inserted, __ATOMIC_RELAXED );
+    pStats->expired  = __atomic_load_n( &stationTableVars.expired,  __ATOMIC_RELAXED );
+    pStats->evicted  = __atomic_load_n( &stationTableVars.evicted,  __ATOMIC_RELAXED );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint8_t IStationTable_Top( uint32_t nowMs, tStation* pTop, uint8_t count )
+{
+    uint8_t found = 0;
+    for ( uint32_t i = 0; i < STATION_TABLE_SLOTS; ++i )
+    {
+        tStation station = stationTableVars.slots[ i ];
+        if ( station.frames == 0 || nowMs - station.lastSeenMs > STATION_TABLE_MAX_AGE_MS )
+        {
+            continue;
+        }
+
+        // Insertion sort, count is small
+        uint8_t position = found;
+        while ( position > 0 && pTop[ position - 1 ].frames < station.frames )
+        {
+            if ( position < count )
+            {
+                pTop[ position ] = pTop[ position - 1 ];
+            }
+            --position;
+        }
+        if ( position < count )
+        {
+            pTop[ position ] = station;
+            if ( found < count )
+            {
+                ++found;
+            }
+        }
+    }
+    return found;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t hashMac( const uint8_t* pMac )
+{
+    // All 48 bits through the finalizer: a multiply only carries bits
+    // upward, so without the shifts the upper bytes never reach the
+    // slot bits
+    uint32_t low  = pMac[ 0 ] | ( pMac[ 1 ] << 8 ) | ( pMac[ 2 ] << 16 ) | ( (uint32_t)pMac[ 3 ] << 24 );
+    uint32_t high = pMac[ 4 ] | ( pMac[ 5 ] << 8 );
+    return mix32( low ^ mix32( high ) ) & STATION_TABLE_MASK;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline uint32_t mix32( uint32_t value )
+{
+    // MurmurHash3 finalizer
+    value ^= value >> 16;
+    value *= 0x85EBCA6Bu;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35u;
+    value ^= value >> 16;
+    return value;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline void countEvent( uint32_t* pCounter )
+{
+    __atomic_store_n( pCounter, *pCounter + 1, __ATOMIC_RELAXED );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline bool checkSequence( tStation* pStation, uint8_t seqSpace, uint16_t seqCtrl, bool retry )
+{
+    pStation->retries += retry;
+    if ( seqSpace >= STATION_SEQ_SPACES )
+    {
+        return false;
+    }
+
+    // A retry repeats sequence number and fragment of the original,
+    // anything else starts a new frame
+    uint16_t* pLast = &pStation->lastSeqCtrl[ seqSpace ];
+    if ( retry && *pLast == seqCtrl )
+    {
+        ++pStation->duplicates;
+        return true;
+    }
+    *pLast = seqCtrl;
+    return false;
+}
@@ -0,0 +1,51 @@
+/**
+ * @file    StationTable.h
+ * @brief   Station table private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef STATIONTABLE_H
+#define STATIONTABLE_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IStationTable.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#if ( STATION_TABLE_SLOTS & ( STATION_TABLE_SLOTS - 1 ) ) != 0
+#error "STATION_TABLE_SLOTS must be a power of two"
+#endif
+
+#if STATION_TABLE_PROBE_LIMIT > STATION_TABLE_SLOTS
+#error "STATION_TABLE_PROBE_LIMIT must not exceed STATION_TABLE_SLOTS"
+#endif
+
+#define STATION_TABLE_MASK          ( STATION_TABLE_SLOTS - 1 )
+
+// Smoothing of RSSI, new = old + ( sample - old ) / 2^N
+#define STATION_RSSI_SHIFT          3
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // STATIONTABLE_H
@@ -0,0 +1,240 @@
+/**
+ * @file    IStatsRecord.h
+ * @brief   Compact binary encoding of interval statistics, sent as
+ *          STREAM_RECORD_STATS records.
+ *
+ *          Record payload:
+ *            u8 STATS_VERSION, varint interval number, varint uptime
+ *            (ms), varint interval length (ms), sections...
+ *
+ *          Section:
+ *            u8 section id, varint content length, content
+ *
+ *          Unless noted otherwise, section fields are unsigned LEB128
+ *          varints, signed fields are zigzag encoded varints, MAC
+ *          addresses are 6 raw bytes and strings are a varint length
+ *          followed by the bytes. Decoders skip unknown sections and
+ *          ignore trailing fields they don't know, so sections and
+ *          fields can be added without bumping STATS_VERSION.
+ *
+ *          Sections never span records. When the next section doesn't
+ *          fit, the record is sent and a new one with the same header
+ *          started; the host joins records by interval number.
+ *          Interval counters are sent as they are (they are deltas by
+ *          nature), running totals as absolute values so that a lost
+ *          record doesn't corrupt later intervals.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef ISTATSRECORD_H
+#define ISTATSRECORD_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#define STATS_VERSION           1
+
+// Counters per STATS_SECTION_RUN section
+#define STATS_RUN_LEN           16
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef enum
+{
+    // packets, no header, retry, protected, more fragments (interval),
+    // max packets, min packets, max deauths, min deauths, total
+    // packets, total no header, duplicates (interval), total
+    // duplicates, MPDUs, A-MPDUs (interval), total MPDUs, total
+    // A-MPDUs, sections dropped for exceeding STATS_SECTION_MAX_LEN
+    // (running total up to the previous interval)
+    STATS_SECTION_SUMMARY       = 1,
+
+    // Slice of a counter array: table (tStatsTable), index of first
+    // counter, up to STATS_RUN_LEN counters. Slices that are all zero
+    // are not sent.
+    STATS_SECTION_RUN           = 2,
+
+    // Distinct devices: interval, max, min, total (estimates)
+    STATS_SECTION_DEVICES       = 3,
+
+    // One per hopped channel: channel, current (0/1), frames, dwell
+    // ms, visits (running totals), rate (frames/s), next dwell ms,
+    // distinct devices, airtime us, utilisation 1/10 % (interval),
+    // retries, duplicates (running totals)
+    STATS_SECTION_CHANNEL       = 4,
+
+    // frames, HT, 40 MHz, short GI, signed RSSI sum, signed p10,
+    // p50, p90 RSSI (interval)
+    STATS_SECTION_SIGNAL        = 5,
+
+    // Station table: active, used, inserted, expired, evicted
+    STATS_SECTION_STATIONS      = 6,
+
+    // One per listed station: MAC, frames, bytes, signed RSSI, age
+    // ms, airtime us, retries, duplicates
+    STATS_SECTION_STATION       = 7,
+
+    // Deauth detector: frames, alarms, tuples replaced, alarms of all
+    // tuples together
+    STATS_SECTION_DEAUTH        = 8,
+
+    // One per ongoing flood: source MAC, BSSID, target MAC, frames in
+    // window, total frames
+    STATS_SECTION_DEAUTH_FLOOD  = 9,
+
+    // Probe requests: total, wildcard, truncated, malformed
+    STATS_SECTION_PROBES        = 10,
+
+    // One per listed SSID: SSID string, truncated (0/1), probes,
+    // distinct stations, MAC of last station
+    STATS_SECTION_PROBE_SSID    = 11,
+
+    // Capture ring: pushed, dropped, high-water (running totals)
+    STATS_SECTION_RING          = 12,
+
+    // Capture filter: evaluated, accepted, programs loaded (running
+    // totals), instructions in active program
+    STATS_SECTION_FILTER        = 13,
+
+    // Access point inventory: frames, malformed, active, inserted,
+    // updated, expired, evicted (running totals but active)
+    STATS_SECTION_APS           = 14,
+
+    // One per access point change since the last report (tApChange):
+    // change type, changed fields, BSSID, SSID string, channel,
+    // security, flags, beacon interval (TU), signed RSSI, ms since
+    // first heard
+    STATS_SECTION_AP_CHANGE     = 15,
+
+    // RX callback timing, CALLBACK_TIMING builds only: calls, ticks
+    // per us, mean, p50, p99 and max ns in the callback, p50 and p99
+    // ns between calls (interval)
+    STATS_SECTION_TIMING        = 16,
+
+    // Flash log, FLASH_LOG builds only: records, dropped, blocks, raw
+    // bytes, stored bytes, erases, errors (running totals), sector
+    // sequence, sectors, most erases of a sector
+    STATS_SECTION_FLASH_LOG     = 17,
+
+    // Airtime: frames, frames of unknown rate, airtime us,
+    // utilisation 1/10 % (interval)
+    STATS_SECTION_AIRTIME       = 18,
+
+    // Beacon detector: beacons, hidden, SSIDs indexed, new SSID/BSSID
+    // pairs, SSIDs replaced, flood, security, channel and BSSID
+    // alarms, alarms dropped (running totals but SSIDs)
+    STATS_SECTION_BEACONS       = 19,
+
+    // Devices behind probe request addresses: estimated devices,
+    // randomised devices, addresses, random addresses, fingerprints
+    // (heard within PROBE_CLUSTER_MAX_AGE_MS), then probes, partial,
+    // malformed, linked, linked by sequence, links undone, devices
+    // evicted, fingerprints replaced (running totals)
+    STATS_SECTION_PROBERS       = 20
+} tStatsSection;
+
+// Counter arrays sent as STATS_SECTION_RUN
+typedef enum
+{
+    STATS_TABLE_CLASSES         = 1,    // Frames per frame class (interval)
+    STATS_TABLE_CLASS_TOTALS    = 2,    // Frames per frame class (total)
+    STATS_TABLE_RSSI            = 3,    // Frames per -dBm (interval)
+    STATS_TABLE_RATES           = 4,    // Legacy frames per rate code (interval)
+    STATS_TABLE_MCS             = 5,    // HT frames per MCS (interval)
+    STATS_TABLE_LATENCY         = 6,    // Callbacks per log2 ticks spent (interval)
+    STATS_TABLE_GAPS            = 7,    // Callbacks per log2 ticks since previous (interval)
+    STATS_TABLE_AIRTIME_CLASSES = 8     // Airtime us per frame class, no header last (interval)
+} tStatsTable;
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Start the statistics of an interval.
+ *
+ * @param  interval   Interval number
+ * @param  uptimeMs   Time at end of interval
+ * @param  intervalMs Interval length
+ */
+void IStatsRecord_Begin( uint32_t interval, uint32_t uptimeMs, uint32_t intervalMs );
+
+/**
+ * Start a section. Fields are added with the Put functions.
+ *
+ * @param  section Section id
+ */
+void IStatsRecord_BeginSection( tStatsSection section );
+
+/**
+ * Add an unsigned varint field to the current section.
+ *
+ * @param  value Field value
+ */
+void IStatsRecord_PutUnsigned( uint64_t value );
+
+/**
+ * Add a signed (zigzag) varint field to the current section.
+ *
+ * @param  value Field value
+ */
+void IStatsRecord_PutSigned( int32_t value );
+
+/**
+ * Add a MAC address field to the current section.
+ *
+ * @param  pMac Address
+ */
+void IStatsRecord_PutMac( const uint8_t* pMac );
+
+/**
+ * Add a string field to the current section.
+ *
+ * @param  pData  String bytes
+ * @param  length Number of bytes
+ */
+void IStatsRecord_PutString( const uint8_t* pData, uint8_t length );
+
+/**
+ * Finish the current section. A section of more than
+ * STATS_SECTION_MAX_LEN bytes is dropped and counted, see
+ * IStatsRecord_End().
+ */
+void IStatsRecord_EndSection( void );
+
+/**
+ * Add a counter array as STATS_SECTION_RUN sections.
+ *
+ * @param  table   Table id
+ * @param  pCounts Counters, element size given by width
+ * @param  width   sizeof() one counter: 2, 4 or 8
+ * @param  count   Number of counters
+ */
+void IStatsRecord_PutTable( tStatsTable table, const void* pCounts, uint8_t width, uint16_t count );
+
+/**
+ * Send what remains of the interval.
+ *
+ * @return Number of sections dropped because they didn't fit.
+ */
+uint8_t IStatsRecord_End( void );
+
+#endif // ISTATSRECORD_H
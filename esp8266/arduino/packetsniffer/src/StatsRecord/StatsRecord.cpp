@@ -0,0 +1,283 @@
+/**
+ * @file    StatsRecord.cpp
+ * @brief   Compact binary encoding of interval statistics.
+ *
+ *          Sections are built in a scratch buffer and moved into the
+ *          record once complete, so a record never has to be undone
+ *          when a section turns out not to fit.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include <StreamOut/IStreamOut.h>
+
+#include "StatsRecord.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    uint8_t  record[ STREAM_MAX_PAYLOAD_LEN ];
+    uint16_t recordLength;
+    uint8_t  headerLength;
+    uint8_t  section[ STATS_SECTION_MAX_LEN ];
+    uint8_t  sectionId;
+    uint8_t  sectionLength;
+    bool     overflow;
+    uint8_t  dropped;
+} tStatsRecordVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static void putByte( uint8_t value );
+static uint8_t encodeVarint( uint8_t* pDst, uint64_t value );
+static uint64_t readCounter( const void* pCounts, uint8_t width, uint16_t index );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tStatsRecordVars statsRecordVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStatsRecord_Begin( uint32_t interval, uint32_t uptimeMs, uint32_t intervalMs )
+{
+    uint8_t* pDst = statsRecordVars.record;
+    *pDst++ = STATS_VERSION;
+    pDst   += encodeVarint( pDst, interval );
+    pDst   += encodeVarint( pDst, uptimeMs );
+    pDst   += encodeVarint( pDst, intervalMs );
+
+    statsRecordVars.headerLength = pDst - statsRecordVars.record;
+    statsRecordVars.recordLength = statsRecordVars.headerLength;
+    statsRecordVars.dropped      = 0;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStatsRecord_BeginSection( tStatsSection section )
+{
+    statsRecordVars.sectionId     = (uint8_t)section;
+    statsRecordVars.sectionLength = 0;
+    statsRecordVars.overflow      = false;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStatsRecord_PutUnsigned( uint64_t value )
+{
+    uint8_t encoded[ 10 ];
+    uint8_t length = encodeVarint( encoded, value );
+    for ( uint8_t i = 0; i < length; ++i )
+    {
+        putByte( encoded[ i ] );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStatsRecord_PutSigned( int32_t value )
+{
+    // Zigzag, small magnitudes of either sign stay short
+    IStatsRecord_PutUnsigned( ( (uint32_t)value << 1 ) ^ (uint32_t)( value >> 31 ) );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStatsRecord_PutMac( const uint8_t* pMac )
+{
+    for ( uint8_t i = 0; i < 6; ++i )
+    {
+        putByte( pMac[ i ] );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStatsRecord_PutString( const uint8_t* pData, uint8_t length )
+{
+    IStatsRecord_PutUnsigned( length );
+    for ( uint8_t i = 0; i < length; ++i )
+    {
+        putByte( pData[ i ] );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStatsRecord_EndSection( void )
+{
+    if ( statsRecordVars.overflow )
+    {
+        ++statsRecordVars.dropped;
+        return;
+    }
+
+    // Start a new record for this interval if the section won't fit
+    uint8_t  length[ STATS_SECTION_HEADER_MAX_LEN - 1 ];
+    uint8_t  lengthBytes = encodeVarint( length, statsRecordVars.sectionLength );
+    uint16_t needed      = 1 + lengthBytes + statsRecordVars.sectionLength;
+    if ( statsRecordVars.recordLength + needed > STREAM_MAX_PAYLOAD_LEN )
+    {
+        IStreamOut_Stats( statsRecordVars.record, statsRecordVars.recordLength );
+        statsRecordVars.recordLength = statsRecordVars.headerLength;
+    }
+
+    uint8_t* pDst = &statsRecordVars.record[ statsRecordVars.recordLength ];
+    *pDst++ = statsRecordVars.sectionId;
+    memcpy( pDst, length, lengthBytes );
+    pDst += lengthBytes;
+    memcpy( pDst, statsRecordVars.section, statsRecordVars.sectionLength );
+    statsRecordVars.recordLength += needed;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStatsRecord_PutTable( tStatsTable table, const void* pCounts, uint8_t width, uint16_t count )
+{
+    for ( uint16_t first = 0; first < count; first += STATS_RUN_LEN )
+    {
+        uint16_t length  = count - first < STATS_RUN_LEN ? count - first : STATS_RUN_LEN;
+        bool     nonZero = false;
+        for ( uint16_t i = 0; i < length && !nonZero; ++i )
+        {
+            nonZero = readCounter( pCounts, width, first + i ) != 0;
+        }
+        if ( !nonZero )
+        {
+            continue;
+        }
+
+        IStatsRecord_BeginSection( STATS_SECTION_RUN );
+        IStatsRecord_PutUnsigned( table );
+        IStatsRecord_PutUnsigned( first );
+        for ( uint16_t i = 0; i < length; ++i )
+        {
+            IStatsRecord_PutUnsigned( readCounter( pCounts, width, first + i ) );
+        }
+        IStatsRecord_EndSection();
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint8_t IStatsRecord_End( void )
+{
+    // Sent even without sections, the host still learns the interval
+    // happened
+    IStreamOut_Stats( statsRecordVars.record, statsRecordVars.recordLength );
+    return statsRecordVars.dropped;
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void putByte( uint8_t value )
+{
+    if ( statsRecordVars.sectionLength >= STATS_SECTION_MAX_LEN )
+    {
+        statsRecordVars.overflow = true;
+        return;
+    }
+    statsRecordVars.section[ statsRecordVars.sectionLength++ ] = value;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint8_t encodeVarint( uint8_t* pDst, uint64_t value )
+{
+    // LEB128, seven bits per byte, least significant first
+    uint8_t length = 0;
+    while ( value >= 0x80 )
+    {
+        pDst[ length++ ] = (uint8_t)( value | 0x80 );
+        value >>= 7;
+    }
+    pDst[ length++ ] = (uint8_t)value;
+    return length;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint64_t readCounter( const void* pCounts, uint8_t width, uint16_t index )
+{
+    switch ( width )
+    {
+        case 2:  return ( (const uint16_t*)pCounts )[ index ];
+        case 4:  return ( (const uint32_t*)pCounts )[ index ];
+        case 8:  return ( (const uint64_t*)pCounts )[ index ];
+        default: return 0;
+    }
+}
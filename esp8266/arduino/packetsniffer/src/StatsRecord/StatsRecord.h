@@ -0,0 +1,51 @@
+/**
+ * @file    StatsRecord.h
+ * @brief   Statistics record encoder private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef STATSRECORD_H
+#define STATSRECORD_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IStatsRecord.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Largest section content, a full run of 32 bit counters fits
+#define STATS_SECTION_MAX_LEN   96
+
+#if STATS_SECTION_MAX_LEN > 255
+#error "STATS_SECTION_MAX_LEN must fit the one byte section length"
+#endif
+
+// Largest record header: version and three 32 bit varints
+#define STATS_HEADER_MAX_LEN    ( 1 + 3 * 5 )
+
+// Section id and the longest varint length
+#define STATS_SECTION_HEADER_MAX_LEN 3
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // STATSRECORD_H
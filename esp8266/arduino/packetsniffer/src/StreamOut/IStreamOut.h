@@ -0,0 +1,133 @@
+/**
+ * @file    IStreamOut.h
+ * @brief   Binary, COBS framed record stream for high rate capture
+ *          output over the UART.
+ *
+ *          Every record is COBS encoded and terminated by a 0x00
+ *          byte, so a reader can resynchronise at any delimiter.
+ *          Decoded record layout (little endian):
+ *
+ *            u8   version (STREAM_VERSION)
+ *            u8   record type (tStreamRecordType)
+ *            u16  sequence number, +1 per record
+ *            ...  payload
+ *            u16  Fletcher-16 over all preceding bytes
+ *
+ *          See tools/snifferstream.py for the host side decoder.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef ISTREAMOUT_H
+#define ISTREAMOUT_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <stdint.h>
+
+#include <CaptureRing/ICaptureRing.h>
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+#define STREAM_VERSION          1
+
+// Largest payload of a single record
+#define STREAM_MAX_PAYLOAD_LEN  250
+
+// STREAM_RECORD_FRAME flags
+#define STREAM_FRAME_FLAG_HT    0x01    // HT (802.11n) PPDU, mcs valid
+#define STREAM_FRAME_FLAG_40MHZ 0x02
+#define STREAM_FRAME_FLAG_SGI   0x04
+#define STREAM_FRAME_FLAG_AMPDU 0x08
+#define STREAM_FRAME_FLAG_GROUP 0x10
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef enum
+{
+    // Captured frame:
+    //   u32 timestamp (us), u16 frame length on air, u16 frames
+    //   dropped on device since previous frame record, i8 rssi,
+    //   u8 channel, u8 rate (rx_ctrl encoding), u8 mcs, u8 flags,
+    //   u8 reserved, frame bytes
+    STREAM_RECORD_FRAME     = 1,
+
+    // Log message: text, not terminated
+    STREAM_RECORD_TEXT      = 2,
+
+    // Interval statistics, see StatsRecord/IStatsRecord.h. One
+    // interval may span several records.
+    STREAM_RECORD_STATS     = 3
+} tStreamRecordType;
+
+// Sink for encoded bytes, e.g. a wrapper around Serial.write()
+typedef void (*tStreamOutWrite)( const uint8_t* pData, uint16_t length );
+
+/**
+ * ------------------------------------------------------------------
+ * Functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * Set output sink and restart sequence numbering.
+ *
+ * @param  pWrite Sink for encoded bytes
+ */
+void IStreamOut_Init( tStreamOutWrite pWrite );
+
+/**
+ * Emit a captured frame record.
+ *
+ * @param  pRecord Record from the capture ring
+ * @param  dropped Frames lost on device since previous call
+ */
+void IStreamOut_Frame( const tCaptureRecord* pRecord, uint16_t dropped );
+
+/**
+ * Encode the payload of a captured frame record without emitting it,
+ * e.g. to store it and emit it later with IStreamOut_FramePayload().
+ *
+ * @param  pRecord  Record from the capture ring
+ * @param  dropped  Frames lost on device since previous frame record
+ * @param  pPayload Output, STREAM_MAX_PAYLOAD_LEN bytes
+ * @return Payload length.
+ */
+uint16_t IStreamOut_EncodeFrame( const tCaptureRecord* pRecord, uint16_t dropped, uint8_t* pPayload );
+
+/**
+ * Emit a captured frame record from a payload encoded earlier.
+ *
+ * @param  pPayload Payload from IStreamOut_EncodeFrame()
+ * @param  length   Payload length
+ */
+void IStreamOut_FramePayload( const uint8_t* pPayload, uint16_t length );
+
+/**
+ * Emit a log message record.
+ *
+ * @param  pText Zero terminated text
+ */
+void IStreamOut_Text( const char* pText );
+
+/**
+ * Emit a statistics record.
+ *
+ * @param  pPayload Encoded statistics
+ * @param  length   Payload length, at most STREAM_MAX_PAYLOAD_LEN
+ */
+void IStreamOut_Stats( const uint8_t* pPayload, uint16_t length );
+
+#endif // ISTREAMOUT_H
@@ -0,0 +1,308 @@
+/**
+ * @file    StreamOut.cpp
+ * @brief   Binary, COBS framed record stream.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+#include <string.h>
+
+#include "StreamOut.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+typedef struct
+{
+    tStreamOutWrite pWrite;
+    uint16_t        sequence;
+    uint8_t         record[ STREAM_MAX_RECORD_LEN ];
+    uint8_t         encoded[ STREAM_MAX_ENCODED_LEN ];
+} tStreamOutVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+static uint8_t* beginRecord( tStreamRecordType type );
+static void endRecord( uint16_t payloadLength );
+static uint16_t cobsEncode( const uint8_t* pIn, uint16_t length, uint8_t* pOut );
+static uint16_t fletcher16( const uint8_t* pData, uint16_t length );
+static uint8_t* put16( uint8_t* pDst, uint16_t value );
+static uint8_t* put32( uint8_t* pDst, uint32_t value );
+
+/**
+ * ------------------------------------------------------------------
+ * Private data
+ * ------------------------------------------------------------------
+ */
+
+static tStreamOutVars streamOutVars;
+
+/**
+ * ------------------------------------------------------------------
+ * Interface implementation
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStreamOut_Init( tStreamOutWrite pWrite )
+{
+    streamOutVars.pWrite   = pWrite;
+    streamOutVars.sequence = 0;
+
+    // Lone delimiter so the reader drops any partial record
+    static const uint8_t delimiter = 0x00;
+    pWrite( &delimiter, 1 );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStreamOut_Frame( const tCaptureRecord* pRecord, uint16_t dropped )
+{
+    uint8_t* pDst = beginRecord( STREAM_RECORD_FRAME );
+    endRecord( IStreamOut_EncodeFrame( pRecord, dropped, pDst ) );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+uint16_t IStreamOut_EncodeFrame( const tCaptureRecord* pRecord, uint16_t dropped, uint8_t* pPayload )
+{
+    const tRxControl* pRx = &pRecord->rxCtrl;
+
+    uint8_t flags = 0;
+    if ( pRx->sig_mode != 0 )
+    {
+        flags |= STREAM_FRAME_FLAG_HT;
+    }
+    if ( pRx->CWB )
+    {
+        flags |= STREAM_FRAME_FLAG_40MHZ;
+    }
+    if ( pRx->SGI )
+    {
+        flags |= STREAM_FRAME_FLAG_SGI;
+    }
+    if ( pRx->Aggregation )
+    {
+        flags |= STREAM_FRAME_FLAG_AMPDU;
+    }
+    if ( pRx->is_group )
+    {
+        flags |= STREAM_FRAME_FLAG_GROUP;
+    }
+
+    uint8_t* pDst = pPayload;
+    pDst    = put32( pDst, pRecord->timestamp );
+    pDst    = put16( pDst, pRecord->length );
+    pDst    = put16( pDst, dropped );
+    *pDst++ = (uint8_t)(int8_t)pRx->rssi;
+    *pDst++ = pRx->channel;
+    *pDst++ = pRx->rate;
+    *pDst++ = pRx->MCS;
+    *pDst++ = flags;
+    *pDst++ = 0;
+
+    uint16_t space    = STREAM_MAX_PAYLOAD_LEN - STREAM_FRAME_META_LEN;
+    uint16_t captured = pRecord->captured < space ? pRecord->captured : space;
+    memcpy( pDst, pRecord->header, captured );
+    pDst += captured;
+
+    return (uint16_t)( pDst - pPayload );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStreamOut_FramePayload( const uint8_t* pPayload, uint16_t length )
+{
+    if ( length > STREAM_MAX_PAYLOAD_LEN )
+    {
+        length = STREAM_MAX_PAYLOAD_LEN;
+    }
+
+    uint8_t* pDst = beginRecord( STREAM_RECORD_FRAME );
+    memcpy( pDst, pPayload, length );
+    endRecord( length );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStreamOut_Text( const char* pText )
+{
+    size_t length = strlen( pText );
+    if ( length > STREAM_MAX_PAYLOAD_LEN )
+    {
+        length = STREAM_MAX_PAYLOAD_LEN;
+    }
+
+    uint8_t* pDst = beginRecord( STREAM_RECORD_TEXT );
+    memcpy( pDst, pText, length );
+    endRecord( length );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+void IStreamOut_Stats( const uint8_t* pPayload, uint16_t length )
+{
+    if ( length > STREAM_MAX_PAYLOAD_LEN )
+    {
+        length = STREAM_MAX_PAYLOAD_LEN;
+    }
+
+    uint8_t* pDst = beginRecord( STREAM_RECORD_STATS );
+    memcpy( pDst, pPayload, length );
+    endRecord( length );
+}
+
+/**
+ * ------------------------------------------------------------------
+ * Private functions
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint8_t* beginRecord( tStreamRecordType type )
+{
+    uint8_t* pDst = streamOutVars.record;
+    *pDst++ = STREAM_VERSION;
+    *pDst++ = (uint8_t)type;
+    pDst    = put16( pDst, streamOutVars.sequence++ );
+    return pDst;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void endRecord( uint16_t payloadLength )
+{
+    uint16_t length = STREAM_RECORD_HEADER_LEN + payloadLength;
+    put16( &streamOutVars.record[ length ], fletcher16( streamOutVars.record, length ) );
+    length += STREAM_RECORD_TRAILER_LEN;
+
+    if ( streamOutVars.pWrite != NULL )
+    {
+        uint16_t encoded = cobsEncode( streamOutVars.record, length, streamOutVars.encoded );
+        streamOutVars.pWrite( streamOutVars.encoded, encoded );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint16_t cobsEncode( const uint8_t* pIn, uint16_t length, uint8_t* pOut )
+{
+    uint8_t* pCode = pOut;
+    uint8_t* pDst  = pOut + 1;
+    uint8_t  code  = 1;
+
+    for ( uint16_t i = 0; i < length; ++i )
+    {
+        if ( pIn[ i ] == 0 )
+        {
+            *pCode = code;
+            pCode  = pDst++;
+            code   = 1;
+        }
+        else
+        {
+            *pDst++ = pIn[ i ];
+            if ( ++code == 0xFF )
+            {
+                *pCode = code;
+                pCode  = pDst++;
+                code   = 1;
+            }
+        }
+    }
+    *pCode  = code;
+    *pDst++ = 0x00;
+
+    return pDst - pOut;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint16_t fletcher16( const uint8_t* pData, uint16_t length )
+{
+    uint16_t sum1 = 0;
+    uint16_t sum2 = 0;
+    for ( uint16_t i = 0; i < length; ++i )
+    {
+        sum1 = ( sum1 + pData[ i ] ) % 255;
+        sum2 = ( sum2 + sum1 ) % 255;
+    }
+    return ( sum2 << 8 ) | sum1;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint8_t* put16( uint8_t* pDst, uint16_t value )
+{
+    pDst[ 0 ] = (uint8_t)( value );
+    pDst[ 1 ] = (uint8_t)( value >> 8 );
+    return pDst + 2;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static uint8_t* put32( uint8_t* pDst, uint32_t value )
+{
+    pDst[ 0 ] = (uint8_t)( value );
+    pDst[ 1 ] = (uint8_t)( value >> 8 );
+    pDst[ 2 ] = (uint8_t)( value >> 16 );
+    pDst[ 3 ] = (uint8_t)( value >> 24 );
+    return pDst + 4;
+}
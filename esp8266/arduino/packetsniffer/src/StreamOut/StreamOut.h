@@ -0,0 +1,53 @@
+/**
+ * @file    StreamOut.h
+ * @brief   Binary record stream private header.
+ *
+ * @author  Simon Lövgren
+ * @license MIT
+ */
+
+#ifndef STREAMOUT_H
+#define STREAMOUT_H
+
+/**
+ * ------------------------------------------------------------------
+ * Includes
+ * ------------------------------------------------------------------
+ */
+
+#include "IStreamOut.h"
+
+/**
+ * ------------------------------------------------------------------
+ * Defines
+ * ------------------------------------------------------------------
+ */
+
+// Version, type, sequence
+#define STREAM_RECORD_HEADER_LEN    4
+
+// Fletcher-16
+#define STREAM_RECORD_TRAILER_LEN   2
+
+// Largest decoded record
+#define STREAM_MAX_RECORD_LEN       ( STREAM_RECORD_HEADER_LEN + STREAM_MAX_PAYLOAD_LEN + STREAM_RECORD_TRAILER_LEN )
+
+// COBS adds one byte per 254 plus the leading code and the delimiter
+#define STREAM_MAX_ENCODED_LEN      ( STREAM_MAX_RECORD_LEN + STREAM_MAX_RECORD_LEN / 254 + 2 )
+
+// Fixed part of STREAM_RECORD_FRAME payload
+#define STREAM_FRAME_META_LEN       14
+
+/**
+ * ------------------------------------------------------------------
+ * Typedefs
+ * ------------------------------------------------------------------
+ */
+
+/**
+ * ------------------------------------------------------------------
+ * Prototypes
+ * ------------------------------------------------------------------
+ */
+
+#endif // STREAMOUT_H
@@ -18,6 +18,31 @@
 #include <Arduino.h>
 #include <ESP8266WiFi.h>
 
+extern "C" {
+#include <user_interface.h>
+}
+
+#include <SnifferBuf/ISnifferBuf.h>
+#include <CaptureRing/ICaptureRing.h>
+#include <FrameClass/IFrameClass.h>
+#include <FrameCounters/IFrameCounters.h>
+#include <ChannelHop/IChannelHop.h>
+#include <StreamOut/IStreamOut.h>
+#include <StationTable/IStationTable.h>
+#include <DeauthDetector/IDeauthDetector.h>
+#include <BeaconDetector/IBeaconDetector.h>
+#include <ProbeSsids/IProbeSsids.h>
+#include <ProbeClusters/IProbeClusters.h>
+#include <DistinctDevices/IDistinctDevices.h>
+#include <RxStats/IRxStats.h>
+#include <Airtime/IAirtime.h>
+#include <StatsRecord/IStatsRecord.h>
+#include <CaptureFilter/ICaptureFilter.h>
+#include <ApInventory/IApInventory.h>
+#include <Oui/IOui.h>
+#include <CallbackTiming/ICallbackTiming.h>
+#include <FlashLog/IFlashLog.h>
+
 /**
  * ------------------------------------------------------------------
  * Defines
@@ -27,17 +52,50 @@
 #define DISABLE 0
 #define ENABLE  1
 
-// Max channel number (US = 11, EU = 13, Japan = 14)
-#define MAX_CHANNEL   13
+// Output modes, select with -DOUTPUT_MODE=... (see platformio.ini)
+#define OUTPUT_TEXT     0       // Human readable tables
+#define OUTPUT_BINARY   1       // COBS framed capture and statistics stream, see tools/
+#define OUTPUT_STATS    2       // COBS framed statistics stream, see tools/
+
+#ifndef OUTPUT_MODE
+#define OUTPUT_MODE     OUTPUT_STATS
+#endif
+
+// UART rate, keeps the time loop() spends writing to a minimum
+#ifndef SERIAL_BAUD
+#if OUTPUT_MODE == OUTPUT_TEXT
+#define SERIAL_BAUD     115200
+#else
+#define SERIAL_BAUD     921600
+#endif
+#endif
+
+// Channels to hop across (US = 1-11, EU = 1-13, Japan = 1-14),
+// a single channel disables hopping
+#define HOP_CHANNELS  { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 }
+
+// How often loop() reports statistics
+#define REPORT_INTERVAL_MS    1000
+
+// Number of busiest stations listed per report
+#define TOP_STATIONS          5
 
-// Channel to set
-#define CHANNEL       1
+// Number of ongoing deauth floods listed per report
+#define TOP_DEAUTH_FLOODS     4
 
-// Deauth alarm level (packet rate per second)
-#define DEAUTH_ALARM_LEVEL    5
+// Number of most probed SSIDs listed per report
+#define TOP_PROBED_SSIDS      PROBE_TOP_K
 
-// How long to sleep in main loop
-#define LOOP_DELAY_MS         1000
+// Most access point changes sent per report, the rest follow with the
+// next one
+#define AP_CHANGES_PER_REPORT 16
+
+// How often a partly filled flash log block is written anyway, bounds
+// what a power cut loses
+#define FLASH_LOG_FLUSH_MS    30000
+
+// Longest serial command: "filter " and a program in hex
+#define COMMAND_MAX_LEN       ( 7 + 2 * FILTER_MAX_INSNS * FILTER_INSN_LEN )
 
 /**
  * ------------------------------------------------------------------
@@ -45,119 +103,6 @@
  * ------------------------------------------------------------------
  */
 
-typedef struct RxControl {
-    signed rssi:8;
-    unsigned rate:4;
-    unsigned is_group:1;
-    unsigned:1;
-    unsigned sig_mode:2;
-    unsigned legacy_length:12;
-    unsigned damatch0:1;
-    unsigned damatch1:1;
-    unsigned bssidmatch0:1;
-    unsigned bssidmatch1:1;
-    unsigned MCS:7;
-    unsigned CWB:1;
-    unsigned HT_length:16;
-    unsigned Smoothing:1;
-    unsigned Not_Sounding:1;
-    unsigned:1;
-    unsigned Aggregation:1;
-    unsigned STBC:2;
-    unsigned FEC_CODING:1;
-    unsigned SGI:1;
-    unsigned rxend_state:8;
-    unsigned ampdu_cnt:8;
-    unsigned channel:4;
-    unsigned:12;
-} tRxControl;
-
-typedef struct Ampdu_Info
-{
-  uint16 length;
-  uint16 seq;
-  uint8  address3[6];
-} tAmpduInfo;
-
-typedef struct sniffer_buf {
-    tRxControl rx_ctrl;
-    uint8_t  buf[36];
-    uint16_t cnt;
-    tAmpduInfo ampdu_info[1];
-} tSnifferBuf;
-
-
-typedef enum{
-    FRAME_TYPE_MANAGEMENT = 0x0,
-    FRAME_TYPE_CONTROL    = 0x1,
-    FRAME_TYPE_DATA       = 0x2,
-    FRAME_TYPE_RESERVED   = 0x3
-} tFrameType;
-
-typedef enum{
-    MANAGEMENT_TYPE_ASSOC_REQ = 0,
-    MANAGEMENT_TYPE_ASSOC_RSP,
-    MANAGEMENT_TYPE_REASSOC_REQ,
-    MANAGEMENT_TYPE_REASSOC_RSP,
-    MANAGEMENT_TYPE_PROBE_REQ,
-    MANAGEMENT_TYPE_PROBE_RSP,
-    // 0110 - 0111 RESERVED
-    MANAGEMENT_TYPE_BEACON = 0x80,
-    MANAGEMENT_TYPE_ATIM,
-    MANAGEMENT_TYPE_DISASSOC,
-    MANAGEMENT_TYPE_AUTHENTICATION,
-    MANAGEMENT_TYPE_DEAUTHENTICATION,
-    MANAGEMENT_TYPE_ACTION
-    // 1110 - 1111 RESERVED
-} tManagementSubType;
-
-typedef enum{
-    // 0000 - 0111 RESERVED
-    CONTROL_TYPE_BLOCK_ACK_REQ = 0x80,
-    CONTROL_TYPE_BLOCK_ACK,
-    CONTROL_TYPE_PS_POLL,
-    CONTROL_TYPE_RTS,
-    CONTROL_TYPE_CTS,
-    CONTROL_TYPE_ACK,
-    CONTROL_TYPE_CF_END,
-    CONTROL_TYPE_CF_END_ACK
-} tControlSubType;
-
-typedef enum{
-    DATA_TYPE_DATA,
-    DATA_TYPE_DATA_CF_ACK,
-    DATA_TYPE_DATA_CF_POLL,
-    DATA_TYPE_DATA_CF_ACK_POLL,
-    DATA_TYPE_NULL,
-    DATA_TYPE_CF_ACK,
-    DATA_TYPE_CF_POLL,
-    DATA_TYPE_CF_ACK_POLL,
-    DATA_TYPE_QOS_DATA,
-    DATA_TYPE_QOS_DATA_CF_ACK,
-    DATA_TYPE_QOS_DATA_CF_POLL,
-    DATA_TYPE_QOS_DATA_CF_ACK_POLL,
-    DATA_TYPE_QOS_NULL,
-    DATA_TYPE_RESERVED,
-    DATA_TYPE_QOS_CF_POLL_NODATA,
-    DATA_TYPE_QOS_CF_ACK_NODATA
-} tDataSubType;
-
-typedef struct
-{
-    uint8_t protocol;
-    uint8_t type;
-    uint8_t subtype;
-    uint8_t toDS;
-    uint8_t fromDS;
-    uint8_t moreFragments;
-    uint8_t retry;
-    uint8_t powerManagement;
-    uint8_t moreData;
-    uint8_t protectedBit;
-    uint8_t order;
-
-} tFrameControl;
-
 /**
  * ------------------------------------------------------------------
  * Prototypes
@@ -165,6 +110,46 @@ typedef struct
  */
 
 static void packetSniffer( uint8_t* buffer, uint16_t length );
+static inline void handleFrame( uint8_t* buffer, uint16_t length );
+static inline void countStation( const tSnifferFrame* pFrame, uint8_t frameClass, uint32_t airtimeUs );
+static void hopChannel( void* pArg );
+static void drainCaptures( void );
+static void sendStatistics( uint32_t nowMs, uint32_t intervalMs, const tFrameCounterBank* pInterval, const tFrameCounterTotals* pTotals, const tDistinctDevicesBank* pDevices, const tRxStatsBank* pRx, const tAirtimeBank* pAirtime );
+static void printStatistics( uint32_t intervalMs, const tFrameCounterBank* pInterval, const tFrameCounterTotals* pTotals, const tDistinctDevicesBank* pDevices, const tRxStatsBank* pRx, const tAirtimeBank* pAirtime );
+static void printSignal( const tRxStatsBank* pRx );
+static void printAirtime( uint32_t intervalMs, const tAirtimeBank* pAirtime );
+static void printChannels( const tDistinctDevicesBank* pDevices, const tAirtimeBank* pAirtime );
+static void printStations( void );
+static void printDeauthFloods( void );
+static void printBeaconDetector( void );
+static void printProbeClusters( void );
+static void printProbedSsids( void );
+#if CALLBACK_TIMING
+static void printTiming( void );
+static void sendTiming( void );
+#endif
+static void reportDeauthAlarms( void );
+static void reportBeaconAlarms( void );
+static void reportApChanges( void );
+static void sendApChanges( uint32_t nowMs );
+#if FLASH_LOG
+static void serviceFlashLog( uint32_t nowMs );
+static void printFlashLog( void );
+static void sendFlashLog( void );
+static void dumpRecord( const uint8_t* pRecord, uint16_t length );
+#endif
+static const char* formatMac( char* pStr, const uint8_t* pMac );
+static const char* formatSsid( char* pStr, const tAccessPoint* pAp );
+static const char* formatSecurity( char* pStr, uint8_t security, uint8_t flags );
+static void printFrameClasses( const tFrameCounterBank* pInterval, const tFrameCounterTotals* pTotals, const tAirtimeBank* pAirtime );
+static const char* formatCount( char* pStr, uint64_t value );
+static void pollCommands( void );
+static void runCommand( const char* pLine );
+static void loadFilter( const char* pHex );
+static void loadDefaultFilter( void );
+static int8_t hexValue( char c );
+static void logText( const char* pText );
+static void writeSerial( const uint8_t* pData, uint16_t length );
 
 /**
  * ------------------------------------------------------------------
@@ -172,15 +157,72 @@ static void packetSniffer( uint8_t* buffer, uint16_t length );
  * ------------------------------------------------------------------
  */
 
-// Packet counters
-static unsigned long packets             = 0;
-static unsigned long deauths             = 0;
-static unsigned long totalPackets        = 0;       // Should probably be long long, but can't be bothered to fix the serial print of it...
-static unsigned long totalDeauths        = 0;       // Should probably be long long, but can't be bothered to fix the serial print of it...
+// Per interval extremes, totals are kept by FrameCounters
 static unsigned long maxPackets          = 0;
 static unsigned long maxDeauths          = 0;
 static unsigned long minPackets          = -1;
 static unsigned long minDeauths          = -1;
+static unsigned long maxDevices          = 0;
+static unsigned long minDevices          = -1;
+static unsigned long droppedSections     = 0;
+
+// Capture ring counters at last report
+static tCaptureRingStats lastRingStats;
+
+#if OUTPUT_MODE == OUTPUT_BINARY || FLASH_LOG
+// Ring drops already passed on with a recorded frame
+static uint32_t recordedDropped = 0;
+#endif
+
+// Channel hopping
+static const uint8_t    hopChannels[] = HOP_CHANNELS;
+static os_timer_t       hopTimer;
+static tChannelHopStats lastChannelStats[ CHANNEL_HOP_MAX_CHANNEL + 1 ];
+
+// Time spent on each channel up to the last report, for utilisation
+static uint32_t lastListenMs[ CHANNEL_HOP_MAX_CHANNEL + 1 ];
+
+// What an AP_CHANGE_UPDATED is about, by AP_FIELD_... bit
+static const char* const apFieldNames[] = {
+    "ssid", "channel", "security", "interval", "flags"
+};
+
+// Time and number of last statistics report
+static uint32_t lastReportMs = 0;
+static uint32_t reportCount  = 0;
+
+#if FLASH_LOG
+// Time of last flash log flush, dump requested over serial
+static uint32_t lastFlushMs = 0;
+static bool     dumping     = false;
+#endif
+
+// Serial command being received
+static char     commandLine[ COMMAND_MAX_LEN + 1 ];
+static uint16_t commandLength   = 0;
+static bool     commandOverflow = false;
+
+// Frames recorded until a filter is loaded
+#if OUTPUT_MODE == OUTPUT_BINARY || FLASH_LOG
+// Everything, the stream or the log is the point
+static const tFilterInsn defaultFilter[] = {
+    { FILTER_OP_RET,  0, 0, UINT16_MAX }
+};
+#else
+// Probe requests, for the probed SSID summary
+static const tFilterInsn defaultFilter[] = {
+    { FILTER_OP_LD_B, 0, 0, 0 },
+    { FILTER_OP_AND,  0, 0, 0xFC },
+    { FILTER_OP_JEQ,  0, 1, 0x40 },
+    { FILTER_OP_RET,  0, 0, UINT16_MAX },
+    { FILTER_OP_RET,  0, 0, 0 }
+};
+#endif
+
+// Why ICaptureFilter_Load() rejected a program, by tFilterLoadResult
+static const char* const filterLoadErrors[] = {
+    "ok", "empty", "too long", "partial instruction", "bad opcode", "jump out of program", "no return at end"
+};
 
 /**
  * ------------------------------------------------------------------
@@ -195,8 +237,35 @@ static unsigned long minDeauths          = -1;
  */
 void setup( void )
 {
-    // Enable serial communication over UART @ 115200 baud
-    Serial.begin( 115200 );
+    // Enable serial communication over UART
+    Serial.begin( SERIAL_BAUD );
+    if ( OUTPUT_MODE != OUTPUT_TEXT )
+    {
+        IStreamOut_Init( writeSerial );
+    }
+
+    // Must be ready before the RX callback is registered
+    ICaptureRing_Init();
+    IFrameCounters_Init();
+    IStationTable_Init();
+    IDeauthDetector_Init();
+    IBeaconDetector_Init();
+    IProbeSsids_Init();
+    IProbeClusters_Init();
+    IDistinctDevices_Init();
+    IRxStats_Init();
+    IAirtime_Init();
+    ICaptureFilter_Init();
+    loadDefaultFilter();
+    IApInventory_Init();
+    IOui_Init();
+#if CALLBACK_TIMING
+    ICallbackTiming_Init();
+#endif
+#if FLASH_LOG
+    // Continues the log left by the previous run
+    IFlashLog_Init();
+#endif
 
     // Set up ESP8266 in promiscuous mode
     wifi_set_opmode( STATION_MODE );
@@ -205,13 +274,25 @@ void setup( void )
     wifi_set_promiscuous_rx_cb( packetSniffer );
     wifi_promiscuous_enable( ENABLE );
 
-    // Currently only sniffing pre-defined channel.
-    // Should rotate through all channels in loop continuously and
-    // use yield() instead of sleep.
-    wifi_set_channel( CHANNEL );
+    // Hop channels from a timer so loop() never has to sleep
+    uint32_t dwellMs;
+    uint8_t  channel = IChannelHop_Init( hopChannels, sizeof( hopChannels ), millis(), &dwellMs );
+    wifi_set_channel( channel );
+    os_timer_disarm( &hopTimer );
+    os_timer_setfn( &hopTimer, hopChannel, NULL );
+    os_timer_arm( &hopTimer, dwellMs, false );
+    lastReportMs = millis();
 
-    // Report setup completed
-    Serial.println( "Setup completed." );
+    // Report setup completed, and what the vendor table costs
+    tOuiStats ouiStats;
+    char      text[ 96 ];
+    IOui_GetStats( &ouiStats );
+    snprintf( text, sizeof( text ), "OUI table: %lu prefixes, %lu vendors, %lu bytes of flash",
+        (unsigned long)ouiStats.entries,
+        (unsigned long)ouiStats.names,
+        (unsigned long)ouiStats.flashBytes );
+    logText( text );
+    logText( "Setup completed." );
 }
 
 /**
@@ -221,13 +302,47 @@ void setup( void )
  */
 void loop( void )
 {
-    delay( LOOP_DELAY_MS );
-    unsigned long currentPackets = packets;
-    unsigned long currentDeauths = deauths;
+    // Filter changes and other requests from the host
+    pollCommands();
+
+    // Output frames queued by the RX callback since last loop
+    drainCaptures();
+
+#if FLASH_LOG
+    // Dump in progress, periodic flush
+    serviceFlashLog( millis() );
+#endif
+
+    // Alarms go out as soon as they are raised, not with the report
+    reportDeauthAlarms();
+    reportBeaconAlarms();
+
+    // Access points that came, changed or went
+    if ( OUTPUT_MODE == OUTPUT_TEXT )
+    {
+        reportApChanges();
+    }
+
+    uint32_t now = millis();
+    if ( now - lastReportMs < REPORT_INTERVAL_MS )
+    {
+        yield();
+        return;
+    }
+    uint32_t intervalMs = now - lastReportMs;
+    lastReportMs = now;
+
+    // Retire the counters the callback has been writing to since last
+    // loop, the callback continues in the other bank meanwhile
+    const tFrameCounterBank*   pInterval = IFrameCounters_Swap();
+    const tFrameCounterTotals* pTotals   = IFrameCounters_GetTotals();
+    const tDistinctDevicesBank* pDevices = IDistinctDevices_Swap();
+    const tRxStatsBank*         pRx      = IRxStats_Swap();
+    const tAirtimeBank*         pAirtime = IAirtime_Swap();
 
-    // Add to total
-    totalPackets += currentPackets;
-    totalDeauths += currentDeauths;
+    unsigned long currentPackets = pInterval->packets;
+    unsigned long currentDeauths = pInterval->classes[ MANAGEMENT_TYPE_DEAUTHENTICATION ];
+    unsigned long currentDevices = IDistinctDevices_Estimate( &pDevices->all );
 
     // Grab max/min
     if ( currentPackets > maxPackets )
@@ -246,28 +361,29 @@ void loop( void )
     {
         minDeauths = currentDeauths;
     }
+    if ( currentDevices > maxDevices )
+    {
+        maxDevices = currentDevices;
+    }
+    if ( currentDevices < minDevices )
+    {
+        minDevices = currentDevices;
+    }
 
-    // Spacing
-    Serial.print( "\n" );
-
-    // Print statistics
-    Serial.print( "           SEEN    MAX     MIN     TOTAL\n" );
-    Serial.print( "           --------------------------------------\n" );
-    Serial.printf( "PACKETS    %-4lu    %-4lu    %-4lu    %lu\n", currentPackets, maxPackets, minPackets, totalPackets );
-    Serial.printf( "DEAUTHS    %-4lu    %-4lu    %-4lu    %lu\n", currentDeauths, maxDeauths, minDeauths, totalDeauths );
+    if ( OUTPUT_MODE == OUTPUT_TEXT )
+    {
+        printStatistics( intervalMs, pInterval, pTotals, pDevices, pRx, pAirtime );
 
-    // Deauth alarm
-    if ( deauths > DEAUTH_ALARM_LEVEL )
+        // For additional spacing
+        Serial.print( "\n" );
+    }
+    else
     {
-        Serial.println("\n[ DEAUTH ALARM ]");
+        sendStatistics( now, intervalMs, pInterval, pTotals, pDevices, pRx, pAirtime );
     }
 
-    // For additional spacing
-    Serial.print( "\n" );
-
-    // Reset counters
-    packets = 0;
-    deauths = 0;
+    // Probe counts fade out over a few intervals
+    IProbeSsids_Decay();
 }
 
 /**
@@ -276,57 +392,1434 @@ void loop( void )
  * ------------------------------------------------------------------
  */
 
-void expandFrameControl( uint8_t frameBytes[2], tFrameControl* pFrameControl )
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline void countStation( const tSnifferFrame* pFrame, uint8_t frameClass, uint32_t airtimeUs )
+{
+    const tRxControl* pRx       = pFrame->pRx;
+    bool              retry     = ( pFrame->pFrame[1] & FRAME_FLAG_RETRY ) != 0;
+    bool              duplicate = false;
+
+    // An A-MPDU counts with all its subframes, the sequence and retry
+    // flag are those of the first
+    if ( IFrameClass_HasTransmitter( frameClass ) && pFrame->captured >= FRAME_ADDR2_OFFSET + 6 )
+    {
+        // Control frames have no sequence control, QoS data numbers
+        // per TID
+        uint8_t  seqSpace = STATION_SEQ_NONE;
+        uint16_t seqCtrl  = 0;
+        if ( FRAME_CLASS_TYPE( frameClass ) != FRAME_TYPE_CONTROL && pFrame->captured >= FRAME_SEQ_CTRL_OFFSET + 2 )
+        {
+            seqSpace = frameClass >= DATA_TYPE_QOS_DATA ? STATION_SEQ_QOS_DATA : STATION_SEQ_MANAGEMENT;
+            seqCtrl  = pFrame->pFrame[ FRAME_SEQ_CTRL_OFFSET ] | ( pFrame->pFrame[ FRAME_SEQ_CTRL_OFFSET + 1 ] << 8 );
+        }
+
+        duplicate = IStationTable_Update( &pFrame->pFrame[ FRAME_ADDR2_OFFSET ], pRx->rssi, pFrame->totalLength, pFrame->mpdus, airtimeUs, seqSpace, seqCtrl, retry, millis() );
+        IDistinctDevices_Count( pRx->channel, &pFrame->pFrame[ FRAME_ADDR2_OFFSET ] );
+    }
+
+    if ( retry )
+    {
+        IChannelHop_CountRetry( pRx->channel, duplicate );
+    }
+    if ( duplicate )
+    {
+        IFrameCounters_CountDuplicate();
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void hopChannel( void* pArg )
 {
-    // First Byte
-    pFrameControl->protocol = ( frameBytes[0] & 0x03 );
-    pFrameControl->type     = ( frameBytes[0] & 0x0C ) >> 2;
-    pFrameControl->subtype  = ( frameBytes[0] & 0xF0 ) >> 4;
+    (void)pArg;
 
-    // Second Byte
-    pFrameControl->toDS                 = ( frameBytes[1] & 0x01 );
-    pFrameControl->fromDS               = ( frameBytes[1] & 0x02 ) >> 1;
-    pFrameControl->moreFragments        = ( frameBytes[1] & 0x04 ) >> 2;
-    pFrameControl->retry                = ( frameBytes[1] & 0x08 ) >> 3;
-    pFrameControl->powerManagement      = ( frameBytes[1] & 0x10 ) >> 4;
-    pFrameControl->moreData             = ( frameBytes[1] & 0x20 ) >> 5;
-    pFrameControl->protectedBit         = ( frameBytes[1] & 0x40 ) >> 6;
-    pFrameControl->order                = ( frameBytes[1] & 0x80 ) >> 7;
+    uint32_t dwellMs;
+    uint8_t  channel = IChannelHop_Next( millis(), &dwellMs );
+    wifi_set_channel( channel );
+    os_timer_arm( &hopTimer, dwellMs, false );
 }
 
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void drainCaptures( void )
+{
+    const tCaptureRecord* pRecord;
+    while ( ( pRecord = ICaptureRing_Peek() ) != NULL )
+    {
+#if OUTPUT_MODE == OUTPUT_BINARY || FLASH_LOG
+        // Frames lost in the ring are reported with the next recorded
+        // frame so the host can account for them
+        tCaptureRingStats ringStats;
+        ICaptureRing_GetStats( &ringStats );
+        uint32_t dropped = ringStats.dropped - recordedDropped;
+        dropped          = dropped > UINT16_MAX ? UINT16_MAX : dropped;
+        recordedDropped += dropped;
+#endif
+#if OUTPUT_MODE == OUTPUT_BINARY
+        IStreamOut_Frame( pRecord, (uint16_t)dropped );
+#endif
+#if FLASH_LOG
+        // Same record as streamed, so a dump reads like a capture stream
+        uint8_t payload[ STREAM_MAX_PAYLOAD_LEN ];
+        IFlashLog_Append( payload, IStreamOut_EncodeFrame( pRecord, (uint16_t)dropped, payload ) );
+#endif
+        // Probe requests are summarised per SSID in the report, and
+        // the devices behind their addresses estimated
+        if ( IFrameClass_Get( pRecord->header[0] ) == MANAGEMENT_TYPE_PROBE_REQ )
+        {
+            IProbeSsids_Count( pRecord->header, pRecord->captured );
+            IProbeClusters_Count( pRecord->header, pRecord->captured, pRecord->length, millis() );
+        }
+        ICaptureRing_Release();
+    }
+}
 
 /**
  * ******************************************************************
  * Function
  * ******************************************************************
  */
-static void packetSniffer( uint8_t* buffer, uint16_t length )
+static void sendStatistics( uint32_t nowMs, uint32_t intervalMs, const tFrameCounterBank* pInterval, const tFrameCounterTotals* pTotals, const tDistinctDevicesBank* pDevices, const tRxStatsBank* pRx, const tAirtimeBank* pAirtime )
 {
-    // Gets called for each packet
-    ++packets;
+    // Same content as printStatistics(), see IStatsRecord.h for the
+    // encoding
+    IStatsRecord_Begin( ++reportCount, nowMs, intervalMs );
+
+    IStatsRecord_BeginSection( STATS_SECTION_SUMMARY );
+    IStatsRecord_PutUnsigned( pInterval->packets );
+    IStatsRecord_PutUnsigned( pInterval->noHeader );
+    IStatsRecord_PutUnsigned( pInterval->retry );
+    IStatsRecord_PutUnsigned( pInterval->protectedFrames );
+    IStatsRecord_PutUnsigned( pInterval->moreFragments );
+    // Counts are 32 bit, so are the unset minimums: 5 byte varints
+    // rather than 10 on a 64 bit host
+    IStatsRecord_PutUnsigned( (uint32_t)maxPackets );
+    IStatsRecord_PutUnsigned( (uint32_t)minPackets );
+    IStatsRecord_PutUnsigned( (uint32_t)maxDeauths );
+    IStatsRecord_PutUnsigned( (uint32_t)minDeauths );
+    IStatsRecord_PutUnsigned( pTotals->packets );
+    IStatsRecord_PutUnsigned( pTotals->noHeader );
+    IStatsRecord_PutUnsigned( pInterval->duplicates );
+    IStatsRecord_PutUnsigned( pTotals->duplicates );
+    IStatsRecord_PutUnsigned( pInterval->mpdus );
+    IStatsRecord_PutUnsigned( pInterval->aggregates );
+    IStatsRecord_PutUnsigned( pTotals->mpdus );
+    IStatsRecord_PutUnsigned( pTotals->aggregates );
+    IStatsRecord_PutUnsigned( droppedSections );
+    IStatsRecord_EndSection();
+    IStatsRecord_PutTable( STATS_TABLE_CLASSES, pInterval->classes, sizeof( pInterval->classes[0] ), FRAME_CLASS_COUNT );
+    IStatsRecord_PutTable( STATS_TABLE_CLASS_TOTALS, pTotals->classes, sizeof( pTotals->classes[0] ), FRAME_CLASS_COUNT );
+
+    IStatsRecord_BeginSection( STATS_SECTION_DEVICES );
+    IStatsRecord_PutUnsigned( IDistinctDevices_Estimate( &pDevices->all ) );
+    IStatsRecord_PutUnsigned( maxDevices );
+    IStatsRecord_PutUnsigned( minDevices );
+    IStatsRecord_PutUnsigned( IDistinctDevices_Estimate( IDistinctDevices_GetTotal() ) );
+    IStatsRecord_EndSection();
+
+    for ( uint8_t i = 0; i < sizeof( hopChannels ); ++i )
+    {
+        uint8_t          channel = hopChannels[ i ];
+        tChannelHopStats stats;
+        if ( !IChannelHop_GetStats( channel, &stats ) )
+        {
+            continue;
+        }
+        uint32_t listenMs = IChannelHop_ListenMs( channel, nowMs );
+        IStatsRecord_BeginSection( STATS_SECTION_CHANNEL );
+        IStatsRecord_PutUnsigned( channel );
+        IStatsRecord_PutUnsigned( channel == IChannelHop_Current() );
+        IStatsRecord_PutUnsigned( stats.frames );
+        IStatsRecord_PutUnsigned( stats.dwellMs );
+        IStatsRecord_PutUnsigned( stats.visits );
+        IStatsRecord_PutUnsigned( stats.rate );
+        IStatsRecord_PutUnsigned( stats.nextDwellMs );
+        IStatsRecord_PutUnsigned( IDistinctDevices_Estimate( &pDevices->channels[ channel ] ) );
+        IStatsRecord_PutUnsigned( pAirtime->channels[ channel ] );
+        IStatsRecord_PutUnsigned( IAirtime_Utilisation( pAirtime->channels[ channel ], listenMs - lastListenMs[ channel ] ) );
+        IStatsRecord_PutUnsigned( stats.retries );
+        IStatsRecord_PutUnsigned( stats.duplicates );
+        IStatsRecord_EndSection();
+        lastListenMs[ channel ] = listenMs;
+    }
+
+    IStatsRecord_BeginSection( STATS_SECTION_AIRTIME );
+    IStatsRecord_PutUnsigned( pAirtime->frames );
+    IStatsRecord_PutUnsigned( pAirtime->unknown );
+    IStatsRecord_PutUnsigned( pAirtime->airtimeUs );
+    IStatsRecord_PutUnsigned( IAirtime_Utilisation( pAirtime->airtimeUs, intervalMs ) );
+    IStatsRecord_EndSection();
+    IStatsRecord_PutTable( STATS_TABLE_AIRTIME_CLASSES, pAirtime->classes, sizeof( pAirtime->classes[0] ), AIRTIME_CLASSES );
+
+    IStatsRecord_BeginSection( STATS_SECTION_SIGNAL );
+    IStatsRecord_PutUnsigned( pRx->frames );
+    IStatsRecord_PutUnsigned( pRx->ht );
+    IStatsRecord_PutUnsigned( pRx->wide );
+    IStatsRecord_PutUnsigned( pRx->shortGi );
+    IStatsRecord_PutSigned( pRx->rssiSum );
+    IStatsRecord_PutSigned( IRxStats_RssiPercentile( pRx, 10 ) );
+    IStatsRecord_PutSigned( IRxStats_RssiPercentile( pRx, 50 ) );
+    IStatsRecord_PutSigned( IRxStats_RssiPercentile( pRx, 90 ) );
+    IStatsRecord_EndSection();
+    IStatsRecord_PutTable( STATS_TABLE_RSSI, pRx->rssi, sizeof( pRx->rssi[0] ), RX_STATS_RSSI_BUCKETS );
+    IStatsRecord_PutTable( STATS_TABLE_RATES, pRx->rates, sizeof( pRx->rates[0] ), RX_STATS_RATE_CODES );
+    IStatsRecord_PutTable( STATS_TABLE_MCS, pRx->mcs, sizeof( pRx->mcs[0] ), RX_STATS_MCS_BUCKETS );
+
+    tStationTableStats stationStats;
+    tStation           stations[ TOP_STATIONS ];
+    IStationTable_GetStats( nowMs, &stationStats );
+    IStatsRecord_BeginSection( STATS_SECTION_STATIONS );
+    IStatsRecord_PutUnsigned( stationStats.active );
+    IStatsRecord_PutUnsigned( stationStats.used );
+    IStatsRecord_PutUnsigned( stationStats.inserted );
+    IStatsRecord_PutUnsigned( stationStats.expired );
+    IStatsRecord_PutUnsigned( stationStats.evicted );
+    IStatsRecord_EndSection();
+    uint8_t count = IStationTable_Top( nowMs, stations, TOP_STATIONS );
+    for ( uint8_t i = 0; i < count; ++i )
+    {
+        IStatsRecord_BeginSection( STATS_SECTION_STATION );
+        IStatsRecord_PutMac( stations[ i ].mac );
+        IStatsRecord_PutUnsigned( stations[ i ].frames );
+        IStatsRecord_PutUnsigned( stations[ i ].bytes );
+        IStatsRecord_PutSigned( stations[ i ].rssiAvg / STATION_RSSI_SCALE );
+        IStatsRecord_PutUnsigned( nowMs - stations[ i ].lastSeenMs );
+        IStatsRecord_PutUnsigned( stations[ i ].airtimeUs );
+        IStatsRecord_PutUnsigned( stations[ i ].retries );
+        IStatsRecord_PutUnsigned( stations[ i ].duplicates );
+        IStatsRecord_EndSection();
+    }
 
-    tSnifferBuf* pBuf = (tSnifferBuf*)buffer;
-    if ( length > 12 )
+    tDeauthDetectorStats deauthStats;
+    tDeauthAlarm         floods[ TOP_DEAUTH_FLOODS ];
+    IDeauthDetector_GetStats( &deauthStats );
+    IStatsRecord_BeginSection( STATS_SECTION_DEAUTH );
+    IStatsRecord_PutUnsigned( deauthStats.frames );
+    IStatsRecord_PutUnsigned( deauthStats.alarms );
+    IStatsRecord_PutUnsigned( deauthStats.replaced );
+    IStatsRecord_PutUnsigned( deauthStats.floods );
+    IStatsRecord_EndSection();
+    count = IDeauthDetector_Active( nowMs, floods, TOP_DEAUTH_FLOODS );
+    for ( uint8_t i = 0; i < count; ++i )
     {
-        // Split out frame control
-        tFrameControl frameControl;
-        expandFrameControl( pBuf->buf, &frameControl );
+        IStatsRecord_BeginSection( STATS_SECTION_DEAUTH_FLOOD );
+        IStatsRecord_PutMac( floods[ i ].source );
+        IStatsRecord_PutMac( floods[ i ].bssid );
+        IStatsRecord_PutMac( floods[ i ].target );
+        IStatsRecord_PutUnsigned( floods[ i ].windowFrames );
+        IStatsRecord_PutUnsigned( floods[ i ].totalFrames );
+        IStatsRecord_EndSection();
+    }
+
+    tBeaconDetectorStats beaconStats;
+    IBeaconDetector_GetStats( &beaconStats );
+    IStatsRecord_BeginSection( STATS_SECTION_BEACONS );
+    IStatsRecord_PutUnsigned( beaconStats.beacons );
+    IStatsRecord_PutUnsigned( beaconStats.hidden );
+    IStatsRecord_PutUnsigned( beaconStats.ssids );
+    IStatsRecord_PutUnsigned( beaconStats.newPairs );
+    IStatsRecord_PutUnsigned( beaconStats.replaced );
+    IStatsRecord_PutUnsigned( beaconStats.floods );
+    IStatsRecord_PutUnsigned( beaconStats.security );
+    IStatsRecord_PutUnsigned( beaconStats.channel );
+    IStatsRecord_PutUnsigned( beaconStats.bssid );
+    IStatsRecord_PutUnsigned( beaconStats.dropped );
+    IStatsRecord_EndSection();
+
+    tProbeClustersStats clusterStats;
+    IProbeClusters_GetStats( nowMs, &clusterStats );
+    IStatsRecord_BeginSection( STATS_SECTION_PROBERS );
+    IStatsRecord_PutUnsigned( clusterStats.devices );
+    IStatsRecord_PutUnsigned( clusterStats.randomised );
+    IStatsRecord_PutUnsigned( clusterStats.addresses );
+    IStatsRecord_PutUnsigned( clusterStats.localAddresses );
+    IStatsRecord_PutUnsigned( clusterStats.fingerprints );
+    IStatsRecord_PutUnsigned( clusterStats.probes );
+    IStatsRecord_PutUnsigned( clusterStats.partial );
+    IStatsRecord_PutUnsigned( clusterStats.malformed );
+    IStatsRecord_PutUnsigned( clusterStats.linked );
+    IStatsRecord_PutUnsigned( clusterStats.bySequence );
+    IStatsRecord_PutUnsigned( clusterStats.undone );
+    IStatsRecord_PutUnsigned( clusterStats.evicted );
+    IStatsRecord_PutUnsigned( clusterStats.replaced );
+    IStatsRecord_EndSection();
+
+    tProbeSsidsStats probeStats;
+    tProbeSsid       ssids[ TOP_PROBED_SSIDS ];
+    IProbeSsids_GetStats( &probeStats );
+    IStatsRecord_BeginSection( STATS_SECTION_PROBES );
+    IStatsRecord_PutUnsigned( probeStats.probes );
+    IStatsRecord_PutUnsigned( probeStats.wildcard );
+    IStatsRecord_PutUnsigned( probeStats.truncated );
+    IStatsRecord_PutUnsigned( probeStats.malformed );
+    IStatsRecord_EndSection();
+    count = IProbeSsids_Top( ssids, TOP_PROBED_SSIDS );
+    for ( uint8_t i = 0; i < count; ++i )
+    {
+        IStatsRecord_BeginSection( STATS_SECTION_PROBE_SSID );
+        IStatsRecord_PutString( ssids[ i ].ssid, ssids[ i ].length );
+        IStatsRecord_PutUnsigned( ssids[ i ].truncated );
+        IStatsRecord_PutUnsigned( ssids[ i ].probes );
+        IStatsRecord_PutUnsigned( ssids[ i ].distinctStations );
+        IStatsRecord_PutMac( ssids[ i ].stations[ ( ssids[ i ].nextStation + PROBE_TOP_STATIONS - 1 ) % PROBE_TOP_STATIONS ] );
+        IStatsRecord_EndSection();
+    }
+
+    sendApChanges( nowMs );
+
+#if CALLBACK_TIMING
+    sendTiming();
+#endif
+
+#if FLASH_LOG
+    sendFlashLog();
+#endif
+
+    tCaptureRingStats ringStats;
+    ICaptureRing_GetStats( &ringStats );
+    IStatsRecord_BeginSection( STATS_SECTION_RING );
+    IStatsRecord_PutUnsigned( ringStats.pushed );
+    IStatsRecord_PutUnsigned( ringStats.dropped );
+    IStatsRecord_PutUnsigned( ringStats.highWater );
+    IStatsRecord_EndSection();
+
+    tCaptureFilterStats filterStats;
+    ICaptureFilter_GetStats( &filterStats );
+    IStatsRecord_BeginSection( STATS_SECTION_FILTER );
+    IStatsRecord_PutUnsigned( filterStats.evaluated );
+    IStatsRecord_PutUnsigned( filterStats.accepted );
+    IStatsRecord_PutUnsigned( filterStats.loaded );
+    IStatsRecord_PutUnsigned( filterStats.insns );
+    IStatsRecord_EndSection();
+
+    // Dropped sections are a bug, a field outgrew the section
+    uint8_t dropped = IStatsRecord_End();
+    if ( dropped > 0 )
+    {
+        char text[ 64 ];
+        droppedSections += dropped;
+        snprintf( text, sizeof( text ), "Statistics: %u sections too long, dropped.", dropped );
+        logText( text );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void printStatistics( uint32_t intervalMs, const tFrameCounterBank* pInterval, const tFrameCounterTotals* pTotals, const tDistinctDevicesBank* pDevices, const tRxStatsBank* pRx, const tAirtimeBank* pAirtime )
+{
+    // Spacing
+    Serial.print( "\n" );
+
+    // Print statistics
+    Serial.print( "           SEEN    MAX     MIN     TOTAL\n" );
+    Serial.print( "           --------------------------------------\n" );
+    char total[ 21 ];
+    Serial.printf( "PACKETS    %-4lu    %-4lu    %-4lu    %s\n", (unsigned long)pInterval->packets, maxPackets, minPackets, formatCount( total, pTotals->packets ) );
+    Serial.printf( "MPDUS      %-4lu                    %s\n", (unsigned long)pInterval->mpdus, formatCount( total, pTotals->mpdus ) );
+    Serial.printf( "DEAUTHS    %-4lu    %-4lu    %-4lu    %s\n", (unsigned long)pInterval->classes[ MANAGEMENT_TYPE_DEAUTHENTICATION ], maxDeauths, minDeauths, formatCount( total, pTotals->classes[ MANAGEMENT_TYPE_DEAUTHENTICATION ] ) );
+    Serial.printf( "DEVICES    %-4lu    %-4lu    %-4lu    ~%lu\n", (unsigned long)IDistinctDevices_Estimate( &pDevices->all ), maxDevices, minDevices, (unsigned long)IDistinctDevices_Estimate( IDistinctDevices_GetTotal() ) );
+
+    // Break down per frame class
+    printFrameClasses( pInterval, pTotals, pAirtime );
+
+    // Link quality
+    printSignal( pRx );
+
+    // How busy the medium is
+    printAirtime( intervalMs, pAirtime );
+
+    // Break down per channel
+    printChannels( pDevices, pAirtime );
 
-        if ( frameControl.type == FRAME_TYPE_MANAGEMENT && frameControl.subtype == MANAGEMENT_TYPE_DEAUTHENTICATION )
+    // Busiest transmitters
+    printStations();
+
+    // Ongoing deauth floods
+    printDeauthFloods();
+
+    // Beacon floods and evil twins, alarms are printed as they happen
+    printBeaconDetector();
+
+    // Devices behind the random addresses of probe requests
+    printProbeClusters();
+
+    // What stations are looking for
+    printProbedSsids();
+
+    // Access points, changes are printed as they happen
+    tApInventoryStats apStats;
+    IApInventory_GetStats( millis(), &apStats );
+    Serial.printf( "\nAPS        active %lu, new %lu, updated %lu, expired %lu, evicted %lu\n",
+        (unsigned long)apStats.active,
+        (unsigned long)apStats.inserted,
+        (unsigned long)apStats.updated,
+        (unsigned long)apStats.expired,
+        (unsigned long)apStats.evicted );
+
+    // Capture ring health
+    tCaptureRingStats ringStats;
+    ICaptureRing_GetStats( &ringStats );
+    Serial.printf( "\nRING       captured %lu, dropped %lu (total %lu), high-water %lu/%u\n",
+        (unsigned long)( ringStats.pushed - lastRingStats.pushed ),
+        (unsigned long)( ringStats.dropped - lastRingStats.dropped ),
+        (unsigned long)ringStats.dropped,
+        (unsigned long)ringStats.highWater,
+        CAPTURE_RING_SLOTS );
+    lastRingStats = ringStats;
+
+#if CALLBACK_TIMING
+    // Time spent in the RX callback
+    printTiming();
+#endif
+
+#if FLASH_LOG
+    // Capture log in flash
+    printFlashLog();
+#endif
+
+    tCaptureFilterStats filterStats;
+    ICaptureFilter_GetStats( &filterStats );
+    Serial.printf( "FILTER     %u instructions, accepted %lu of %lu (total), loaded %lu\n",
+        filterStats.insns,
+        (unsigned long)filterStats.accepted,
+        (unsigned long)filterStats.evaluated,
+        (unsigned long)filterStats.loaded );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void printFrameClasses( const tFrameCounterBank* pInterval, const tFrameCounterTotals* pTotals, const tAirtimeBank* pAirtime )
+{
+    char total[ 21 ];
+
+    Serial.print( "\nFRAME CLASS    SEEN      AIRTIME   TOTAL\n" );
+    Serial.print( "           --------------------------------------\n" );
+    for ( uint8_t frameClass = 0; frameClass < FRAME_CLASS_COUNT; ++frameClass )
+    {
+        // Only classes seen at some point, the full matrix is mostly empty
+        if ( pTotals->classes[ frameClass ] == 0 )
         {
-            ++deauths;
+            continue;
         }
-        else if ( frameControl.type == FRAME_TYPE_MANAGEMENT && frameControl.subtype == MANAGEMENT_TYPE_PROBE_REQ )
+        Serial.printf( "%-14s %-8lu  %-8lu  %s\n",
+            IFrameClass_Name( frameClass ),
+            (unsigned long)pInterval->classes[ frameClass ],
+            (unsigned long)pAirtime->classes[ frameClass ],
+            formatCount( total, pTotals->classes[ frameClass ] ) );
+    }
+    Serial.printf( "%-14s %-8lu  %-8lu  %s\n", "(NO HEADER)", (unsigned long)pInterval->noHeader, (unsigned long)pAirtime->classes[ AIRTIME_CLASS_NO_HEADER ], formatCount( total, pTotals->noHeader ) );
+    Serial.printf( "%-14s %-8lu            %s\n", "(RETRY)",     (unsigned long)pInterval->retry,           formatCount( total, pTotals->retry ) );
+    Serial.printf( "%-14s %-8lu            %s\n", "(A-MPDU)",    (unsigned long)pInterval->aggregates,      formatCount( total, pTotals->aggregates ) );
+    Serial.printf( "%-14s %-8lu            %s\n", "(DUPLICATE)", (unsigned long)pInterval->duplicates,      formatCount( total, pTotals->duplicates ) );
+    Serial.printf( "%-14s %-8lu            %s\n", "(PROTECTED)", (unsigned long)pInterval->protectedFrames, formatCount( total, pTotals->protectedFrames ) );
+    Serial.printf( "%-14s %-8lu            %s\n", "(MOREFRAG)",  (unsigned long)pInterval->moreFragments,   formatCount( total, pTotals->moreFragments ) );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void printSignal( const tRxStatsBank* pRx )
+{
+    if ( pRx->frames == 0 )
+    {
+        Serial.print( "\nSIGNAL     no frames\n" );
+        return;
+    }
+
+    Serial.printf( "\nSIGNAL     mean %d dBm, p10 %d, p50 %d, p90 %d, HT %lu%%, 40MHz %lu%%, SGI %lu%%\n",
+        (int)( pRx->rssiSum / (int32_t)pRx->frames ),
+        IRxStats_RssiPercentile( pRx, 10 ),
+        IRxStats_RssiPercentile( pRx, 50 ),
+        IRxStats_RssiPercentile( pRx, 90 ),
+        (unsigned long)( pRx->ht * 100 / pRx->frames ),
+        (unsigned long)( pRx->wide * 100 / pRx->frames ),
+        (unsigned long)( pRx->ht != 0 ? pRx->shortGi * 100 / pRx->ht : 0 ) );
+
+    // 10 dB bins labelled by their upper edge, the first and last
+    // bins are open ended
+    Serial.print( "RSSI       " );
+    for ( int upper = -100; upper <= -20; upper += 10 )
+    {
+        uint32_t count = 0;
+        for ( uint8_t bucket = 0; bucket < RX_STATS_RSSI_BUCKETS; ++bucket )
         {
-            Serial.println( "Probe request encountered" );
-            Serial.printf( "Data length: %u\n", length );
-            Serial.print( "Data: ");
-            for ( uint8_t i = 0; i < 32; ++i )
+            int dbm = -(int)bucket;
+            if ( ( dbm > upper - 10 || upper == -100 ) && ( dbm <= upper || upper == -20 ) )
             {
-                Serial.printf( "%02X", pBuf->buf[i] );
+                count += pRx->rssi[ bucket ];
             }
-            Serial.print( "\n" );
         }
+        Serial.printf( "%d:%lu ", upper, (unsigned long)count );
+    }
+    Serial.print( "\n" );
+
+    Serial.print( "RATE       " );
+    for ( uint8_t code = 0; code < RX_STATS_RATE_CODES; ++code )
+    {
+        uint8_t rate = IRxStats_LegacyRate( code );
+        if ( pRx->rates[ code ] == 0 || rate == 0 )
+        {
+            continue;
+        }
+        Serial.printf( "%u%sM:%lu ", rate / 2, rate & 1 ? ".5" : "", (unsigned long)pRx->rates[ code ] );
+    }
+    Serial.print( "\n" );
+
+    Serial.print( "MCS        " );
+    for ( uint8_t mcs = 0; mcs < RX_STATS_MCS_BUCKETS; ++mcs )
+    {
+        if ( pRx->mcs[ mcs ] != 0 )
+        {
+            Serial.printf( "%u%s:%lu ", mcs, mcs == RX_STATS_MCS_BUCKETS - 1 ? "+" : "", (unsigned long)pRx->mcs[ mcs ] );
+        }
+    }
+    Serial.print( "\n" );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void printAirtime( uint32_t intervalMs, const tAirtimeBank* pAirtime )
+{
+    uint16_t busy = IAirtime_Utilisation( pAirtime->airtimeUs, intervalMs );
+    Serial.printf( "AIRTIME    %lu us in %lu ms, busy %u.%u%%, %lu frames of unknown rate\n",
+        (unsigned long)pAirtime->airtimeUs,
+        (unsigned long)intervalMs,
+        busy / 10,
+        busy % 10,
+        (unsigned long)pAirtime->unknown );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void printChannels( const tDistinctDevicesBank* pDevices, const tAirtimeBank* pAirtime )
+{
+    Serial.print( "\nCHANNEL    SEEN      UNIQUE    RETRY  DWELL     RATE      NEXT      DEVICES   BUSY\n" );
+    Serial.print( "           --------------------------------------\n" );
+    for ( uint8_t i = 0; i < sizeof( hopChannels ); ++i )
+    {
+        uint8_t          channel = hopChannels[ i ];
+        tChannelHopStats stats;
+        if ( !IChannelHop_GetStats( channel, &stats ) )
+        {
+            continue;
+        }
+
+        // Airtime heard on the channel against time spent listening
+        tChannelHopStats* pLast    = &lastChannelStats[ channel ];
+        uint32_t          listenMs = IChannelHop_ListenMs( channel, millis() );
+        uint16_t          busy     = IAirtime_Utilisation( pAirtime->channels[ channel ], listenMs - lastListenMs[ channel ] );
+        uint32_t          seen     = stats.frames - pLast->frames;
+        uint32_t          retries  = stats.retries - pLast->retries;
+        Serial.printf( "%-2u%-9s%-8lu  %-8lu  %-3lu%%   %-6lums  %-5u/s   %-6ums  %-8lu  %u.%u%%\n",
+            channel,
+            channel == IChannelHop_Current() ? " *" : "",
+            (unsigned long)seen,
+            (unsigned long)( seen - ( stats.duplicates - pLast->duplicates ) ),
+            (unsigned long)( seen != 0 ? (uint64_t)retries * 100 / seen : 0 ),
+            (unsigned long)( stats.dwellMs - pLast->dwellMs ),
+            stats.rate,
+            stats.nextDwellMs,
+            (unsigned long)IDistinctDevices_Estimate( &pDevices->channels[ channel ] ),
+            busy / 10,
+            busy % 10 );
+        *pLast                  = stats;
+        lastListenMs[ channel ] = listenMs;
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void printStations( void )
+{
+    uint32_t           now = millis();
+    tStationTableStats stats;
+    tStation           top[ TOP_STATIONS ];
+
+    IStationTable_GetStats( now, &stats );
+    Serial.printf( "\nSTATIONS   active %lu, slots %lu/%u, new %lu, expired %lu, evicted %lu\n",
+        (unsigned long)stats.active,
+        (unsigned long)stats.used,
+        STATION_TABLE_SLOTS,
+        (unsigned long)stats.inserted,
+        (unsigned long)stats.expired,
+        (unsigned long)stats.evicted );
+
+    uint8_t count = IStationTable_Top( now, top, TOP_STATIONS );
+    if ( count == 0 )
+    {
+        return;
+    }
+    Serial.print( "TRANSMITTER          FRAMES    UNIQUE    RETRY  BYTES       AIRTIME     RSSI   AGE        VENDOR\n" );
+    Serial.print( "           --------------------------------------\n" );
+    for ( uint8_t i = 0; i < count; ++i )
+    {
+        const tStation* pStation = &top[ i ];
+        char            mac[ 18 ];
+        char            vendor[ OUI_NAME_SIZE ];
+        IOui_Lookup( pStation->mac, vendor, sizeof( vendor ) );
+        Serial.printf( "%s    %-8lu  %-8lu  %-3lu%%   %-10lu  %-8lums  %-4d   %-7lums  %s\n",
+            formatMac( mac, pStation->mac ),
+            (unsigned long)pStation->frames,
+            (unsigned long)( pStation->frames - pStation->duplicates ),
+            (unsigned long)( (uint64_t)pStation->retries * 100 / pStation->frames ),
+            (unsigned long)pStation->bytes,
+            (unsigned long)( pStation->airtimeUs / 1000 ),
+            pStation->rssiAvg / STATION_RSSI_SCALE,
+            (unsigned long)( now - pStation->lastSeenMs ),
+            vendor );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void printDeauthFloods( void )
+{
+    tDeauthDetectorStats stats;
+    tDeauthAlarm         floods[ TOP_DEAUTH_FLOODS ];
+
+    IDeauthDetector_GetStats( &stats );
+    uint8_t count = IDeauthDetector_Active( millis(), floods, TOP_DEAUTH_FLOODS );
+    Serial.printf( "\nDEAUTH     floods %u, alarms %lu, spread floods %lu, frames %lu, tuples replaced %lu\n",
+        count,
+        (unsigned long)stats.alarms,
+        (unsigned long)stats.floods,
+        (unsigned long)stats.frames,
+        (unsigned long)stats.replaced );
+    if ( count == 0 )
+    {
+        return;
+    }
+
+    Serial.print( "SOURCE               BSSID                TARGET               WINDOW  TOTAL\n" );
+    Serial.print( "           --------------------------------------\n" );
+    for ( uint8_t i = 0; i < count; ++i )
+    {
+        char source[ 18 ];
+        char bssid[ 18 ];
+        char target[ 18 ];
+        Serial.printf( "%s    %s    %s    %-6u  %lu\n",
+            formatMac( source, floods[ i ].source ),
+            formatMac( bssid, floods[ i ].bssid ),
+            formatMac( target, floods[ i ].target ),
+            floods[ i ].windowFrames,
+            (unsigned long)floods[ i ].totalFrames );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void printBeaconDetector( void )
+{
+    tBeaconDetectorStats stats;
+    IBeaconDetector_GetStats( &stats );
+    Serial.printf( "\nBEACONS    %lu (%lu hidden), SSIDs %lu, new pairs %lu, SSIDs replaced %lu\n",
+        (unsigned long)stats.beacons,
+        (unsigned long)stats.hidden,
+        (unsigned long)stats.ssids,
+        (unsigned long)stats.newPairs,
+        (unsigned long)stats.replaced );
+    Serial.printf( "           alarms: floods %lu, security %lu, channel %lu, BSSID %lu, dropped %lu\n",
+        (unsigned long)stats.floods,
+        (unsigned long)stats.security,
+        (unsigned long)stats.channel,
+        (unsigned long)stats.bssid,
+        (unsigned long)stats.dropped );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void printProbeClusters( void )
+{
+    tProbeClustersStats stats;
+    IProbeClusters_GetStats( millis(), &stats );
+    Serial.printf( "\nPROBERS    ~%lu devices (%lu randomised) using %lu addresses since first heard (%lu random), %lu fingerprints\n",
+        (unsigned long)stats.devices,
+        (unsigned long)stats.randomised,
+        (unsigned long)stats.addresses,
+        (unsigned long)stats.localAddresses,
+        (unsigned long)stats.fingerprints );
+    Serial.printf( "           linked %lu (%lu by sequence, %lu undone), partial %lu, malformed %lu, evicted %lu, replaced %lu\n",
+        (unsigned long)stats.linked,
+        (unsigned long)stats.bySequence,
+        (unsigned long)stats.undone,
+        (unsigned long)stats.partial,
+        (unsigned long)stats.malformed,
+        (unsigned long)stats.evicted,
+        (unsigned long)stats.replaced );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void printProbedSsids( void )
+{
+    tProbeSsidsStats stats;
+    tProbeSsid       top[ TOP_PROBED_SSIDS ];
+
+    IProbeSsids_GetStats( &stats );
+    Serial.printf( "\nPROBES     total %lu, wildcard %lu, truncated %lu, malformed %lu\n",
+        (unsigned long)stats.probes,
+        (unsigned long)stats.wildcard,
+        (unsigned long)stats.truncated,
+        (unsigned long)stats.malformed );
+
+    uint8_t count = IProbeSsids_Top( top, TOP_PROBED_SSIDS );
+    if ( count > 0 )
+    {
+        Serial.print( "SSID                              PROBES    STATIONS  LAST\n" );
+        Serial.print( "           --------------------------------------\n" );
     }
+    for ( uint8_t i = 0; i < count; ++i )
+    {
+        const tProbeSsid* pEntry = &top[ i ];
 
-}
\ No newline at end of file
+        // SSIDs are arbitrary bytes, keep the table readable
+        char ssid[ PROBE_SSID_MAX_LEN + 2 ];
+        for ( uint8_t c = 0; c < pEntry->length; ++c )
+        {
+            ssid[ c ] = ( pEntry->ssid[ c ] >= 0x20 && pEntry->ssid[ c ] < 0x7F ) ? (char)pEntry->ssid[ c ] : '.';
+        }
+        ssid[ pEntry->length ]     = pEntry->truncated ? '~' : '\0';
+        ssid[ pEntry->length + 1 ] = '\0';
+
+        char mac[ 18 ];
+        Serial.printf( "%-32s  %-8lu  %-8u  %s\n",
+            ssid,
+            (unsigned long)pEntry->probes,
+            pEntry->distinctStations,
+            formatMac( mac, pEntry->stations[ ( pEntry->nextStation + PROBE_TOP_STATIONS - 1 ) % PROBE_TOP_STATIONS ] ) );
+    }
+}
+
+#if CALLBACK_TIMING
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void printTiming( void )
+{
+    const tCallbackTimingBank* pTiming = ICallbackTiming_Swap();
+    if ( pTiming->calls == 0 )
+    {
+        Serial.print( "TIMING     no calls\n" );
+        return;
+    }
+
+    Serial.printf( "TIMING     %lu calls, mean %lu ns, p50 %lu, p99 %lu, max %lu; between calls p50 %lu ns, p99 %lu\n",
+        (unsigned long)pTiming->calls,
+        (unsigned long)ICallbackTiming_ToNs( pTiming->totalTicks / pTiming->calls ),
+        (unsigned long)ICallbackTiming_ToNs( ICallbackTiming_Percentile( pTiming->latency, 50 ) ),
+        (unsigned long)ICallbackTiming_ToNs( ICallbackTiming_Percentile( pTiming->latency, 99 ) ),
+        (unsigned long)ICallbackTiming_ToNs( pTiming->maxTicks ),
+        (unsigned long)ICallbackTiming_ToNs( ICallbackTiming_Percentile( pTiming->gaps, 50 ) ),
+        (unsigned long)ICallbackTiming_ToNs( ICallbackTiming_Percentile( pTiming->gaps, 99 ) ) );
+
+    // Calls per log2 bucket, by upper bound
+    Serial.print( "LATENCY   " );
+    for ( uint8_t bucket = 0; bucket < CALLBACK_TIMING_BUCKETS; ++bucket )
+    {
+        if ( pTiming->latency[ bucket ] != 0 )
+        {
+            Serial.printf( " <%luns:%lu",
+                (unsigned long)ICallbackTiming_ToNs( 1ull << bucket ),
+                (unsigned long)pTiming->latency[ bucket ] );
+        }
+    }
+    Serial.print( "\n" );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void sendTiming( void )
+{
+    const tCallbackTimingBank* pTiming = ICallbackTiming_Swap();
+    IStatsRecord_BeginSection( STATS_SECTION_TIMING );
+    IStatsRecord_PutUnsigned( pTiming->calls );
+    IStatsRecord_PutUnsigned( ICallbackTiming_TicksPerUs() );
+    IStatsRecord_PutUnsigned( pTiming->calls ? ICallbackTiming_ToNs( pTiming->totalTicks / pTiming->calls ) : 0 );
+    IStatsRecord_PutUnsigned( ICallbackTiming_ToNs( ICallbackTiming_Percentile( pTiming->latency, 50 ) ) );
+    IStatsRecord_PutUnsigned( ICallbackTiming_ToNs( ICallbackTiming_Percentile( pTiming->latency, 99 ) ) );
+    IStatsRecord_PutUnsigned( ICallbackTiming_ToNs( pTiming->maxTicks ) );
+    IStatsRecord_PutUnsigned( ICallbackTiming_ToNs( ICallbackTiming_Percentile( pTiming->gaps, 50 ) ) );
+    IStatsRecord_PutUnsigned( ICallbackTiming_ToNs( ICallbackTiming_Percentile( pTiming->gaps, 99 ) ) );
+    IStatsRecord_EndSection();
+    IStatsRecord_PutTable( STATS_TABLE_LATENCY, pTiming->latency, sizeof( pTiming->latency[0] ), CALLBACK_TIMING_BUCKETS );
+    IStatsRecord_PutTable( STATS_TABLE_GAPS, pTiming->gaps, sizeof( pTiming->gaps[0] ), CALLBACK_TIMING_BUCKETS );
+}
+#endif
+
+#if FLASH_LOG
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void serviceFlashLog( uint32_t nowMs )
+{
+    // One block per loop, so a dump doesn't hold up the rest
+    if ( dumping && !IFlashLog_DumpNext( dumpRecord ) )
+    {
+        dumping = false;
+
+        tFlashLogStats stats;
+        IFlashLog_GetStats( &stats );
+        char text[ 64 ];
+        snprintf( text, sizeof( text ), "Dump done, %lu records, %lu corrupt blocks.",
+            (unsigned long)stats.dumped,
+            (unsigned long)stats.corrupt );
+        logText( text );
+    }
+
+    if ( nowMs - lastFlushMs >= FLASH_LOG_FLUSH_MS )
+    {
+        IFlashLog_Flush();
+        lastFlushMs = nowMs;
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void printFlashLog( void )
+{
+    tFlashLogStats stats;
+    IFlashLog_GetStats( &stats );
+    if ( stats.sectors == 0 )
+    {
+        Serial.print( "FLASH LOG  no filesystem area in the flash layout\n" );
+        return;
+    }
+
+    Serial.printf( "FLASH LOG  %lu records (dropped %lu), %lu blocks at %lu%% of raw size, sector %lu (%lu in log, %lu erases max), errors %lu\n",
+        (unsigned long)stats.records,
+        (unsigned long)stats.dropped,
+        (unsigned long)stats.blocks,
+        (unsigned long)( stats.rawBytes ? stats.storedBytes * 100 / stats.rawBytes : 0 ),
+        (unsigned long)stats.sequence,
+        (unsigned long)stats.sectors,
+        (unsigned long)stats.maxErases,
+        (unsigned long)stats.errors );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void sendFlashLog( void )
+{
+    tFlashLogStats stats;
+    IFlashLog_GetStats( &stats );
+    IStatsRecord_BeginSection( STATS_SECTION_FLASH_LOG );
+    IStatsRecord_PutUnsigned( stats.records );
+    IStatsRecord_PutUnsigned( stats.dropped );
+    IStatsRecord_PutUnsigned( stats.blocks );
+    IStatsRecord_PutUnsigned( stats.rawBytes );
+    IStatsRecord_PutUnsigned( stats.storedBytes );
+    IStatsRecord_PutUnsigned( stats.erases );
+    IStatsRecord_PutUnsigned( stats.errors );
+    IStatsRecord_PutUnsigned( stats.sequence );
+    IStatsRecord_PutUnsigned( stats.sectors );
+    IStatsRecord_PutUnsigned( stats.maxErases );
+    IStatsRecord_EndSection();
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void dumpRecord( const uint8_t* pRecord, uint16_t length )
+{
+    IStreamOut_FramePayload( pRecord, length );
+}
+#endif
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void reportDeauthAlarms( void )
+{
+    tDeauthAlarm alarm;
+    while ( IDeauthDetector_PollAlarm( &alarm ) )
+    {
+        char source[ 18 ];
+        char bssid[ 18 ];
+        char target[ 18 ];
+        char text[ 128 ];
+        if ( alarm.all )
+        {
+            snprintf( text, sizeof( text ), "[ DEAUTH FLOOD ] %u frames in %ums from all sources",
+                alarm.windowFrames,
+                (unsigned int)DEAUTH_WINDOW_MS );
+            logText( text );
+            continue;
+        }
+        snprintf( text, sizeof( text ), "[ DEAUTH ALARM ] %s -> %s (BSSID %s), %u frames in %ums",
+            formatMac( source, alarm.source ),
+            formatMac( target, alarm.target ),
+            formatMac( bssid, alarm.bssid ),
+            alarm.windowFrames,
+            (unsigned int)DEAUTH_WINDOW_MS );
+        logText( text );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void reportBeaconAlarms( void )
+{
+    tBeaconAlarm alarm;
+    while ( IBeaconDetector_PollAlarm( &alarm ) )
+    {
+        char bssid[ 18 ];
+        char other[ 18 ];
+        char ssid[ AP_SSID_MAX_LEN + 12 ];
+        char security[ 40 ];
+        char text[ 200 ];
+        formatMac( bssid, alarm.heard.bssid );
+        formatMac( other, alarm.other );
+        formatSsid( ssid, &alarm.heard );
+        switch ( alarm.type )
+        {
+            case BEACON_ALARM_FLOOD:
+                snprintf( text, sizeof( text ), "[ BEACON FLOOD ] %u new networks in %ums, last %s %s",
+                    alarm.count,
+                    (unsigned int)BEACON_WINDOW_MS,
+                    bssid,
+                    ssid );
+                break;
+            case BEACON_ALARM_SECURITY:
+            {
+                // Other security is kept masked, coarse but enough
+                char otherSecurity[ 40 ];
+                snprintf( text, sizeof( text ), "[ EVIL TWIN ] %s %s is %s, %s was %s",
+                    bssid,
+                    ssid,
+                    formatSecurity( security, alarm.heard.security, alarm.heard.flags ),
+                    other,
+                    formatSecurity( otherSecurity, alarm.otherSecurity, AP_FLAG_SECURITY_KNOWN ) );
+                break;
+            }
+            case BEACON_ALARM_CHANNEL:
+                snprintf( text, sizeof( text ), "[ EVIL TWIN ] %s %s beacons on ch %u and ch %u",
+                    bssid,
+                    ssid,
+                    alarm.otherChannel,
+                    alarm.heard.channel );
+                break;
+            case BEACON_ALARM_BSSID:
+                snprintf( text, sizeof( text ), "[ BSSID CHANGE ] %s %s ch %u, %s, last heard from %s ch %u",
+                    bssid,
+                    ssid,
+                    alarm.heard.channel,
+                    formatSecurity( security, alarm.heard.security, alarm.heard.flags ),
+                    other,
+                    alarm.otherChannel );
+                break;
+            default:
+                continue;
+        }
+        logText( text );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void reportApChanges( void )
+{
+    tApChange change;
+    while ( IApInventory_PollChange( millis(), &change ) )
+    {
+        const tAccessPoint* pAp = &change.ap;
+        char bssid[ 18 ];
+        char ssid[ AP_SSID_MAX_LEN + 12 ];
+        char text[ 200 ];
+        if ( change.type == AP_CHANGE_GONE )
+        {
+            snprintf( text, sizeof( text ), "[ AP GONE ] %s %s",
+                formatMac( bssid, pAp->bssid ),
+                formatSsid( ssid, pAp ) );
+        }
+        else
+        {
+            char security[ 40 ];
+            char fields[ 48 ] = "";
+            for ( uint8_t i = 0; i < sizeof( apFieldNames ) / sizeof( apFieldNames[0] ); ++i )
+            {
+                if ( change.fields & ( 1 << i ) )
+                {
+                    size_t used = strlen( fields );
+                    snprintf( &fields[ used ], sizeof( fields ) - used, "%s%s", used ? "," : " (", apFieldNames[ i ] );
+                }
+            }
+            if ( fields[0] != '\0' )
+            {
+                strncat( fields, ")", sizeof( fields ) - strlen( fields ) - 1 );
+            }
+            snprintf( text, sizeof( text ), "[ AP %s ] %s %s ch %u, %s, %u TU, %d dBm%s",
+                change.type == AP_CHANGE_NEW ? "NEW" : "UPDATED",
+                formatMac( bssid, pAp->bssid ),
+                formatSsid( ssid, pAp ),
+                pAp->channel,
+                formatSecurity( security, pAp->security, pAp->flags ),
+                pAp->beaconInterval,
+                pAp->rssiAvg / AP_RSSI_SCALE,
+                fields );
+        }
+        logText( text );
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void sendApChanges( uint32_t nowMs )
+{
+    tApInventoryStats apStats;
+    IApInventory_GetStats( nowMs, &apStats );
+    IStatsRecord_BeginSection( STATS_SECTION_APS );
+    IStatsRecord_PutUnsigned( apStats.frames );
+    IStatsRecord_PutUnsigned( apStats.malformed );
+    IStatsRecord_PutUnsigned( apStats.active );
+    IStatsRecord_PutUnsigned( apStats.inserted );
+    IStatsRecord_PutUnsigned( apStats.updated );
+    IStatsRecord_PutUnsigned( apStats.expired );
+    IStatsRecord_PutUnsigned( apStats.evicted );
+    IStatsRecord_EndSection();
+
+    // Only what changed since the last report, the host keeps the list
+    tApChange change;
+    for ( uint8_t i = 0; i < AP_CHANGES_PER_REPORT && IApInventory_PollChange( nowMs, &change ); ++i )
+    {
+        const tAccessPoint* pAp = &change.ap;
+        IStatsRecord_BeginSection( STATS_SECTION_AP_CHANGE );
+        IStatsRecord_PutUnsigned( change.type );
+        IStatsRecord_PutUnsigned( change.fields );
+        IStatsRecord_PutMac( pAp->bssid );
+        IStatsRecord_PutString( pAp->ssid, pAp->ssidLength );
+        IStatsRecord_PutUnsigned( pAp->channel );
+        IStatsRecord_PutUnsigned( pAp->security );
+        IStatsRecord_PutUnsigned( pAp->flags );
+        IStatsRecord_PutUnsigned( pAp->beaconInterval );
+        IStatsRecord_PutSigned( pAp->rssiAvg / AP_RSSI_SCALE );
+        IStatsRecord_PutUnsigned( nowMs - pAp->firstSeenMs );
+        IStatsRecord_EndSection();
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static const char* formatMac( char* pStr, const uint8_t* pMac )
+{
+    // pStr must hold at least 18 characters
+    snprintf( pStr, 18, "%02X:%02X:%02X:%02X:%02X:%02X", pMac[0], pMac[1], pMac[2], pMac[3], pMac[4], pMac[5] );
+    return pStr;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static const char* formatSsid( char* pStr, const tAccessPoint* pAp )
+{
+    // pStr must hold at least AP_SSID_MAX_LEN + 12 characters
+    if ( pAp->ssidLength == 0 )
+    {
+        strcpy( pStr, "<hidden>" );
+        return pStr;
+    }
+
+    char* pEnd = pStr;
+    *pEnd++ = '"';
+    for ( uint8_t i = 0; i < pAp->ssidLength; ++i )
+    {
+        uint8_t c = pAp->ssid[ i ];
+        *pEnd++ = ( c >= 0x20 && c < 0x7F ) ? (char)c : '.';
+    }
+    *pEnd++ = '"';
+    *pEnd   = '\0';
+    if ( pAp->flags & AP_FLAG_HIDDEN )
+    {
+        strcpy( pEnd, " (hidden)" );
+    }
+    return pStr;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static const char* formatSecurity( char* pStr, uint8_t security, uint8_t flags )
+{
+    // pStr must hold at least 40 characters, e.g. "WPA/WPA2/WPA3-PSK+SAE TKIP+CCMP"
+    if ( !( security & ( AP_SECURITY_WPA | AP_SECURITY_RSN ) ) )
+    {
+        strcpy( pStr, !( security & AP_SECURITY_PRIVACY ) ? "open" : ( flags & AP_FLAG_SECURITY_KNOWN ) ? "WEP" : "encrypted" );
+        return pStr;
+    }
+
+    const char* pRsn = "";
+    if ( security & AP_SECURITY_RSN )
+    {
+        pRsn = !( security & AP_SECURITY_SAE ) ? "WPA2" : ( security & AP_SECURITY_PSK ) ? "WPA2/WPA3" : "WPA3";
+    }
+    snprintf( pStr, 40, "%s%s%s%s%s%s%s%s%s%s",
+        ( security & AP_SECURITY_WPA ) ? "WPA" : "",
+        ( security & AP_SECURITY_WPA ) && ( security & AP_SECURITY_RSN ) ? "/" : "",
+        pRsn,
+        ( security & AP_SECURITY_PSK ) ? "-PSK" : "",
+        ( security & AP_SECURITY_SAE ) ? ( ( security & AP_SECURITY_PSK ) ? "+SAE" : "-SAE" ) : "",
+        ( security & AP_SECURITY_EAP ) ? ( ( security & ( AP_SECURITY_PSK | AP_SECURITY_SAE ) ) ? "+EAP" : "-EAP" ) : "",
+        ( security & ( AP_SECURITY_TKIP | AP_SECURITY_CCMP ) ) ? " " : "",
+        ( security & AP_SECURITY_TKIP ) ? "TKIP" : "",
+        ( security & AP_SECURITY_TKIP ) && ( security & AP_SECURITY_CCMP ) ? "+" : "",
+        ( security & AP_SECURITY_CCMP ) ? "CCMP" : "" );
+    return pStr;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static const char* formatCount( char* pStr, uint64_t value )
+{
+    // Serial.printf() can't be trusted with %llu, format by hand.
+    // pStr must hold at least 21 characters.
+    char* pEnd = pStr + 20;
+    *pEnd = '\0';
+    do
+    {
+        *--pEnd = '0' + ( value % 10 );
+        value /= 10;
+    } while ( value != 0 );
+    return pEnd;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void pollCommands( void )
+{
+    // One command per line, lines too long to be a command are dropped
+    while ( Serial.available() > 0 )
+    {
+        int c = Serial.read();
+        if ( c < 0 )
+        {
+            break;
+        }
+        if ( c == '\n' || c == '\r' )
+        {
+            commandLine[ commandLength ] = '\0';
+            if ( commandOverflow )
+            {
+                logText( "Command too long, ignored." );
+            }
+            else if ( commandLength > 0 )
+            {
+                runCommand( commandLine );
+            }
+            commandLength   = 0;
+            commandOverflow = false;
+        }
+        else if ( commandLength < COMMAND_MAX_LEN )
+        {
+            commandLine[ commandLength++ ] = (char)c;
+        }
+        else
+        {
+            commandOverflow = true;
+        }
+    }
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void runCommand( const char* pLine )
+{
+    // filter [program in hex], see tools/snifferfilter.py. Without a
+    // program the default filter is restored.
+    if ( strncmp( pLine, "filter", 6 ) == 0 && ( pLine[ 6 ] == '\0' || pLine[ 6 ] == ' ' ) )
+    {
+        const char* pArgs = &pLine[ 6 ];
+        while ( *pArgs == ' ' )
+        {
+            ++pArgs;
+        }
+        if ( *pArgs == '\0' )
+        {
+            loadDefaultFilter();
+            logText( "Filter reset to default." );
+        }
+        else
+        {
+            loadFilter( pArgs );
+        }
+        return;
+    }
+
+#if FLASH_LOG
+    // dump: read the flash log back as capture stream frame records,
+    // see tools/sniffer2pcap.py
+    if ( strcmp( pLine, "dump" ) == 0 )
+    {
+        if ( OUTPUT_MODE == OUTPUT_TEXT )
+        {
+            logText( "Dump needs a binary output mode." );
+            return;
+        }
+        IFlashLog_DumpStart();
+        dumping = true;
+        return;
+    }
+#endif
+
+    char text[ 64 ];
+    snprintf( text, sizeof( text ), "Unknown command: %.40s", pLine );
+    logText( text );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void loadFilter( const char* pHex )
+{
+    static uint8_t code[ FILTER_MAX_INSNS * FILTER_INSN_LEN ];
+
+    // Length is bounded by COMMAND_MAX_LEN
+    uint16_t length = 0;
+    while ( pHex[ 0 ] != '\0' && pHex[ 0 ] != ' ' )
+    {
+        int8_t high = hexValue( pHex[ 0 ] );
+        int8_t low  = hexValue( pHex[ 1 ] );
+        if ( high < 0 || low < 0 || length >= sizeof( code ) )
+        {
+            logText( "Filter rejected: not a program in hex." );
+            return;
+        }
+        code[ length++ ] = (uint8_t)( ( high << 4 ) | low );
+        pHex += 2;
+    }
+
+    char    text[ 64 ];
+    uint8_t errorAt;
+    tFilterLoadResult result = ICaptureFilter_Load( code, length, &errorAt );
+    if ( result == FILTER_LOAD_OK )
+    {
+        snprintf( text, sizeof( text ), "Filter loaded, %u instructions.", length / FILTER_INSN_LEN );
+    }
+    else
+    {
+        snprintf( text, sizeof( text ), "Filter rejected: %s at instruction %u.", filterLoadErrors[ result ], errorAt );
+    }
+    logText( text );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void loadDefaultFilter( void )
+{
+    ICaptureFilter_LoadInsns( defaultFilter, sizeof( defaultFilter ) / sizeof( defaultFilter[ 0 ] ), NULL );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static int8_t hexValue( char c )
+{
+    if ( c >= '0' && c <= '9' )
+    {
+        return c - '0';
+    }
+    if ( c >= 'a' && c <= 'f' )
+    {
+        return c - 'a' + 10;
+    }
+    if ( c >= 'A' && c <= 'F' )
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void logText( const char* pText )
+{
+#if OUTPUT_MODE == OUTPUT_TEXT
+    Serial.println( pText );
+#else
+    IStreamOut_Text( pText );
+#endif
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void writeSerial( const uint8_t* pData, uint16_t length )
+{
+    Serial.write( pData, length );
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static void packetSniffer( uint8_t* buffer, uint16_t length )
+{
+    // Nothing but a call of handleFrame() unless built with
+    // CALLBACK_TIMING
+    CALLBACK_TIMING_START();
+    handleFrame( buffer, length );
+    CALLBACK_TIMING_STOP();
+}
+
+/**
+ * ******************************************************************
+ * Function
+ * ******************************************************************
+ */
+static inline void handleFrame( uint8_t* buffer, uint16_t length )
+{
+    // Management frames come with 112 bytes, everything else with 36,
+    // told apart by length
+    tSnifferFrame  frame;
+    tSnifferLayout layout = ISnifferBuf_Parse( buffer, length, &frame );
+    if ( layout == SNIFFER_LAYOUT_INVALID )
+    {
+        return;
+    }
+    const tRxControl* pRx = frame.pRx;
+
+    // rx_ctrl knows which channel the frame really arrived on
+    IChannelHop_CountFrame( pRx->channel, frame.mpdus );
+    IRxStats_Count( pRx );
+
+    if ( layout != SNIFFER_LAYOUT_RX_CTRL )
+    {
+        // Type/subtype straight from the first frame control byte
+        uint8_t frameClass = IFrameClass_Get( frame.pFrame[0] );
+        IFrameCounters_Count( frameClass, frame.pFrame[1], frame.mpdus );
+
+        // rx_ctrl's length covers the whole PPDU, A-MPDU framing too
+        uint32_t airtimeUs = IAirtime_Count( pRx, ISnifferBuf_FrameLength( pRx ), frameClass );
+
+        // Per-transmitter statistics and retransmissions
+        countStation( &frame, frameClass, airtimeUs );
+
+        // Both kick stations off the network
+        if ( frameClass == MANAGEMENT_TYPE_DEAUTHENTICATION || frameClass == MANAGEMENT_TYPE_DISASSOC )
+        {
+            IDeauthDetector_Count( frame.pFrame, frame.captured, millis() );
+        }
+
+        // Access points describe themselves in these two
+        if ( frameClass == MANAGEMENT_TYPE_BEACON || frameClass == MANAGEMENT_TYPE_PROBE_RSP )
+        {
+            tAccessPoint heard;
+            uint32_t     nowMs = millis();
+            if ( IApInventory_Update( frame.pFrame, frame.captured, pRx->rssi, pRx->channel, nowMs, &heard )
+              && frameClass == MANAGEMENT_TYPE_BEACON )
+            {
+                // Probe responses answer one station, floods beacon
+                IBeaconDetector_Check( &heard, nowMs );
+            }
+        }
+
+        // What gets recorded, and how much of it, is up to the capture
+        // filter loaded over serial. Statistics above still see every
+        // frame, the probe summaries fed from the ring only what it
+        // passes.
+        uint16_t snapLength = ICaptureFilter_Run( pRx, frame.pFrame, frame.captured );
+        if ( snapLength != 0 )
+        {
+            // Output from here stalls the RX path, leave it to loop()
+            ICaptureRing_Push( pRx, frame.pFrame, snapLength < frame.captured ? snapLength : frame.captured, frame.length, micros() );
+        }
+    }
+    else
+    {
+        // Only RX control, nothing to classify
+        IFrameCounters_CountNoHeader( frame.mpdus );
+        IAirtime_Count( pRx, ISnifferBuf_FrameLength( pRx ), AIRTIME_CLASS_NO_HEADER );
+    }
+}
@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+"""
+@file    beaconsim.py
+@brief   Write the beacons of a neighbourhood of access points, with or
+         without an attack, as a radiotap pcap file, to see which
+         alarms the packet sniffer's beacon detector (src/BeaconDetector)
+         raises on it.
+
+         Write a trace with an open twin of the ESS:
+           beaconsim.py --attack twin -o beacons.pcap
+         Replay it through the host build, hopping as the sniffer does:
+           beaconsim.py --attack twin -o beacons.pcap --replay .pio/build/native/program
+
+         The neighbourhood is an ESS of six access points on channels
+         1, 6 and 11 and --networks networks of one access point spread
+         over channels 1 to 13, a quarter of them open. Every access
+         point beacons every 102.4 ms. --attack starts --attack-at
+         seconds in:
+
+           none    Nothing, no alarm should be raised
+           flood   A tool beacons 1000 random open networks every
+                   200 ms on channel 6 for FLOOD_S seconds, long enough
+                   for the sniffer to hop past: FLOOD
+           twin    Open access points with the ESS's SSID on its
+                   channels, a second 10 s later and a third 35 s
+                   later, after BEACON_REARM_MS: two SECURITY
+           clone   One of the ESS's BSSIDs also beacons on channel 3:
+                   CHANNEL
+           new-ap  New access points join the ESS, on channel 6 and
+                   then on 3, 9 and, 45 s in, 13 which it doesn't use:
+                   two BSSID
+
+         host/Replay.cpp --check-beacons runs the same scenarios with
+         the expected alarm counts and fails on any other.
+
+@author  Simon Lövgren
+@license MIT
+"""
+
+import argparse
+import random
+import struct
+import subprocess
+import sys
+
+LINKTYPE_IEEE802_11_RADIOTAP = 127
+
+# Radiotap header with the channel field only: frequency and flags
+RADIOTAP_PRESENT_CHANNEL = 1 << 3
+RADIOTAP_CHANNEL_2GHZ = 0x0080
+
+BEACON_INTERVAL_S = 0.1024
+BROADCAST = b"\xff" * 6
+
+IE_SSID = 0
+IE_RATES = 1
+IE_DS_PARAMS = 3
+IE_RSN = 48
+
+# WPA2 personal, CCMP
+RSN = bytes([0x01, 0x00, 0x00, 0x0f, 0xac, 0x04, 0x01, 0x00, 0x00, 0x0f, 0xac, 0x04,
+             0x01, 0x00, 0x00, 0x0f, 0xac, 0x02, 0x00, 0x00])
+
+ESS_SSID = b"Campus"
+ESS_CHANNELS = (1, 1, 6, 6, 11, 11)
+
+ATTACKS = ("none", "flood", "twin", "clone", "new-ap")
+
+# Length of the flood, more than one hop cycle
+FLOOD_S = 3
+
+
+def frequency(channel):
+    return 2484 if channel == 14 else 2407 + 5 * channel
+
+
+def radiotap(channel):
+    return struct.pack("<BBHIHH", 0, 0, 12, RADIOTAP_PRESENT_CHANNEL,
+                       frequency(channel), RADIOTAP_CHANNEL_2GHZ)
+
+
+def element(id, data):
+    return bytes([id, len(data)]) + data
+
+
+def beacon(bssid, ssid, channel, rsn):
+    header = struct.pack("<BBH6s6s6sH", 0x80, 0x00, 0, BROADCAST, bssid, bssid, 0)
+    body = struct.pack("<QHH", 0, 100, 0x0411 if rsn else 0x0401)
+    body += element(IE_SSID, ssid) + element(IE_RATES, bytes([0x82, 0x84, 0x8b, 0x96]))
+    body += element(IE_DS_PARAMS, bytes([channel]))
+    if rsn:
+        body += element(IE_RSN, RSN)
+    return header + body
+
+
+def access_points(args):
+    """(bssid, ssid, channel, rsn, start) of every access point."""
+    aps = [(bytes([0x24, 0x0a, 0xc4, 0, 0, i]), ESS_SSID, channel, True, 0.0)
+           for i, channel in enumerate(ESS_CHANNELS)]
+    aps += [(bytes([0x00, 0x17, 0xf2, 0, 1, i]), b"Home-%02d" % i, 1 + i % 13, i % 4 != 0, 0.0)
+            for i in range(args.networks)]
+
+    start = args.attack_at
+    if args.attack == "twin":
+        for i, (channel, delay) in enumerate(((6, 0), (1, 10), (11, 35))):
+            aps.append((bytes([0x02, 0xba, 0xd0, 0, 0, 1 + i]), ESS_SSID, channel, False, start + delay))
+    elif args.attack == "clone":
+        bssid, ssid, _, rsn, _ = aps[2]
+        aps.append((bssid, ssid, 3, rsn, start))
+    elif args.attack == "new-ap":
+        for i, (channel, delay) in enumerate(((6, 0), (3, 10), (9, 20), (13, 45))):
+            aps.append((bytes([0x24, 0x0a, 0xc4, 0, 1, i]), ESS_SSID, channel, True, start + delay))
+    return aps
+
+
+def simulate(args, rng):
+    """(time, channel, frame) of every beacon sent, in order."""
+    frames = []
+    duration = args.minutes * 60.0
+    for bssid, ssid, channel, rsn, start in access_points(args):
+        t = start + rng.uniform(0, BEACON_INTERVAL_S)
+        frame = beacon(bssid, ssid, channel, rsn)
+        while t < duration:
+            frames.append((t, channel, frame))
+            t += BEACON_INTERVAL_S
+
+    if args.attack == "flood":
+        for i in range(int(FLOOD_S / 0.0002)):
+            bssid = bytes([0x02] + [rng.randrange(256) for _ in range(5)])
+            ssid = b"FREE-%05d" % rng.randrange(100000)
+            frames.append((args.attack_at + i * 0.0002, 6, beacon(bssid, ssid, 6, False)))
+
+    frames.sort(key=lambda frame: frame[0])
+    return frames
+
+
+def write_pcap(path, frames):
+    with open(path, "wb") as out:
+        out.write(struct.pack("<IHHiIII", 0xA1B2C3D4, 2, 4, 0, 0, 65535, LINKTYPE_IEEE802_11_RADIOTAP))
+        for t, channel, frame in frames:
+            record = radiotap(channel) + frame
+            out.write(struct.pack("<IIII", int(t), int((t % 1) * 1e6), len(record), len(record)))
+            out.write(record)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("-o", "--output", required=True, help="pcap file to write")
+    parser.add_argument("--attack", choices=ATTACKS, default="none", help="(default %(default)s)")
+    parser.add_argument("--attack-at", type=float, default=70,
+                        help="seconds in, after the detector has learned the ESS (default %(default)s)")
+    parser.add_argument("--networks", type=int, default=48,
+                        help="networks of one access point around the ESS (default %(default)s)")
+    parser.add_argument("--minutes", type=float, default=2, help="trace length (default %(default)s)")
+    parser.add_argument("--seed", type=int, default=1, help="random seed (default %(default)s)")
+    parser.add_argument("--replay", metavar="PROGRAM", help="host replay (text output) to run on the trace")
+    args = parser.parse_args()
+
+    frames = simulate(args, random.Random(args.seed))
+    write_pcap(args.output, frames)
+    print("TRACE      %d beacons from %d access points over %.0f s, attack %s"
+          % (len(frames), len(set(frame[10:16] for _, _, frame in frames)), args.minutes * 60, args.attack))
+    if not args.replay:
+        return 0
+
+    # Only what the sniffer hears on the channel it is tuned to
+    result = subprocess.run([args.replay, "--quiet", "--tuned-only", args.output],
+                            stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                            universal_newlines=True, errors="replace", check=True)
+    # The final report's BEACONS line, the last one, and the alarm totals
+    # under it
+    lines = result.stdout.splitlines()
+    first = max(i for i, line in enumerate(lines) if line.startswith("BEACONS"))
+    print(lines[first])
+    for line in lines[first + 1:]:
+        if not line.startswith(" "):
+            break
+        print(line)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""
+@file    hopsim.py
+@brief   Write synthetic 802.11 traffic spread over the 2.4 GHz channels
+         as a radiotap pcap file, to compare the packet sniffer's fixed
+         and adaptive channel hopping (src/ChannelHop) on it.
+
+         Write a trace:
+           hopsim.py -o traffic.pcap
+         Replay it through the host build with both schedules:
+           hopsim.py -o traffic.pcap --replay .pio/build/native/program
+
+         Every channel with traffic has access points beaconing every
+         102.4 ms and stations sending data frames, a few busy ones
+         and many that are rarely heard. --load sets the frames per
+         second of each channel, beacons included (default: 1, 6 and
+         11 busy, a few quiet channels in between). Frames are sent at
+         random (Poisson) times.
+
+         The replay reports, for fixed and adaptive dwell times, the
+         share of frames and of transmitters the scheduler was tuned
+         in for. Coverage of frames is what adaptive dwells win; quiet
+         channels, visited more briefly, are where they lose
+         transmitters.
+
+@author  Simon Lövgren
+@license MIT
+"""
+
+import argparse
+import random
+import struct
+import subprocess
+import sys
+
+LINKTYPE_IEEE802_11_RADIOTAP = 127
+
+# Radiotap header with the channel field only: frequency and flags
+RADIOTAP_PRESENT_CHANNEL = 1 << 3
+RADIOTAP_CHANNEL_2GHZ = 0x0080
+
+BEACON_INTERVAL_S = 0.1024
+BROADCAST = b"\xff" * 6
+
+# Frames per second of each channel, beacons included
+DEFAULT_LOAD = "1:300,6:800,11:400,3:20,9:15,13:5"
+
+# Access points per this many frames/s of a channel, at least one
+FRAMES_PER_AP = 200
+
+
+def frequency(channel):
+    return 2484 if channel == 14 else 2407 + 5 * channel
+
+
+def radiotap(channel):
+    return struct.pack("<BBHIHH", 0, 0, 12, RADIOTAP_PRESENT_CHANNEL,
+                       frequency(channel), RADIOTAP_CHANNEL_2GHZ)
+
+
+def beacon(bssid, ssid, seq):
+    header = struct.pack("<BBH6s6s6sH", 0x80, 0x00, 0, BROADCAST, bssid, bssid, (seq & 0xfff) << 4)
+    body = struct.pack("<QHH", 0, 100, 0x0401) + bytes([0, len(ssid)]) + ssid
+    return header + body
+
+
+def qos_data(bssid, station, seq):
+    header = struct.pack("<BBH6s6s6sHH", 0x88, 0x01, 0, bssid, station, bssid, (seq & 0xfff) << 4, 0)
+    return header + bytes(32)
+
+
+def parse_load(text):
+    load = {}
+    for part in text.split(","):
+        channel, rate = part.split(":")
+        load[int(channel)] = float(rate)
+    return load
+
+
+def simulate(args, rng):
+    """(time, channel, frame) of every frame sent, in order."""
+    frames = []
+    duration = args.minutes * 60.0
+    for channel, rate in sorted(parse_load(args.load).items()):
+        aps = [bytes([0x00, 0x1a, 0x11, channel, 0x00, i]) for i in range(max(1, int(rate // FRAMES_PER_AP)))]
+        for number, bssid in enumerate(aps):
+            ssid = ("ch%d-net%d" % (channel, number)).encode()
+            t = rng.uniform(0, BEACON_INTERVAL_S)
+            seq = 0
+            while t < duration:
+                frames.append((t, channel, beacon(bssid, ssid, seq)))
+                seq += 1
+                t += BEACON_INTERVAL_S
+
+        # Data shared out Zipf-like, the first station the busiest
+        data_rate = rate - len(aps) / BEACON_INTERVAL_S
+        if data_rate <= 0:
+            continue
+        stations = max(1, int(args.stations * rate / max(parse_load(args.load).values())))
+        weights = [1.0 / (i + 1) for i in range(stations)]
+        total = sum(weights)
+        for i in range(stations):
+            station = bytes([0x00, 0x17, 0xf2, channel, i >> 8, i & 0xff])
+            bssid = aps[i % len(aps)]
+            station_rate = data_rate * weights[i] / total
+            t = rng.expovariate(station_rate)
+            seq = rng.randrange(4096)
+            while t < duration:
+                frames.append((t, channel, qos_data(bssid, station, seq)))
+                seq += 1
+                t += rng.expovariate(station_rate)
+
+    frames.sort(key=lambda frame: frame[0])
+    return frames
+
+
+def write_pcap(path, frames):
+    with open(path, "wb") as out:
+        out.write(struct.pack("<IHHiIII", 0xA1B2C3D4, 2, 4, 0, 0, 65535, LINKTYPE_IEEE802_11_RADIOTAP))
+        for t, channel, frame in frames:
+            record = radiotap(channel) + frame
+            out.write(struct.pack("<IIII", int(t), int((t % 1) * 1e6), len(record), len(record)))
+            out.write(record)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("-o", "--output", required=True, help="pcap file to write")
+    parser.add_argument("--load", default=DEFAULT_LOAD,
+                        help="channel:frames/s,... (default %(default)s)")
+    parser.add_argument("--stations", type=int, default=40,
+                        help="stations on the busiest channel, fewer on the rest (default %(default)s)")
+    parser.add_argument("--minutes", type=float, default=2, help="trace length (default %(default)s)")
+    parser.add_argument("--seed", type=int, default=1, help="random seed (default %(default)s)")
+    parser.add_argument("--replay", metavar="PROGRAM", help="host replay to compare the schedules with")
+    args = parser.parse_args()
+
+    frames = simulate(args, random.Random(args.seed))
+    write_pcap(args.output, frames)
+    channels = sorted(set(channel for _, channel, _ in frames))
+    print("TRACE      %d frames on channels %s over %.0f s"
+          % (len(frames), ",".join(str(c) for c in channels), args.minutes * 60))
+    if not args.replay:
+        return 0
+
+    result = subprocess.run([args.replay, "--quiet", "--compare-hop", args.output],
+                            stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+                            universal_newlines=True, check=True)
+    # The HOP line and the ones indented under it
+    reporting = False
+    for line in result.stderr.splitlines():
+        reporting = line.startswith("HOP") or (reporting and line.startswith(" "))
+        if reporting:
+            print(line)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
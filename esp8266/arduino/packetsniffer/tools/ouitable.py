@@ -0,0 +1,305 @@
+#!/usr/bin/env python3
+"""
+@file    ouitable.py
+@brief   Compile the IEEE OUI list into the packet sniffer's vendor
+         table: a minimal perfect hash over the 24-bit prefixes and a
+         pool of vendor names, each stored once.
+
+         Generate the table (run by the PlatformIO build, see
+         tools/pio_ouitable.py):
+           ouitable.py --output OuiData.h oui.csv
+         Look up vendors on the host, with the device's algorithm:
+           ouitable.py --lookup 24:0a:c4:12:34:56 oui.csv
+         Other host tools look names up in vendor_names(), without
+         building the hash.
+
+         Reads the IEEE MA-L list as CSV (oui.csv) or text (oui.txt),
+         from https://standards-oui.ieee.org/. Without a list the table
+         is empty and every lookup fails. Names are shortened to
+         --name-max characters, legal suffixes (Inc., Co., Ltd. ...)
+         removed, and non-ASCII characters dropped.
+
+         Prefixes hash into buckets of about OUI_BUCKET_LOAD; each
+         bucket gets the first displacement that moves all of its keys
+         to free slots (hash and displace). A lookup is then one
+         displacement, one entry and the name.
+
+@author  Simon Lövgren
+@license MIT
+"""
+
+import argparse
+import csv
+import hashlib
+import re
+import sys
+import unicodedata
+
+# Average prefixes per bucket, displacements cost 2 bytes per bucket
+OUI_BUCKET_LOAD = 4
+
+# Salts tried before giving up, one almost always does
+OUI_SALT_ATTEMPTS = 32
+
+OUI_DISPLACEMENT_MAX = 0xFFFF
+OUI_NAME_MAX = 20
+
+# Flash bytes per displacement and entry, as laid out in src/Oui
+OUI_DISPLACEMENT_SIZE = 2
+OUI_ENTRY_SIZE = 8
+
+GOLDEN = 0x9E3779B9
+MASK32 = 0xFFFFFFFF
+
+LEGAL_SUFFIXES = re.compile(
+    r"[\s,.]+(inc|incorporated|co|corp|corporation|company|ltd|limited|llc|l\.l\.c|"
+    r"gmbh|ag|sa|s\.a|srl|s\.r\.l|spa|s\.p\.a|bv|b\.v|nv|oy|ab|as|a/s|kg|plc|pty|"
+    r"pte|sas|kk|k\.k|co\.?,?\s*ltd)\.?$", re.IGNORECASE)
+HEX_PREFIX = re.compile(r"^\s*([0-9A-Fa-f]{2})-([0-9A-Fa-f]{2})-([0-9A-Fa-f]{2})\s+\(hex\)\s+(.*)$")
+
+
+def mix(x):
+    """32-bit finaliser, as mix() in src/Oui/Oui.cpp."""
+    x ^= x >> 16
+    x = (x * 0x7FEB352D) & MASK32
+    x ^= x >> 15
+    x = (x * 0x846CA68B) & MASK32
+    x ^= x >> 16
+    return x
+
+
+def reduce(h, n):
+    """Map a 32-bit hash onto 0..n-1 without a division."""
+    return (h * n) >> 32
+
+
+def slot_of(h, displacement, n):
+    return reduce(mix((h + displacement * GOLDEN) & MASK32), n)
+
+
+def short_name(name, name_max):
+    name = unicodedata.normalize("NFKD", name).encode("ascii", "ignore").decode("ascii")
+    name = " ".join(name.split())
+    while True:
+        stripped = LEGAL_SUFFIXES.sub("", name).rstrip(" ,.")
+        if stripped == name or not stripped:
+            break
+        name = stripped
+    return name[:name_max].rstrip(" ,.-")
+
+
+def read_ieee(path):
+    """Prefix to organisation name, from oui.csv or oui.txt."""
+    vendors = {}
+    with open(path, encoding="utf-8", errors="replace") as source:
+        first = source.readline()
+        source.seek(0)
+        if first.startswith("Registry,"):
+            for row in csv.DictReader(source):
+                try:
+                    vendors[int(row["Assignment"], 16)] = row["Organization Name"]
+                except (KeyError, ValueError):
+                    continue
+        else:
+            for line in source:
+                match = HEX_PREFIX.match(line)
+                if match:
+                    vendors[int("".join(match.group(1, 2, 3)), 16)] = match.group(4)
+    return vendors
+
+
+def vendor_names(vendors, name_max=OUI_NAME_MAX):
+    """Prefix to name as the device has it."""
+    names = {}
+    for oui, name in vendors.items():
+        short = short_name(name, name_max)
+        if short:
+            names[oui] = short
+    return names
+
+
+def prefix_of(mac):
+    """24-bit prefix of a MAC address (bytes or aa:bb:cc:...), None for
+    locally administered and group addresses, which carry none."""
+    if isinstance(mac, str):
+        mac = bytes(int(part, 16) for part in re.split("[:-]", mac))
+    if mac[0] & 0x03:
+        return None
+    return (mac[0] << 16) | (mac[1] << 8) | mac[2]
+
+
+class OuiTable:
+    """Hash, displacements, entries and name pool as stored on the device."""
+
+    def __init__(self, vendors, name_max=OUI_NAME_MAX):
+        names = vendor_names(vendors, name_max)
+        pool = bytearray()
+        offsets = {}
+        for name in sorted(set(names.values())):
+            offsets[name] = len(pool)
+            pool += name.encode("ascii") + b"\0"
+
+        self.name_max = name_max
+        self.names = len(offsets)
+        self.pool = bytes(pool)
+        self._build(sorted(names), names, offsets)
+
+    def _build(self, keys, names, offsets):
+        n = len(keys)
+        buckets = max(1, (n + OUI_BUCKET_LOAD - 1) // OUI_BUCKET_LOAD)
+        for attempt in range(OUI_SALT_ATTEMPTS):
+            salt = mix(attempt + 1)
+            members = [[] for _ in range(buckets)]
+            for oui in keys:
+                h = mix(oui ^ salt)
+                members[reduce(h, buckets)].append((h, oui))
+
+            displacements = [0] * buckets
+            entries = [None] * n
+            placed = True
+            for bucket in sorted(range(buckets), key=lambda b: -len(members[b])):
+                if members[bucket] and not self._place(members[bucket], bucket, displacements, entries, n):
+                    placed = False
+                    break
+            if placed:
+                self.salt = salt
+                self.displacements = displacements
+                self.entries = [(oui, offsets[names[oui]]) for oui in entries]
+                return
+        raise RuntimeError("no perfect hash after %d salts" % OUI_SALT_ATTEMPTS)
+
+    @staticmethod
+    def _place(bucket_keys, bucket, displacements, entries, n):
+        for displacement in range(OUI_DISPLACEMENT_MAX + 1):
+            slots = [slot_of(h, displacement, n) for h, _ in bucket_keys]
+            if len(set(slots)) == len(slots) and all(entries[s] is None for s in slots):
+                for s, (_, oui) in zip(slots, bucket_keys):
+                    entries[s] = oui
+                displacements[bucket] = displacement
+                return True
+        return False
+
+    def flash_bytes(self):
+        # An empty table is left out of the lookup altogether
+        if not self.entries:
+            return 0
+        return (len(self.displacements) * OUI_DISPLACEMENT_SIZE
+                + len(self.entries) * OUI_ENTRY_SIZE + len(self.pool))
+
+    def lookup(self, mac):
+        """Vendor of a MAC address (bytes or aa:bb:cc:...), or None."""
+        oui = prefix_of(mac)
+        if not self.entries or oui is None:
+            return None
+        h = mix(oui ^ self.salt)
+        displacement = self.displacements[reduce(h, len(self.displacements))]
+        key, offset = self.entries[slot_of(h, displacement, len(self.entries))]
+        if key != oui:
+            return None
+        return self.pool[offset:self.pool.index(b"\0", offset)].decode("ascii")
+
+
+def c_string(pool):
+    """Pool as adjacent C string literals, octal escapes can't run on."""
+    lines = []
+    line = ""
+    for byte in pool[:-1]:
+        if byte == 0:
+            line += "\\0"
+            lines.append(line)
+            line = ""
+        elif byte in (0x22, 0x5C) or byte < 0x20 or byte > 0x7E or byte == 0x3F:
+            line += "\\%03o" % byte
+        else:
+            line += chr(byte)
+    lines.append(line)
+    return "\n".join('    "%s"' % line for line in lines)
+
+
+def write_header(table, out, source, digest):
+    entries = table.entries or [(0, 0)]
+    pool = table.pool or b"\0"
+    out.write("/**\n"
+              " * @file    OuiData.h\n"
+              " * @brief   Vendor table generated by tools/ouitable.py, don't edit.\n"
+              " *\n"
+              " *          %s\n"
+              " *          %d prefixes, %d names, %d bytes of flash.\n"
+              " */\n\n" % (source, len(table.entries), table.names, table.flash_bytes()))
+    out.write("// Source %s\n" % digest)
+    out.write("#define OUI_ENTRIES                 %d\n" % len(table.entries))
+    out.write("#define OUI_BUCKETS                 %d\n" % len(table.displacements))
+    out.write("#define OUI_NAMES                   %d\n" % table.names)
+    out.write("#define OUI_NAME_MAX                %d\n" % table.name_max)
+    out.write("#define OUI_POOL_SIZE               %d\n" % len(pool))
+    out.write("#define OUI_SALT                    0x%08Xu\n\n" % table.salt)
+
+    out.write("static const uint16_t ouiDisplacements[ OUI_BUCKETS ] PROGMEM = {\n")
+    for i in range(0, len(table.displacements), 12):
+        out.write("    %s,\n" % ", ".join("%d" % d for d in table.displacements[i:i + 12]))
+    out.write("};\n\n")
+
+    out.write("static const tOuiEntry ouiEntries[ %s ] PROGMEM = {\n"
+              % ("OUI_ENTRIES" if table.entries else "1"))
+    for i in range(0, len(entries), 4):
+        out.write("    %s,\n" % ", ".join("{ 0x%06X, %d }" % entry for entry in entries[i:i + 4]))
+    out.write("};\n\n")
+
+    out.write("static const char ouiNames[ OUI_POOL_SIZE ] PROGMEM =\n%s;\n" % c_string(pool))
+
+
+def source_digest(path, name_max):
+    digest = hashlib.sha1(("name-max %d\n" % name_max).encode("ascii"))
+    if path is not None:
+        with open(path, "rb") as source:
+            digest.update(source.read())
+    return digest.hexdigest()
+
+
+def generate(path, output, name_max=OUI_NAME_MAX, log=sys.stderr):
+    """Write the table header unless it is up to date. path may be None."""
+    digest = source_digest(path, name_max)
+    try:
+        with open(output) as current:
+            if ("// Source %s\n" % digest) in current.read(1024):
+                return
+    except OSError:
+        pass
+
+    if path is None:
+        table = OuiTable({}, name_max)
+        source = "No IEEE OUI list, empty table."
+    else:
+        table = OuiTable(read_ieee(path), name_max)
+        source = "From %s." % path.replace("\\", "/").split("/")[-1]
+    with open(output, "w") as out:
+        write_header(table, out, source, digest)
+    log.write("OUI table: %d prefixes, %d names, %d bytes of flash "
+              "(displacements %d, entries %d, names %d)\n"
+              % (len(table.entries), table.names, table.flash_bytes(),
+                 len(table.displacements) * OUI_DISPLACEMENT_SIZE,
+                 len(table.entries) * OUI_ENTRY_SIZE, len(table.pool)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("source", nargs="?", help="IEEE OUI list, oui.csv or oui.txt")
+    parser.add_argument("--output", help="table header to write")
+    parser.add_argument("--lookup", action="append", default=[], metavar="MAC",
+                        help="print the vendor of MAC")
+    parser.add_argument("--name-max", type=int, default=OUI_NAME_MAX,
+                        help="longest vendor name kept (default %(default)s)")
+    args = parser.parse_args()
+
+    if args.output:
+        generate(args.source, args.output, args.name_max)
+    if args.lookup:
+        table = OuiTable(read_ieee(args.source) if args.source else {}, args.name_max)
+        for mac in args.lookup:
+            print("%s  %s" % (mac, table.lookup(mac) or "-"))
+    if not args.output and not args.lookup:
+        parser.error("nothing to do, give --output or --lookup")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,35 @@
+"""
+@file    pio_ouitable.py
+@brief   PlatformIO pre-build script generating the vendor table
+         (src/Oui) into the build directory with tools/ouitable.py.
+
+         The IEEE OUI list is read from custom_oui_file in
+         platformio.ini (default oui.csv next to it); without one the
+         table is empty. custom_oui_name_max shortens vendor names,
+         as --name-max. The table's flash footprint is printed when it
+         is generated; it is only generated again when the list or the
+         options change.
+
+@author  Simon Lövgren
+@license MIT
+"""
+
+import os
+import sys
+
+Import("env")  # noqa: F821 (provided by PlatformIO)
+
+project_dir = env.subst("$PROJECT_DIR")  # noqa: F821
+sys.path.insert(0, os.path.join(project_dir, "tools"))
+import ouitable  # noqa: E402
+
+source = os.path.join(project_dir, env.GetProjectOption("custom_oui_file", "oui.csv"))  # noqa: F821
+name_max = int(env.GetProjectOption("custom_oui_name_max", str(ouitable.OUI_NAME_MAX)))  # noqa: F821
+if not os.path.isfile(source):
+    print("OUI table: no %s, vendor names left out" % os.path.relpath(source, project_dir))
+    source = None
+
+output_dir = os.path.join(env.subst("$BUILD_DIR"), "oui")  # noqa: F821
+os.makedirs(output_dir, exist_ok=True)
+ouitable.generate(source, os.path.join(output_dir, "OuiData.h"), name_max, sys.stdout)
+env.Append(CPPPATH=[output_dir])  # noqa: F821
@@ -0,0 +1,257 @@
+#!/usr/bin/env python3
+"""
+@file    probesim.py
+@brief   Simulate phones probing from random addresses and write their
+         probe requests as a pcap file, to see how close the packet
+         sniffer's device estimate (src/ProbeClusters) gets to the
+         devices that were there.
+
+         Write a trace and print what is known about it:
+           probesim.py --devices 80 --minutes 30 -o probes.pcap
+         Replay it through the host build and compare, over ten traces:
+           probesim.py --devices 80 -o probes.pcap --runs 10 --replay .pio/build/native/program
+
+         Devices are drawn from --models device models, a few popular
+         ones taking most of them, and come and go during the trace.
+         A model fixes what goes into the probe requests (elements and
+         their order, rates, HT and extended capabilities, vendor
+         elements) and the address policy: a global address, or a
+         random one changed every scan, every few scans or every few
+         minutes, with sequence numbers that carry on or start over.
+         Models are drawn from small pools, so unrelated models can
+         share a fingerprint as on air. Every scan is heard as one to
+         three probe requests, wildcard or directed.
+
+         The truth is what the sniffer reports on: devices heard within
+         WINDOW_S of the last probe request. Counting the addresses
+         heard in that time is what the estimate has to beat. --replay
+         runs the replay with --bench-probes and puts its estimate next
+         to both; with --runs, over several traces.
+
+@author  Simon Lövgren
+@license MIT
+"""
+
+import argparse
+import random
+import re
+import struct
+import subprocess
+import sys
+
+# Devices heard this long before the end are present, as
+# PROBE_CLUSTER_MAX_AGE_MS in src/ProbeClusters/IProbeClusters.h
+WINDOW_S = 300
+
+LINKTYPE_IEEE802_11 = 105
+
+BROADCAST = b"\xff" * 6
+
+# Element ids
+IE_SSID = 0
+IE_RATES = 1
+IE_DS_PARAMS = 3
+IE_HT_CAPABILITIES = 45
+IE_EXT_RATES = 50
+IE_INTERWORKING = 107
+IE_EXT_CAPABILITIES = 127
+IE_VENDOR = 221
+
+# What models are made of
+RATES = (bytes([0x02, 0x04, 0x0b, 0x16]),
+         bytes([0x02, 0x04, 0x0b, 0x16, 0x0c, 0x12, 0x18, 0x24]),
+         bytes([0x82, 0x84, 0x8b, 0x96, 0x0c, 0x12, 0x18, 0x24]))
+EXT_RATES = (None, bytes([0x30, 0x48, 0x60, 0x6c]))
+HT_INFO = (bytes([0x2d, 0x01, 0x17]), bytes([0xef, 0x01, 0x1b]),
+           bytes([0x6f, 0x00, 0x17]), bytes([0x21, 0x00, 0x03]))
+EXT_CAPABILITIES = (None, bytes([0x00, 0x00, 0x0a]),
+                    bytes([0x00, 0x00, 0x08, 0x04, 0x00, 0x00, 0x00, 0x40]),
+                    bytes([0x04, 0x00, 0x0a, 0x02, 0x01, 0x00, 0x40, 0x80]))
+VENDORS = (None, bytes([0x00, 0x50, 0xf2, 0x08, 0x00, 0x10, 0x00]),
+           bytes([0x00, 0x17, 0xf2, 0x0a, 0x00, 0x01, 0x04]),
+           bytes([0x50, 0x6f, 0x9a, 0x09, 0x02, 0x02, 0x00, 0x25, 0x00]))
+ORDERS = (("rates", "ext_rates", "ds", "ht", "ext_caps", "vendor"),
+          ("rates", "ds", "ext_rates", "ht", "ext_caps", "vendor"),
+          ("rates", "ext_rates", "ht", "ds", "interworking", "ext_caps", "vendor"))
+
+# Address policies: scans between address changes (0 = minutes), share
+ROTATE_EVERY = ((1, 3), (3, 2), (10, 1), (0, 2))
+GLOBAL_SHARE = 0.2
+
+SSIDS = ("home", "eduroam", "Office-5", "FreeWifi", "AndroidAP", "Hotel Guest Network")
+
+
+class Model(object):
+    def __init__(self, rng, number):
+        self.number = number
+        self.rates = rng.choice(RATES)
+        self.ext_rates = rng.choice(EXT_RATES)
+        self.ht = rng.choice(HT_INFO) + bytes(23)
+        self.ext_caps = rng.choice(EXT_CAPABILITIES)
+        self.vendor = rng.choice(VENDORS)
+        self.order = rng.choice(ORDERS)
+        self.randomises = rng.random() >= GLOBAL_SHARE
+        self.rotate_every = rng.choices([r for r, _ in ROTATE_EVERY],
+                                        [w for _, w in ROTATE_EVERY])[0]
+        self.keeps_sequence = rng.random() < 0.5
+
+    def body(self, ssid, channel):
+        elements = {
+            "rates": (IE_RATES, self.rates),
+            "ext_rates": (IE_EXT_RATES, self.ext_rates),
+            "ds": (IE_DS_PARAMS, bytes([channel])),
+            "ht": (IE_HT_CAPABILITIES, self.ht),
+            "ext_caps": (IE_EXT_CAPABILITIES, self.ext_caps),
+            "interworking": (IE_INTERWORKING, bytes([0x02])),
+            "vendor": (IE_VENDOR, self.vendor),
+        }
+        body = bytes([IE_SSID, len(ssid)]) + ssid
+        for name in self.order:
+            element, data = elements[name]
+            if data is not None:
+                body += bytes([element, len(data)]) + data
+        return body
+
+
+class Device(object):
+    def __init__(self, rng, model, arrive, leave):
+        self.rng = rng
+        self.model = model
+        self.arrive = arrive
+        self.leave = leave
+        self.interval = rng.uniform(30, 120)
+        self.ssids = rng.sample(SSIDS, rng.randint(0, 2))
+        self.seq = rng.randrange(4096)
+        self.addresses = []
+        self.last_heard = None
+        if not model.randomises:
+            self.addresses.append(bytes([0x00, 0x1a, 0x11]) + rng.randbytes(3))
+
+    def new_address(self):
+        # Locally administered, not a group address
+        address = bytes([(self.rng.randrange(256) & 0xfc) | 0x02]) + self.rng.randbytes(5)
+        self.addresses.append(address)
+        if not self.model.keeps_sequence:
+            self.seq = self.rng.randrange(4096)
+
+    def probes(self):
+        """(time, frame) of every probe request heard from the device."""
+        t = self.arrive
+        scan = 0
+        changed = t
+        while t < self.leave:
+            if self.model.randomises:
+                every = self.model.rotate_every
+                if not self.addresses or (every and scan % every == 0) \
+                        or (not every and t - changed >= 600):
+                    self.new_address()
+                    changed = t
+            heard = self.rng.randint(1, 3)
+            for i in range(heard):
+                ssid = self.rng.choice(self.ssids).encode() if self.ssids and i > 0 else b""
+                header = struct.pack("<BBH6s6s6sH", 0x40, 0x00, 0, BROADCAST, self.addresses[-1],
+                                     BROADCAST, (self.seq & 0xfff) << 4)
+                yield t + i * 0.02, header + self.model.body(ssid, 1)
+                self.seq += 1
+            self.last_heard = t
+            # Probes on the other channels aren't heard
+            self.seq += self.rng.randint(10, 30)
+            scan += 1
+            t += self.interval * self.rng.uniform(0.8, 1.2)
+
+
+def simulate(args, seed):
+    rng = random.Random(seed)
+    models = [Model(rng, i) for i in range(args.models)]
+    popularity = [1.0 / (i + 1) for i in range(args.models)]
+    duration = args.minutes * 60.0
+    devices = []
+    for _ in range(args.devices):
+        arrive = rng.uniform(0, duration)
+        leave = min(duration, arrive + rng.expovariate(1.0 / (args.stay * 60.0)))
+        devices.append(Device(rng, rng.choices(models, popularity)[0], arrive, leave))
+
+    frames = []
+    for device in devices:
+        frames.extend(device.probes())
+    frames.sort(key=lambda frame: frame[0])
+    return models, devices, frames
+
+
+def write_pcap(path, frames):
+    with open(path, "wb") as out:
+        out.write(struct.pack("<IHHiIII", 0xA1B2C3D4, 2, 4, 0, 0, 65535, LINKTYPE_IEEE802_11))
+        for t, frame in frames:
+            out.write(struct.pack("<IIII", int(t), int((t % 1) * 1e6), len(frame), len(frame)))
+            out.write(frame)
+
+
+def evaluate(args, seed):
+    """Write and replay one trace, (devices, estimate, addresses) or None."""
+    models, devices, frames = simulate(args, seed)
+    if not frames:
+        return None
+    write_pcap(args.output, frames)
+
+    end = frames[-1][0]
+    present = [d for d in devices if d.last_heard is not None and end - d.last_heard <= WINDOW_S]
+    random_present = [d for d in present if d.model.randomises]
+    heard = set(frame[10:16] for t, frame in frames if end - t <= WINDOW_S)
+    fingerprints = len(set(m.body(b"", 1) for m in models))
+    print("TRACE      seed %d: %d probe requests from %d addresses, %d devices of %d models "
+          "(%d fingerprints)"
+          % (seed, len(frames), len(set(frame[10:16] for _, frame in frames)), len(devices),
+             len(models), fingerprints))
+    print("TRUTH      %d devices (%d randomised), %d addresses heard in the last %d s"
+          % (len(present), len(random_present), len(heard), WINDOW_S))
+    if not args.replay:
+        return None
+
+    result = subprocess.run([args.replay, "--quiet", "--bench-probes", args.output],
+                            stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+                            universal_newlines=True, check=True)
+    # The PROBES line and the ones indented under it
+    reporting = False
+    for line in result.stderr.splitlines():
+        reporting = line.startswith("PROBES") or (reporting and line.startswith(" "))
+        if reporting:
+            print(line)
+    match = re.search(r"~(\d+) devices", result.stderr)
+    if not match or not present:
+        return None
+    estimate = int(match.group(1))
+    print("ERROR      estimate %+d devices (%+.1f%%), counting addresses %+d (%+.1f%%)\n"
+          % (estimate - len(present), 100.0 * (estimate - len(present)) / len(present),
+             len(heard) - len(present), 100.0 * (len(heard) - len(present)) / len(present)))
+    return len(present), estimate, len(heard)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("-o", "--output", required=True, help="pcap file to write")
+    parser.add_argument("--devices", type=int, default=60, help="devices (default %(default)s)")
+    parser.add_argument("--models", type=int, default=12, help="device models (default %(default)s)")
+    parser.add_argument("--minutes", type=float, default=20, help="trace length (default %(default)s)")
+    parser.add_argument("--stay", type=float, default=10,
+                        help="mean minutes a device stays (default %(default)s)")
+    parser.add_argument("--seed", type=int, default=1, help="random seed (default %(default)s)")
+    parser.add_argument("--runs", type=int, default=1,
+                        help="traces, seeds counting up from --seed (default %(default)s)")
+    parser.add_argument("--replay", metavar="PROGRAM", help="host replay to run on the trace")
+    args = parser.parse_args()
+
+    results = []
+    for seed in range(args.seed, args.seed + args.runs):
+        result = evaluate(args, seed)
+        if result:
+            results.append(result)
+    if len(results) > 1:
+        present = sum(r[0] for r in results)
+        print("MEAN       %d traces: estimate %+.1f%% (%.1f%% absolute), counting addresses %+.1f%%"
+              % (len(results), 100.0 * sum(r[1] - r[0] for r in results) / present,
+                 100.0 * sum(abs(r[1] - r[0]) for r in results) / present,
+                 100.0 * sum(r[2] - r[0] for r in results) / present))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
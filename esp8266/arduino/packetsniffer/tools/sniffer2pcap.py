@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+@file    sniffer2pcap.py
+@brief   Reassemble the packet sniffer's binary stream into a pcap
+         file (radiotap + 802.11) that opens in Wireshark.
+
+         Read from the device:
+           sniffer2pcap.py --port /dev/ttyUSB0 -o capture.pcap
+         Convert a recorded stream:
+           sniffer2pcap.py --input stream.bin -o capture.pcap
+
+         Device log messages go to stderr. On exit a summary of lost
+         records (sequence gaps on the UART) and frames the device had
+         to drop is printed.
+
+@author  Simon Lövgren
+@license MIT
+"""
+
+import argparse
+import sys
+
+import snifferstream
+
+
+def open_source(args):
+    if args.port:
+        try:
+            import serial
+        except ImportError:
+            sys.exit("Reading from a serial port requires pyserial (pip install pyserial)")
+        return serial.Serial(args.port, args.baud, timeout=0.1)
+    if args.input == "-":
+        return sys.stdin.buffer
+    return open(args.input, "rb")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port of the sniffer")
+    source.add_argument("--input", help="recorded stream file, - for stdin")
+    parser.add_argument("--baud", type=int, default=921600, help="UART rate (default %(default)s)")
+    parser.add_argument("-o", "--output", required=True, help="pcap file to write, - for stdout")
+    args = parser.parse_args()
+
+    source = open_source(args)
+    output = sys.stdout.buffer if args.output == "-" else open(args.output, "wb")
+    decoder = snifferstream.StreamDecoder()
+    writer = snifferstream.PcapWriter(output)
+    frames = 0
+
+    try:
+        while True:
+            data = source.read(4096)
+            if not data:
+                if args.port:
+                    continue
+                break
+            for record in decoder.feed(data):
+                if isinstance(record, snifferstream.FrameRecord):
+                    writer.write(record)
+                    frames += 1
+                elif isinstance(record, snifferstream.TextRecord):
+                    sys.stderr.write("[device] %s\n" % record.text.strip())
+    except KeyboardInterrupt:
+        pass
+    finally:
+        output.flush()
+
+    sys.stderr.write("%d frames written, %d records lost in transit, %d corrupt, "
+                     "%d frames dropped on device\n"
+                     % (frames, decoder.lost, decoder.corrupt, decoder.deviceDropped))
+
+
+if __name__ == "__main__":
+    main()
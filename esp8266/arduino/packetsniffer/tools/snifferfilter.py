@@ -0,0 +1,422 @@
+#!/usr/bin/env python3
+"""
+@file    snifferfilter.py
+@brief   Compile capture filter expressions into the packet sniffer's
+         filter bytecode and load them over serial.
+
+         Load a filter on the device:
+           snifferfilter.py --port /dev/ttyUSB0 'type mgt and not beacon'
+         Restore the device's default filter:
+           snifferfilter.py --port /dev/ttyUSB0 --reset
+         Print the serial command (e.g. for the host replay's
+         --command) or the compiled program:
+           snifferfilter.py 'addr2 24:0a:c4:00:00:00/24'
+           snifferfilter.py -d 'rssi > -70 and (deauth or disassoc)'
+
+         Expressions combine primitives with and, or, not and
+         parentheses (&&, || and ! work too):
+           type mgt|ctl|data        Frame type
+           subtype NAME, NAME       Frame class, e.g. beacon, probe_req,
+                                    deauth, qos_data (see FRAME_CLASS_NAMES)
+           addr1|ra, addr2|ta, addr3 MAC[/BITS]
+                                    Address, optionally only the first
+                                    BITS bits (addr2 24:0a:c4:00:00:00/24)
+           to_ds, from_ds, more_frag, retry, power_mgmt, more_data,
+           protected, order         Frame control flags
+           rssi|channel|length|rate|mcs OP NUMBER
+                                    RX metadata, OP is one of
+                                    == != < <= > >=
+           ht                       Received as HT
+         An empty expression records every frame. --snap limits how
+         many bytes of each recorded frame are kept.
+
+@author  Simon Lövgren
+@license MIT
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+import snifferstream
+
+# ------------------------------------------------------------------
+# Bytecode, keep in sync with src/CaptureFilter/ICaptureFilter.h
+# ------------------------------------------------------------------
+
+FILTER_MAX_INSNS = 64
+
+OP_RET = 0
+OP_LD_IMM = 1
+OP_LD_B = 2
+OP_LD_H = 3
+OP_LD_W = 4
+OP_LD_META = 5
+OP_AND = 6
+OP_RSH = 7
+OP_JA = 8
+OP_JEQ = 9
+OP_JGT = 10
+OP_JGE = 11
+OP_JSET = 12
+OP_JSGT = 13
+OP_JSGE = 14
+
+OP_NAMES = ("ret", "ld", "ldb", "ldh", "ld", "ld", "and", "rsh",
+            "ja", "jeq", "jgt", "jge", "jset", "jsgt", "jsge")
+JUMP_OPS = (OP_JEQ, OP_JGT, OP_JGE, OP_JSET, OP_JSGT, OP_JSGE)
+
+META_FIELDS = {"rssi": 0, "channel": 1, "length": 2, "rate": 3, "mcs": 4}
+META_HT = 5
+META_NAMES = ("rssi", "channel", "length", "rate", "mcs", "ht")
+META_SIGNED = ("rssi",)
+
+_INSN = struct.Struct("<BBBxI")
+
+# ------------------------------------------------------------------
+# 802.11 header
+# ------------------------------------------------------------------
+
+FRAME_TYPES = {"mgt": 0, "ctl": 1, "data": 2}
+
+ADDRESS_OFFSETS = {"addr1": 4, "ra": 4, "addr2": 10, "ta": 10, "addr3": 16}
+
+FLAGS = {
+    "to_ds": 0x01, "from_ds": 0x02, "more_frag": 0x04, "retry": 0x08,
+    "power_mgmt": 0x10, "more_data": 0x20, "protected": 0x40, "order": 0x80,
+}
+
+# Frame class name (lower case) to frame class id, reserved types left out
+FRAME_CLASSES = dict((name.lower(), frameClass)
+                     for frameClass, name in enumerate(snifferstream.FRAME_CLASS_NAMES[:48]))
+
+COMPARISONS = ("==", "=", "!=", "<=", ">=", "<", ">")
+
+_TOKEN = re.compile(r"\s*(&&|\|\||==|!=|<=|>=|[()!<>=]|[^\s()!<>=&|]+)")
+
+
+class FilterError(Exception):
+    pass
+
+
+# ------------------------------------------------------------------
+# Parser, expression to tree of tuples
+# ------------------------------------------------------------------
+
+class Parser(object):
+
+    def __init__(self, text):
+        self.tokens = []
+        position = 0
+        text = text.strip()
+        while position < len(text):
+            match = _TOKEN.match(text, position)
+            if not match:
+                raise FilterError("can't parse '%s'" % text[position:])
+            self.tokens.append(match.group(1))
+            position = match.end()
+        self.index = 0
+
+    def parse(self):
+        if not self.tokens:
+            return ("true",)
+        node = self.parse_or()
+        if self.index != len(self.tokens):
+            raise FilterError("unexpected '%s'" % self.tokens[self.index])
+        return node
+
+    def peek(self):
+        return self.tokens[self.index].lower() if self.index < len(self.tokens) else None
+
+    def next(self, what):
+        if self.index >= len(self.tokens):
+            raise FilterError("expected %s at end of expression" % what)
+        self.index += 1
+        return self.tokens[self.index - 1]
+
+    def parse_or(self):
+        node = self.parse_and()
+        while self.peek() in ("or", "||"):
+            self.index += 1
+            node = ("or", node, self.parse_and())
+        return node
+
+    def parse_and(self):
+        node = self.parse_not()
+        while self.peek() in ("and", "&&"):
+            self.index += 1
+            node = ("and", node, self.parse_not())
+        return node
+
+    def parse_not(self):
+        token = self.peek()
+        if token in ("not", "!"):
+            self.index += 1
+            return ("not", self.parse_not())
+        if token == "(":
+            self.index += 1
+            node = self.parse_or()
+            if self.next("')'") != ")":
+                raise FilterError("expected ')'")
+            return node
+        return self.parse_primitive()
+
+    def parse_primitive(self):
+        word = self.next("a primitive").lower()
+        if word == "type":
+            name = self.next("frame type").lower()
+            if name not in FRAME_TYPES:
+                raise FilterError("unknown frame type '%s'" % name)
+            return ("type", FRAME_TYPES[name])
+        if word == "subtype":
+            word = self.next("frame class").lower()
+            if word not in FRAME_CLASSES:
+                raise FilterError("unknown frame class '%s'" % word)
+        if word in FRAME_CLASSES:
+            return ("class", FRAME_CLASSES[word])
+        if word in FLAGS:
+            return ("flag", FLAGS[word])
+        if word == "ht":
+            return ("ht",)
+        if word in ADDRESS_OFFSETS:
+            return ("addr", ADDRESS_OFFSETS[word]) + parse_mac(self.next("MAC address"))
+        if word in META_FIELDS:
+            op = self.next("comparison")
+            if op not in COMPARISONS:
+                raise FilterError("expected comparison after %s, got '%s'" % (word, op))
+            value = self.next("number")
+            try:
+                value = int(value, 0)
+            except ValueError:
+                raise FilterError("expected number, got '%s'" % value)
+            return ("meta", word, "==" if op == "=" else op, value)
+        raise FilterError("unknown primitive '%s'" % word)
+
+
+def parse_mac(text):
+    mac, _, bits = text.partition("/")
+    parts = mac.replace("-", ":").split(":")
+    try:
+        octets = bytes(int(part, 16) for part in parts)
+        bits = int(bits) if bits else 48
+    except ValueError:
+        raise FilterError("bad MAC address '%s'" % text)
+    if len(octets) != 6 or not 1 <= bits <= 48:
+        raise FilterError("bad MAC address '%s'" % text)
+    return octets, bits
+
+
+# ------------------------------------------------------------------
+# Code generation
+# ------------------------------------------------------------------
+
+class Compiler(object):
+    """
+    Every node is compiled as a test jumping to a true and a false
+    label. Labels are always placed after the code referring to them,
+    so all jumps go forward as the device requires.
+    """
+
+    def __init__(self):
+        self.code = []      # (op, jt label, jf label, k) and ("label", id)
+        self.labels = 0
+
+    def new_label(self):
+        self.labels += 1
+        return self.labels
+
+    def place(self, label):
+        self.code.append(("label", label))
+
+    def emit(self, op, k=0):
+        self.code.append((op, None, None, k))
+
+    def jump(self, op, k, true, false):
+        self.code.append((op, true, false, k & 0xFFFFFFFF))
+
+    def compile(self, node, snap):
+        true = self.new_label()
+        false = self.new_label()
+        if node[0] == "true":
+            self.emit(OP_RET, snap)
+            return self.assemble()
+        self.test(node, true, false)
+        self.place(true)
+        self.emit(OP_RET, snap)
+        self.place(false)
+        self.emit(OP_RET, 0)
+        return self.assemble()
+
+    def test(self, node, true, false):
+        kind = node[0]
+        if kind == "and":
+            middle = self.new_label()
+            self.test(node[1], middle, false)
+            self.place(middle)
+            self.test(node[2], true, false)
+        elif kind == "or":
+            middle = self.new_label()
+            self.test(node[1], true, middle)
+            self.place(middle)
+            self.test(node[2], true, false)
+        elif kind == "not":
+            self.test(node[1], false, true)
+        elif kind == "type":
+            self.emit(OP_LD_B, 0)
+            self.emit(OP_AND, 0x0C)
+            self.jump(OP_JEQ, node[1] << 2, true, false)
+        elif kind == "class":
+            frameType, subtype = divmod(node[1], 16)
+            self.emit(OP_LD_B, 0)
+            self.emit(OP_AND, 0xFC)
+            self.jump(OP_JEQ, (subtype << 4) | (frameType << 2), true, false)
+        elif kind == "flag":
+            self.emit(OP_LD_B, 1)
+            self.jump(OP_JSET, node[1], true, false)
+        elif kind == "ht":
+            self.emit(OP_LD_META, META_HT)
+            self.jump(OP_JSET, 1, true, false)
+        elif kind == "addr":
+            self.test_address(node[1], node[2], node[3], true, false)
+        elif kind == "meta":
+            self.test_meta(node[1], node[2], node[3], true, false)
+        else:
+            raise FilterError("can't compile %s" % kind)
+
+    def test_address(self, offset, mac, bits, true, false):
+        # First four octets as a word, last two as a half word
+        high = struct.unpack(">I", mac[:4])[0]
+        low = struct.unpack(">H", mac[4:])[0]
+        highBits = min(bits, 32)
+        lowBits = bits - highBits
+        highMask = (0xFFFFFFFF << (32 - highBits)) & 0xFFFFFFFF
+        self.emit(OP_LD_W, offset)
+        if highMask != 0xFFFFFFFF:
+            self.emit(OP_AND, highMask)
+        if lowBits == 0:
+            self.jump(OP_JEQ, high & highMask, true, false)
+            return
+        middle = self.new_label()
+        lowMask = (0xFFFF << (16 - lowBits)) & 0xFFFF
+        self.jump(OP_JEQ, high, middle, false)
+        self.place(middle)
+        self.emit(OP_LD_H, offset + 4)
+        if lowMask != 0xFFFF:
+            self.emit(OP_AND, lowMask)
+        self.jump(OP_JEQ, low & lowMask, true, false)
+
+    def test_meta(self, field, op, value, true, false):
+        signed = field in META_SIGNED
+        greater = OP_JSGT if signed else OP_JGT
+        greaterEqual = OP_JSGE if signed else OP_JGE
+        self.emit(OP_LD_META, META_FIELDS[field])
+        if op == "==":
+            self.jump(OP_JEQ, value, true, false)
+        elif op == "!=":
+            self.jump(OP_JEQ, value, false, true)
+        elif op == ">":
+            self.jump(greater, value, true, false)
+        elif op == ">=":
+            self.jump(greaterEqual, value, true, false)
+        elif op == "<":
+            self.jump(greaterEqual, value, false, true)
+        else:
+            self.jump(greater, value, false, true)
+
+    def assemble(self):
+        positions = {}
+        count = 0
+        for entry in self.code:
+            if entry[0] == "label":
+                positions[entry[1]] = count
+            else:
+                count += 1
+        if count > FILTER_MAX_INSNS:
+            raise FilterError("filter needs %d instructions, the device takes %d"
+                              % (count, FILTER_MAX_INSNS))
+
+        program = []
+        for entry in self.code:
+            if entry[0] == "label":
+                continue
+            op, true, false, k = entry
+            pc = len(program)
+            jt = positions[true] - pc - 1 if true is not None else 0
+            jf = positions[false] - pc - 1 if false is not None else 0
+            program.append((op, jt, jf, k))
+        return program
+
+
+def compile_filter(expression, snap=0xFFFF):
+    """
+    Compile a filter expression to a list of (op, jt, jf, k).
+    """
+    return Compiler().compile(Parser(expression).parse(), snap)
+
+
+def encode(program):
+    return b"".join(_INSN.pack(*insn) for insn in program)
+
+
+def disassemble(program):
+    lines = []
+    for pc, (op, jt, jf, k) in enumerate(program):
+        if op == OP_LD_META:
+            text = "ld     %s" % META_NAMES[k]
+        elif op in (OP_LD_B, OP_LD_H, OP_LD_W):
+            text = "%-6s [%d]" % (OP_NAMES[op], k)
+        elif op in JUMP_OPS:
+            value = k - (1 << 32) if op in (OP_JSGT, OP_JSGE) and k & 0x80000000 else k
+            text = "%-6s #0x%x%s, %d, %d" % (OP_NAMES[op], k, " (%d)" % value if value < 0 else "",
+                                           pc + 1 + jt, pc + 1 + jf)
+        elif op == OP_JA:
+            text = "ja     %d" % (pc + 1 + k)
+        else:
+            text = "%-6s #0x%x" % (OP_NAMES[op], k)
+        lines.append("(%03d) %s" % (pc, text))
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("expression", nargs="*", help="filter expression, empty records everything")
+    parser.add_argument("--snap", type=int, default=0xFFFF,
+                        help="bytes recorded per frame (default whole frame)")
+    parser.add_argument("--port", help="serial port of the sniffer to load the filter on")
+    parser.add_argument("--baud", type=int, default=921600, help="UART rate (default %(default)s)")
+    parser.add_argument("--reset", action="store_true", help="restore the device's default filter")
+    parser.add_argument("-d", "--disassemble", action="store_true",
+                        help="print the compiled program instead of the command")
+    args = parser.parse_args()
+
+    if args.reset:
+        command = "filter"
+    else:
+        if not 1 <= args.snap <= 0xFFFF:
+            sys.exit("--snap must be 1..65535")
+        try:
+            program = compile_filter(" ".join(args.expression), args.snap)
+        except FilterError as error:
+            sys.exit("filter: %s" % error)
+        if args.disassemble:
+            print(disassemble(program))
+            return
+        command = "filter " + encode(program).hex()
+
+    if not args.port:
+        print(command)
+        return
+
+    try:
+        import serial
+    except ImportError:
+        sys.exit("Writing to a serial port requires pyserial (pip install pyserial)")
+    port = serial.Serial(args.port, args.baud, timeout=0.1)
+    port.write((command + "\n").encode("ascii"))
+    port.flush()
+    sys.stderr.write("sent, the device confirms in its log\n")
+
+
+if __name__ == "__main__":
+    main()
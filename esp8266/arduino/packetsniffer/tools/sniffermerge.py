@@ -0,0 +1,438 @@
+#!/usr/bin/env python3
+"""
+@file    sniffermerge.py
+@brief   Merge the binary streams of several packet sniffers, e.g. one
+         per channel, into one capture and one set of statistics.
+
+         Read from the devices:
+           sniffermerge.py --port /dev/ttyUSB0 --port /dev/ttyUSB1 -o capture.pcap
+         Merge recorded streams:
+           sniffermerge.py --input ch1.bin --input ch6.bin -o capture.pcap --stats stats.csv
+
+         Every stream is read and decoded by a thread of its own. Frames
+         are put on a common timeline and written in time order once
+         every stream has caught up; a port that goes quiet holds the
+         others back for at most --max-delay seconds.
+
+         Device timestamps count from power on and drift apart, so each
+         stream's offset to the first one is learnt from beacons and
+         probe responses heard by both: they carry the AP's TSF, which
+         makes them the same transmission wherever they are heard. Until
+         a stream shares one, its frames are placed by when they arrived
+         (ports) or by the start of the file (recordings).
+
+         Frames with a sequence number heard by more than one device
+         within DEDUP_WINDOW_US are written once, as first heard. Control
+         frames have nothing to tell transmissions apart and are all
+         written.
+
+         The statistics records of all devices go to --stats as CSV, one
+         row per device and interval on the common timeline. Every
+         --interval seconds a table of what each device contributed to
+         the merged capture is printed, device log messages go to
+         stderr.
+
+@author  Simon Lövgren
+@license MIT
+"""
+
+import argparse
+import collections
+import csv
+import heapq
+import itertools
+import queue
+import sys
+import threading
+import time
+
+import snifferstats
+import snifferstream
+
+
+# Frames with the same start heard by two devices this close together
+# (after alignment) are one transmission
+DEDUP_WINDOW_US = 500000
+
+# Bytes of a frame compared to find duplicates: the MAC header with
+# sequence number, and the TSF of a beacon or probe response
+DEDUP_KEY_LEN = 32
+
+# Beacons and probe responses remembered to align clocks with
+SYNC_BEACONS = 65536
+
+# Share of the remaining clock error corrected per shared beacon once a
+# stream is aligned, follows drift without jumping on jitter
+SYNC_GAIN = 0.125
+
+# Larger errors of an aligned stream are taken for a beacon that only
+# looks the same (e.g. a replayed or spoofed one) and ignored
+SYNC_MAX_ERROR_US = 100000
+
+# Frame control byte 0 of the frames that carry a TSF
+SYNC_FRAME_TYPES = (0x80, 0x50)
+
+# Bytes per read, and decoded batches a recording may run ahead by
+READ_LEN = 16384
+FILE_QUEUE_BATCHES = 64
+
+# Half the range of the 32 bit device clock (micros())
+CLOCK_HALF_RANGE = 1 << 31
+
+
+class Source(object):
+    """One sniffer stream, read and decoded by a thread of its own."""
+
+    def __init__(self, index, name, stream, live):
+        self.index = index
+        self.name = name
+        self.live = live
+        self._stream = stream
+
+        # Ports are drained as fast as they deliver, a recording waits
+        # for the merge to catch up
+        self.queue = queue.Queue(0 if live else FILE_QUEUE_BATCHES)
+        self.decoder = snifferstream.StreamDecoder()
+        self.bytes = 0
+        self.done = False
+
+        # Device time to common time: aligned = unwrapped + offset (us)
+        self.offset = None
+        self.synced = index == 0
+        self.syncs = 0
+        self.lastUnwrapped = None
+        self.watermark = None       # Newest frame, aligned
+        self.lastArrival = None     # Host time it arrived
+
+        self.stats = None           # Interval being received
+        self.frames = 0
+        self.duplicates = 0
+        self.channels = collections.Counter()
+
+        self._thread = threading.Thread(target=self._read, name=name)
+        self._thread.daemon = True
+
+    def start(self):
+        self._thread.start()
+
+    def unwrap(self, timestamp):
+        """64 bit device time closest to the last one seen."""
+        if self.lastUnwrapped is None:
+            unwrapped = timestamp
+        else:
+            delta = (timestamp - self.lastUnwrapped) & 0xFFFFFFFF
+            if delta >= CLOCK_HALF_RANGE:
+                delta -= 1 << 32
+            unwrapped = self.lastUnwrapped + delta
+        self.lastUnwrapped = unwrapped
+        return unwrapped
+
+    def align(self, unwrapped, arrival, origin):
+        """Common time of a device time, first call sets the offset."""
+        if self.offset is None:
+            if self.live:
+                self.offset = int((arrival - origin) * 1e6) - unwrapped
+            else:
+                self.offset = -unwrapped
+        return unwrapped + self.offset
+
+    def _read(self):
+        try:
+            while True:
+                data = self._stream.read(READ_LEN)
+                if not data:
+                    if self.live:
+                        continue
+                    break
+                self.bytes += len(data)
+                records = self.decoder.feed(data)
+                if records:
+                    self.queue.put((time.time(), records))
+        finally:
+            self.queue.put(None)
+
+
+class Merger(object):
+    """Puts the frames of all sources in order, once."""
+
+    def __init__(self, sources, writer, statsWriter, interval, maxDelay, out):
+        self.sources = sources
+        self.origin = time.time()
+        self._writer = writer
+        self._statsWriter = statsWriter
+        self._interval = int(interval * 1e6)
+        self._maxDelay = int(maxDelay * 1e6)
+        self._out = out
+
+        self._heap = []
+        self._order = itertools.count()
+        self._beacons = collections.OrderedDict()
+        self._recent = {}
+        self._expiry = collections.deque()
+
+        self.written = 0
+        self.duplicates = 0
+        self._reportEnd = None
+        self._reportCount = 0
+        self._lastLost = [0] * len(sources)
+        self._lastDropped = [0] * len(sources)
+
+    def add(self, source, arrival, records):
+        for record in records:
+            if isinstance(record, snifferstream.FrameRecord):
+                self._add_frame(source, arrival, record)
+            elif isinstance(record, snifferstream.StatsRecord):
+                self._add_stats(source, arrival, record)
+            elif isinstance(record, snifferstream.TextRecord):
+                sys.stderr.write("[%s] %s\n" % (source.name, record.text.strip()))
+
+    def finish(self, source):
+        source.done = True
+        if source.stats is not None:
+            self._write_stats(source, source.stats)
+            source.stats = None
+
+    def emit(self, final=False):
+        """Write the frames no source can come up with anything older than."""
+        if final:
+            limit = None
+        else:
+            now = int((time.time() - self.origin) * 1e6)
+            limit = min(self._source_limit(source, now) for source in self.sources)
+        heap = self._heap
+        while heap and (limit is None or heap[0][0] <= limit):
+            aligned, _, index, record = heapq.heappop(heap)
+            self._write_frame(aligned, self.sources[index], record)
+        if final:
+            self._report(None)
+
+    def _source_limit(self, source, now):
+        if source.done:
+            return float("inf")
+        if source.live:
+            # Quiet port: time passes all the same, up to --max-delay
+            # behind the host
+            if source.watermark is None:
+                return now - self._maxDelay
+            return max(source.watermark + int((time.time() - source.lastArrival) * 1e6) - self._maxDelay,
+                       now - self._maxDelay)
+        if source.watermark is None:
+            return float("-inf")
+        return source.watermark
+
+    def _add_frame(self, source, arrival, record):
+        unwrapped = source.unwrap(record.timestamp)
+        source.align(unwrapped, arrival, self.origin)
+        data = record.data
+        if len(data) >= DEDUP_KEY_LEN and data[0] in SYNC_FRAME_TYPES:
+            self._sync(source, unwrapped, (record.length, bytes(data[:DEDUP_KEY_LEN])))
+        aligned = unwrapped + source.offset
+        heapq.heappush(self._heap, (aligned, next(self._order), source.index, record))
+        source.watermark = aligned
+        source.lastArrival = arrival
+
+    def _sync(self, source, unwrapped, key):
+        entry = self._beacons.get(key)
+        if entry is None:
+            self._beacons[key] = (source, unwrapped)
+            if len(self._beacons) > SYNC_BEACONS:
+                self._beacons.popitem(last=False)
+            return
+        if not entry:
+            return
+        other, otherUnwrapped = entry
+        if other is source:
+            # A TSF doesn't repeat, whatever sends this can't be trusted
+            self._beacons[key] = ()
+            return
+
+        # Both heard it at the same moment. An unaligned stream snaps to
+        # an aligned one, of two aligned ones the later follows.
+        if source.synced and (not other.synced or other.index > source.index):
+            follower, leader = other, source
+            followerUnwrapped, leaderUnwrapped = otherUnwrapped, unwrapped
+        elif other.synced and source.index != 0:
+            follower, leader = source, other
+            followerUnwrapped, leaderUnwrapped = unwrapped, otherUnwrapped
+        else:
+            return
+        target = leaderUnwrapped + leader.offset - followerUnwrapped
+        if follower.synced:
+            if abs(target - follower.offset) > SYNC_MAX_ERROR_US:
+                return
+            follower.offset += int((target - follower.offset) * SYNC_GAIN)
+        else:
+            follower.offset = target
+            follower.synced = True
+        follower.syncs += 1
+
+    def _write_frame(self, aligned, source, record):
+        if self._reportEnd is None:
+            self._reportEnd = aligned + self._interval
+        while aligned >= self._reportEnd:
+            self._report(self._reportEnd)
+            self._reportEnd += self._interval
+
+        # Control frames (type 1) have no sequence number
+        data = record.data
+        if len(data) >= 24 and data[0] & 0x0C != 0x04:
+            expiry = self._expiry
+            recent = self._recent
+            while expiry and expiry[0][0] < aligned - DEDUP_WINDOW_US:
+                heardAt, oldKey = expiry.popleft()
+                if recent.get(oldKey, (None,))[0] == heardAt:
+                    del recent[oldKey]
+
+            key = (record.length, bytes(data[:DEDUP_KEY_LEN]))
+            heard = recent.get(key)
+            if heard is not None and heard[1] != source.index and aligned - heard[0] <= DEDUP_WINDOW_US:
+                source.duplicates += 1
+                self.duplicates += 1
+                return
+            recent[key] = (aligned, source.index)
+            expiry.append((aligned, key))
+
+        source.frames += 1
+        source.channels[record.channel] += 1
+        self.written += 1
+        if self._writer is not None:
+            self._writer.write(record, self.origin + aligned / 1e6)
+
+    def _add_stats(self, source, arrival, record):
+        # An interval may be spread over several records
+        if source.stats is not None and source.stats.interval == record.interval:
+            source.stats.add(record)
+            return
+        if source.stats is not None:
+            self._write_stats(source, source.stats)
+        source.stats = snifferstream.StatsInterval(record)
+        source.stats.aligned = source.align(source.unwrap((record.uptimeMs * 1000) & 0xFFFFFFFF),
+                                            arrival, self.origin)
+        if source.watermark is None or source.stats.aligned > source.watermark:
+            source.watermark = source.stats.aligned
+            source.lastArrival = arrival
+
+    def _write_stats(self, source, stats):
+        if self._statsWriter is None:
+            return
+        row = ["%.3f" % (stats.aligned / 1e6), source.name]
+        row += ["" if value is None else value for value in (get(stats) for _, get in snifferstats.CSV_COLUMNS)]
+        self._statsWriter.writerow(row)
+
+    def _report(self, end):
+        # What every device added to the merged capture since the last
+        # report
+        self._reportCount += 1
+        out = self._out
+        if end is None:
+            out.write("\n#%d  end\n" % self._reportCount)
+        else:
+            out.write("\n#%d  until %.1f s\n" % (self._reportCount, end / 1e6))
+        out.write("DEVICE               CHANNELS        FRAMES    DUPLICATES  LOST   DROPPED  OFFSET\n")
+        frames = 0
+        duplicates = 0
+        for i, source in enumerate(self.sources):
+            decoder = source.decoder
+            channels = ",".join("%d" % channel for channel, _ in source.channels.most_common(3))
+            out.write("%-20s %-15s %-9d %-11d %-6d %-8d %s\n"
+                      % (source.name[-20:], channels or "-", source.frames, source.duplicates,
+                         decoder.lost - self._lastLost[i], decoder.deviceDropped - self._lastDropped[i],
+                         "%+.3f s%s" % (source.offset / 1e6, "" if source.synced else " (unaligned)")
+                         if source.offset is not None else "-"))
+            frames += source.frames
+            duplicates += source.duplicates
+            self._lastLost[i] = decoder.lost
+            self._lastDropped[i] = decoder.deviceDropped
+            source.frames = 0
+            source.duplicates = 0
+            source.channels.clear()
+        out.write("MERGED                               %-9d %d\n" % (frames, duplicates))
+        out.flush()
+
+
+def open_stream(path, live, baud):
+    if live:
+        try:
+            import serial
+        except ImportError:
+            sys.exit("Reading from a serial port requires pyserial (pip install pyserial)")
+        return serial.Serial(path, baud, timeout=0.1)
+    return open(path, "rb")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--port", action="append", default=[], help="serial port of a sniffer, repeat for more")
+    parser.add_argument("--input", action="append", default=[], help="recorded stream file, repeat for more")
+    parser.add_argument("--baud", type=int, default=921600, help="UART rate (default %(default)s)")
+    parser.add_argument("-o", "--output", help="merged pcap file to write")
+    parser.add_argument("--stats", help="CSV file for the statistics of all devices")
+    parser.add_argument("--interval", type=float, default=10.0,
+                        help="seconds between merge reports (default %(default)s)")
+    parser.add_argument("--max-delay", type=float, default=2.0,
+                        help="seconds a quiet port may hold back the others (default %(default)s)")
+    args = parser.parse_args()
+    if not args.port and not args.input:
+        parser.error("at least one --port or --input is required")
+
+    sources = []
+    for path in args.port:
+        sources.append(Source(len(sources), path, open_stream(path, True, args.baud), True))
+    for path in args.input:
+        sources.append(Source(len(sources), path, open_stream(path, False, args.baud), False))
+
+    output = open(args.output, "wb") if args.output else None
+    statsFile = open(args.stats, "w", newline="") if args.stats else None
+    statsWriter = None
+    if statsFile is not None:
+        statsWriter = csv.writer(statsFile)
+        statsWriter.writerow(["time_s", "device"] + [name for name, _ in snifferstats.CSV_COLUMNS])
+    writer = snifferstream.PcapWriter(output) if output else None
+    merger = Merger(sources, writer, statsWriter, args.interval, args.max_delay, sys.stdout)
+
+    start = time.time()
+    for source in sources:
+        source.start()
+    try:
+        # Take from the stream furthest behind, that's the one holding
+        # the merge back
+        pending = [source for source in sources]
+        while pending:
+            source = min(pending, key=lambda s: float("-inf") if s.watermark is None else s.watermark)
+            try:
+                batch = source.queue.get(timeout=0.1 if source.live else None)
+            except queue.Empty:
+                merger.emit()
+                continue
+            if batch is None:
+                merger.finish(source)
+                pending.remove(source)
+            else:
+                merger.add(source, batch[0], batch[1])
+            merger.emit()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        merger.emit(final=True)
+        if output is not None:
+            output.close()
+        if statsFile is not None:
+            statsFile.close()
+
+    seconds = max(time.time() - start, 1e-6)
+    total = sum(source.bytes for source in sources)
+    records = sum(source.decoder.records for source in sources)
+    sys.stderr.write("%d frames written, %d duplicates dropped; %d records lost in transit, %d corrupt, "
+                     "%d frames dropped on devices\n"
+                     % (merger.written, merger.duplicates,
+                        sum(source.decoder.lost for source in sources),
+                        sum(source.decoder.corrupt for source in sources),
+                        sum(source.decoder.deviceDropped for source in sources)))
+    sys.stderr.write("%d streams, %.1f MB in %.2f s: %.0f records/s, %.2f MB/s, as much as %.1f devices "
+                     "at %d baud\n"
+                     % (len(sources), total / 1e6, seconds, records / seconds, total / seconds / 1e6,
+                        total / seconds / (args.baud / 10.0), args.baud))
+
+
+if __name__ == "__main__":
+    main()
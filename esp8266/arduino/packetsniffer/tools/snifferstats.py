@@ -0,0 +1,337 @@
+#!/usr/bin/env python3
+"""
+@file    snifferstats.py
+@brief   Turn the packet sniffer's binary statistics records back into
+         tables or CSV.
+
+         Read from the device:
+           snifferstats.py --port /dev/ttyUSB0
+         Convert a recorded stream to CSV:
+           snifferstats.py --input stream.bin --format csv > stats.csv
+         Name the vendors of listed stations from the IEEE OUI list,
+         shortened as on the device (tools/ouitable.py):
+           snifferstats.py --input stream.bin --oui oui.csv
+
+         An interval is printed once the first record of the next one
+         arrives, as it may be spread over several records. Device log
+         messages go to stderr, frame records are ignored.
+
+@author  Simon Lövgren
+@license MIT
+"""
+
+import argparse
+import csv
+import sys
+
+import ouitable
+import snifferstream
+
+
+CSV_COLUMNS = (
+    ("interval", lambda s: s.interval),
+    ("uptime_ms", lambda s: s.uptimeMs),
+    ("interval_ms", lambda s: s.intervalMs),
+    ("packets", lambda s: s.get("summary", "packets")),
+    ("no_header", lambda s: s.get("summary", "noHeader")),
+    ("mpdus", lambda s: s.get("summary", "mpdus")),
+    ("aggregates", lambda s: s.get("summary", "aggregates")),
+    ("retry", lambda s: s.get("summary", "retry")),
+    ("duplicates", lambda s: s.get("summary", "duplicates")),
+    ("protected", lambda s: s.get("summary", "protected")),
+    ("more_fragments", lambda s: s.get("summary", "moreFragments")),
+    ("deauths", lambda s: s.tables["classes"][snifferstream.FRAME_CLASS_DEAUTH]),
+    ("total_packets", lambda s: s.get("summary", "totalPackets")),
+    ("devices", lambda s: s.get("devices", "interval")),
+    ("devices_total", lambda s: s.get("devices", "total")),
+    ("rssi_mean", lambda s: rssi_mean(s)),
+    ("rssi_p10", lambda s: s.get("signal", "p10")),
+    ("rssi_p50", lambda s: s.get("signal", "p50")),
+    ("rssi_p90", lambda s: s.get("signal", "p90")),
+    ("ht", lambda s: s.get("signal", "ht")),
+    ("airtime_us", lambda s: s.get("airtime", "airtimeUs")),
+    ("airtime_busy_permille", lambda s: s.get("airtime", "busy")),
+    ("stations_active", lambda s: s.get("stations", "active")),
+    ("deauth_alarms", lambda s: s.get("deauth", "alarms")),
+    ("deauth_floods", lambda s: len(s.sections["deauthFlood"])),
+    ("beacon_new_pairs", lambda s: s.get("beacons", "newPairs")),
+    ("beacon_alarms", lambda s: beacon_alarms(s)),
+    ("probes", lambda s: s.get("probes", "probes")),
+    ("probe_devices", lambda s: s.get("probers", "devices")),
+    ("probe_addresses", lambda s: s.get("probers", "addresses")),
+    ("ring_dropped", lambda s: s.get("ring", "dropped")),
+    ("filter_accepted", lambda s: s.get("filter", "accepted")),
+    ("aps_active", lambda s: s.get("aps", "active")),
+    ("ap_changes", lambda s: len(s.sections["apChange"])),
+    ("callback_mean_ns", lambda s: s.get("timing", "meanNs")),
+    ("callback_p99_ns", lambda s: s.get("timing", "p99Ns")),
+    ("callback_max_ns", lambda s: s.get("timing", "maxNs")),
+    ("callback_gap_p50_ns", lambda s: s.get("timing", "gapP50Ns")),
+    ("flash_log_records", lambda s: s.get("flashLog", "records")),
+    ("flash_log_stored_bytes", lambda s: s.get("flashLog", "storedBytes")),
+    ("sections_dropped", lambda s: s.get("summary", "droppedSections")),
+)
+
+
+def rssi_mean(stats):
+    frames = stats.get("signal", "frames", 0)
+    if not frames:
+        return None
+    return stats.get("signal", "rssiSum") // frames
+
+
+def retry_percent(entry):
+    # Older devices don't send retries
+    if not entry["frames"]:
+        return 0
+    return entry.get("retries", 0) * 100 // entry["frames"]
+
+
+def beacon_alarms(stats):
+    beacons = stats.sections.get("beacons")
+    if not beacons:
+        return None
+    return beacons["floods"] + beacons["security"] + beacons["channel"] + beacons["bssid"]
+
+
+def format_ap(change):
+    ssid = change["ssid"].decode("utf-8", "replace")
+    if not ssid:
+        ssid = "<hidden>"
+    elif change["flags"] & snifferstream.AP_FLAG_HIDDEN:
+        ssid += " (hidden)"
+    if change["change"] == 3:
+        return ssid
+    fields = [name for bit, name in enumerate(snifferstream.AP_FIELD_NAMES)
+              if change["fields"] & (1 << bit)]
+    return "%-32s  ch %-2d  %-24s  %d TU  %d dBm%s" % (
+        ssid, change["channel"],
+        snifferstream.format_security(change["security"], change["flags"]),
+        change["beaconInterval"], change["rssi"],
+        "  (%s)" % ",".join(fields) if fields else "")
+
+
+def open_source(args):
+    if args.port:
+        try:
+            import serial
+        except ImportError:
+            sys.exit("Reading from a serial port requires pyserial (pip install pyserial)")
+        return serial.Serial(args.port, args.baud, timeout=0.1)
+    if args.input == "-":
+        return sys.stdin.buffer
+    return open(args.input, "rb")
+
+
+def read_records(source, decoder, live):
+    while True:
+        data = source.read(4096)
+        if not data:
+            if live:
+                continue
+            return
+        for record in decoder.feed(data):
+            if isinstance(record, snifferstream.StatsRecord):
+                yield record
+            elif isinstance(record, snifferstream.TextRecord):
+                sys.stderr.write("[device] %s\n" % record.text.strip())
+
+
+def print_table(stats, out, vendors=None):
+    summary = stats.sections.get("summary", {})
+    devices = stats.sections.get("devices", {})
+    classes = stats.tables["classes"]
+    totals = stats.tables["classTotals"]
+    deauth = snifferstream.FRAME_CLASS_DEAUTH
+
+    out.write("\n#%d  uptime %.1f s, interval %d ms\n"
+              % (stats.interval, stats.uptimeMs / 1000.0, stats.intervalMs))
+    out.write("           SEEN    MAX     MIN     TOTAL\n")
+    out.write("           --------------------------------------\n")
+    out.write("PACKETS    %-4s    %-4s    %-4s    %s\n"
+              % (summary.get("packets"), summary.get("maxPackets"),
+                 summary.get("minPackets"), summary.get("totalPackets")))
+    if "mpdus" in summary:
+        out.write("MPDUS      %-4s                    %s\n"
+                  % (summary["mpdus"], summary["totalMpdus"]))
+    out.write("DEAUTHS    %-4s    %-4s    %-4s    %s\n"
+              % (classes[deauth], summary.get("maxDeauths"),
+                 summary.get("minDeauths"), totals[deauth]))
+    out.write("DEVICES    %-4s    %-4s    %-4s    ~%s\n"
+              % (devices.get("interval"), devices.get("max"),
+                 devices.get("min"), devices.get("total")))
+
+    airtimeClasses = stats.tables["airtimeClasses"]
+    out.write("\nFRAME CLASS    SEEN      AIRTIME   TOTAL\n")
+    for frameClass, total in enumerate(totals):
+        if total:
+            out.write("%-14s %-8d  %-8d  %d\n"
+                      % (snifferstream.FRAME_CLASS_NAMES[frameClass], classes[frameClass],
+                         airtimeClasses[frameClass], total))
+    out.write("%-14s %s\n" % ("(RETRY)", summary.get("retry")))
+    out.write("%-14s %-8s            %s\n"
+              % ("(A-MPDU)", summary.get("aggregates"), summary.get("totalAggregates", "")))
+    out.write("%-14s %-8s            %s\n"
+              % ("(DUPLICATE)", summary.get("duplicates"), summary.get("totalDuplicates", "")))
+    if summary.get("droppedSections"):
+        out.write("SECTIONS   %d dropped, too long\n" % summary["droppedSections"])
+
+    signal = stats.sections.get("signal")
+    if signal and signal.get("frames"):
+        out.write("\nSIGNAL     mean %d dBm, p10 %d, p50 %d, p90 %d, HT %d%%\n"
+                  % (rssi_mean(stats), signal["p10"], signal["p50"], signal["p90"],
+                     signal["ht"] * 100 // signal["frames"]))
+        rates = ["%gM:%d" % (snifferstream.LEGACY_RATE_500K[code] / 2.0, count)
+                 for code, count in enumerate(stats.tables["rates"]) if count]
+        mcs = ["%d:%d" % (index, count) for index, count in enumerate(stats.tables["mcs"]) if count]
+        out.write("RATE       %s\n" % " ".join(rates))
+        out.write("MCS        %s\n" % " ".join(mcs))
+
+    airtime = stats.sections.get("airtime")
+    if airtime:
+        out.write("AIRTIME    %d us in %d ms, busy %.1f%%, %d frames of unknown rate\n"
+                  % (airtime["airtimeUs"], stats.intervalMs, airtime["busy"] / 10.0,
+                     airtime["unknown"]))
+
+    if stats.sections["channel"]:
+        out.write("\nCHANNEL    FRAMES    UNIQUE    RETRY  DWELL     RATE      NEXT      DEVICES   BUSY\n")
+        for channel in stats.sections["channel"]:
+            out.write("%-2d%-9s%-8d  %-8d  %-3d%%   %-6dms  %-5d/s   %-6dms  %-8d  %.1f%%\n"
+                      % (channel["channel"], " *" if channel["current"] else "",
+                         channel["frames"], channel["frames"] - channel.get("duplicates", 0),
+                         retry_percent(channel), channel["dwellMs"], channel["rate"],
+                         channel["nextDwellMs"], channel["devices"],
+                         channel.get("busy", 0) / 10.0))
+
+    stations = stats.sections.get("stations")
+    if stations:
+        out.write("\nSTATIONS   active %d, slots %d, new %d, expired %d, evicted %d\n"
+                  % (stations["active"], stations["used"], stations["inserted"],
+                     stations["expired"], stations["evicted"]))
+        for station in stats.sections["station"]:
+            vendor = vendors.get(ouitable.prefix_of(station["mac"]), "") if vendors else ""
+            out.write(("%s    %-8d  %-8d  %-3d%%   %-10d  %-8dms  %-4d   %-7dms  %s" % (
+                station["mac"], station["frames"],
+                station["frames"] - station.get("duplicates", 0),
+                retry_percent(station), station["bytes"],
+                station.get("airtimeUs", 0) // 1000, station["rssi"],
+                station["ageMs"], vendor)).rstrip() + "\n")
+
+    deauthStats = stats.sections.get("deauth")
+    if deauthStats:
+        out.write("\nDEAUTH     floods %d, alarms %d, spread floods %d, frames %d, tuples replaced %d\n"
+                  % (len(stats.sections["deauthFlood"]), deauthStats["alarms"],
+                     deauthStats.get("floods", 0), deauthStats["frames"], deauthStats["replaced"]))
+        for flood in stats.sections["deauthFlood"]:
+            out.write("%s -> %s (BSSID %s)  %d in window, %d total\n"
+                      % (flood["source"], flood["target"], flood["bssid"],
+                         flood["windowFrames"], flood["totalFrames"]))
+
+    beacons = stats.sections.get("beacons")
+    if beacons:
+        out.write("\nBEACONS    %d (%d hidden), SSIDs %d, new pairs %d, SSIDs replaced %d\n"
+                  % (beacons["beacons"], beacons["hidden"], beacons["ssids"],
+                     beacons["newPairs"], beacons["replaced"]))
+        out.write("           alarms: floods %d, security %d, channel %d, BSSID %d, dropped %d\n"
+                  % (beacons["floods"], beacons["security"], beacons["channel"],
+                     beacons["bssid"], beacons["dropped"]))
+
+    probers = stats.sections.get("probers")
+    if probers:
+        out.write("\nPROBERS    ~%d devices (%d randomised) using %d addresses since first heard (%d random), "
+                  "%d fingerprints\n"
+                  % (probers["devices"], probers["randomised"], probers["addresses"],
+                     probers["localAddresses"], probers["fingerprints"]))
+        out.write("           linked %d (%d by sequence, %d undone), partial %d, malformed %d, "
+                  "evicted %d, replaced %d\n"
+                  % (probers["linked"], probers["bySequence"], probers["undone"], probers["partial"],
+                     probers["malformed"], probers["evicted"], probers["replaced"]))
+
+    probes = stats.sections.get("probes")
+    if probes:
+        out.write("\nPROBES     total %d, wildcard %d, truncated %d, malformed %d\n"
+                  % (probes["probes"], probes["wildcard"], probes["truncated"],
+                     probes["malformed"]))
+        for ssid in stats.sections["probeSsid"]:
+            name = ssid["ssid"].decode("utf-8", "replace") + ("~" if ssid["truncated"] else "")
+            out.write("%-32s  %-8d  %-8d  %s\n"
+                      % (name, ssid["probes"], ssid["stations"], ssid["lastStation"]))
+
+    aps = stats.sections.get("aps")
+    if aps:
+        out.write("\nAPS        active %d, new %d, updated %d, expired %d, evicted %d\n"
+                  % (aps["active"], aps["inserted"], aps["updated"], aps["expired"],
+                     aps["evicted"]))
+        for change in stats.sections["apChange"]:
+            out.write("%-8s %s  %s\n" % (snifferstream.AP_CHANGE_NAMES.get(change["change"], "?"),
+                                        change["bssid"], format_ap(change)))
+
+    ring = stats.sections.get("ring")
+    if ring:
+        out.write("\nRING       pushed %d, dropped %d, high-water %d\n"
+                  % (ring["pushed"], ring["dropped"], ring["highWater"]))
+
+    timing = stats.sections.get("timing")
+    if timing:
+        out.write("TIMING     %d calls, mean %d ns, p50 %d, p99 %d, max %d; between calls p50 %d ns, p99 %d\n"
+                  % (timing["calls"], timing["meanNs"], timing["p50Ns"], timing["p99Ns"],
+                     timing["maxNs"], timing["gapP50Ns"], timing["gapP99Ns"]))
+        latency = ["<%dns:%d" % ((1 << bucket) * 1000 // timing["ticksPerUs"], count)
+                   for bucket, count in enumerate(stats.tables["latency"]) if count]
+        out.write("LATENCY    %s\n" % " ".join(latency))
+
+    flash_log = stats.sections.get("flashLog")
+    if flash_log:
+        out.write("FLASH LOG  %d records (dropped %d), %d blocks at %d%% of raw size, "
+                  "sector %d (%d in log, %d erases max), errors %d\n"
+                  % (flash_log["records"], flash_log["dropped"], flash_log["blocks"],
+                     flash_log["storedBytes"] * 100 // max(flash_log["rawBytes"], 1),
+                     flash_log["sequence"], flash_log["sectors"], flash_log["maxErases"],
+                     flash_log["errors"]))
+
+    capture = stats.sections.get("filter")
+    if capture:
+        out.write("FILTER     %d instructions, accepted %d of %d (total), loaded %d\n"
+                  % (capture["insns"], capture["accepted"], capture["evaluated"],
+                     capture["loaded"]))
+    out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="serial port of the sniffer")
+    source.add_argument("--input", help="recorded stream file, - for stdin")
+    parser.add_argument("--baud", type=int, default=921600, help="UART rate (default %(default)s)")
+    parser.add_argument("--format", choices=("table", "csv"), default="table",
+                        help="output format (default %(default)s)")
+    parser.add_argument("--oui", metavar="FILE",
+                        help="IEEE OUI list (oui.csv or oui.txt) to name station vendors")
+    args = parser.parse_args()
+
+    vendors = ouitable.vendor_names(ouitable.read_ieee(args.oui)) if args.oui else None
+
+    source = open_source(args)
+    decoder = snifferstream.StreamDecoder()
+    writer = None
+    if args.format == "csv":
+        writer = csv.writer(sys.stdout)
+        writer.writerow([name for name, _ in CSV_COLUMNS])
+
+    try:
+        for stats in snifferstream.join_intervals(read_records(source, decoder, args.port is not None)):
+            if writer is not None:
+                writer.writerow(["" if value is None else value
+                                 for value in (get(stats) for _, get in CSV_COLUMNS)])
+                sys.stdout.flush()
+            else:
+                print_table(stats, sys.stdout, vendors)
+    except KeyboardInterrupt:
+        pass
+
+    sys.stderr.write("%d records, %d lost in transit, %d corrupt\n"
+                     % (decoder.records, decoder.lost, decoder.corrupt))
+
+
+if __name__ == "__main__":
+    main()
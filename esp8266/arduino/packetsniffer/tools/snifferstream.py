@@ -0,0 +1,513 @@
+"""
+@file    snifferstream.py
+@brief   Host side decoder for the packet sniffer's binary output
+         stream (OUTPUT_MODE=OUTPUT_BINARY or OUTPUT_STATS), see
+         src/StreamOut and src/StatsRecord.
+
+@author  Simon Lövgren
+@license MIT
+"""
+
+import itertools
+import struct
+import time
+
+# ------------------------------------------------------------------
+# Stream format, keep in sync with src/StreamOut/IStreamOut.h
+# ------------------------------------------------------------------
+
+STREAM_VERSION = 1
+
+RECORD_FRAME = 1
+RECORD_TEXT = 2
+RECORD_STATS = 3
+
+FRAME_FLAG_HT = 0x01
+FRAME_FLAG_40MHZ = 0x02
+FRAME_FLAG_SGI = 0x04
+FRAME_FLAG_AMPDU = 0x08
+FRAME_FLAG_GROUP = 0x10
+
+_HEADER = struct.Struct("<BBH")
+_FRAME_META = struct.Struct("<IHHbBBBBB")
+
+# Frame class names, keep in sync with src/FrameClass/FrameClass.cpp
+FRAME_CLASS_NAMES = (
+    "ASSOC_REQ", "ASSOC_RSP", "REASSOC_REQ", "REASSOC_RSP",
+    "PROBE_REQ", "PROBE_RSP", "MGMT_RSV6", "MGMT_RSV7",
+    "BEACON", "ATIM", "DISASSOC", "AUTH",
+    "DEAUTH", "ACTION", "MGMT_RSV14", "MGMT_RSV15",
+    "CTRL_RSV0", "CTRL_RSV1", "CTRL_RSV2", "CTRL_RSV3",
+    "CTRL_RSV4", "CTRL_RSV5", "CTRL_RSV6", "CTRL_WRAP",
+    "BAR", "BA", "PS_POLL", "RTS",
+    "CTS", "ACK", "CF_END", "CF_END_ACK",
+    "DATA", "DATA_ACK", "DATA_POLL", "DATA_ACK_POLL",
+    "NULL", "CF_ACK", "CF_POLL", "CF_ACK_POLL",
+    "QOS_DATA", "QOS_ACK", "QOS_POLL", "QOS_ACK_POLL",
+    "QOS_NULL", "DATA_RSV13", "QOS_POLL_ND", "QOS_ACK_ND",
+) + tuple("RSV_%d" % i for i in range(16)) + ("INVALID",)
+
+FRAME_CLASS_DEAUTH = 12
+
+# rx_ctrl.rate encoding to 500 kbps units (0 = unknown)
+LEGACY_RATE_500K = (2, 4, 11, 22, 0, 4, 11, 22, 96, 48, 24, 12, 108, 72, 36, 18)
+
+# pcap link type for radiotap + 802.11
+LINKTYPE_IEEE802_11_RADIOTAP = 127
+
+
+# ------------------------------------------------------------------
+# Framing
+# ------------------------------------------------------------------
+
+def cobs_decode(data):
+    """Decode one COBS block (without the 0x00 delimiter)."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("bad COBS code")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def fletcher16(data):
+    # Same as reducing modulo 255 after every byte, without a Python
+    # level loop: sum2 is the sum of all running sums
+    sum1 = sum(data) % 255
+    sum2 = sum(itertools.accumulate(data)) % 255
+    return (sum2 << 8) | sum1
+
+
+class FrameRecord(object):
+    """Captured frame as sent by the device."""
+
+    __slots__ = ("sequence", "timestamp", "length", "dropped", "rssi",
+                 "channel", "rate", "mcs", "flags", "data")
+
+    def __init__(self, sequence, payload):
+        (self.timestamp, self.length, self.dropped, self.rssi, self.channel,
+         self.rate, self.mcs, self.flags, _) = _FRAME_META.unpack_from(payload)
+        self.sequence = sequence
+        self.data = payload[_FRAME_META.size:]
+
+
+class TextRecord(object):
+    """Log message from the device."""
+
+    __slots__ = ("sequence", "text")
+
+    def __init__(self, sequence, payload):
+        self.sequence = sequence
+        self.text = payload.decode("utf-8", "replace")
+
+
+class UnknownRecord(object):
+    """Record of a type this decoder doesn't know about."""
+
+    __slots__ = ("sequence", "type", "payload")
+
+    def __init__(self, sequence, recordType, payload):
+        self.sequence = sequence
+        self.type = recordType
+        self.payload = payload
+
+
+# ------------------------------------------------------------------
+# Statistics records, keep in sync with src/StatsRecord/IStatsRecord.h
+# ------------------------------------------------------------------
+
+STATS_VERSION = 1
+
+# Field types: u = unsigned varint, s = zigzag varint, mac = 6 bytes,
+# str = varint length + bytes
+STATS_SECTIONS = {
+    1: ("summary", (("packets", "u"), ("noHeader", "u"), ("retry", "u"),
+                    ("protected", "u"), ("moreFragments", "u"), ("maxPackets", "u"),
+                    ("minPackets", "u"), ("maxDeauths", "u"), ("minDeauths", "u"),
+                    ("totalPackets", "u"), ("totalNoHeader", "u"), ("duplicates", "u"),
+                    ("totalDuplicates", "u"), ("mpdus", "u"), ("aggregates", "u"),
+                    ("totalMpdus", "u"), ("totalAggregates", "u"), ("droppedSections", "u"))),
+    3: ("devices", (("interval", "u"), ("max", "u"), ("min", "u"), ("total", "u"))),
+    4: ("channel", (("channel", "u"), ("current", "u"), ("frames", "u"), ("dwellMs", "u"),
+                    ("visits", "u"), ("rate", "u"), ("nextDwellMs", "u"), ("devices", "u"),
+                    ("airtimeUs", "u"), ("busy", "u"), ("retries", "u"), ("duplicates", "u"))),
+    5: ("signal", (("frames", "u"), ("ht", "u"), ("wide", "u"), ("shortGi", "u"),
+                   ("rssiSum", "s"), ("p10", "s"), ("p50", "s"), ("p90", "s"))),
+    6: ("stations", (("active", "u"), ("used", "u"), ("inserted", "u"), ("expired", "u"),
+                     ("evicted", "u"))),
+    7: ("station", (("mac", "mac"), ("frames", "u"), ("bytes", "u"), ("rssi", "s"),
+                    ("ageMs", "u"), ("airtimeUs", "u"), ("retries", "u"), ("duplicates", "u"))),
+    8: ("deauth", (("frames", "u"), ("alarms", "u"), ("replaced", "u"), ("floods", "u"))),
+    9: ("deauthFlood", (("source", "mac"), ("bssid", "mac"), ("target", "mac"),
+                        ("windowFrames", "u"), ("totalFrames", "u"))),
+    10: ("probes", (("probes", "u"), ("wildcard", "u"), ("truncated", "u"),
+                    ("malformed", "u"))),
+    11: ("probeSsid", (("ssid", "str"), ("truncated", "u"), ("probes", "u"),
+                       ("stations", "u"), ("lastStation", "mac"))),
+    12: ("ring", (("pushed", "u"), ("dropped", "u"), ("highWater", "u"))),
+    13: ("filter", (("evaluated", "u"), ("accepted", "u"), ("loaded", "u"), ("insns", "u"))),
+    14: ("aps", (("frames", "u"), ("malformed", "u"), ("active", "u"), ("inserted", "u"),
+                 ("updated", "u"), ("expired", "u"), ("evicted", "u"))),
+    15: ("apChange", (("change", "u"), ("fields", "u"), ("bssid", "mac"), ("ssid", "str"),
+                      ("channel", "u"), ("security", "u"), ("flags", "u"), ("beaconInterval", "u"),
+                      ("rssi", "s"), ("ageMs", "u"))),
+    16: ("timing", (("calls", "u"), ("ticksPerUs", "u"), ("meanNs", "u"), ("p50Ns", "u"),
+                    ("p99Ns", "u"), ("maxNs", "u"), ("gapP50Ns", "u"), ("gapP99Ns", "u"))),
+    17: ("flashLog", (("records", "u"), ("dropped", "u"), ("blocks", "u"), ("rawBytes", "u"),
+                      ("storedBytes", "u"), ("erases", "u"), ("errors", "u"), ("sequence", "u"),
+                      ("sectors", "u"), ("maxErases", "u"))),
+    18: ("airtime", (("frames", "u"), ("unknown", "u"), ("airtimeUs", "u"), ("busy", "u"))),
+    19: ("beacons", (("beacons", "u"), ("hidden", "u"), ("ssids", "u"), ("newPairs", "u"),
+                     ("replaced", "u"), ("floods", "u"), ("security", "u"), ("channel", "u"),
+                     ("bssid", "u"), ("dropped", "u"))),
+    20: ("probers", (("devices", "u"), ("randomised", "u"), ("addresses", "u"),
+                     ("localAddresses", "u"), ("fingerprints", "u"), ("probes", "u"),
+                     ("partial", "u"), ("malformed", "u"), ("linked", "u"), ("bySequence", "u"),
+                     ("undone", "u"), ("evicted", "u"), ("replaced", "u"))),
+}
+
+# Counter arrays sent in run sections (id 2)
+STATS_SECTION_RUN = 2
+STATS_TABLES = {
+    1: ("classes", 65),
+    2: ("classTotals", 65),
+    3: ("rssi", 128),
+    4: ("rates", 16),
+    5: ("mcs", 17),
+    6: ("latency", 32),
+    7: ("gaps", 32),
+    8: ("airtimeClasses", 66),
+}
+
+# Sections that appear once per listed item
+STATS_LISTS = ("channel", "station", "deauthFlood", "probeSsid", "apChange")
+
+# Access point changes, keep in sync with src/ApInventory/IApInventory.h
+AP_CHANGE_NAMES = {1: "NEW", 2: "UPDATED", 3: "GONE"}
+AP_FIELD_NAMES = ("ssid", "channel", "security", "interval", "flags")
+AP_SECURITY_PRIVACY = 0x01
+AP_SECURITY_WPA = 0x02
+AP_SECURITY_RSN = 0x04
+AP_SECURITY_PSK = 0x08
+AP_SECURITY_EAP = 0x10
+AP_SECURITY_SAE = 0x20
+AP_SECURITY_TKIP = 0x40
+AP_SECURITY_CCMP = 0x80
+AP_FLAG_HIDDEN = 0x01
+AP_FLAG_IBSS = 0x02
+AP_FLAG_SECURITY_KNOWN = 0x04
+
+
+def format_security(security, flags):
+    """Same as formatSecurity() in src/main.cpp."""
+    if not security & (AP_SECURITY_WPA | AP_SECURITY_RSN):
+        if not security & AP_SECURITY_PRIVACY:
+            return "open"
+        return "WEP" if flags & AP_FLAG_SECURITY_KNOWN else "encrypted"
+    protocols = []
+    if security & AP_SECURITY_WPA:
+        protocols.append("WPA")
+    if security & AP_SECURITY_RSN:
+        if not security & AP_SECURITY_SAE:
+            protocols.append("WPA2")
+        elif security & AP_SECURITY_PSK:
+            protocols.append("WPA2/WPA3")
+        else:
+            protocols.append("WPA3")
+    akms = [name for bit, name in ((AP_SECURITY_PSK, "PSK"), (AP_SECURITY_SAE, "SAE"),
+                                   (AP_SECURITY_EAP, "EAP")) if security & bit]
+    ciphers = [name for bit, name in ((AP_SECURITY_TKIP, "TKIP"), (AP_SECURITY_CCMP, "CCMP"))
+               if security & bit]
+    text = "/".join(protocols)
+    if akms:
+        text += "-" + "+".join(akms)
+    if ciphers:
+        text += " " + "+".join(ciphers)
+    return text
+
+
+def read_varint(data, offset):
+    value = 0
+    shift = 0
+    while True:
+        if offset >= len(data):
+            raise ValueError("truncated varint")
+        byte = data[offset]
+        offset += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            return value, offset
+
+
+def format_mac(mac):
+    return ":".join("%02X" % b for b in mac)
+
+
+def _parse_fields(data, fields):
+    values = {}
+    offset = 0
+    for name, kind in fields:
+        if offset >= len(data):
+            break                   # Older device, field not sent
+        if kind == "u":
+            values[name], offset = read_varint(data, offset)
+        elif kind == "s":
+            raw, offset = read_varint(data, offset)
+            values[name] = (raw >> 1) ^ -(raw & 1)
+        elif kind == "mac":
+            values[name] = format_mac(data[offset:offset + 6])
+            offset += 6
+        elif kind == "str":
+            length, offset = read_varint(data, offset)
+            values[name] = bytes(data[offset:offset + length])
+            offset += length
+    return values
+
+
+class StatsRecord(object):
+    """
+    One statistics record. An interval may be split over several
+    records with the same interval number, see StatsInterval.
+    """
+
+    __slots__ = ("sequence", "interval", "uptimeMs", "intervalMs", "sections")
+
+    def __init__(self, sequence, payload):
+        if payload[0] != STATS_VERSION:
+            raise ValueError("unsupported stats version %d" % payload[0])
+        self.sequence = sequence
+        self.interval, offset = read_varint(payload, 1)
+        self.uptimeMs, offset = read_varint(payload, offset)
+        self.intervalMs, offset = read_varint(payload, offset)
+        self.sections = []
+        while offset < len(payload):
+            sectionId = payload[offset]
+            length, offset = read_varint(payload, offset + 1)
+            if offset + length > len(payload):
+                raise ValueError("truncated section")
+            self.sections.append((sectionId, payload[offset:offset + length]))
+            offset += length
+
+
+class StatsInterval(object):
+    """
+    Decoded statistics of one interval. Single sections are dicts
+    (summary, devices, signal, ...), repeated ones lists of dicts
+    (see STATS_LISTS) and counter tables lists of counts.
+    """
+
+    def __init__(self, record):
+        self.interval = record.interval
+        self.uptimeMs = record.uptimeMs
+        self.intervalMs = record.intervalMs
+        self.sections = {}
+        self.tables = {}
+        for name in STATS_LISTS:
+            self.sections[name] = []
+        for name, size in STATS_TABLES.values():
+            self.tables[name] = [0] * size
+        self.add(record)
+
+    def add(self, record):
+        for sectionId, data in record.sections:
+            if sectionId == STATS_SECTION_RUN:
+                self._add_run(data)
+                continue
+            known = STATS_SECTIONS.get(sectionId)
+            if known is None:
+                continue
+            name, fields = known
+            values = _parse_fields(data, fields)
+            if name in STATS_LISTS:
+                self.sections[name].append(values)
+            else:
+                self.sections[name] = values
+
+    def get(self, section, field, default=None):
+        return self.sections.get(section, {}).get(field, default)
+
+    def _add_run(self, data):
+        table, offset = read_varint(data, 0)
+        first, offset = read_varint(data, offset)
+        known = STATS_TABLES.get(table)
+        if known is None:
+            return
+        counts = self.tables[known[0]]
+        index = first
+        while offset < len(data) and index < len(counts):
+            counts[index], offset = read_varint(data, offset)
+            index += 1
+
+
+def join_intervals(records):
+    """
+    Group consecutive StatsRecords of the same interval. Yields
+    StatsInterval objects.
+    """
+    current = None
+    for record in records:
+        if current is not None and record.interval == current.interval:
+            current.add(record)
+            continue
+        if current is not None:
+            yield current
+        current = StatsInterval(record)
+    if current is not None:
+        yield current
+
+
+RECORD_TYPES = {
+    RECORD_FRAME: FrameRecord,
+    RECORD_TEXT: TextRecord,
+    RECORD_STATS: StatsRecord,
+}
+
+
+class StreamDecoder(object):
+    """
+    Incremental decoder. Feed raw bytes as they arrive from the UART
+    and iterate over the returned records. Keeps count of corrupt
+    records, records lost in transit (sequence gaps) and frames the
+    device reports as dropped before they were sent.
+    """
+
+    def __init__(self):
+        self._pending = bytearray()
+        self._nextSequence = None
+        self.records = 0
+        self.corrupt = 0
+        self.lost = 0
+        self.deviceDropped = 0
+
+    def feed(self, data):
+        records = []
+        self._pending += data
+        while True:
+            end = self._pending.find(b"\x00")
+            if end < 0:
+                break
+            block = bytes(self._pending[:end])
+            del self._pending[:end + 1]
+            if not block:
+                continue
+            record = self._parse(block)
+            if record is not None:
+                records.append(record)
+        return records
+
+    def _parse(self, block):
+        try:
+            raw = cobs_decode(block)
+        except ValueError:
+            self.corrupt += 1
+            return None
+        if len(raw) < _HEADER.size + 2 or raw[0] != STREAM_VERSION:
+            self.corrupt += 1
+            return None
+        body, checksum = raw[:-2], struct.unpack_from("<H", raw, len(raw) - 2)[0]
+        if fletcher16(body) != checksum:
+            self.corrupt += 1
+            return None
+
+        _, recordType, sequence = _HEADER.unpack_from(body)
+        if self._nextSequence is not None:
+            self.lost += (sequence - self._nextSequence) & 0xFFFF
+        self._nextSequence = (sequence + 1) & 0xFFFF
+        self.records += 1
+
+        payload = body[_HEADER.size:]
+        cls = RECORD_TYPES.get(recordType)
+        if cls is None:
+            return UnknownRecord(sequence, recordType, payload)
+        try:
+            record = cls(sequence, payload)
+        except (struct.error, ValueError):
+            self.corrupt += 1
+            return None
+        if isinstance(record, FrameRecord):
+            self.deviceDropped += record.dropped
+        return record
+
+
+# ------------------------------------------------------------------
+# pcap output
+# ------------------------------------------------------------------
+
+def channel_frequency(channel):
+    if channel == 14:
+        return 2484
+    return 2407 + 5 * channel
+
+
+def radiotap_header(record):
+    """Build a radiotap header from the rx_ctrl fields of a frame."""
+    present = (1 << 1) | (1 << 3) | (1 << 5)    # Flags, channel, antenna signal
+    fields = bytearray()
+
+    # Flags: frames are captured without FCS
+    fields += struct.pack("<B", 0x00)
+
+    ht = bool(record.flags & FRAME_FLAG_HT)
+    rate = 0 if ht else LEGACY_RATE_500K[record.rate & 0x0F]
+    if rate:
+        present |= 1 << 2
+        fields += struct.pack("<B", rate)
+
+    # Channel is 2 byte aligned, radiotap header itself is 8 bytes
+    if (8 + len(fields)) % 2:
+        fields += b"\x00"
+    cck = not ht and (record.rate & 0x0F) < 8
+    channelFlags = 0x0080 | (0x0020 if cck else 0x0040)
+    fields += struct.pack("<HH", channel_frequency(record.channel), channelFlags)
+    fields += struct.pack("<b", record.rssi)
+
+    if ht:
+        present |= 1 << 19
+        known = 0x01 | 0x02 | 0x04              # Bandwidth, MCS, guard interval
+        flags = 0
+        if record.flags & FRAME_FLAG_40MHZ:
+            flags |= 0x01
+        if record.flags & FRAME_FLAG_SGI:
+            flags |= 0x04
+        fields += struct.pack("<BBB", known, flags, record.mcs)
+
+    return struct.pack("<BBHI", 0, 0, 8 + len(fields), present) + bytes(fields)
+
+
+class PcapWriter(object):
+    """Writes frame records as a radiotap pcap file."""
+
+    def __init__(self, stream):
+        self._stream = stream
+        self._stream.write(struct.pack("<IHHiIII", 0xA1B2C3D4, 2, 4, 0, 0, 65535,
+                                       LINKTYPE_IEEE802_11_RADIOTAP))
+        self._baseTime = None
+        self._lastTimestamp = None
+        self._wraps = 0
+
+    def write(self, record, seconds=None):
+        # Device timestamp is micros(), wraps every ~71 minutes. Anchor
+        # it to host time at the first frame, unless the caller has
+        # placed the frame in time already.
+        if seconds is None:
+            if self._baseTime is None:
+                self._baseTime = time.time() - record.timestamp / 1e6
+            elif record.timestamp < self._lastTimestamp:
+                self._wraps += 1
+            self._lastTimestamp = record.timestamp
+            micros = (self._wraps << 32) + record.timestamp
+            seconds = self._baseTime + micros / 1e6
+
+        header = radiotap_header(record)
+        captured = len(header) + len(record.data)
+        original = len(header) + max(len(record.data), record.length)
+        self._stream.write(struct.pack("<IIII", int(seconds), int((seconds % 1) * 1e6),
+                                       captured, original))
+        self._stream.write(header)
+        self._stream.write(record.data)